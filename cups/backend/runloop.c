@@ -22,6 +22,10 @@
 #include "backend-private.h"
 #include <limits.h>
 #include <sys/select.h>
+#ifdef HAVE_SPLICE
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#endif /* HAVE_SPLICE */
 
 
 /*
@@ -153,6 +157,10 @@ backendRunLoop(
   char		print_buffer[8192],	/* Print data buffer */
 		*print_ptr,		/* Pointer into print data buffer */
 		bc_buffer[1024];	/* Back-channel data buffer */
+#ifdef HAVE_SPLICE
+  int		use_splice = 0;		/* Splice print data to the device? */
+  struct stat	fileinfo;		/* Print file information */
+#endif /* HAVE_SPLICE */
   struct timeval timeout;		/* Timeout for select() */
   time_t	curtime,		/* Current time */
 		snmp_update = 0;
@@ -202,6 +210,16 @@ backendRunLoop(
 
   nfds = (print_fd > device_fd ? print_fd : device_fd) + 1;
 
+#ifdef HAVE_SPLICE
+ /*
+  * Print data coming from a filter pipe can be moved straight to the device
+  * without copying it through print_buffer...
+  */
+
+  if (!fstat(print_fd, &fileinfo) && S_ISFIFO(fileinfo.st_mode))
+    use_splice = 1;
+#endif /* HAVE_SPLICE */
+
  /*
   * Now loop until we are out of data from print_fd...
   */
@@ -294,6 +312,44 @@ backendRunLoop(
         use_bc = 0;
     }
 
+#ifdef HAVE_SPLICE
+   /*
+    * Splice print data from the pipe to the device; if the device does not
+    * support splice() go back to reading and writing the data ourselves...
+    */
+
+    if (use_splice && FD_ISSET(print_fd, &input))
+    {
+      if ((bytes = splice(print_fd, NULL, device_fd, NULL,
+                          8 * sizeof(print_buffer),
+			  SPLICE_F_MOVE | SPLICE_F_MORE)) == 0)
+      {
+       /*
+        * End of file, break out of the loop...
+	*/
+
+        break;
+      }
+      else if (bytes > 0)
+      {
+        fprintf(stderr, "DEBUG: Spliced %d bytes of print data...\n",
+	        (int)bytes);
+
+	total_bytes += bytes;
+
+	FD_CLR(print_fd, &input);
+      }
+      else if (errno == EAGAIN || errno == EINTR)
+        FD_CLR(print_fd, &input);
+      else
+      {
+        fprintf(stderr, "DEBUG: Unable to splice print data: %s\n",
+	        strerror(errno));
+        use_splice = 0;
+      }
+    }
+#endif /* HAVE_SPLICE */
+
    /*
     * Check if we have print data ready...
     */
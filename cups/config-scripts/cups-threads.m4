@@ -47,6 +47,15 @@ if test "x$enable_threads" != xno; then
 	fi
 fi
 
+dnl Check for compiler atomic builtins used by the string pool...
+AC_MSG_CHECKING([for atomic builtins])
+AC_TRY_LINK([],
+	[int v = 0; __atomic_add_fetch(&v, 1, __ATOMIC_SEQ_CST);
+	 return (__atomic_load_n(&v, __ATOMIC_ACQUIRE) != 1);],
+	AC_DEFINE(HAVE_ATOMIC_BUILTINS)
+	AC_MSG_RESULT([yes]),
+	AC_MSG_RESULT([no]))
+
 AC_SUBST(PTHREAD_FLAGS)
 
 dnl
@@ -0,0 +1,84 @@
+/*
+ * "$Id$"
+ *
+ *   Private page accounting file definitions for CUPS.
+ *
+ *   Copyright 2014 by Apple Inc.
+ *
+ *   These coded instructions, statements, and computer programs are the
+ *   property of Apple Inc. and are protected by Federal copyright
+ *   law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ *   which should have been included with this file.  If this file is
+ *   file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ *   This file is subject to the Apple OS-Developed Software exception.
+ */
+
+#ifndef _CUPS_ACCOUNTING_PRIVATE_H_
+#  define _CUPS_ACCOUNTING_PRIVATE_H_
+
+/*
+ * The scheduler writes page accounting records to the AccountingDir
+ * directory.  There is one "printer.page" file per printer and a shared
+ * "strings" file:
+ *
+ * - Each file starts with a 16-byte header: an 8-byte magic string, the
+ *   format version, and the record size (32-bit big-endian integers).
+ *
+ * - The "strings" file holds NUL-terminated strings.  Strings are referenced
+ *   by their byte offset in the file; offset 0 means "no value".
+ *
+ * - Each "printer.page" file holds fixed-size records in time order, so the
+ *   records for a printer and date range are found with a binary search
+ *   instead of reading the whole history.  All values are big-endian.
+ *
+ * Both kinds of files are only ever appended to.
+ */
+
+#  define _CUPS_ACCT_MAGIC	"CUPSACCT"
+					/* Magic string for page files */
+#  define _CUPS_ACCT_STRMAGIC	"CUPSSTRS"
+					/* Magic string for the string table */
+#  define _CUPS_ACCT_VERSION	1	/* Format version */
+#  define _CUPS_ACCT_HEADER	16	/* Size of file header */
+#  define _CUPS_ACCT_RECORD	48	/* Size of page record */
+
+#  define _CUPS_ACCT_STRINGS	"strings"
+					/* Name of string table file */
+#  define _CUPS_ACCT_SUFFIX	".page"	/* Suffix of page files */
+
+/*
+ * Offsets of the fields in a page record...
+ */
+
+#  define _CUPS_ACCT_TIME	0	/* 64-bit UNIX time */
+#  define _CUPS_ACCT_JOB_ID	8	/* job-id */
+#  define _CUPS_ACCT_PAGE	12	/* Page number or 0 for a total */
+#  define _CUPS_ACCT_COPIES	16	/* Number of copies or total pages */
+#  define _CUPS_ACCT_FLAGS	20	/* Record flags */
+#  define _CUPS_ACCT_PRINTER	24	/* String: printer name */
+#  define _CUPS_ACCT_USER	28	/* String: job-originating-user-name */
+#  define _CUPS_ACCT_TITLE	32	/* String: job-name */
+#  define _CUPS_ACCT_BILLING	36	/* String: job-billing */
+#  define _CUPS_ACCT_HOST	40	/* String: job-originating-host-name */
+#  define _CUPS_ACCT_MEDIA	44	/* String: media */
+
+#  define _CUPS_ACCT_FLAG_TOTAL	1	/* Copies is the total for the job */
+
+/*
+ * Macros to get and put 32-bit big-endian values...
+ */
+
+#  define _CUPS_ACCT_GET32(p)	((unsigned)(p)[0] << 24 | \
+				 (unsigned)(p)[1] << 16 | \
+				 (unsigned)(p)[2] << 8 | (unsigned)(p)[3])
+#  define _CUPS_ACCT_PUT32(p,v)	((p)[0] = (unsigned char)((v) >> 24), \
+				 (p)[1] = (unsigned char)((v) >> 16), \
+				 (p)[2] = (unsigned char)((v) >> 8), \
+				 (p)[3] = (unsigned char)(v))
+
+#endif /* !_CUPS_ACCOUNTING_PRIVATE_H_ */
+
+/*
+ * End of "$Id$".
+ */
@@ -33,12 +33,24 @@ extern "C" {
 #  endif /* __cplusplus */
 
 
+/*
+ * Array flags for _cupsArrayNew4...
+ */
+
+#  define _CUPS_ARRAY_FLAG_TREE	1	/* Store elements in a B-tree */
+
+
 /*
  * Functions...
  */
 
 extern int		_cupsArrayAddStrings(cups_array_t *a, const char *s,
 			                     char delim) _CUPS_API_1_5;
+extern cups_array_t	*_cupsArrayNew4(cups_array_func_t f, void *d,
+			                cups_ahash_func_t h, int hsize,
+					cups_acopy_func_t cf,
+					cups_afree_func_t ff, int flags)
+					_CUPS_API_2_0;
 extern cups_array_t	*_cupsArrayNewStrings(const char *s, char delim)
 			                      _CUPS_API_1_5;
 
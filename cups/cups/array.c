@@ -30,19 +30,39 @@
  */
 
 #define _CUPS_MAXSAVE	32		/**** Maximum number of saves ****/
+#define _CUPS_ANODE_MAX	64		/**** Maximum elements per B-tree node ****/
+#define _CUPS_ANODE_DEPTH 32		/**** Maximum depth of B-tree ****/
 
 
 /*
  * Types and structures...
  */
 
+typedef struct _cups_anode_s		/**** B-tree node ****/
+{
+  int			num,		/* Number of elements or children */
+			leaf;		/* 1 for leaf nodes, 0 for branches */
+  void			*elements[_CUPS_ANODE_MAX];
+					/* Elements or first element of each child */
+} _cups_anode_t;
+
+typedef struct _cups_abranch_s		/**** B-tree branch node ****/
+{
+  _cups_anode_t		node;		/* Common node data */
+  int			counts[_CUPS_ANODE_MAX];
+					/* Number of elements under each child */
+  _cups_anode_t		*children[_CUPS_ANODE_MAX];
+					/* Child nodes */
+} _cups_abranch_t;
+
 struct _cups_array_s			/**** CUPS array structure ****/
 {
  /*
   * The current implementation uses an insertion sort into an array of
-  * sorted pointers.  We leave the array type private/opaque so that we
-  * can change the underlying implementation without affecting the users
-  * of this API.
+  * sorted pointers, or optionally a B-tree whose branches track the number
+  * of elements under each child so that elements can still be accessed by
+  * index.  We leave the array type private/opaque so that we can change
+  * the underlying implementation without affecting the users of this API.
   */
 
   int			num_elements,	/* Number of array elements */
@@ -61,6 +81,10 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			*hash;		/* Hash array */
   cups_acopy_func_t	copyfunc;	/* Copy function */
   cups_afree_func_t	freefunc;	/* Free function */
+  int			tree;		/* Use B-tree storage? */
+  _cups_anode_t		*root,		/* Root node of B-tree */
+			*leaf;		/* Leaf node containing leaf_first */
+  int			leaf_first;	/* Index of first element in leaf */
 };
 
 
@@ -70,6 +94,13 @@ struct _cups_array_s			/**** CUPS array structure ****/
 
 static int	cups_array_add(cups_array_t *a, void *e, int insert);
 static int	cups_array_find(cups_array_t *a, void *e, int prev, int *rdiff);
+static void	*cups_array_get(cups_array_t *a, int n);
+static int	cups_array_tree_bound(cups_array_t *a, void *e, int upper);
+static void	cups_array_tree_free(cups_array_t *a, _cups_anode_t *node);
+static int	cups_array_tree_insert(cups_array_t *a, int n, void *e);
+static void	cups_array_tree_merge(_cups_abranch_t *b, int i);
+static void	*cups_array_tree_remove(cups_array_t *a, int n);
+static int	cups_array_tree_split(_cups_abranch_t *b, int i);
 
 
 /*
@@ -227,7 +258,14 @@ cupsArrayClear(cups_array_t *a)		/* I - Array */
   * Free the existing elements as needed..
   */
 
-  if (a->freefunc)
+  if (a->tree)
+  {
+    cups_array_tree_free(a, a->root);
+
+    a->root = NULL;
+    a->leaf = NULL;
+  }
+  else if (a->freefunc)
   {
     int		i;			/* Looping var */
     void	**e;			/* Current element */
@@ -297,7 +335,7 @@ cupsArrayCurrent(cups_array_t *a)	/* I - Array */
   */
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (cups_array_get(a, a->current));
   else
     return (NULL);
 }
@@ -327,7 +365,9 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   * responsible for doing the dirty work...)
   */
 
-  if (a->freefunc)
+  if (a->tree)
+    cups_array_tree_free(a, a->root);
+  else if (a->freefunc)
   {
     int		i;			/* Looping var */
     void	**e;			/* Current element */
@@ -383,10 +423,37 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
   da->insert    = a->insert;
   da->unique    = a->unique;
   da->num_saved = a->num_saved;
+  da->tree      = a->tree;
 
   memcpy(da->saved, a->saved, sizeof(a->saved));
 
-  if (a->num_elements)
+  if (a->tree)
+  {
+   /*
+    * Append each element to the new B-tree...
+    */
+
+    int		i;			/* Looping var */
+    void	*e;			/* Current element */
+
+    for (i = 0; i < a->num_elements; i ++)
+    {
+      e = cups_array_get(a, i);
+
+      if (a->copyfunc)
+        e = (a->copyfunc)(e, a->data);
+
+      if (!e || !cups_array_tree_insert(da, i, e))
+      {
+        cups_array_tree_free(da, da->root);
+	free(da);
+	return (NULL);
+      }
+
+      da->num_elements ++;
+    }
+  }
+  else if (a->num_elements)
   {
    /*
     * Allocate memory for the elements...
@@ -505,7 +572,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
       * The array is not unique, find the first match...
       */
 
-      while (current > 0 && !(*(a->compare))(e, a->elements[current - 1],
+      while (current > 0 && !(*(a->compare))(e, cups_array_get(a, current - 1),
                                              a->data))
         current --;
     }
@@ -515,7 +582,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
     if (hash >= 0)
       a->hash[hash] = current;
 
-    return (a->elements[current]);
+    return (cups_array_get(a, current));
   }
   else
   {
@@ -781,6 +848,34 @@ cupsArrayNew3(cups_array_func_t  f,	/* I - Comparison function or @code NULL@ fo
 }
 
 
+/*
+ * '_cupsArrayNew4()' - Create a new array with hash, free function, and flags.
+ *
+ * The arguments are the same as @link cupsArrayNew3@.  The flags ("flags")
+ * select the storage used for the elements - _CUPS_ARRAY_FLAG_TREE stores
+ * them in a B-tree so that adding and removing elements stays fast for
+ * arrays with many thousands of elements.
+ */
+
+cups_array_t *				/* O - Array */
+_cupsArrayNew4(cups_array_func_t  f,	/* I - Comparison function or @code NULL@ for an unsorted array */
+               void               *d,	/* I - User data or @code NULL@ */
+               cups_ahash_func_t  h,	/* I - Hash function or @code NULL@ for unhashed lookups */
+	       int                hsize,/* I - Hash size (>= 0) */
+	       cups_acopy_func_t  cf,	/* I - Copy function */
+	       cups_afree_func_t  ff,	/* I - Free function */
+	       int                flags)/* I - Array flags */
+{
+  cups_array_t	*a;			/* Array  */
+
+
+  if ((a = cupsArrayNew3(f, d, h, hsize, cf, ff)) != NULL)
+    a->tree = (flags & _CUPS_ARRAY_FLAG_TREE) != 0;
+
+  return (a);
+}
+
+
 /*
  * '_cupsArrayNewStrings()' - Create a new array of comma-delimited strings.
  *
@@ -914,14 +1009,26 @@ cupsArrayRemove(cups_array_t *a,	/* I - Array */
   * Yes, now remove it...
   */
 
-  a->num_elements --;
+  if (a->tree)
+  {
+    e = cups_array_tree_remove(a, (int)current);
 
-  if (a->freefunc)
-    (a->freefunc)(a->elements[current], a->data);
+    a->num_elements --;
 
-  if (current < a->num_elements)
-    memmove(a->elements + current, a->elements + current + 1,
-            (size_t)(a->num_elements - current) * sizeof(void *));
+    if (a->freefunc)
+      (a->freefunc)(e, a->data);
+  }
+  else
+  {
+    a->num_elements --;
+
+    if (a->freefunc)
+      (a->freefunc)(a->elements[current], a->data);
+
+    if (current < a->num_elements)
+      memmove(a->elements + current, a->elements + current + 1,
+              (size_t)(a->num_elements - current) * sizeof(void *));
+  }
 
   if (current <= a->current)
     a->current --;
@@ -961,7 +1068,7 @@ cupsArrayRestore(cups_array_t *a)	/* I - Array */
   a->current = a->saved[a->num_saved];
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (cups_array_get(a, a->current));
   else
     return (NULL);
 }
@@ -1029,6 +1136,65 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 
   DEBUG_printf(("7cups_array_add(a=%p, e=%p, insert=%d)", a, e, insert));
 
+  if (a->tree)
+  {
+   /*
+    * Find the insertion point at the beginning or end of any run of equal
+    * elements and add the element to the B-tree...
+    */
+
+    if (!a->compare)
+      current = insert ? 0 : a->num_elements;
+    else
+    {
+      current = cups_array_tree_bound(a, e, !insert);
+
+      if (insert && current < a->num_elements)
+        diff = (*(a->compare))(e, cups_array_get(a, current), a->data);
+      else if (!insert && current > 0)
+        diff = (*(a->compare))(e, cups_array_get(a, current - 1), a->data);
+      else
+        diff = 1;
+
+      if (!diff)
+        a->unique = 0;
+    }
+
+    if (a->copyfunc && (e = (a->copyfunc)(e, a->data)) == NULL)
+    {
+      DEBUG_puts("8cups_array_add: Copy function returned NULL, returning 0");
+      return (0);
+    }
+
+    if (!cups_array_tree_insert(a, current, e))
+    {
+      DEBUG_puts("9cups_array_add: allocation failed, returning 0");
+
+      if (a->freefunc && a->copyfunc)
+        (a->freefunc)(e, a->data);
+
+      return (0);
+    }
+
+    if (current < a->num_elements)
+    {
+      if (a->current >= current)
+        a->current ++;
+
+      for (i = 0; i < a->num_saved; i ++)
+        if (a->saved[i] >= current)
+	  a->saved[i] ++;
+    }
+
+    a->num_elements ++;
+    a->insert = current;
+
+    DEBUG_printf(("9cups_array_add: added element at index %d, returning 1",
+                  current));
+
+    return (1);
+  }
+
  /*
   * Verify we have room for the new element...
   */
@@ -1210,7 +1376,30 @@ cups_array_find(cups_array_t *a,	/* I - Array */
   DEBUG_printf(("7cups_array_find(a=%p, e=%p, prev=%d, rdiff=%p)", a, e, prev,
                 rdiff));
 
-  if (a->compare)
+  if (a->compare && a->tree)
+  {
+   /*
+    * Check the previous element, otherwise find the first element that is
+    * greater than or equal to this one in the B-tree...
+    */
+
+    DEBUG_puts("9cups_array_find: B-tree search");
+
+    if (prev >= 0 && prev < a->num_elements && a->unique &&
+        !(*(a->compare))(e, cups_array_get(a, prev), a->data))
+    {
+      current = prev;
+      diff    = 0;
+    }
+    else
+    {
+      if ((current = cups_array_tree_bound(a, e, 0)) >= a->num_elements)
+        current = a->num_elements - 1;
+
+      diff = (*(a->compare))(e, cups_array_get(a, current), a->data);
+    }
+  }
+  else if (a->compare)
   {
    /*
     * Do a binary search for the element...
@@ -1310,7 +1499,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
     diff = 1;
 
     for (current = 0; current < a->num_elements; current ++)
-      if (a->elements[current] == e)
+      if (cups_array_get(a, current) == e)
       {
         diff = 0;
         break;
@@ -1329,6 +1518,487 @@ cups_array_find(cups_array_t *a,	/* I - Array */
 }
 
 
+/*
+ * 'cups_array_get()' - Get the N-th element in the array.
+ *
+ * For B-tree arrays the leaf containing the element is cached so that
+ * iterating through the array only searches the tree once per leaf.
+ */
+
+static void *				/* O - Element */
+cups_array_get(cups_array_t *a,		/* I - Array */
+               int          n)		/* I - Index into array, starting at 0 */
+{
+  int			i;		/* Looping var */
+  _cups_anode_t		*node;		/* Current node */
+  _cups_abranch_t	*b;		/* Current branch */
+
+
+  if (!a->tree)
+    return (a->elements[n]);
+
+  if (!a->leaf || n < a->leaf_first || n >= a->leaf_first + a->leaf->num)
+  {
+   /*
+    * Find the leaf containing the element using the branch counts...
+    */
+
+    for (node = a->root, a->leaf_first = n; !node->leaf; node = b->children[i])
+    {
+      for (i = 0, b = (_cups_abranch_t *)node;
+           i < node->num - 1 && a->leaf_first >= b->counts[i];
+	   i ++)
+        a->leaf_first -= b->counts[i];
+    }
+
+    a->leaf       = node;
+    a->leaf_first = n - a->leaf_first;
+  }
+
+  return (a->leaf->elements[n - a->leaf_first]);
+}
+
+
+/*
+ * 'cups_array_tree_bound()' - Find the index of the first element greater
+ *                             than (upper) or greater than or equal to
+ *                             (lower) an element.
+ */
+
+static int				/* O - Index of element */
+cups_array_tree_bound(cups_array_t *a,	/* I - Array */
+                      void         *e,	/* I - Element */
+		      int          upper)
+					/* I - 1 = upper bound, 0 = lower bound */
+{
+  int			i,		/* Looping var */
+			left,		/* Left side of search */
+			right,		/* Right side of search */
+			current,	/* Current element */
+			diff,		/* Comparison with current element */
+			n = 0;		/* Index of element */
+  _cups_anode_t		*node;		/* Current node */
+  _cups_abranch_t	*b;		/* Current branch */
+
+
+  if ((node = a->root) == NULL)
+    return (0);
+
+  for (;;)
+  {
+   /*
+    * Count the elements or child keys that sort before the element...
+    */
+
+    for (left = 0, right = node->num; left < right;)
+    {
+      current = (left + right) / 2;
+      diff    = (*(a->compare))(e, node->elements[current], a->data);
+
+      if (diff > 0 || (upper && !diff))
+        left = current + 1;
+      else
+        right = current;
+    }
+
+    if (node->leaf)
+    {
+      a->leaf       = node;
+      a->leaf_first = n;
+
+      return (n + left);
+    }
+
+   /*
+    * Then descend into the last child that starts before the element...
+    */
+
+    b = (_cups_abranch_t *)node;
+
+    if (left > 0)
+      left --;
+
+    for (i = 0; i < left; i ++)
+      n += b->counts[i];
+
+    node = b->children[left];
+  }
+}
+
+
+/*
+ * 'cups_array_tree_free()' - Free a B-tree node and its children.
+ */
+
+static void
+cups_array_tree_free(
+    cups_array_t  *a,			/* I - Array */
+    _cups_anode_t *node)		/* I - Node or @code NULL@ */
+{
+  int			i;		/* Looping var */
+  _cups_abranch_t	*b;		/* Branch node */
+
+
+  if (!node)
+    return;
+
+  if (node->leaf)
+  {
+    if (a->freefunc)
+      for (i = 0; i < node->num; i ++)
+        (a->freefunc)(node->elements[i], a->data);
+  }
+  else
+  {
+    for (i = 0, b = (_cups_abranch_t *)node; i < node->num; i ++)
+      cups_array_tree_free(a, b->children[i]);
+  }
+
+  free(node);
+}
+
+
+/*
+ * 'cups_array_tree_insert()' - Insert an element into a B-tree at an index.
+ *
+ * Full nodes are split on the way down so that there is always room in the
+ * parent for the new sibling.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_array_tree_insert(cups_array_t *a,	/* I - Array */
+                       int          n,	/* I - Index for new element */
+		       void         *e)	/* I - Element to insert */
+{
+  int			i,		/* Looping var */
+			depth,		/* Depth of node */
+			indices[_CUPS_ANODE_DEPTH];
+					/* Child indices along path */
+  _cups_anode_t		*node;		/* Current node */
+  _cups_abranch_t	*b,		/* Current branch */
+			*path[_CUPS_ANODE_DEPTH];
+					/* Branches along path */
+
+
+  if (!a->root)
+  {
+    if ((a->root = calloc(1, sizeof(_cups_anode_t))) == NULL)
+      return (0);
+
+    a->root->leaf = 1;
+  }
+  else if (a->root->num == _CUPS_ANODE_MAX)
+  {
+   /*
+    * Grow the tree by adding a new root above the full one...
+    */
+
+    if ((b = calloc(1, sizeof(_cups_abranch_t))) == NULL)
+      return (0);
+
+    b->node.num         = 1;
+    b->node.elements[0] = a->root->elements[0];
+    b->counts[0]        = a->num_elements;
+    b->children[0]      = a->root;
+
+    a->root = &(b->node);
+  }
+
+  for (node = a->root, depth = 0; !node->leaf; node = b->children[i], depth ++)
+  {
+    for (i = 0, b = (_cups_abranch_t *)node;
+         i < node->num - 1 && n > b->counts[i];
+	 i ++)
+      n -= b->counts[i];
+
+    if (b->children[i]->num == _CUPS_ANODE_MAX)
+    {
+      if (!cups_array_tree_split(b, i))
+        return (0);
+
+      if (n > b->counts[i])
+      {
+        n -= b->counts[i];
+	i ++;
+      }
+    }
+
+    path[depth]    = b;
+    indices[depth] = i;
+  }
+
+ /*
+  * Insert the element in the leaf and then update the counts and keys of the
+  * branches above it...
+  */
+
+  if (n < node->num)
+    memmove(node->elements + n + 1, node->elements + n,
+            (size_t)(node->num - n) * sizeof(void *));
+
+  node->elements[n] = e;
+  node->num ++;
+
+  while (depth > 0)
+  {
+    depth --;
+    b = path[depth];
+    i = indices[depth];
+
+    b->counts[i] ++;
+    b->node.elements[i] = b->children[i]->elements[0];
+  }
+
+  a->leaf = NULL;
+
+  return (1);
+}
+
+
+/*
+ * 'cups_array_tree_merge()' - Merge two adjacent children of a branch.
+ */
+
+static void
+cups_array_tree_merge(
+    _cups_abranch_t *b,			/* I - Branch */
+    int             i)			/* I - Index of left child */
+{
+  _cups_anode_t		*left = b->children[i],
+					/* Left child */
+			*right = b->children[i + 1];
+					/* Right child */
+
+
+  memcpy(left->elements + left->num, right->elements,
+         (size_t)right->num * sizeof(void *));
+
+  if (!left->leaf)
+  {
+    _cups_abranch_t	*lb = (_cups_abranch_t *)left,
+					/* Left branch */
+			*rb = (_cups_abranch_t *)right;
+					/* Right branch */
+
+    memcpy(lb->counts + left->num, rb->counts,
+           (size_t)right->num * sizeof(int));
+    memcpy(lb->children + left->num, rb->children,
+           (size_t)right->num * sizeof(_cups_anode_t *));
+  }
+
+  left->num    += right->num;
+  b->counts[i] += b->counts[i + 1];
+
+  free(right);
+
+  b->node.num --;
+
+  if (i + 1 < b->node.num)
+  {
+    memmove(b->node.elements + i + 1, b->node.elements + i + 2,
+            (size_t)(b->node.num - i - 1) * sizeof(void *));
+    memmove(b->counts + i + 1, b->counts + i + 2,
+            (size_t)(b->node.num - i - 1) * sizeof(int));
+    memmove(b->children + i + 1, b->children + i + 2,
+            (size_t)(b->node.num - i - 1) * sizeof(_cups_anode_t *));
+  }
+}
+
+
+/*
+ * 'cups_array_tree_remove()' - Remove the element at an index from a B-tree.
+ *
+ * Nodes that become less than a quarter full are merged with a neighbor when
+ * the two fit in a single node, and empty nodes are freed.
+ */
+
+static void *				/* O - Removed element */
+cups_array_tree_remove(cups_array_t *a,	/* I - Array */
+                       int          n)	/* I - Index of element */
+{
+  int			i,		/* Looping var */
+			depth,		/* Depth of node */
+			indices[_CUPS_ANODE_DEPTH];
+					/* Child indices along path */
+  void			*e;		/* Removed element */
+  _cups_anode_t		*node,		/* Current node */
+			*child;		/* Child node */
+  _cups_abranch_t	*b,		/* Current branch */
+			*path[_CUPS_ANODE_DEPTH];
+					/* Branches along path */
+
+
+  for (node = a->root, depth = 0; !node->leaf; node = b->children[i], depth ++)
+  {
+    for (i = 0, b = (_cups_abranch_t *)node;
+         i < node->num - 1 && n >= b->counts[i];
+	 i ++)
+      n -= b->counts[i];
+
+    path[depth]    = b;
+    indices[depth] = i;
+  }
+
+  e = node->elements[n];
+
+  node->num --;
+
+  if (n < node->num)
+    memmove(node->elements + n, node->elements + n + 1,
+            (size_t)(node->num - n) * sizeof(void *));
+
+  while (depth > 0)
+  {
+    depth --;
+    b     = path[depth];
+    i     = indices[depth];
+    child = b->children[i];
+
+    b->counts[i] --;
+
+    if (!child->num)
+    {
+     /*
+      * Free the empty child...
+      */
+
+      free(child);
+
+      b->node.num --;
+
+      if (i < b->node.num)
+      {
+	memmove(b->node.elements + i, b->node.elements + i + 1,
+		(size_t)(b->node.num - i) * sizeof(void *));
+	memmove(b->counts + i, b->counts + i + 1,
+		(size_t)(b->node.num - i) * sizeof(int));
+	memmove(b->children + i, b->children + i + 1,
+		(size_t)(b->node.num - i) * sizeof(_cups_anode_t *));
+      }
+
+      continue;
+    }
+
+    if (child->num < _CUPS_ANODE_MAX / 4)
+    {
+     /*
+      * Merge a sparse child with a neighbor...
+      */
+
+      if (i + 1 < b->node.num &&
+          child->num + b->children[i + 1]->num <= _CUPS_ANODE_MAX)
+        cups_array_tree_merge(b, i);
+      else if (i > 0 &&
+               child->num + b->children[i - 1]->num <= _CUPS_ANODE_MAX)
+      {
+        cups_array_tree_merge(b, i - 1);
+	continue;
+      }
+    }
+
+    b->node.elements[i] = child->elements[0];
+  }
+
+ /*
+  * Remove any empty root or branch roots with a single child...
+  */
+
+  while (a->root && !a->root->leaf && a->root->num <= 1)
+  {
+    node    = a->root;
+    a->root = node->num ? ((_cups_abranch_t *)node)->children[0] : NULL;
+
+    free(node);
+  }
+
+  if (a->root && !a->root->num)
+  {
+    free(a->root);
+    a->root = NULL;
+  }
+
+  a->leaf = NULL;
+
+  return (e);
+}
+
+
+/*
+ * 'cups_array_tree_split()' - Split a full child of a branch in two.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_array_tree_split(
+    _cups_abranch_t *b,			/* I - Branch */
+    int             i)			/* I - Index of full child */
+{
+  int			j,		/* Looping var */
+			half = _CUPS_ANODE_MAX / 2,
+					/* Number of elements to keep */
+			count;		/* Elements in new node */
+  _cups_anode_t		*left = b->children[i],
+					/* Full child */
+			*right;		/* New sibling */
+
+
+  if (left->leaf)
+  {
+    if ((right = calloc(1, sizeof(_cups_anode_t))) == NULL)
+      return (0);
+
+    right->leaf = 1;
+    count       = _CUPS_ANODE_MAX - half;
+  }
+  else
+  {
+    _cups_abranch_t	*lb = (_cups_abranch_t *)left,
+					/* Full branch */
+			*rb;		/* New branch */
+
+    if ((rb = calloc(1, sizeof(_cups_abranch_t))) == NULL)
+      return (0);
+
+    memcpy(rb->counts, lb->counts + half,
+           (size_t)(_CUPS_ANODE_MAX - half) * sizeof(int));
+    memcpy(rb->children, lb->children + half,
+           (size_t)(_CUPS_ANODE_MAX - half) * sizeof(_cups_anode_t *));
+
+    for (j = 0, count = 0; j < _CUPS_ANODE_MAX - half; j ++)
+      count += rb->counts[j];
+
+    right = &(rb->node);
+  }
+
+  memcpy(right->elements, left->elements + half,
+         (size_t)(_CUPS_ANODE_MAX - half) * sizeof(void *));
+
+  right->num = _CUPS_ANODE_MAX - half;
+  left->num  = half;
+
+ /*
+  * Add the new sibling after the full child...
+  */
+
+  if (i + 1 < b->node.num)
+  {
+    memmove(b->node.elements + i + 2, b->node.elements + i + 1,
+            (size_t)(b->node.num - i - 1) * sizeof(void *));
+    memmove(b->counts + i + 2, b->counts + i + 1,
+            (size_t)(b->node.num - i - 1) * sizeof(int));
+    memmove(b->children + i + 2, b->children + i + 1,
+            (size_t)(b->node.num - i - 1) * sizeof(_cups_anode_t *));
+  }
+
+  b->node.elements[i + 1] = right->elements[0];
+  b->counts[i + 1]        = count;
+  b->counts[i]           -= count;
+  b->children[i + 1]      = right;
+  b->node.num ++;
+
+  return (1);
+}
+
+
 /*
  * End of "$Id: array.c 12078 2014-07-31 11:45:57Z msweet $".
  */
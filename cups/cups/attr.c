@@ -53,17 +53,22 @@ ppdFindAttr(ppd_file_t *ppd,		/* I - PPD file data */
     return (NULL);
 
  /*
-  * Search for a matching attribute...
+  * Search for a matching attribute, using the hash index if possible...
   */
 
-  memset(&key, 0, sizeof(key));
-  strlcpy(key.name, name, sizeof(key.name));
+  if (!_ppdIndexFindAttr(ppd, name, spec, &attr))
+  {
+    memset(&key, 0, sizeof(key));
+    strlcpy(key.name, name, sizeof(key.name));
+
+    attr = (ppd_attr_t *)cupsArrayFind(ppd->sorted_attrs, &key);
+  }
 
  /*
   * Return the first matching attribute, if any...
   */
 
-  if ((attr = (ppd_attr_t *)cupsArrayFind(ppd->sorted_attrs, &key)) != NULL)
+  if (attr)
   {
     if (spec)
     {
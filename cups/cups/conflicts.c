@@ -37,14 +37,100 @@ enum
   _PPD_ALL_CONSTRAINTS
 };
 
+enum
+{
+  _PPD_PAGE_PAGESIZE,			/* PageSize option */
+  _PPD_PAGE_PAGEREGION,			/* PageRegion option */
+  _PPD_PAGE_MEDIA,			/* media option */
+  _PPD_PAGE_MARKED,			/* Marked page size */
+  _PPD_FIRST_PAGESIZE,			/* AP_FIRSTPAGE_PageSize option */
+  _PPD_FIRST_PAGEREGION,		/* AP_FIRSTPAGE_PageRegion option */
+  _PPD_PAGE_MAX
+};
+
+#define _PPD_WORD_BITS	(int)(8 * sizeof(unsigned))
+					/* Bits in each bitset word */
+#define _PPD_BIT_CLEAR(bits,bit) \
+	(bits)[(bit) / _PPD_WORD_BITS] &= ~(1U << ((bit) % _PPD_WORD_BITS))
+#define _PPD_BIT_ISSET(bits,bit) \
+	((bits)[(bit) / _PPD_WORD_BITS] & (1U << ((bit) % _PPD_WORD_BITS)))
+#define _PPD_BIT_SET(bits,bit) \
+	(bits)[(bit) / _PPD_WORD_BITS] |= 1U << ((bit) % _PPD_WORD_BITS)
+#define _PPD_IS_OFF(value) \
+	(!_cups_strcasecmp((value), "None") || \
+	 !_cups_strcasecmp((value), "Off") || \
+	 !_cups_strcasecmp((value), "False"))
+					/* Bitset and "on" helpers */
+
+
+/*
+ * Local types...
+ *
+ * Constraints are compiled into bit masks when they are loaded.  Every choice
+ * of every option has a bit, and every option has an extra bit that is set
+ * when the option is "on" (not None, Off, or False).  A constraint is active
+ * when all of its bits are set in the current selection, so testing a
+ * constraint is a handful of word-wide AND operations instead of option
+ * lookups and string comparisons.
+ */
+
+typedef struct _ppd_uiindex_s		/**** Constraint bit index ****/
+{
+  ppd_group_t	*groups;		/* Top-level groups */
+  int		num_groups,		/* Number of top-level groups */
+		num_words,		/* Number of words in a selection */
+		on_bit;			/* First "on" bit */
+  int		*options,		/* First option number for each group */
+		*choices;		/* First choice bit for each option */
+  unsigned	*off;			/* Choices that turn an option off */
+  ppd_option_t	*page_size,		/* PageSize option */
+		*page_region;		/* PageRegion option */
+} _ppd_uiindex_t;
+
+typedef struct _ppd_uistate_s		/**** Option selection to test ****/
+{
+  ppd_file_t	*ppd;			/* PPD file */
+  _ppd_uiindex_t *index;		/* Constraint bit index */
+  unsigned	*value,			/* Option value and "on" bits */
+		*first,			/* AP_FIRSTPAGE_option value bits */
+		*page,			/* Page size bits */
+		*test;			/* Combined bits for testing */
+  int		page_set[_PPD_PAGE_MAX];/* Page size values that are set */
+  char		page_values[_PPD_PAGE_MAX][PPD_MAX_NAME * 2];
+					/* Page size values */
+} _ppd_uistate_t;
+
 
 /*
  * Local functions...
  */
 
+static int		ppd_compile_constraints(_ppd_uiindex_t *index,
+			                        _ppd_cups_uiconsts_t *consts);
+static _ppd_uiindex_t	*ppd_create_index(ppd_file_t *ppd);
+static int		ppd_index_option(_ppd_uiindex_t *index,
+			                 ppd_option_t *option);
 static int		ppd_is_installable(ppd_group_t *installable,
 			                   const char *option);
 static void		ppd_load_constraints(ppd_file_t *ppd);
+static void		ppd_state_choices(_ppd_uistate_t *state, unsigned *bits,
+			                  ppd_option_t *option,
+			                  const char *value);
+static void		ppd_state_free(_ppd_uistate_t *state);
+static int		ppd_state_init(_ppd_uistate_t *state, ppd_file_t *ppd,
+			               int num_options, cups_option_t *options);
+static void		ppd_state_merge(_ppd_uistate_t *state, unsigned *bits,
+			                const unsigned *src,
+			                ppd_option_t *option);
+static ppd_option_t	*ppd_state_option(_ppd_uistate_t *state,
+			                  const char *name);
+static void		ppd_state_page(_ppd_uistate_t *state, unsigned *bits,
+			               const char *page, const char *first);
+static void		ppd_state_set(_ppd_uistate_t *state, const char *name,
+			              const char *value);
+static cups_array_t	*ppd_state_test(_ppd_uistate_t *state,
+			                const char *option, const char *choice,
+			                int which);
 static cups_array_t	*ppd_test_constraints(ppd_file_t *ppd,
 			                      const char *option,
 					      const char *choice,
@@ -179,6 +265,7 @@ cupsResolveConflicts(
 			tries,		/* Number of tries */
 			num_newopts;	/* Number of new options */
   cups_option_t		*newopts;	/* New options */
+  _ppd_uistate_t	state;		/* Selection with new options */
   cups_array_t		*active = NULL,	/* Active constraints */
 			*pass,		/* Resolvers for this pass */
 			*resolvers,	/* Resolvers we have used */
@@ -218,6 +305,17 @@ cupsResolveConflicts(
   if (option && _cups_strcasecmp(option, "Collate"))
     num_newopts = cupsAddOption(option, choice, num_newopts, &newopts);
 
+ /*
+  * Compute the selection for the new options; it is updated as each option is
+  * changed below so every test only looks at what changed...
+  */
+
+  if (!ppd_state_init(&state, ppd, num_newopts, newopts))
+  {
+    cupsFreeOptions(num_newopts, newopts);
+    return (0);
+  }
+
  /*
   * Loop until we have no conflicts...
   */
@@ -229,8 +327,8 @@ cupsResolveConflicts(
   tries     = 0;
 
   while (tries < 100 &&
-         (active = ppd_test_constraints(ppd, NULL, NULL, num_newopts, newopts,
-                                        _PPD_ALL_CONSTRAINTS)) != NULL)
+         (active = ppd_state_test(&state, NULL, NULL,
+                                  _PPD_ALL_CONSTRAINTS)) != NULL)
   {
     tries ++;
 
@@ -340,9 +438,8 @@ cupsResolveConflicts(
 	  * Try this choice...
 	  */
 
-          if ((test = ppd_test_constraints(ppd, resoption, reschoice,
-					   num_newopts, newopts,
-					   _PPD_ALL_CONSTRAINTS)) == NULL)
+          if ((test = ppd_state_test(&state, resoption, reschoice,
+				     _PPD_ALL_CONSTRAINTS)) == NULL)
 	  {
 	   /*
 	    * That worked...
@@ -361,6 +458,7 @@ cupsResolveConflicts(
 
 	  num_newopts = cupsAddOption(resoption, reschoice, num_newopts,
 				      &newopts);
+	  ppd_state_set(&state, resoption, reschoice);
         }
       }
       else
@@ -437,10 +535,9 @@ cupsResolveConflicts(
           test = NULL;
 
           if (_cups_strcasecmp(value, constptr->option->defchoice) &&
-	      (test = ppd_test_constraints(ppd, constptr->option->keyword,
-	                                   constptr->option->defchoice,
-					   num_newopts, newopts,
-					   _PPD_OPTION_CONSTRAINTS)) == NULL)
+	      (test = ppd_state_test(&state, constptr->option->keyword,
+	                             constptr->option->defchoice,
+				     _PPD_OPTION_CONSTRAINTS)) == NULL)
 	  {
 	   /*
 	    * That worked...
@@ -449,6 +546,8 @@ cupsResolveConflicts(
 	    num_newopts = cupsAddOption(constptr->option->keyword,
 	                                constptr->option->defchoice,
 					num_newopts, &newopts);
+	    ppd_state_set(&state, constptr->option->keyword,
+	                  constptr->option->defchoice);
             changed     = 1;
 	  }
 	  else
@@ -468,10 +567,9 @@ cupsResolveConflicts(
 	      if (_cups_strcasecmp(value, cptr->choice) &&
 	          _cups_strcasecmp(constptr->option->defchoice, cptr->choice) &&
 		  _cups_strcasecmp("Custom", cptr->choice) &&
-	          (test = ppd_test_constraints(ppd, constptr->option->keyword,
-	                                       cptr->choice, num_newopts,
-					       newopts,
-					       _PPD_OPTION_CONSTRAINTS)) == NULL)
+	          (test = ppd_state_test(&state, constptr->option->keyword,
+	                                 cptr->choice,
+					 _PPD_OPTION_CONSTRAINTS)) == NULL)
 	      {
 	       /*
 		* This choice works...
@@ -480,6 +578,7 @@ cupsResolveConflicts(
 		num_newopts = cupsAddOption(constptr->option->keyword,
 					    cptr->choice, num_newopts,
 					    &newopts);
+		ppd_state_set(&state, constptr->option->keyword, cptr->choice);
 		changed     = 1;
 		break;
 	      }
@@ -535,6 +634,8 @@ cupsResolveConflicts(
 
   cupsArrayRestore(ppd->sorted_attrs);
 
+  ppd_state_free(&state);
+
   DEBUG_printf(("1cupsResolveConflicts: Returning %d options:", num_newopts));
 #ifdef DEBUG
   for (i = 0; i < num_newopts; i ++)
@@ -558,6 +659,8 @@ cupsResolveConflicts(
 
   cupsArrayRestore(ppd->sorted_attrs);
 
+  ppd_state_free(&state);
+
   DEBUG_puts("1cupsResolveConflicts: Unable to resolve conflicts!");
 
   return (0);
@@ -671,6 +774,184 @@ ppdInstallableConflict(
 }
 
 
+/*
+ * 'ppd_compile_constraints()' - Compile a set of constraints into bit masks.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+ppd_compile_constraints(
+    _ppd_uiindex_t       *index,	/* I - Constraint bit index */
+    _ppd_cups_uiconsts_t *consts)	/* I - Constraints */
+{
+  int			i, j,		/* Looping vars */
+			num,		/* Option number */
+			bit;		/* Bit for constraint */
+  _ppd_cups_uiconst_t	*constptr;	/* Current constraint */
+  _ppd_cups_uimask_t	*masks;		/* Compiled masks */
+
+
+  if (!index ||
+      (masks = calloc((size_t)consts->num_constraints,
+                      sizeof(_ppd_cups_uimask_t))) == NULL)
+    return (0);
+
+  consts->masks     = masks;
+  consts->num_masks = 0;
+
+  for (i = consts->num_constraints, constptr = consts->constraints;
+       i > 0;
+       i --, constptr ++)
+  {
+    if ((num = ppd_index_option(index, constptr->option)) < 0)
+    {
+      free(consts->masks);
+      consts->masks     = NULL;
+      consts->num_masks = 0;
+
+      return (0);
+    }
+
+   /*
+    * Constraints on a choice use the choice bit, constraints on just an
+    * option use the option's "on" bit...
+    */
+
+    if (constptr->choice)
+      bit = index->choices[num] +
+            (int)(constptr->choice - constptr->option->choices);
+    else
+      bit = index->on_bit + num;
+
+   /*
+    * Merge bits that land in the same word...
+    */
+
+    for (j = 0; j < consts->num_masks; j ++)
+      if (masks[j].word == bit / _PPD_WORD_BITS)
+        break;
+
+    if (j == consts->num_masks)
+    {
+      masks[j].word = bit / _PPD_WORD_BITS;
+      consts->num_masks ++;
+    }
+
+    masks[j].bits |= 1U << (bit % _PPD_WORD_BITS);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'ppd_create_index()' - Create the constraint bit index for a PPD file.
+ */
+
+static _ppd_uiindex_t *			/* O - Constraint bit index or NULL */
+ppd_create_index(ppd_file_t *ppd)	/* I - PPD file */
+{
+  int			i,		/* Looping var */
+			num_options,	/* Number of options */
+			num_choices,	/* Number of choices */
+			num_words;	/* Number of words in a selection */
+  ppd_group_t		*group;		/* Current group */
+  ppd_option_t		*option;	/* Current option */
+  ppd_choice_t		*choice;	/* Current choice */
+  _ppd_uiindex_t	*index;		/* Constraint bit index */
+
+
+ /*
+  * Count the options and choices in the top-level groups, which is where
+  * ppdFindOption looks...
+  */
+
+  for (i = ppd->num_groups, group = ppd->groups, num_options = 0,
+           num_choices = 0;
+       i > 0;
+       i --, group ++)
+  {
+    int	j;				/* Looping var */
+
+    for (j = group->num_options, option = group->options;
+         j > 0;
+	 j --, option ++)
+      num_choices += option->num_choices;
+
+    num_options += group->num_options;
+  }
+
+ /*
+  * Allocate the index and its arrays in one block...
+  */
+
+  num_words = (num_choices + num_options + _PPD_WORD_BITS) / _PPD_WORD_BITS;
+
+  if ((index = calloc(1, sizeof(_ppd_uiindex_t) +
+                         (size_t)num_words * sizeof(unsigned) +
+                         (size_t)(ppd->num_groups + num_options) *
+			     sizeof(int))) == NULL)
+    return (NULL);
+
+  index->groups      = ppd->groups;
+  index->num_groups  = ppd->num_groups;
+  index->num_words   = num_words;
+  index->on_bit      = num_choices;
+  index->off         = (unsigned *)(index + 1);
+  index->options     = (int *)(index->off + num_words);
+  index->choices     = index->options + ppd->num_groups;
+  index->page_size   = ppdFindOption(ppd, "PageSize");
+  index->page_region = ppdFindOption(ppd, "PageRegion");
+
+  for (i = 0, group = ppd->groups, num_options = 0, num_choices = 0;
+       i < ppd->num_groups;
+       i ++, group ++)
+  {
+    int	j;				/* Looping var */
+
+    index->options[i] = num_options;
+
+    for (j = group->num_options, option = group->options;
+         j > 0;
+	 j --, option ++)
+    {
+      int	k;			/* Looping var */
+
+      index->choices[num_options ++] = num_choices;
+
+      for (k = option->num_choices, choice = option->choices;
+           k > 0;
+	   k --, choice ++, num_choices ++)
+        if (_PPD_IS_OFF(choice->choice))
+	  _PPD_BIT_SET(index->off, num_choices);
+    }
+  }
+
+  return (index);
+}
+
+
+/*
+ * 'ppd_index_option()' - Get the option number for an option.
+ */
+
+static int				/* O - Option number or -1 */
+ppd_index_option(
+    _ppd_uiindex_t *index,		/* I - Constraint bit index */
+    ppd_option_t   *option)		/* I - Option */
+{
+  int		i;			/* Looping var */
+  ppd_group_t	*group;			/* Current group */
+
+
+  for (i = 0, group = index->groups; i < index->num_groups; i ++, group ++)
+    if (option >= group->options &&
+        option < (group->options + group->num_options))
+      return (index->options[i] + (int)(option - group->options));
+
+  return (-1);
+}
+
+
 /*
  * 'ppd_is_installable()' - Determine whether an option is in the
  *                          InstallableOptions group.
@@ -710,6 +991,7 @@ ppd_load_constraints(ppd_file_t *ppd)	/* I - PPD file */
   ppd_attr_t	*constattr;		/* Current cupsUIConstraints attribute */
   _ppd_cups_uiconsts_t	*consts;	/* Current cupsUIConstraints data */
   _ppd_cups_uiconst_t	*constptr;	/* Current constraint */
+  _ppd_uiindex_t	*index;		/* Constraint bit index */
   ppd_group_t	*installable;		/* Installable options group */
   const char	*vptr;			/* Pointer into constraint value */
   char		option[PPD_MAX_NAME],	/* Option name/MainKeyword */
@@ -720,10 +1002,12 @@ ppd_load_constraints(ppd_file_t *ppd)	/* I - PPD file */
   DEBUG_printf(("7ppd_load_constraints(ppd=%p)", ppd));
 
  /*
-  * Create an array to hold the constraint data...
+  * Create an array to hold the constraint data; the bit index used to test
+  * the compiled constraints is kept as the array's user data...
   */
 
-  ppd->cups_uiconstraints = cupsArrayNew(NULL, NULL);
+  index                   = ppd_create_index(ppd);
+  ppd->cups_uiconstraints = cupsArrayNew(NULL, index);
 
  /*
   * Find the installable options group if it exists...
@@ -835,9 +1119,17 @@ ppd_load_constraints(ppd_file_t *ppd)	/* I - PPD file */
     consts->installable = constptr[0].installable || constptr[1].installable;
 
    /*
-    * Add it to the constraints array...
+    * Compile and add it to the constraints array...
     */
 
+    if (!ppd_compile_constraints(index, consts))
+    {
+      DEBUG_puts("8ppd_load_constraints: Unable to compile UIConstraints!");
+      free(consts->constraints);
+      free(consts);
+      continue;
+    }
+
     cupsArrayAdd(ppd->cups_uiconstraints, consts);
   }
 
@@ -932,7 +1224,7 @@ ppd_load_constraints(ppd_file_t *ppd)	/* I - PPD file */
       }
     }
 
-    if (!vptr)
+    if (!vptr && ppd_compile_constraints(index, consts))
       cupsArrayAdd(ppd->cups_uiconstraints, consts);
     else
     {
@@ -944,249 +1236,461 @@ ppd_load_constraints(ppd_file_t *ppd)	/* I - PPD file */
 
 
 /*
- * 'ppd_test_constraints()' - See if any constraints are active.
+ * 'ppd_state_choices()' - Set the choice bits for an option value.
  */
 
-static cups_array_t *			/* O - Array of active constraints */
-ppd_test_constraints(
-    ppd_file_t    *ppd,			/* I - PPD file */
-    const char    *option,		/* I - Current option */
-    const char    *choice,		/* I - Current choice */
-    int           num_options,		/* I - Number of additional options */
-    cups_option_t *options,		/* I - Additional options */
-    int           which)		/* I - Which constraints to test */
+static void
+ppd_state_choices(
+    _ppd_uistate_t *state,		/* I - Selection */
+    unsigned       *bits,		/* I - Bits to update */
+    ppd_option_t   *option,		/* I - Option */
+    const char     *value)		/* I - Value or NULL */
 {
-  int			i;		/* Looping var */
-  _ppd_cups_uiconsts_t	*consts;	/* Current constraints */
-  _ppd_cups_uiconst_t	*constptr;	/* Current constraint */
-  ppd_choice_t		key,		/* Search key */
-			*marked;	/* Marked choice */
-  cups_array_t		*active = NULL;	/* Active constraints */
-  const char		*value,		/* Current value */
-			*firstvalue;	/* AP_FIRSTPAGE_Keyword value */
-  char			firstpage[255];	/* AP_FIRSTPAGE_Keyword string */
+  int		i,			/* Looping var */
+		bit;			/* Current bit */
+  ppd_choice_t	*choice;		/* Current choice */
 
 
-  DEBUG_printf(("7ppd_test_constraints(ppd=%p, option=\"%s\", choice=\"%s\", "
-                "num_options=%d, options=%p, which=%d)", ppd, option, choice,
-		num_options, options, which));
+  if ((bit = ppd_index_option(state->index, option)) < 0)
+    return;
+
+  bit = state->index->choices[bit];
+
+  if (value && !_cups_strncasecmp(value, "Custom.", 7))
+    value = "Custom";
+
+  for (i = option->num_choices, choice = option->choices;
+       i > 0;
+       i --, choice ++, bit ++)
+  {
+    if (value && !_cups_strcasecmp(value, choice->choice))
+      _PPD_BIT_SET(bits, bit);
+    else
+      _PPD_BIT_CLEAR(bits, bit);
+  }
+}
+
+
+/*
+ * 'ppd_state_free()' - Free the memory used by a selection.
+ */
+
+static void
+ppd_state_free(_ppd_uistate_t *state)	/* I - Selection */
+{
+  free(state->value);
+
+  state->value = NULL;
+  state->first = NULL;
+  state->page  = NULL;
+  state->test  = NULL;
+}
+
+
+/*
+ * 'ppd_state_init()' - Compute the selection for the marked choices and
+ *                      additional options.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+ppd_state_init(
+    _ppd_uistate_t *state,		/* I - Selection */
+    ppd_file_t     *ppd,		/* I - PPD file */
+    int            num_options,		/* I - Number of additional options */
+    cups_option_t  *options)		/* I - Additional options */
+{
+  int			num,		/* Option number */
+			bit;		/* Choice bit */
+  _ppd_uiindex_t	*index;		/* Constraint bit index */
+  ppd_choice_t		*marked;	/* Marked choice */
+  ppd_size_t		*size;		/* Marked page size */
+
+
+  memset(state, 0, sizeof(_ppd_uistate_t));
+
+  state->ppd = ppd;
 
   if (!ppd->cups_uiconstraints)
     ppd_load_constraints(ppd);
 
-  DEBUG_printf(("9ppd_test_constraints: %d constraints!",
-	        cupsArrayCount(ppd->cups_uiconstraints)));
+  if ((index = (_ppd_uiindex_t *)cupsArrayUserData(ppd->cups_uiconstraints))
+          == NULL)
+    return (0);
+
+  state->index = index;
+
+  if ((state->value = calloc(4 * (size_t)index->num_words,
+                             sizeof(unsigned))) == NULL)
+    return (0);
+
+  state->first = state->value + index->num_words;
+  state->page  = state->first + index->num_words;
+  state->test  = state->page + index->num_words;
+
+ /*
+  * Start with the marked choices...
+  */
 
   cupsArraySave(ppd->marked);
 
-  for (consts = (_ppd_cups_uiconsts_t *)cupsArrayFirst(ppd->cups_uiconstraints);
-       consts;
-       consts = (_ppd_cups_uiconsts_t *)cupsArrayNext(ppd->cups_uiconstraints))
+  for (marked = (ppd_choice_t *)cupsArrayFirst(ppd->marked);
+       marked;
+       marked = (ppd_choice_t *)cupsArrayNext(ppd->marked))
   {
-    DEBUG_printf(("9ppd_test_constraints: installable=%d, resolver=\"%s\", "
-                  "num_constraints=%d option1=\"%s\", choice1=\"%s\", "
-		  "option2=\"%s\", choice2=\"%s\", ...",
-		  consts->installable, consts->resolver, consts->num_constraints,
-		  consts->constraints[0].option->keyword,
-		  consts->constraints[0].choice ?
-		      consts->constraints[0].choice->choice : "",
-		  consts->constraints[1].option->keyword,
-		  consts->constraints[1].choice ?
-		      consts->constraints[1].choice->choice : ""));
+    if ((num = ppd_index_option(index, marked->option)) < 0)
+      continue;
 
-    if (consts->installable && which < _PPD_INSTALLABLE_CONSTRAINTS)
-      continue;				/* Skip installable option constraint */
+    bit = index->choices[num] + (int)(marked - marked->option->choices);
 
-    if (!consts->installable && which == _PPD_INSTALLABLE_CONSTRAINTS)
-      continue;				/* Skip non-installable option constraint */
+    if (!_PPD_BIT_ISSET(index->off, bit))
+      _PPD_BIT_SET(state->value, index->on_bit + num);
 
-    if (which == _PPD_OPTION_CONSTRAINTS && option)
-    {
-     /*
-      * Skip constraints that do not involve the current option...
-      */
+    if (marked->option != index->page_size &&
+        marked->option != index->page_region)
+      _PPD_BIT_SET(state->value, bit);
+  }
 
-      for (i = consts->num_constraints, constptr = consts->constraints;
-	   i > 0;
-	   i --, constptr ++)
-      {
-        if (!_cups_strcasecmp(constptr->option->keyword, option))
-	  break;
+  cupsArrayRestore(ppd->marked);
 
-        if (!_cups_strncasecmp(option, "AP_FIRSTPAGE_", 13) &&
-	    !_cups_strcasecmp(constptr->option->keyword, option + 13))
-	  break;
-      }
+  if ((size = ppdPageSize(ppd, NULL)) != NULL)
+  {
+    strlcpy(state->page_values[_PPD_PAGE_MARKED], size->name,
+            sizeof(state->page_values[0]));
+    state->page_set[_PPD_PAGE_MARKED] = 1;
+  }
 
-      if (!i)
-        continue;
-    }
+ /*
+  * Then apply the options, with earlier options taking precedence like
+  * cupsGetOption...
+  */
 
-    DEBUG_puts("9ppd_test_constraints: Testing...");
+  for (options += num_options - 1; num_options > 0; num_options --, options --)
+    ppd_state_set(state, options->name, options->value);
 
-    for (i = consts->num_constraints, constptr = consts->constraints;
-         i > 0;
-	 i --, constptr ++)
+  ppd_state_page(state, state->page, NULL, NULL);
+
+  return (1);
+}
+
+
+/*
+ * 'ppd_state_merge()' - Add the choice bits of an option from another bitset.
+ */
+
+static void
+ppd_state_merge(
+    _ppd_uistate_t *state,		/* I - Selection */
+    unsigned       *bits,		/* I - Bits to update */
+    const unsigned *src,		/* I - Bits to add */
+    ppd_option_t   *option)		/* I - Option */
+{
+  int	i,				/* Looping var */
+	bit;				/* Current bit */
+
+
+  if ((bit = ppd_index_option(state->index, option)) < 0)
+    return;
+
+  for (i = option->num_choices, bit = state->index->choices[bit];
+       i > 0;
+       i --, bit ++)
+    if (_PPD_BIT_ISSET(src, bit))
+      _PPD_BIT_SET(bits, bit);
+}
+
+
+/*
+ * 'ppd_state_option()' - Find an option by name.
+ */
+
+static ppd_option_t *			/* O - Option or NULL */
+ppd_state_option(
+    _ppd_uistate_t *state,		/* I - Selection */
+    const char     *name)		/* I - Option name */
+{
+ /*
+  * Names that are too long for an option keyword cannot match one...
+  */
+
+  if (strlen(name) >= PPD_MAX_NAME)
+    return (NULL);
+
+  return (ppdFindOption(state->ppd, name));
+}
+
+
+/*
+ * 'ppd_state_page()' - Set the page size choice bits.
+ *
+ * PageSize and PageRegion are used depending on the selected input slot and
+ * manual feed mode, so constraints on either option are tested against the
+ * selected page size instead of the individual option.
+ */
+
+static void
+ppd_state_page(
+    _ppd_uistate_t *state,		/* I - Selection */
+    unsigned       *bits,		/* I - Bits to update */
+    const char     *page,		/* I - Page size being tested or NULL */
+    const char     *first)		/* I - First page size being tested or NULL */
+{
+  int		i, j,			/* Looping vars */
+		bit;			/* Current bit */
+  ppd_option_t	*options[2],		/* PageSize and PageRegion options */
+		*option;		/* Current option */
+  ppd_choice_t	*choice;		/* Current choice */
+
+
+  for (i = _PPD_PAGE_PAGESIZE; !page && i <= _PPD_PAGE_MARKED; i ++)
+    if (state->page_set[i])
+      page = state->page_values[i];
+
+  for (i = _PPD_FIRST_PAGESIZE; !first && i <= _PPD_FIRST_PAGEREGION; i ++)
+    if (state->page_set[i])
+      first = state->page_values[i];
+
+  if (page && !_cups_strncasecmp(page, "Custom.", 7))
+    page = "Custom";
+
+  if (first && !_cups_strncasecmp(first, "Custom.", 7))
+    first = "Custom";
+
+  options[0] = state->index->page_size;
+  options[1] = state->index->page_region != options[0] ?
+                   state->index->page_region : NULL;
+
+  for (j = 0; j < 2; j ++)
+  {
+    if ((option = options[j]) == NULL ||
+        (bit = ppd_index_option(state->index, option)) < 0)
+      continue;
+
+    for (i = option->num_choices, choice = option->choices,
+             bit = state->index->choices[bit];
+	 i > 0;
+	 i --, choice ++, bit ++)
     {
-      DEBUG_printf(("9ppd_test_constraints: %s=%s?", constptr->option->keyword,
-		    constptr->choice ? constptr->choice->choice : ""));
+      if ((page && !_cups_strcasecmp(page, choice->choice)) ||
+          (first && !_cups_strcasecmp(first, choice->choice)))
+	_PPD_BIT_SET(bits, bit);
+      else
+	_PPD_BIT_CLEAR(bits, bit);
+    }
+  }
+}
 
-      if (constptr->choice &&
-          (!_cups_strcasecmp(constptr->option->keyword, "PageSize") ||
-           !_cups_strcasecmp(constptr->option->keyword, "PageRegion")))
-      {
-       /*
-        * PageSize and PageRegion are used depending on the selected input slot
-	* and manual feed mode.  Validate against the selected page size instead
-	* of an individual option...
-	*/
 
-        if (option && choice &&
-	    (!_cups_strcasecmp(option, "PageSize") ||
-	     !_cups_strcasecmp(option, "PageRegion")))
-	{
-	  value = choice;
-        }
-	else if ((value = cupsGetOption("PageSize", num_options,
-	                                options)) == NULL)
-	  if ((value = cupsGetOption("PageRegion", num_options,
-	                             options)) == NULL)
-	    if ((value = cupsGetOption("media", num_options, options)) == NULL)
-	    {
-	      ppd_size_t *size = ppdPageSize(ppd, NULL);
+/*
+ * 'ppd_state_set()' - Set an option in a selection.
+ */
 
-              if (size)
-	        value = size->name;
-	    }
+static void
+ppd_state_set(_ppd_uistate_t *state,	/* I - Selection */
+              const char     *name,	/* I - Option name */
+	      const char     *value)	/* I - Option value */
+{
+  int		num,			/* Option number or page size value */
+		bit;			/* "On" bit */
+  ppd_option_t	*option;		/* Option */
 
-        if (value && !_cups_strncasecmp(value, "Custom.", 7))
-	  value = "Custom";
 
-        if (option && choice &&
-	    (!_cups_strcasecmp(option, "AP_FIRSTPAGE_PageSize") ||
-	     !_cups_strcasecmp(option, "AP_FIRSTPAGE_PageRegion")))
-	{
-	  firstvalue = choice;
-        }
-	else if ((firstvalue = cupsGetOption("AP_FIRSTPAGE_PageSize",
-	                                     num_options, options)) == NULL)
-	  firstvalue = cupsGetOption("AP_FIRSTPAGE_PageRegion", num_options,
-	                             options);
+ /*
+  * Options that select the page size...
+  */
 
-        if (firstvalue && !_cups_strncasecmp(firstvalue, "Custom.", 7))
-	  firstvalue = "Custom";
+  if (!_cups_strcasecmp(name, "PageSize"))
+    num = _PPD_PAGE_PAGESIZE;
+  else if (!_cups_strcasecmp(name, "PageRegion"))
+    num = _PPD_PAGE_PAGEREGION;
+  else if (!_cups_strcasecmp(name, "media"))
+    num = _PPD_PAGE_MEDIA;
+  else if (!_cups_strcasecmp(name, "AP_FIRSTPAGE_PageSize"))
+    num = _PPD_FIRST_PAGESIZE;
+  else if (!_cups_strcasecmp(name, "AP_FIRSTPAGE_PageRegion"))
+    num = _PPD_FIRST_PAGEREGION;
+  else
+    num = -1;
 
-        if ((!value || _cups_strcasecmp(value, constptr->choice->choice)) &&
-	    (!firstvalue || _cups_strcasecmp(firstvalue, constptr->choice->choice)))
-	{
-	  DEBUG_puts("9ppd_test_constraints: NO");
-	  break;
-	}
-      }
-      else if (constptr->choice)
-      {
-       /*
-        * Compare against the constrained choice...
-	*/
+  if (num >= 0)
+  {
+    strlcpy(state->page_values[num], value, sizeof(state->page_values[0]));
+    state->page_set[num] = 1;
 
-        if (option && choice && !_cups_strcasecmp(option, constptr->option->keyword))
-	{
-	  if (!_cups_strncasecmp(choice, "Custom.", 7))
-	    value = "Custom";
-	  else
-	    value = choice;
-	}
-        else if ((value = cupsGetOption(constptr->option->keyword, num_options,
-	                                options)) != NULL)
-        {
-	  if (!_cups_strncasecmp(value, "Custom.", 7))
-	    value = "Custom";
-	}
-        else if (constptr->choice->marked)
-	  value = constptr->choice->choice;
-	else
-	  value = NULL;
+    ppd_state_page(state, state->page, NULL, NULL);
+  }
 
-       /*
-        * Now check AP_FIRSTPAGE_option...
-	*/
+ /*
+  * The option itself...
+  */
 
-        snprintf(firstpage, sizeof(firstpage), "AP_FIRSTPAGE_%s",
-	         constptr->option->keyword);
+  if ((option = ppd_state_option(state, name)) != NULL &&
+      (num = ppd_index_option(state->index, option)) >= 0)
+  {
+    bit = state->index->on_bit + num;
 
-        if (option && choice && !_cups_strcasecmp(option, firstpage))
-	{
-	  if (!_cups_strncasecmp(choice, "Custom.", 7))
-	    firstvalue = "Custom";
-	  else
-	    firstvalue = choice;
-	}
-        else if ((firstvalue = cupsGetOption(firstpage, num_options,
-	                                     options)) != NULL)
-        {
-	  if (!_cups_strncasecmp(firstvalue, "Custom.", 7))
-	    firstvalue = "Custom";
-	}
-	else
-	  firstvalue = NULL;
+    if (_PPD_IS_OFF(value))
+      _PPD_BIT_CLEAR(state->value, bit);
+    else
+      _PPD_BIT_SET(state->value, bit);
 
-        DEBUG_printf(("9ppd_test_constraints: value=%s, firstvalue=%s", value,
-	              firstvalue));
+    if (option != state->index->page_size &&
+        option != state->index->page_region)
+      ppd_state_choices(state, state->value, option, value);
+  }
 
-        if ((!value || _cups_strcasecmp(value, constptr->choice->choice)) &&
-	    (!firstvalue || _cups_strcasecmp(firstvalue, constptr->choice->choice)))
-	{
-	  DEBUG_puts("9ppd_test_constraints: NO");
-	  break;
-	}
-      }
-      else if (option && choice &&
-               !_cups_strcasecmp(option, constptr->option->keyword))
-      {
-	if (!_cups_strcasecmp(choice, "None") || !_cups_strcasecmp(choice, "Off") ||
-	    !_cups_strcasecmp(choice, "False"))
-	{
-	  DEBUG_puts("9ppd_test_constraints: NO");
-	  break;
-	}
-      }
-      else if ((value = cupsGetOption(constptr->option->keyword, num_options,
-				      options)) != NULL)
-      {
-	if (!_cups_strcasecmp(value, "None") || !_cups_strcasecmp(value, "Off") ||
-	    !_cups_strcasecmp(value, "False"))
-	{
-	  DEBUG_puts("9ppd_test_constraints: NO");
-	  break;
-	}
-      }
+ /*
+  * And the first page value of an option...
+  */
+
+  if (!_cups_strncasecmp(name, "AP_FIRSTPAGE_", 13) &&
+      (option = ppd_state_option(state, name + 13)) != NULL &&
+      option != state->index->page_size &&
+      option != state->index->page_region)
+    ppd_state_choices(state, state->first, option, value);
+}
+
+
+/*
+ * 'ppd_state_test()' - See if any constraints are active for a selection.
+ */
+
+static cups_array_t *			/* O - Array of active constraints */
+ppd_state_test(
+    _ppd_uistate_t *state,		/* I - Selection */
+    const char     *option,		/* I - Option being tested or NULL */
+    const char     *choice,		/* I - Choice being tested or NULL */
+    int            which)		/* I - Which constraints to test */
+{
+  int			i,		/* Looping var */
+			num;		/* Option number */
+  _ppd_uiindex_t	*index = state->index;
+					/* Constraint bit index */
+  unsigned		*test = state->test;
+					/* Combined bits */
+  ppd_option_t		*optptr = NULL,	/* Option being tested */
+			*firstptr = NULL;
+					/* Option for AP_FIRSTPAGE_option */
+  _ppd_cups_uiconsts_t	*consts;	/* Current constraints */
+  _ppd_cups_uiconst_t	*constptr;	/* Current constraint */
+  _ppd_cups_uimask_t	*mask;		/* Current constraint mask */
+  cups_array_t		*active = NULL;	/* Active constraints */
+
+
+  for (i = 0; i < index->num_words; i ++)
+    test[i] = state->value[i] | state->first[i] | state->page[i];
+
+  if (option)
+  {
+    optptr = ppd_state_option(state, option);
+
+    if (!_cups_strncasecmp(option, "AP_FIRSTPAGE_", 13))
+      firstptr = ppd_state_option(state, option + 13);
+  }
+
+  if (option && choice)
+  {
+   /*
+    * Replace the current value of the option being tested; this only touches
+    * the bits for that option so the rest of the selection is reused...
+    */
+
+    if (!_cups_strcasecmp(option, "PageSize") ||
+        !_cups_strcasecmp(option, "PageRegion"))
+      ppd_state_page(state, test, choice, NULL);
+    else if (!_cups_strcasecmp(option, "AP_FIRSTPAGE_PageSize") ||
+             !_cups_strcasecmp(option, "AP_FIRSTPAGE_PageRegion"))
+      ppd_state_page(state, test, NULL, choice);
+
+    if (optptr && (num = ppd_index_option(index, optptr)) >= 0)
+    {
+      if (_PPD_IS_OFF(choice))
+        _PPD_BIT_CLEAR(test, index->on_bit + num);
       else
+        _PPD_BIT_SET(test, index->on_bit + num);
+
+      if (optptr != index->page_size && optptr != index->page_region)
       {
-	key.option = constptr->option;
+	ppd_state_choices(state, test, optptr, choice);
+	ppd_state_merge(state, test, state->first, optptr);
+      }
+    }
 
-	if ((marked = (ppd_choice_t *)cupsArrayFind(ppd->marked, &key))
-		== NULL ||
-	    (!_cups_strcasecmp(marked->choice, "None") ||
-	     !_cups_strcasecmp(marked->choice, "Off") ||
-	     !_cups_strcasecmp(marked->choice, "False")))
-	{
-	  DEBUG_puts("9ppd_test_constraints: NO");
+    if (firstptr && firstptr != index->page_size &&
+        firstptr != index->page_region)
+    {
+      ppd_state_choices(state, test, firstptr, choice);
+      ppd_state_merge(state, test, state->value, firstptr);
+    }
+  }
+
+  for (consts = (_ppd_cups_uiconsts_t *)cupsArrayFirst(state->ppd->cups_uiconstraints);
+       consts;
+       consts = (_ppd_cups_uiconsts_t *)cupsArrayNext(state->ppd->cups_uiconstraints))
+  {
+    if (consts->installable && which < _PPD_INSTALLABLE_CONSTRAINTS)
+      continue;				/* Skip installable option constraint */
+
+    if (!consts->installable && which == _PPD_INSTALLABLE_CONSTRAINTS)
+      continue;				/* Skip non-installable option constraint */
+
+    if (which == _PPD_OPTION_CONSTRAINTS && option)
+    {
+     /*
+      * Skip constraints that do not involve the current option...
+      */
+
+      for (i = consts->num_constraints, constptr = consts->constraints;
+	   i > 0;
+	   i --, constptr ++)
+        if (constptr->option == optptr || constptr->option == firstptr)
 	  break;
-	}
-      }
+
+      if (!i)
+        continue;
     }
 
+    for (i = consts->num_masks, mask = consts->masks; i > 0; i --, mask ++)
+      if ((test[mask->word] & mask->bits) != mask->bits)
+        break;
+
     if (i <= 0)
     {
       if (!active)
         active = cupsArrayNew(NULL, NULL);
 
       cupsArrayAdd(active, consts);
-      DEBUG_puts("9ppd_test_constraints: Added...");
     }
   }
 
-  cupsArrayRestore(ppd->marked);
+  return (active);
+}
+
+
+/*
+ * 'ppd_test_constraints()' - See if any constraints are active.
+ */
+
+static cups_array_t *			/* O - Array of active constraints */
+ppd_test_constraints(
+    ppd_file_t    *ppd,			/* I - PPD file */
+    const char    *option,		/* I - Current option */
+    const char    *choice,		/* I - Current choice */
+    int           num_options,		/* I - Number of additional options */
+    cups_option_t *options,		/* I - Additional options */
+    int           which)		/* I - Which constraints to test */
+{
+  _ppd_uistate_t	state;		/* Selection */
+  cups_array_t		*active = NULL;	/* Active constraints */
+
+
+  DEBUG_printf(("7ppd_test_constraints(ppd=%p, option=\"%s\", choice=\"%s\", "
+                "num_options=%d, options=%p, which=%d)", ppd, option, choice,
+		num_options, options, which));
+
+  if (ppd_state_init(&state, ppd, num_options, options))
+    active = ppd_state_test(&state, option, choice, which);
+
+  ppd_state_free(&state);
 
   DEBUG_printf(("8ppd_test_constraints: Found %d active constraints!",
                 cupsArrayCount(active)));
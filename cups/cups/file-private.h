@@ -127,6 +127,7 @@ extern _cups_fc_result_t	_cupsFileCheck(const char *filename,
 extern void			_cupsFileCheckFilter(void *context,
 						     _cups_fc_result_t result,
 						     const char *message);
+extern off_t			_cupsFilePassThrough(cups_file_t *fp, int fd);
 
 #  ifdef __cplusplus
 }
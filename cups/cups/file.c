@@ -40,6 +40,7 @@ static ssize_t	cups_fill(cups_file_t *fp);
 static int	cups_open(const char *filename, int mode);
 static ssize_t	cups_read(cups_file_t *fp, char *buf, size_t bytes);
 static ssize_t	cups_write(cups_file_t *fp, const char *buf, size_t bytes);
+static ssize_t	cups_write_fd(int fd, const char *buf, size_t bytes);
 
 
 #ifndef WIN32
@@ -310,6 +311,102 @@ _cupsFileCheckFilter(
 #endif /* !WIN32 */
 
 
+/*
+ * '_cupsFilePassThrough()' - Copy the rest of a file to a file descriptor.
+ *
+ * Uncompressed data is moved with splice() when the system supports it and
+ * one of the descriptors is a pipe, so the data never passes through a user
+ * space buffer.  Compressed files and other descriptors are copied with
+ * cupsFileRead().
+ */
+
+off_t					/* O - Number of bytes copied or -1 on error */
+_cupsFilePassThrough(cups_file_t *fp,	/* I - CUPS file */
+                     int         fd)	/* I - File descriptor to write to */
+{
+  off_t		total = 0;		/* Total bytes copied */
+  ssize_t	bytes;			/* Bytes read or moved */
+  char		buffer[32768];		/* Copy buffer */
+
+
+  DEBUG_printf(("_cupsFilePassThrough(fp=%p, fd=%d)", fp, fd));
+
+  if (!fp || (fp->mode != 'r' && fp->mode != 's') || fd < 0)
+    return (-1);
+
+ /*
+  * Read the start of the file to see whether it is compressed, then write
+  * out anything that is already buffered...
+  */
+
+  if (!fp->ptr)
+    cups_fill(fp);
+
+  if (fp->ptr && fp->ptr < fp->end)
+  {
+    bytes = (ssize_t)(fp->end - fp->ptr);
+
+    if (cups_write_fd(fd, fp->ptr, (size_t)bytes) < 0)
+      return (-1);
+
+    fp->ptr += bytes;
+    fp->pos += bytes;
+    total   += bytes;
+  }
+
+#ifdef HAVE_SPLICE
+  if (fp->ptr && !fp->compressed && !fp->eof)
+  {
+   /*
+    * Move the rest of the file in the kernel.  splice() fails with EINVAL
+    * when neither descriptor is a pipe or the file system does not support
+    * it; in that case fall back to copying...
+    */
+
+    while ((bytes = splice(fp->fd, NULL, fd, NULL, 1048576,
+                           SPLICE_F_MOVE | SPLICE_F_MORE)) != 0)
+    {
+      if (bytes < 0)
+      {
+        if (errno == EINTR || errno == EAGAIN)
+	  continue;
+	else if (errno == EINVAL || errno == ENOSYS)
+	  break;
+	else
+	  return (-1);
+      }
+
+      DEBUG_printf(("4_cupsFilePassThrough: spliced " CUPS_LLFMT " bytes",
+                    CUPS_LLCAST bytes));
+
+      fp->pos    += bytes;
+      fp->bufpos = fp->pos;
+      fp->ptr    = fp->buf;
+      fp->end    = fp->buf;
+      total      += bytes;
+    }
+
+    if (bytes == 0)
+    {
+      fp->eof = 1;
+
+      return (total);
+    }
+  }
+#endif /* HAVE_SPLICE */
+
+  while ((bytes = cupsFileRead(fp, buffer, sizeof(buffer))) > 0)
+  {
+    if (cups_write_fd(fd, buffer, (size_t)bytes) < 0)
+      return (-1);
+
+    total += bytes;
+  }
+
+  return (total);
+}
+
+
 /*
  * 'cupsFileClose()' - Close a CUPS file.
  *
@@ -2670,6 +2767,43 @@ cups_write(cups_file_t *fp,		/* I - CUPS file */
 }
 
 
+/*
+ * 'cups_write_fd()' - Write all bytes to a file descriptor.
+ */
+
+static ssize_t				/* O - Number of bytes written or -1 */
+cups_write_fd(int        fd,		/* I - File descriptor */
+              const char *buf,		/* I - Buffer */
+	      size_t     bytes)		/* I - Number bytes */
+{
+  size_t	total;			/* Total bytes written */
+  ssize_t	count;			/* Count this time */
+
+
+  for (total = 0; bytes > 0; bytes -= (size_t)count, total += (size_t)count,
+                             buf += count)
+  {
+#ifdef WIN32
+    if ((count = (ssize_t)write(fd, buf, (unsigned)bytes)) < 0)
+#else
+    if ((count = write(fd, buf, bytes)) < 0)
+#endif /* WIN32 */
+    {
+     /*
+      * Writes can be interrupted by signals and unavailable resources...
+      */
+
+      if (errno == EAGAIN || errno == EINTR)
+        count = 0;
+      else
+        return (-1);
+    }
+  }
+
+  return ((ssize_t)total);
+}
+
+
 /*
  * End of "$Id: file.c 11645 2014-02-27 16:35:53Z msweet $".
  */
@@ -40,6 +40,7 @@
 #    include <unistd.h>
 #    include <fcntl.h>
 #    include <sys/socket.h>
+#    include <sys/uio.h>
 #    define CUPS_SOCAST
 #  endif /* WIN32 */
 
@@ -69,6 +70,19 @@
 typedef int socklen_t;
 #  endif /* __APPLE__ && !_SOCKLEN_T */
 
+#  ifdef WIN32
+/*
+ * Windows does not provide writev(), so define the vector type for the
+ * write functions...
+ */
+
+struct iovec				/**** Scatter/gather buffer ****/
+{
+  void		*iov_base;		/* Start of buffer */
+  size_t	iov_len;		/* Length of buffer */
+};
+#  endif /* WIN32 */
+
 #  include <cups/http.h>
 #  include "md5-private.h"
 #  include "ipp-private.h"
@@ -63,6 +63,8 @@ static ssize_t		http_write(http_t *http, const char *buffer,
 			           size_t length);
 static ssize_t		http_write_chunk(http_t *http, const char *buffer,
 			                 size_t length);
+static ssize_t		http_writev(http_t *http, struct iovec *iov,
+			            int iovcnt);
 static off_t		http_set_length(http_t *http);
 static void		http_set_timeout(int fd, double timeout);
 static void		http_set_wait(http_t *http);
@@ -3372,7 +3374,8 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer) &&
+        length < sizeof(http->wbuffer))
     {
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
@@ -3396,16 +3399,44 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
     else
     {
      /*
-      * Otherwise write the data directly...
+      * Otherwise write any buffered data and the new data directly with a
+      * single system call...
       */
 
+      struct iovec	iov[4];		/* Data to write */
+      int		iovcnt = 0;	/* Number of buffers */
+      char		header[16];	/* Chunk header */
+
       DEBUG_printf(("2httpWrite2: Writing " CUPS_LLFMT " bytes to socket...",
                     CUPS_LLCAST length));
 
       if (http->data_encoding == HTTP_ENCODING_CHUNKED)
-	bytes = (ssize_t)http_write_chunk(http, buffer, length);
-      else
-	bytes = (ssize_t)http_write(http, buffer, length);
+      {
+        snprintf(header, sizeof(header), "%x\r\n",
+	         (unsigned)(length + (size_t)http->wused));
+	iov[iovcnt].iov_base  = header;
+	iov[iovcnt ++].iov_len = strlen(header);
+      }
+
+      if (http->wused)
+      {
+	iov[iovcnt].iov_base  = http->wbuffer;
+	iov[iovcnt ++].iov_len = (size_t)http->wused;
+      }
+
+      iov[iovcnt].iov_base  = (void *)buffer;
+      iov[iovcnt ++].iov_len = length;
+
+      if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+      {
+	iov[iovcnt].iov_base  = (char *)"\r\n";
+	iov[iovcnt ++].iov_len = 2;
+      }
+
+      if ((bytes = http_writev(http, iov, iovcnt)) >= 0)
+        bytes = (ssize_t)length;
+
+      http->wused = 0;
 
       DEBUG_printf(("2httpWrite2: Wrote " CUPS_LLFMT " bytes...",
                     CUPS_LLCAST bytes));
@@ -4643,18 +4674,89 @@ http_write(http_t     *http,		/* I - HTTP connection */
            const char *buffer,		/* I - Buffer for data */
 	   size_t     length)		/* I - Number of bytes to write */
 {
-  ssize_t	tbytes,			/* Total bytes sent */
-		bytes;			/* Bytes sent */
+  struct iovec	iov;			/* Data to write */
 
 
   DEBUG_printf(("2http_write(http=%p, buffer=%p, length=" CUPS_LLFMT ")", http,
                 buffer, CUPS_LLCAST length));
+
+  iov.iov_base = (void *)buffer;
+  iov.iov_len  = length;
+
+  return (http_writev(http, &iov, 1));
+}
+
+
+/*
+ * 'http_write_chunk()' - Write a chunked buffer.
+ */
+
+static ssize_t				/* O - Number bytes written */
+http_write_chunk(http_t     *http,	/* I - HTTP connection */
+                 const char *buffer,	/* I - Buffer to write */
+		 size_t        length)	/* I - Length of buffer */
+{
+  char		header[16];		/* Chunk header */
+  struct iovec	iov[3];			/* Chunk header, data, and trailer */
+
+
+  DEBUG_printf(("7http_write_chunk(http=%p, buffer=%p, length=" CUPS_LLFMT ")",
+                http, buffer, CUPS_LLCAST length));
+
+ /*
+  * Write the chunk header, data, and trailer.
+  */
+
+  snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
+
+  iov[0].iov_base = header;
+  iov[0].iov_len  = strlen(header);
+  iov[1].iov_base = (void *)buffer;
+  iov[1].iov_len  = length;
+  iov[2].iov_base = (char *)"\r\n";
+  iov[2].iov_len  = 2;
+
+  if (http_writev(http, iov, 3) < 0)
+  {
+    DEBUG_puts("8http_write_chunk: http_writev failed.");
+    return (-1);
+  }
+
+  return ((ssize_t)length);
+}
+
+
+/*
+ * 'http_writev()' - Write one or more buffers to a HTTP connection.
+ *
+ * The buffers are sent with a single writev() call when possible.  The
+ * iovec array is updated as data is written.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+http_writev(http_t       *http,		/* I - HTTP connection */
+            struct iovec *iov,		/* I - Buffers to write */
+	    int          iovcnt)	/* I - Number of buffers */
+{
+  ssize_t	tbytes,			/* Total bytes sent */
+		bytes;			/* Bytes sent */
+
+
+  DEBUG_printf(("2http_writev(http=%p, iov=%p, iovcnt=%d)", http, iov,
+                iovcnt));
   http->error = 0;
   tbytes      = 0;
 
-  while (length > 0)
+  while (iovcnt > 0)
   {
-    DEBUG_printf(("3http_write: About to write %d bytes.", (int)length));
+    if (iov->iov_len == 0)
+    {
+      iov ++;
+      iovcnt --;
+      continue;
+    }
+
+    DEBUG_printf(("3http_writev: About to write %d buffers.", iovcnt));
 
     if (http->timeout_cb)
     {
@@ -4715,13 +4817,17 @@ http_write(http_t     *http,		/* I - HTTP connection */
 
 #ifdef HAVE_SSL
     if (http->tls)
-      bytes = _httpTLSWrite(http, buffer, (int)length);
+      bytes = _httpTLSWrite(http, iov->iov_base, (int)iov->iov_len);
     else
 #endif /* HAVE_SSL */
-    bytes = send(http->fd, buffer, length, 0);
+#ifdef WIN32
+    bytes = send(http->fd, iov->iov_base, (int)iov->iov_len, 0);
+#else
+    bytes = writev(http->fd, iov, iovcnt);
+#endif /* WIN32 */
 
-    DEBUG_printf(("3http_write: Write of " CUPS_LLFMT " bytes returned "
-                  CUPS_LLFMT ".", CUPS_LLCAST length, CUPS_LLCAST bytes));
+    DEBUG_printf(("3http_writev: Write of %d buffers returned " CUPS_LLFMT ".",
+                  iovcnt, CUPS_LLCAST bytes));
 
     if (bytes < 0)
     {
@@ -4761,67 +4867,41 @@ http_write(http_t     *http,		/* I - HTTP connection */
       }
 #endif /* WIN32 */
 
-      DEBUG_printf(("3http_write: error writing data (%s).",
+      DEBUG_printf(("3http_writev: error writing data (%s).",
                     strerror(http->error)));
 
       return (-1);
     }
 
-    buffer += bytes;
-    tbytes += bytes;
-    length -= (size_t)bytes;
-  }
-
 #ifdef DEBUG
-  http_debug_hex("http_write", buffer - tbytes, (int)tbytes);
+    http_debug_hex("http_writev", iov->iov_base,
+                   (int)(bytes < (ssize_t)iov->iov_len ? bytes :
+		                                         (ssize_t)iov->iov_len));
 #endif /* DEBUG */
 
-  DEBUG_printf(("3http_write: Returning " CUPS_LLFMT ".", CUPS_LLCAST tbytes));
-
-  return (tbytes);
-}
-
-
-/*
- * 'http_write_chunk()' - Write a chunked buffer.
- */
-
-static ssize_t				/* O - Number bytes written */
-http_write_chunk(http_t     *http,	/* I - HTTP connection */
-                 const char *buffer,	/* I - Buffer to write */
-		 size_t        length)	/* I - Length of buffer */
-{
-  char		header[16];		/* Chunk header */
-  ssize_t	bytes;			/* Bytes written */
-
-
-  DEBUG_printf(("7http_write_chunk(http=%p, buffer=%p, length=" CUPS_LLFMT ")",
-                http, buffer, CUPS_LLCAST length));
+    tbytes += bytes;
 
- /*
-  * Write the chunk header, data, and trailer.
-  */
+   /*
+    * Skip the buffers that were written...
+    */
 
-  snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
-  if (http_write(http, header, strlen(header)) < 0)
-  {
-    DEBUG_puts("8http_write_chunk: http_write of length failed.");
-    return (-1);
-  }
+    while (iovcnt > 0 && (size_t)bytes >= iov->iov_len)
+    {
+      bytes -= (ssize_t)iov->iov_len;
+      iov ++;
+      iovcnt --;
+    }
 
-  if ((bytes = http_write(http, buffer, length)) < 0)
-  {
-    DEBUG_puts("8http_write_chunk: http_write of buffer failed.");
-    return (-1);
+    if (iovcnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + bytes;
+      iov->iov_len  -= (size_t)bytes;
+    }
   }
 
-  if (http_write(http, "\r\n", 2) < 0)
-  {
-    DEBUG_puts("8http_write_chunk: http_write of CR LF failed.");
-    return (-1);
-  }
+  DEBUG_printf(("3http_writev: Returning " CUPS_LLFMT ".", CUPS_LLCAST tbytes));
 
-  return (bytes);
+  return (tbytes);
 }
 
 
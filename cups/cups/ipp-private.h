@@ -40,6 +40,10 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define IPP_ARENA_SIZE	8192	/* Size of first arena block */
+#  define IPP_ARENA_MAX	65536	/* Maximum size of arena blocks */
+#  define IPP_INDEX_MIN	32	/* Minimum attributes for a name index */
+#  define IPP_WRITE_DIRECT	1024	/* Minimum value size to write in place */
 
 
 /*
@@ -57,6 +61,29 @@ typedef struct				/**** Attribute mapping data ****/
   const ipp_op_t *operations;		/* Allowed operations for this attr */
 } _ipp_option_t;
 
+typedef struct _ipp_arena_s		/**** Message memory arena block ****/
+{
+  struct _ipp_arena_s	*next;		/* Next (older) block */
+  size_t		size,		/* Size of block data */
+			used;		/* Bytes used in block */
+  _ipp_value_t		data[1];	/* Block data (aligned) */
+} _ipp_arena_t;
+
+typedef struct _ipp_name_s		/**** Attribute name index entry ****/
+{
+  unsigned		hash;		/* Hash of lowercase name */
+  ipp_attribute_t	*attr,		/* First attribute with this name */
+			*prev;		/* Attribute before it or NULL */
+} _ipp_name_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  size_t		num_names,	/* Number of names */
+			alloc_names;	/* Number of hash slots (power of 2) */
+  ipp_attribute_t	*last;		/* Last attribute that was indexed */
+  _ipp_name_t		names[1];	/* Hash slots */
+} _ipp_index_t;
+
 
 /*
  * Prototypes for private functions...
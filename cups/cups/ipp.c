@@ -20,6 +20,7 @@
  */
 
 #include "cups-private.h"
+#include <stddef.h>
 #include <regex.h>
 #ifdef WIN32
 #  include <io.h>
@@ -33,6 +34,8 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
+static void		*ipp_alloc(ipp_t *ipp, size_t bytes);
+static void		ipp_free(ipp_attribute_t *attr, void *ptr);
 static void		ipp_free_values(ipp_attribute_t *attr, int element,
 			                int count);
 static char		*ipp_get_code(const char *locale, char *buffer,
@@ -41,6 +44,17 @@ static char		*ipp_get_code(const char *locale, char *buffer,
 static char		*ipp_lang_code(const char *locale, char *buffer,
 			               size_t bufsize)
 			               __attribute__((nonnull(1,2)));
+static int		ipp_index_add(ipp_t *ipp, ipp_attribute_t *attr,
+			              ipp_attribute_t *prev);
+static int		ipp_index_find(ipp_t *ipp, const char *name,
+			               ipp_attribute_t **attr,
+				       ipp_attribute_t **prev);
+static void		ipp_index_free(ipp_t *ipp);
+static unsigned		ipp_index_hash(const char *name);
+static _ipp_name_t	*ipp_index_lookup(_ipp_index_t *index,
+			                  const char *name, unsigned hash);
+static void		ipp_index_replace(ipp_t *ipp, ipp_attribute_t *oldattr,
+			                  ipp_attribute_t *newattr);
 static size_t		ipp_length(ipp_t *ipp, int collection);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
 			              size_t length);
@@ -50,6 +64,12 @@ static void		ipp_set_error(ipp_status_t status, const char *format,
 			              ...);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static char		*ipp_strdup(ipp_t *ipp, const char *s);
+static void		ipp_strfree(ipp_attribute_t *attr, char *s);
+static int		ipp_write_direct(void *dst, ipp_iocb_t cb,
+			                 ipp_uchar_t *buffer,
+					 ipp_uchar_t *bufptr, const void *data,
+					 int n);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
 
@@ -550,7 +570,7 @@ ippAddOctetString(ipp_t      *ipp,	/* I - IPP message */
 
   if (data)
   {
-    if ((attr->values[0].unknown.data = malloc((size_t)datalen)) == NULL)
+    if ((attr->values[0].unknown.data = ipp_alloc(ipp, (size_t)datalen)) == NULL)
     {
       ippDeleteAttribute(ipp, attr);
       return (NULL);
@@ -976,19 +996,19 @@ ippAddString(ipp_t      *ipp,		/* I - IPP message */
   else
   {
     if (language)
-      attr->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+      attr->values[0].string.language = ipp_strdup(ipp, ipp_lang_code(language, code,
 						      sizeof(code)));
 
     if (value)
     {
       if (value_tag == IPP_TAG_CHARSET)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_get_code(value, code,
+	attr->values[0].string.text = ipp_strdup(ipp, ipp_get_code(value, code,
 								 sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_lang_code(value, code,
+	attr->values[0].string.text = ipp_strdup(ipp, ipp_lang_code(value, code,
 								  sizeof(code)));
       else
-	attr->values[0].string.text = _cupsStrAlloc(value);
+	attr->values[0].string.text = ipp_strdup(ipp, value);
     }
   }
 
@@ -1328,7 +1348,7 @@ ippAddStrings(
         if ((int)value_tag & IPP_TAG_CUPS_CONST)
           value->string.language = (char *)language;
         else
-          value->string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+          value->string.language = ipp_strdup(ipp, ipp_lang_code(language, code,
                                                                sizeof(code)));
       }
       else
@@ -1340,11 +1360,11 @@ ippAddStrings(
       if ((int)value_tag & IPP_TAG_CUPS_CONST)
         value->string.text = (char *)*values++;
       else if (value_tag == IPP_TAG_CHARSET)
-	value->string.text = _cupsStrAlloc(ipp_get_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_strdup(ipp, ipp_get_code(*values++, code, sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	value->string.text = _cupsStrAlloc(ipp_lang_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_strdup(ipp, ipp_lang_code(*values++, code, sizeof(code)));
       else
-	value->string.text = _cupsStrAlloc(*values++);
+	value->string.text = ipp_strdup(ipp, *values++);
     }
   }
 
@@ -1572,13 +1592,14 @@ ippCopyAttribute(
 	       i --, srcval ++, dstval ++)
 	    dstval->string.text = srcval->string.text;
         }
-	else if (srcattr->value_tag & IPP_TAG_CUPS_CONST)
+	else if ((srcattr->value_tag & IPP_TAG_CUPS_CONST) ||
+	         srcattr->in_arena || dstattr->in_arena)
 	{
 	  for (i = srcattr->num_values, srcval = srcattr->values,
 	           dstval = dstattr->values;
 	       i > 0;
 	       i --, srcval ++, dstval ++)
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_strdup(dst, srcval->string.text);
 	}
 	else
 	{
@@ -1649,7 +1670,8 @@ ippCopyAttribute(
 	    dstval->string.text     = srcval->string.text;
           }
         }
-	else if (srcattr->value_tag & IPP_TAG_CUPS_CONST)
+	else if ((srcattr->value_tag & IPP_TAG_CUPS_CONST) ||
+	         srcattr->in_arena || dstattr->in_arena)
 	{
 	  for (i = srcattr->num_values, srcval = srcattr->values,
 	           dstval = dstattr->values;
@@ -1657,11 +1679,11 @@ ippCopyAttribute(
 	       i --, srcval ++, dstval ++)
 	  {
 	    if (srcval == srcattr->values)
-              dstval->string.language = _cupsStrAlloc(srcval->string.language);
+              dstval->string.language = ipp_strdup(dst, srcval->string.language);
 	    else
               dstval->string.language = dstattr->values[0].string.language;
 
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_strdup(dst, srcval->string.text);
           }
         }
 	else
@@ -1712,7 +1734,7 @@ ippCopyAttribute(
 
 	  if (dstval->unknown.length > 0)
 	  {
-	    if ((dstval->unknown.data = malloc((size_t)dstval->unknown.length)) == NULL)
+	    if ((dstval->unknown.data = ipp_alloc(dst, (size_t)dstval->unknown.length)) == NULL)
 	      dstval->unknown.length = 0;
 	    else
 	      memcpy(dstval->unknown.data, srcval->unknown.data, (size_t)dstval->unknown.length);
@@ -1836,6 +1858,7 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
 {
   ipp_attribute_t	*attr,		/* Current attribute */
 			*next;		/* Next attribute */
+  _ipp_arena_t		*block;		/* Current arena block */
 
 
   DEBUG_printf(("ippDelete(ipp=%p)", ipp));
@@ -1854,9 +1877,17 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
     ipp_free_values(attr, 0, attr->num_values);
 
     if (attr->name)
-      _cupsStrFree(attr->name);
+      ipp_strfree(attr, attr->name);
 
-    free(attr);
+    ipp_free(attr, attr);
+  }
+
+  ipp_index_free(ipp);
+
+  while ((block = ipp->arena) != NULL)
+  {
+    ipp->arena = block->next;
+    free(block);
   }
 
   free(ipp);
@@ -1911,6 +1942,7 @@ ippDeleteAttribute(
 	if (current == ipp->last)
 	  ipp->last = prev;
 
+        ipp_index_free(ipp);
         break;
       }
 
@@ -1925,9 +1957,9 @@ ippDeleteAttribute(
   ipp_free_values(attr, 0, attr->num_values);
 
   if (attr->name)
-    _cupsStrFree(attr->name);
+    ipp_strfree(attr, attr->name);
 
-  free(attr);
+  ipp_free(attr, attr);
 }
 
 
@@ -2089,6 +2121,8 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
       ipp->prev     = NULL;
       ipp->current  = ipp->attrs;
       ipp->curindex = 0;
+
+      ipp_index_find(ipp, parent, &ipp->current, &ipp->prev);
     }
 
     name = parent;
@@ -2101,8 +2135,15 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
   }
   else
   {
+   /*
+    * Start with the first attribute with this name, using the name index
+    * for larger messages...
+    */
+
     ipp->prev = NULL;
     attr      = ipp->attrs;
+
+    ipp_index_find(ipp, name, &attr, &ipp->prev);
   }
 
   for (; attr != NULL; ipp->prev = attr, attr = attr->next)
@@ -2909,6 +2950,47 @@ ippNewResponse(ipp_t *request)		/* I - IPP request message */
 }
 
 
+/*
+ * 'ippNewWithArena()' - Allocate a new IPP message that uses a memory arena.
+ *
+ * The attributes, names, and values in the message are allocated from a
+ * private memory arena that is freed all at once by @link ippDelete@, which
+ * is much faster for large messages.  Memory used by deleted or replaced
+ * attributes and values is not reused until the message is deleted, so this
+ * should only be used for messages that are not modified much after they
+ * are created.
+ *
+ * @since CUPS 2.1@
+ */
+
+ipp_t *					/* O - New IPP message */
+ippNewWithArena(void)
+{
+  ipp_t		*temp;			/* New IPP message */
+
+
+  DEBUG_puts("ippNewWithArena()");
+
+  if ((temp = ippNew()) != NULL)
+  {
+    if ((temp->arena = malloc(offsetof(_ipp_arena_t, data) +
+                              IPP_ARENA_SIZE)) == NULL)
+    {
+      ippDelete(temp);
+      return (NULL);
+    }
+
+    temp->arena->next = NULL;
+    temp->arena->size = IPP_ARENA_SIZE;
+    temp->arena->used = 0;
+  }
+
+  DEBUG_printf(("1ippNewWithArena: Returning %p", temp));
+
+  return (temp);
+}
+
+
 /*
  * 'ippRead()' - Read data for an IPP message from a HTTP connection.
  */
@@ -3427,7 +3509,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		value->string.text = _cupsStrAlloc((char *)buffer);
+		value->string.text = ipp_strdup(ipp, (char *)buffer);
 		DEBUG_printf(("2ippReadIO: value=\"%s\"", value->string.text));
 	        break;
 
@@ -3563,7 +3645,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		memcpy(string, bufptr + 2, (size_t)n);
 		string[n] = '\0';
 
-		value->string.language = _cupsStrAlloc((char *)string);
+		value->string.language = ipp_strdup(ipp, (char *)string);
 
                 bufptr += 2 + n;
 		n = (bufptr[0] << 8) | bufptr[1];
@@ -3578,7 +3660,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		bufptr[2 + n] = '\0';
-                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
+                value->string.text = ipp_strdup(ipp, (char *)bufptr + 2);
 	        break;
 
             case IPP_TAG_BEGIN_COLLECTION :
@@ -3651,7 +3733,10 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
+		attr->name = ipp_strdup(ipp, (char *)buffer);
+
+                if (ipp->name_index)
+                  ipp_index_add(ipp, attr, ipp->prev);
 
                /*
 	        * Since collection members are encoded differently than
@@ -3679,7 +3764,7 @@ ippReadIO(void       *src,		/* I - Data source */
 
 	        if (n > 0)
 		{
-		  if ((value->unknown.data = malloc((size_t)n)) == NULL)
+		  if ((value->unknown.data = ipp_alloc(ipp, (size_t)n)) == NULL)
 		  {
 		    _cupsSetHTTPError(HTTP_STATUS_ERROR);
 		    DEBUG_puts("1ippReadIO: Unable to allocate value");
@@ -3970,10 +4055,12 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
   * Set the value and return...
   */
 
-  if ((temp = _cupsStrAlloc(name)) != NULL)
+  if ((temp = ipp_strdup(ipp, name)) != NULL)
   {
+    ipp_index_free(ipp);
+
     if ((*attr)->name)
-      _cupsStrFree((*attr)->name);
+      ipp_strfree(*attr, (*attr)->name);
 
     (*attr)->name = temp;
   }
@@ -4043,7 +4130,7 @@ ippSetOctetString(
 	* Free previous data...
 	*/
 
-	free(value->unknown.data);
+	ipp_free(*attr, value->unknown.data);
 
 	value->unknown.data   = NULL;
         value->unknown.length = 0;
@@ -4053,7 +4140,7 @@ ippSetOctetString(
       {
 	void	*temp;			/* Temporary data pointer */
 
-	if ((temp = malloc((size_t)datalen)) != NULL)
+	if ((temp = ipp_alloc(ipp, (size_t)datalen)) != NULL)
 	{
 	  memcpy(temp, data, (size_t)datalen);
 
@@ -4335,10 +4422,10 @@ ippSetString(ipp_t           *ipp,	/* I  - IPP message */
 
     if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
       value->string.text = (char *)strvalue;
-    else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
+    else if ((temp = ipp_strdup(ipp, strvalue)) != NULL)
     {
       if (value->string.text)
-        _cupsStrFree(value->string.text);
+        ipp_strfree(*attr, value->string.text);
 
       value->string.text = temp;
     }
@@ -4659,7 +4746,7 @@ ippSetValueTag(
           */
 
 	  (*attr)->values[0].string.language =
-	      _cupsStrAlloc(ipp->attrs->next->values[0].string.text);
+	      ipp_strdup(ipp, ipp->attrs->next->values[0].string.text);
         }
         else
         {
@@ -4668,7 +4755,7 @@ ippSetValueTag(
           */
 
 	  language = cupsLangDefault();
-	  (*attr)->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language->language,
+	  (*attr)->values[0].string.language = ipp_strdup(ipp, ipp_lang_code(language->language,
 									code,
 									sizeof(code)));
         }
@@ -4687,7 +4774,7 @@ ippSetValueTag(
 	  for (i = (*attr)->num_values, value = (*attr)->values;
 	       i > 0;
 	       i --, value ++)
-	    value->string.text = _cupsStrAlloc(value->string.text);
+	    value->string.text = ipp_strdup(ipp, value->string.text);
         }
 
         (*attr)->value_tag = IPP_TAG_NAMELANG;
@@ -5879,6 +5966,25 @@ ippWriteIO(void       *dst,		/* I - Destination */
                   DEBUG_printf(("2ippWriteIO: writing string=%d,\"%s\"", n,
 		                value->string.text));
 
+                  if (n >= IPP_WRITE_DIRECT)
+		  {
+		   /*
+		    * Write large strings directly from the attribute...
+		    */
+
+		    if (ipp_write_direct(dst, cb, buffer, bufptr,
+		                         value->string.text, n) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
+
+		    bufptr = buffer;
+		    continue;
+		  }
+
                   if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
 		  {
                     if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
@@ -6287,6 +6393,25 @@ ippWriteIO(void       *dst,		/* I - Destination */
 		    return (IPP_STATE_ERROR);
 		  }
 
+                  if (n >= IPP_WRITE_DIRECT)
+		  {
+		   /*
+		    * Write large values directly from the attribute...
+		    */
+
+		    if (ipp_write_direct(dst, cb, buffer, bufptr,
+		                         value->unknown.data, n) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
+
+		    bufptr = buffer;
+		    continue;
+		  }
+
                   if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
 		  {
                     if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
@@ -6420,8 +6545,8 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
   else
     alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
+  attr = ipp_alloc(ipp, sizeof(ipp_attribute_t) +
+                       (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
 
   if (attr)
   {
@@ -6429,8 +6554,10 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
     * Initialize attribute...
     */
 
+    attr->in_arena = ipp->arena != NULL;
+
     if (name)
-      attr->name = _cupsStrAlloc(name);
+      attr->name = ipp_strdup(ipp, name);
 
     attr->group_tag  = group_tag;
     attr->value_tag  = value_tag;
@@ -6445,6 +6572,15 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
     else
       ipp->attrs = attr;
 
+    if (ipp->name_index)
+    {
+      if (name)
+        ipp_index_add(ipp, attr, ipp->last);
+
+      if (ipp->name_index)
+        ipp->name_index->last = attr;
+    }
+
     ipp->prev = ipp->last;
     ipp->last = ipp->current = attr;
   }
@@ -6455,6 +6591,92 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 }
 
 
+/*
+ * 'ipp_alloc()' - Allocate zeroed memory for a message.
+ *
+ * Messages created with ippNewWithArena() allocate from their arena, other
+ * messages use calloc().
+ */
+
+static void *				/* O - Memory or NULL on error */
+ipp_alloc(ipp_t  *ipp,			/* I - IPP message */
+          size_t bytes)			/* I - Number of bytes */
+{
+  _ipp_arena_t	*block,			/* Current arena block */
+		*temp;			/* New arena block */
+  size_t	size;			/* Size of new block */
+  void		*ptr;			/* Allocated memory */
+
+
+  if (!ipp->arena)
+    return (calloc(1, bytes));
+
+ /*
+  * Keep everything aligned for pointers and doubles...
+  */
+
+  bytes = (bytes + sizeof(double) - 1) & ~(sizeof(double) - 1);
+  block = ipp->arena;
+
+  if (bytes > (block->size - block->used))
+  {
+   /*
+    * Add a new block, doubling the size up to IPP_ARENA_MAX bytes.  Large
+    * allocations get their own block which is put after the current one so
+    * that the free space there can still be used...
+    */
+
+    if ((size = 2 * block->size) > IPP_ARENA_MAX)
+      size = IPP_ARENA_MAX;
+    if (size < bytes)
+      size = bytes;
+
+    if ((temp = malloc(offsetof(_ipp_arena_t, data) + size)) == NULL)
+      return (NULL);
+
+    temp->size = size;
+    temp->used = 0;
+
+    if ((size - bytes) >= (block->size - block->used))
+    {
+      temp->next = block;
+      ipp->arena = temp;
+    }
+    else
+    {
+      temp->next  = block->next;
+      block->next = temp;
+    }
+
+    block = temp;
+  }
+
+  ptr         = (char *)block->data + block->used;
+  block->used += bytes;
+
+  memset(ptr, 0, bytes);
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_free()' - Free memory allocated with ipp_alloc().
+ */
+
+static void
+ipp_free(ipp_attribute_t *attr,		/* I - Attribute */
+         void            *ptr)		/* I - Memory to free */
+{
+ /*
+  * Arena memory is freed all at once by ippDelete()...
+  */
+
+  if (!attr->in_arena)
+    free(ptr);
+}
+
+
 /*
  * 'ipp_free_values()' - Free attribute values.
  */
@@ -6484,7 +6706,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	  if (element == 0 && count == attr->num_values &&
 	      attr->values[0].string.language)
 	  {
-	    _cupsStrFree(attr->values[0].string.language);
+	    ipp_strfree(attr, attr->values[0].string.language);
 	    attr->values[0].string.language = NULL;
 	  }
 	  /* Fall through to other string values */
@@ -6502,7 +6724,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	       i > 0;
 	       i --, value ++)
 	  {
-	    _cupsStrFree(value->string.text);
+	    ipp_strfree(attr, value->string.text);
 	    value->string.text = NULL;
 	  }
 	  break;
@@ -6539,7 +6761,7 @@ ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
 	  {
 	    if (value->unknown.data)
 	    {
-	      free(value->unknown.data);
+	      ipp_free(attr, value->unknown.data);
 	      value->unknown.data = NULL;
 	    }
 	  }
@@ -6623,6 +6845,266 @@ ipp_lang_code(const char *locale,	/* I - Locale string */
 }
 
 
+/*
+ * 'ipp_index_add()' - Add an attribute to the name index.
+ *
+ * Only the first attribute with a given name is indexed, which is where
+ * ippFindAttribute() starts.  The index is created as needed.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+ipp_index_add(ipp_t           *ipp,	/* I - IPP message */
+              ipp_attribute_t *attr,	/* I - Attribute */
+	      ipp_attribute_t *prev)	/* I - Attribute before it */
+{
+  _ipp_index_t	*index = ipp->name_index,
+					/* Name index */
+		*temp;			/* New name index */
+  _ipp_name_t	*entry;			/* Index entry */
+  unsigned	hash;			/* Hash of name */
+  size_t	i,			/* Looping var */
+		alloc_names;		/* Number of hash slots */
+
+
+  hash = ipp_index_hash(attr->name);
+
+ /*
+  * Grow the index as needed, keeping it at most half full...
+  */
+
+  if (!index || (index->num_names + 1) * 2 > index->alloc_names)
+  {
+    alloc_names = index ? 2 * index->alloc_names : 2 * IPP_INDEX_MIN;
+
+    if ((temp = calloc(1, sizeof(_ipp_index_t) + (alloc_names - 1) *
+                              sizeof(_ipp_name_t))) == NULL)
+    {
+      ipp_index_free(ipp);
+      return (0);
+    }
+
+    temp->alloc_names = alloc_names;
+
+    if (index)
+    {
+      temp->last = index->last;
+
+      for (i = 0; i < index->alloc_names; i ++)
+        if (index->names[i].attr)
+	{
+	  entry  = ipp_index_lookup(temp, index->names[i].attr->name,
+	                            index->names[i].hash);
+	  *entry = index->names[i];
+	  temp->num_names ++;
+	}
+
+      free(index);
+    }
+
+    ipp->name_index = index = temp;
+  }
+
+ /*
+  * Add the attribute if it is the first one with the name...
+  */
+
+  if ((entry = ipp_index_lookup(index, attr->name, hash))->attr == NULL)
+  {
+    entry->hash = hash;
+    entry->attr = attr;
+    entry->prev = prev;
+
+    index->num_names ++;
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'ipp_index_find()' - Find the first attribute with a name using the index.
+ *
+ * The index is built the first time a message with at least IPP_INDEX_MIN
+ * attributes is searched.  Returns 0 if the message is not indexed, in which
+ * case "attr" and "prev" are unchanged.
+ */
+
+static int				/* O - 1 if indexed, 0 otherwise */
+ipp_index_find(ipp_t           *ipp,	/* I - IPP message */
+               const char      *name,	/* I - Attribute name */
+	       ipp_attribute_t **attr,	/* O - First attribute or NULL */
+	       ipp_attribute_t **prev)	/* O - Attribute before it */
+{
+  _ipp_index_t		*index;		/* Name index */
+  _ipp_name_t		*entry;		/* Index entry */
+  ipp_attribute_t	*current,	/* Current attribute */
+			*previous;	/* Previous attribute */
+  unsigned		hash;		/* Hash of name */
+  int			count;		/* Number of attributes */
+
+
+  if ((index = ipp->name_index) != NULL && index->last != ipp->last)
+  {
+   /*
+    * The attribute list was changed behind our back...
+    */
+
+    ipp_index_free(ipp);
+    index = NULL;
+  }
+
+  if (!index)
+  {
+   /*
+    * Only index larger messages...
+    */
+
+    for (count = 0, current = ipp->attrs;
+         current && count < IPP_INDEX_MIN;
+	 count ++, current = current->next);
+
+    if (count < IPP_INDEX_MIN)
+      return (0);
+
+    for (previous = NULL, current = ipp->attrs;
+         current;
+	 previous = current, current = current->next)
+      if (current->name && !ipp_index_add(ipp, current, previous))
+        return (0);
+
+    if ((index = ipp->name_index) == NULL)
+      return (0);
+
+    index->last = ipp->last;
+  }
+
+  hash = ipp_index_hash(name);
+
+  entry = ipp_index_lookup(index, name, hash);
+  *attr = entry->attr;
+  *prev = entry->attr ? entry->prev : NULL;
+
+  return (1);
+}
+
+
+/*
+ * 'ipp_index_free()' - Free the name index for a message.
+ *
+ * This is called whenever attributes are removed or renamed; the index is
+ * rebuilt by the next search.
+ */
+
+static void
+ipp_index_free(ipp_t *ipp)		/* I - IPP message */
+{
+  if (ipp->name_index)
+  {
+    free(ipp->name_index);
+    ipp->name_index = NULL;
+  }
+}
+
+
+/*
+ * 'ipp_index_hash()' - Compute the case-insensitive hash of a name.
+ */
+
+static unsigned				/* O - Hash value (FNV-1a) */
+ipp_index_hash(const char *name)	/* I - Attribute name */
+{
+  unsigned	hash;			/* Hash value */
+
+
+  for (hash = 2166136261U; *name; name ++)
+    hash = (hash ^ (unsigned)_cups_tolower(*name)) * 16777619U;
+
+  return (hash);
+}
+
+
+/*
+ * 'ipp_index_lookup()' - Find the slot for a name in the index.
+ */
+
+static _ipp_name_t *			/* O - Matching or empty slot */
+ipp_index_lookup(_ipp_index_t *index,	/* I - Name index */
+                 const char   *name,	/* I - Attribute name */
+		 unsigned     hash)	/* I - Hash of name */
+{
+  size_t	i,			/* Current slot */
+		mask = index->alloc_names - 1;
+					/* Mask for slot numbers */
+  _ipp_name_t	*entry;			/* Current entry */
+
+
+  for (i = hash & mask, entry = index->names + i;
+       entry->attr;
+       i = (i + 1) & mask, entry = index->names + i)
+    if (entry->hash == hash && !_cups_strcasecmp(entry->attr->name, name))
+      break;
+
+  return (entry);
+}
+
+
+/*
+ * 'ipp_index_replace()' - Update the name index for a reallocated attribute.
+ */
+
+static void
+ipp_index_replace(ipp_t           *ipp,	/* I - IPP message */
+                  ipp_attribute_t *oldattr,
+					/* I - Old attribute pointer */
+		  ipp_attribute_t *newattr)
+					/* I - New attribute pointer */
+{
+  _ipp_index_t	*index = ipp->name_index;
+					/* Name index */
+  _ipp_name_t	*entry;			/* Index entry */
+  unsigned	hash;			/* Hash of name */
+  size_t	i,			/* Current slot */
+		mask;			/* Mask for slot numbers */
+
+
+  if (!index)
+    return;
+
+  if (index->last == oldattr)
+    index->last = newattr;
+
+ /*
+  * Update the entry for this attribute and for the one after it, which may
+  * reference this attribute as its previous attribute.  The old attribute
+  * may already be freed, so match its entry by pointer rather than using
+  * ipp_index_lookup()...
+  */
+
+  if (newattr->name)
+  {
+    hash = ipp_index_hash(newattr->name);
+    mask = index->alloc_names - 1;
+
+    for (i = hash & mask, entry = index->names + i;
+	 entry->attr;
+	 i = (i + 1) & mask, entry = index->names + i)
+      if (entry->attr == oldattr)
+      {
+        entry->attr = newattr;
+	break;
+      }
+  }
+
+  if (newattr->next && newattr->next->name)
+  {
+    hash = ipp_index_hash(newattr->next->name);
+
+    if ((entry = ipp_index_lookup(index, newattr->next->name, hash))->prev == oldattr)
+      entry->prev = newattr;
+  }
+}
+
+
 /*
  * 'ipp_length()' - Compute the length of an IPP message or collection value.
  */
@@ -6952,7 +7434,20 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * Reallocate memory...
   */
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
+  if (temp->in_arena)
+  {
+   /*
+    * Arena memory cannot be resized, so allocate a new attribute and leave
+    * the old memory for ippDelete()...
+    */
+
+    if ((temp = ipp_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, offsetof(ipp_attribute_t, values) + (size_t)(*attr)->num_values * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
   {
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
     DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
@@ -7014,6 +7509,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
     if (ipp->last == *attr)
       ipp->last = temp;
 
+    ipp_index_replace(ipp, *attr, temp);
+
     *attr = temp;
   }
 
@@ -7028,6 +7525,84 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 }
 
 
+/*
+ * 'ipp_strdup()' - Copy a string for a message.
+ *
+ * Messages created with ippNewWithArena() copy strings into their arena,
+ * other messages use the shared string pool.
+ */
+
+static char *				/* O - Copy of string or NULL */
+ipp_strdup(ipp_t      *ipp,		/* I - IPP message */
+           const char *s)		/* I - String to copy */
+{
+  char		*temp;			/* Copy of string */
+  size_t	bytes;			/* Size of string */
+
+
+  if (!s)
+    return (NULL);
+
+  if (!ipp || !ipp->arena)
+    return (_cupsStrAlloc(s));
+
+  bytes = strlen(s) + 1;
+
+  if ((temp = ipp_alloc(ipp, bytes)) != NULL)
+    memcpy(temp, s, bytes);
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_strfree()' - Free a string copied with ipp_strdup().
+ */
+
+static void
+ipp_strfree(ipp_attribute_t *attr,	/* I - Attribute */
+            char            *s)		/* I - String to free */
+{
+  if (!attr->in_arena)
+    _cupsStrFree(s);
+}
+
+
+/*
+ * 'ipp_write_direct()' - Write buffered data followed by a large value.
+ *
+ * The value's 2-byte length is added to the buffer, and the value itself is
+ * passed to the write callback without being copied so that HTTP connections
+ * can send it along with the buffered data in a single writev() call.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+ipp_write_direct(void        *dst,	/* I - Destination */
+                 ipp_iocb_t  cb,	/* I - Write callback function */
+		 ipp_uchar_t *buffer,	/* I - Data buffer */
+		 ipp_uchar_t *bufptr,	/* I - Pointer into buffer */
+		 const void  *data,	/* I - Value data */
+		 int         n)		/* I - Length of value */
+{
+  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 2)
+  {
+    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+      return (-1);
+
+    bufptr = buffer;
+  }
+
+  *bufptr++ = (ipp_uchar_t)(n >> 8);
+  *bufptr++ = (ipp_uchar_t)n;
+
+  if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0 ||
+      (*cb)(dst, (ipp_uchar_t *)data, (size_t)n) < 0)
+    return (-1);
+
+  return (0);
+}
+
+
 /*
  * 'ipp_write_file()' - Write IPP data to a file.
  */
@@ -793,6 +793,8 @@ struct _ipp_attribute_s			/**** Attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+/**** New in CUPS 2.1 ****/
+  int		in_arena;		/* Allocated from the message arena? @since CUPS 2.1@ */
   _ipp_value_t	values[1];		/* Values */
 };
 
@@ -813,6 +815,9 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** New in CUPS 2.1 ****/
+  struct _ipp_arena_s	*arena;		/* Memory arena or NULL @since CUPS 2.1@ */
+  struct _ipp_index_s	*name_index;	/* Attribute name index or NULL @since CUPS 2.1@ */
 };
 #  endif /* _IPP_PRIVATE_STRUCTURES */
 
@@ -1010,6 +1015,9 @@ extern int		ippValidateAttributes(ipp_t *ipp) _CUPS_API_1_7;
 /**** New in CUPS 2.0 ****/
 extern const char	*ippStateString(ipp_state_t state) _CUPS_API_2_0;
 
+/**** New in CUPS 2.1 ****/
+extern ipp_t		*ippNewWithArena(void) _CUPS_API_2_1;
+
 
 /*
  * C++ magic...
@@ -349,6 +349,29 @@ cupsMarkOptions(
 }
 
 
+/*
+ * '_ppdFindChoice()' - Return a pointer to an option choice using the PPD
+ *                      file's hash index.
+ *
+ * Options with only a few choices are searched linearly.
+ */
+
+ppd_choice_t *				/* O - Choice pointer or @code NULL@ */
+_ppdFindChoice(ppd_file_t   *ppd,	/* I - PPD file */
+               ppd_option_t *o,		/* I - Pointer to option */
+	       const char   *choice)	/* I - Name of choice */
+{
+  if (!ppd || !ppd->index || !o || !choice ||
+      o->num_choices < _PPD_INDEX_CHOICES)
+    return (ppdFindChoice(o, choice));
+
+  if (choice[0] == '{' || !_cups_strncasecmp(choice, "Custom.", 7))
+    choice = "Custom";
+
+  return (_ppdIndexFindChoice(ppd->index, o, choice));
+}
+
+
 /*
  * 'ppdFindChoice()' - Return a pointer to an option choice.
  */
@@ -419,7 +442,15 @@ ppdFindOption(ppd_file_t *ppd,		/* I - PPD file data */
   if (!ppd || !option)
     return (NULL);
 
-  if (ppd->options)
+  if (ppd->index)
+  {
+   /*
+    * Search in the hash index...
+    */
+
+    return (_ppdIndexFindOption(ppd->index, option));
+  }
+  else if (ppd->options)
   {
    /*
     * Search in the array...
@@ -958,15 +989,8 @@ ppd_mark_option(ppd_file_t *ppd,	/* I - PPD file */
       cupsFreeOptions(num_vals, vals);
     }
   }
-  else
-  {
-    for (i = o->num_choices, c = o->choices; i > 0; i --, c ++)
-      if (!_cups_strcasecmp(c->choice, choice))
-        break;
-
-    if (!i)
-      return;
-  }
+  else if ((c = _ppdFindChoice(ppd, o, choice)) == NULL)
+    return;
 
  /*
   * Option found; mark it and then handle unmarking any other options.
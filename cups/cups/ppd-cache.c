@@ -190,6 +190,10 @@ _ppdCacheCreateWithFile(
     {
       pc->single_file = !_cups_strcasecmp(value, "true");
     }
+    else if (!_cups_strcasecmp(line, "PersistentFilter"))
+    {
+      pc->persistent_filter = _cupsStrAlloc(value);
+    }
     else if (!_cups_strcasecmp(line, "IPP"))
     {
       off_t	pos = cupsFileTell(fp),	/* Position in file */
@@ -1315,6 +1319,10 @@ _ppdCacheCreateWithPPD(ppd_file_t *ppd)	/* I - PPD file */
   if ((ppd_attr = ppdFindAttr(ppd, "cupsSingleFile", NULL)) != NULL)
     pc->single_file = !_cups_strcasecmp(ppd_attr->value, "true");
 
+  if ((ppd_attr = ppdFindAttr(ppd, "cupsPersistentFilter", NULL)) != NULL &&
+      ppd_attr->value && *ppd_attr->value)
+    pc->persistent_filter = _cupsStrAlloc(ppd_attr->value);
+
  /*
   * Copy the product string, if any...
   */
@@ -1493,6 +1501,7 @@ _ppdCacheDestroy(_ppd_cache_t *pc)	/* I - PPD cache and mapping data */
   _cupsStrFree(pc->product);
   cupsArrayDelete(pc->filters);
   cupsArrayDelete(pc->prefilters);
+  _cupsStrFree(pc->persistent_filter);
   cupsArrayDelete(pc->finishings);
 
   _cupsStrFree(pc->charge_info_uri);
@@ -2391,6 +2400,9 @@ _ppdCacheWriteFile(
 
   cupsFilePrintf(fp, "SingleFile %s\n", pc->single_file ? "true" : "false");
 
+  if (pc->persistent_filter)
+    cupsFilePutConf(fp, "PersistentFilter", pc->persistent_filter);
+
  /*
   * Finishing options...
   */
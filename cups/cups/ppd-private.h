@@ -49,7 +49,8 @@ extern "C" {
  * Constants...
  */
 
-#  define _PPD_CACHE_VERSION	6	/* Version number in cache file */
+#  define _PPD_CACHE_VERSION	7	/* Version number in cache file */
+#  define _PPD_INDEX_CHOICES	8	/* Minimum choices for a choice index */
 
 
 /*
@@ -78,12 +79,20 @@ typedef struct _ppd_cups_uiconst_s	/**** Constraint from cupsUIConstraints ****/
   int		installable;		/* Installable option? */
 } _ppd_cups_uiconst_t;
 
+typedef struct _ppd_cups_uimask_s	/**** Compiled constraint bits ****/
+{
+  int		word;			/* Word in selection bitset */
+  unsigned	bits;			/* Bits that must all be set */
+} _ppd_cups_uimask_t;
+
 typedef struct _ppd_cups_uiconsts_s	/**** cupsUIConstraints ****/
 {
   char		resolver[PPD_MAX_NAME];	/* Resolver name */
   int		installable,		/* Constrained against any installable options? */
 		num_constraints;	/* Number of constraints */
   _ppd_cups_uiconst_t *constraints;	/* Constraints */
+  int		num_masks;		/* Number of compiled bit masks */
+  _ppd_cups_uimask_t *masks;		/* Compiled bit masks */
 } _ppd_cups_uiconsts_t;
 
 typedef enum _pwg_print_color_mode_e	/**** PWG print-color-mode indices ****/
@@ -109,6 +118,28 @@ typedef struct _pwg_finishings_s	/**** PWG finishings mapping data ****/
   cups_option_t		*options;	/* Options to apply */
 } _pwg_finishings_t;
 
+typedef struct _ppd_hash_s		/**** Hash index slot ****/
+{
+  unsigned	hash;			/* Hash of lowercase name */
+  int		position;		/* Position in sorted_attrs */
+  const char	*name,			/* Option, choice, or attribute name */
+		*spec;			/* Attribute specifier or NULL */
+  const void	*owner;			/* Option for choices, otherwise NULL */
+  void		*data;			/* Option, choice, or first attribute */
+} _ppd_hash_t;
+
+struct _ppd_index_s			/**** Option, choice, and attribute hash index ****/
+{
+  int		num_attrs;		/* Number of attributes that were indexed */
+  size_t	alloc_options,		/* Number of option slots (power of 2) */
+		alloc_choices,		/* Number of choice slots (power of 2) */
+		alloc_attrs;		/* Number of attribute slots (power of 2) */
+  _ppd_hash_t	*options,		/* Option slots */
+		*choices,		/* Choice slots */
+		*attrs,			/* Attribute name slots */
+		*specs;			/* Attribute name and specifier slots */
+};
+
 struct _ppd_cache_s			/**** PPD cache and PWG conversion data ****/
 {
   int		num_bins;		/* Number of output bins */
@@ -140,6 +171,7 @@ struct _ppd_cache_s			/**** PPD cache and PWG conversion data ****/
   cups_array_t	*filters,		/* cupsFilter/cupsFilter2 values */
 		*prefilters;		/* cupsPreFilter values */
   int		single_file;		/* cupsSingleFile value */
+  char		*persistent_filter;	/* cupsPersistentFilter value */
   cups_array_t	*finishings;		/* cupsIPPFinishings values */
   int		max_copies,		/* cupsMaxCopies value */
 		account_id,		/* cupsJobAccountId value */
@@ -187,10 +219,21 @@ extern const char	*_ppdCacheGetType(_ppd_cache_t *pc,
 			                  const char *media_type);
 extern int		_ppdCacheWriteFile(_ppd_cache_t *pc,
 			                   const char *filename, ipp_t *attrs);
+extern int		_ppdCheckBinary(const char *ppdfile,
+			                const char *binfile);
+extern ppd_choice_t	*_ppdFindChoice(ppd_file_t *ppd, ppd_option_t *o,
+			                const char *choice);
 extern void		_ppdFreeLanguages(cups_array_t *languages);
 extern cups_encoding_t	_ppdGetEncoding(const char *name);
 extern cups_array_t	*_ppdGetLanguages(ppd_file_t *ppd);
 extern unsigned		_ppdHashName(const char *name);
+extern int		_ppdIndexFindAttr(ppd_file_t *ppd, const char *name,
+			                  const char *spec, ppd_attr_t **attr);
+extern ppd_choice_t	*_ppdIndexFindChoice(_ppd_index_t *index,
+			                     ppd_option_t *option,
+			                     const char *choice);
+extern ppd_option_t	*_ppdIndexFindOption(_ppd_index_t *index,
+			                     const char *option);
 extern ppd_attr_t	*_ppdLocalizedAttr(ppd_file_t *ppd, const char *keyword,
 			                   const char *spec, const char *ll_CC);
 extern char		*_ppdNormalizeMakeAndModel(const char *make_and_model,
@@ -198,11 +241,15 @@ extern char		*_ppdNormalizeMakeAndModel(const char *make_and_model,
 						   size_t bufsize);
 extern ppd_file_t	*_ppdOpen(cups_file_t *fp,
 				  _ppd_localization_t localization);
+extern ppd_file_t	*_ppdOpenBinary(const char *ppdfile,
+			                const char *binfile);
 extern ppd_file_t	*_ppdOpenFile(const char *filename,
 				      _ppd_localization_t localization);
 extern int		_ppdParseOptions(const char *s, int num_options,
 			                 cups_option_t **options,
 					 _ppd_parse_t which);
+extern int		_ppdWriteBinary(ppd_file_t *ppd, const char *ppdfile,
+			                const char *binfile);
 extern const char	*_pwgInputSlotForSource(const char *media_source,
 			                        char *name, size_t namesize);
 extern const char	*_pwgMediaTypeForType(const char *media_type,
@@ -30,6 +30,10 @@
 
 #include "cups-private.h"
 #include "ppd-private.h"
+#include <sys/stat.h>
+#ifndef WIN32
+#  include <sys/mman.h>
+#endif /* !WIN32 */
 
 
 /*
@@ -45,6 +49,14 @@
 
 #define PPD_HASHSIZE	512		/* Size of hash */
 
+#define PPD_BIN_MAGIC	"CUPSPPDB"	/* Binary PPD magic string */
+#define PPD_BIN_VERSION	1		/* Binary PPD format version */
+#define PPD_BIN_ORDER	0x01020304	/* Binary PPD byte order mark */
+
+#define PPD_BIN_OFFSET(p) ((size_t)(p))	/* Pointer field to file offset */
+#define PPD_BIN_POINTER(o) ((void *)(size_t)(o))
+					/* File offset to pointer field */
+
 
 /*
  * Line buffer structure...
@@ -57,6 +69,52 @@ typedef struct _ppd_line_s
 } _ppd_line_t;
 
 
+/*
+ * Binary PPD file structures...
+ *
+ * A binary PPD file holds the parsed records in native byte order and
+ * structure layout, so it is only usable on the system that wrote it.  Pointer
+ * fields hold byte offsets from the start of the file (0 for NULL).  The file
+ * is mapped read-only while it is loaded; strings are added to the string pool
+ * like the PPD file parser does and the mapping is released before returning.
+ */
+
+typedef struct _ppd_bin_header_s	/**** Binary PPD file header ****/
+{
+  char		magic[8];		/* PPD_BIN_MAGIC */
+  unsigned	version,		/* PPD_BIN_VERSION */
+		byte_order,		/* PPD_BIN_ORDER */
+		layout[8];		/* Structure sizes */
+  long long	ppd_size,		/* Size of source PPD file */
+		ppd_mtime,		/* Modification time of source PPD file */
+		length;			/* Length of binary file */
+  int		num_coptions;		/* Number of custom options */
+  size_t	coptions;		/* Offset of custom options */
+  ppd_file_t	ppd;			/* PPD file record */
+} _ppd_bin_header_t;
+
+typedef struct _ppd_bin_coption_s	/**** Binary custom option ****/
+{
+  ppd_coption_t	coption;		/* Custom option, params is an offset */
+  int		num_params;		/* Number of parameters */
+} _ppd_bin_coption_t;
+
+typedef struct _ppd_bin_buffer_s	/**** Binary PPD output buffer ****/
+{
+  char		*data;			/* Buffer */
+  size_t	used,			/* Bytes used */
+		alloc;			/* Bytes allocated */
+  int		error;			/* Non-zero on allocation error */
+} _ppd_bin_buffer_t;
+
+typedef struct _ppd_bin_map_s		/**** Binary PPD file mapping ****/
+{
+  const char	*data;			/* Mapped file */
+  size_t	length;			/* Length of mapped file */
+  int		error;			/* Non-zero on bad data */
+} _ppd_bin_map_t;
+
+
 /*
  * Local functions...
  */
@@ -66,6 +124,43 @@ static ppd_attr_t	*ppd_add_attr(ppd_file_t *ppd, const char *name,
 				      const char *value);
 static ppd_choice_t	*ppd_add_choice(ppd_option_t *option, const char *name);
 static ppd_size_t	*ppd_add_size(ppd_file_t *ppd, const char *name);
+#ifndef WIN32
+static size_t		ppd_bin_add(_ppd_bin_buffer_t *buf, const void *data,
+			            size_t bytes, int align);
+static size_t		ppd_bin_add_string(_ppd_bin_buffer_t *buf,
+			                   const char *s);
+static char		*ppd_bin_alloc_string(_ppd_bin_map_t *map,
+			                      const void *offset);
+static void		*ppd_bin_array(_ppd_bin_map_t *map, const void *offset,
+			               int count, size_t size);
+static int		ppd_bin_check(const _ppd_bin_header_t *header,
+			              struct stat *ppdinfo,
+				      struct stat *bininfo);
+static const void	*ppd_bin_data(_ppd_bin_map_t *map, const void *offset,
+			              int count, size_t size);
+static size_t		ppd_bin_groups(_ppd_bin_buffer_t *buf,
+			               ppd_group_t *groups, int num_groups);
+static char		*ppd_bin_keyword(ppd_file_t *ppd, _ppd_bin_map_t *map,
+			                 const char *keyword,
+					 const void *offset);
+static void		ppd_bin_layout(unsigned *layout);
+static ppd_group_t	*ppd_bin_load_groups(_ppd_bin_map_t *map,
+			                     const void *offset,
+			                     int num_groups, int depth);
+static ppd_option_t	*ppd_bin_load_options(_ppd_bin_map_t *map,
+			                      const void *offset,
+			                      int num_options);
+static char		**ppd_bin_load_strings(_ppd_bin_map_t *map,
+			                       const void *offset,
+			                       int num_strings);
+static size_t		ppd_bin_options(_ppd_bin_buffer_t *buf,
+			                ppd_option_t *options,
+			                int num_options);
+static const char	*ppd_bin_string(_ppd_bin_map_t *map,
+			                const void *offset);
+static size_t		ppd_bin_strings(_ppd_bin_buffer_t *buf, char **strings,
+			                int num_strings);
+#endif /* !WIN32 */
 static int		ppd_compare_attrs(ppd_attr_t *a, ppd_attr_t *b);
 static int		ppd_compare_choices(ppd_choice_t *a, ppd_choice_t *b);
 static int		ppd_compare_coptions(ppd_coption_t *a,
@@ -83,7 +178,13 @@ static ppd_group_t	*ppd_get_group(ppd_file_t *ppd, const char *name,
 			               const char *text, _cups_globals_t *cg,
 				       cups_encoding_t encoding);
 static ppd_option_t	*ppd_get_option(ppd_group_t *group, const char *name);
+static unsigned		ppd_hash_name(const char *name);
 static int		ppd_hash_option(ppd_option_t *option);
+static void		ppd_index_hash(ppd_file_t *ppd);
+static _ppd_hash_t	*ppd_index_lookup(_ppd_hash_t *slots, size_t alloc,
+			                  const void *owner, const char *name,
+					  const char *spec, unsigned hash);
+static void		ppd_index_options(ppd_file_t *ppd);
 static int		ppd_read(cups_file_t *fp, _ppd_line_t *line,
 			         char *keyword, char *option, char *text,
 				 char **string, int ignoreblank,
@@ -261,12 +362,20 @@ ppdClose(ppd_file_t *ppd)		/* I - PPD file record */
 	 consts = (_ppd_cups_uiconsts_t *)cupsArrayNext(ppd->cups_uiconstraints))
     {
       free(consts->constraints);
+      free(consts->masks);
       free(consts);
     }
 
+    free(cupsArrayUserData(ppd->cups_uiconstraints));
     cupsArrayDelete(ppd->cups_uiconstraints);
   }
 
+ /*
+  * Free the hash index...
+  */
+
+  free(ppd->index);
+
  /*
   * Free any PPD cache/mapping data...
   */
@@ -352,6 +461,95 @@ _ppdGetEncoding(const char *name)	/* I - LanguageEncoding string */
 }
 
 
+/*
+ * '_ppdIndexFindAttr()' - Find the first attribute with a name and optional
+ *                         specifier using the hash index.
+ *
+ * On success the sorted attribute array is positioned at the attribute so
+ * that ppdFindNextAttr() works as usual.  Returns 0 if the PPD file is not
+ * indexed, in which case "attr" is unchanged.
+ */
+
+int					/* O - 1 if indexed, 0 otherwise */
+_ppdIndexFindAttr(ppd_file_t *ppd,	/* I - PPD file */
+                  const char *name,	/* I - Attribute name */
+		  const char *spec,	/* I - Specifier string or @code NULL@ */
+		  ppd_attr_t **attr)	/* O - First attribute or NULL */
+{
+  _ppd_index_t	*index = ppd->index;	/* Hash index */
+  _ppd_hash_t	*slot;			/* Matching slot */
+
+
+ /*
+  * Names that are too long are truncated when they are loaded; leave those
+  * to the sorted array search...
+  */
+
+  if (!index || !index->alloc_attrs || strlen(name) >= PPD_MAX_NAME ||
+      index->num_attrs != cupsArrayCount(ppd->sorted_attrs))
+    return (0);
+
+  if (spec)
+    slot = ppd_index_lookup(index->specs, index->alloc_attrs, NULL, name,
+                            spec, ppd_hash_name(name) ^ ppd_hash_name(spec));
+  else
+    slot = ppd_index_lookup(index->attrs, index->alloc_attrs, NULL, name,
+                            NULL, ppd_hash_name(name));
+
+  if (slot->data)
+    *attr = (ppd_attr_t *)cupsArrayIndex(ppd->sorted_attrs, slot->position);
+  else
+    *attr = NULL;
+
+  return (1);
+}
+
+
+/*
+ * '_ppdIndexFindChoice()' - Find a choice using the hash index.
+ */
+
+ppd_choice_t *				/* O - Choice or NULL */
+_ppdIndexFindChoice(
+    _ppd_index_t *index,		/* I - Hash index */
+    ppd_option_t *option,		/* I - Option */
+    const char   *choice)		/* I - Choice name */
+{
+  return ((ppd_choice_t *)ppd_index_lookup(index->choices,
+                                           index->alloc_choices, option,
+					   choice, NULL,
+					   ppd_hash_name(choice))->data);
+}
+
+
+/*
+ * '_ppdIndexFindOption()' - Find an option using the hash index.
+ */
+
+ppd_option_t *				/* O - Option or NULL */
+_ppdIndexFindOption(
+    _ppd_index_t *index,		/* I - Hash index */
+    const char   *option)		/* I - Option name */
+{
+  char	key[PPD_MAX_NAME];		/* Option name as stored */
+
+
+ /*
+  * Option keywords are truncated when they are loaded...
+  */
+
+  if (strlen(option) >= sizeof(key))
+  {
+    strlcpy(key, option, sizeof(key));
+    option = key;
+  }
+
+  return ((ppd_option_t *)ppd_index_lookup(index->options,
+                                           index->alloc_options, NULL, option,
+					   NULL, ppd_hash_name(option))->data);
+}
+
+
 /*
  * 'ppdLastError()' - Return the status from the last ppdOpen*().
  *
@@ -383,7 +581,7 @@ _ppdOpen(
     cups_file_t		*fp,		/* I - File to read from */
     _ppd_localization_t	localization)	/* I - Localization to load */
 {
-  int			i, j, k;	/* Looping vars */
+  int			i, j;		/* Looping vars */
   int			count;		/* Temporary count */
   _ppd_line_t		line;		/* Line buffer */
   ppd_file_t		*ppd;		/* PPD file record */
@@ -1968,40 +2166,10 @@ _ppdOpen(
   }
 
  /*
-  * Create the sorted options array and set the option back-pointer for
-  * each choice and custom option...
-  */
-
-  ppd->options = cupsArrayNew2((cups_array_func_t)ppd_compare_options, NULL,
-                               (cups_ahash_func_t)ppd_hash_option,
-			       PPD_HASHSIZE);
-
-  for (i = ppd->num_groups, group = ppd->groups;
-       i > 0;
-       i --, group ++)
-  {
-    for (j = group->num_options, option = group->options;
-         j > 0;
-	 j --, option ++)
-    {
-      ppd_coption_t	*coption;	/* Custom option */
-
-
-      cupsArrayAdd(ppd->options, option);
-
-      for (k = 0; k < option->num_choices; k ++)
-        option->choices[k].option = option;
-
-      if ((coption = ppdFindCustomOption(ppd, option->keyword)) != NULL)
-        coption->option = option;
-    }
-  }
-
- /*
-  * Create an array to track the marked choices...
+  * Create the sorted options array and marked choices array...
   */
 
-  ppd->marked = cupsArrayNew((cups_array_func_t)ppd_compare_choices, NULL);
+  ppd_index_options(ppd);
 
  /*
   * Return the PPD file structure...
@@ -2071,6 +2239,367 @@ ppdOpen2(cups_file_t *fp)		/* I - File to read from */
 }
 
 
+/*
+ * '_ppdCheckBinary()' - See whether a binary PPD file is current.
+ *
+ * Only the header of the binary file is read.  1 is returned when it was
+ * written on this system from the current version of the source PPD file.
+ */
+
+int					/* O - 1 if current, 0 otherwise */
+_ppdCheckBinary(const char *ppdfile,	/* I - Source PPD file */
+                const char *binfile)	/* I - Binary PPD file */
+{
+#ifdef WIN32
+  (void)ppdfile;
+  (void)binfile;
+
+  return (0);
+
+#else
+  int			fd;		/* Binary PPD file */
+  struct stat		ppdinfo,	/* Source PPD file info */
+			bininfo;	/* Binary PPD file info */
+  _ppd_bin_header_t	header;		/* Binary PPD file header */
+  int			status;		/* Return status */
+
+
+  if (!ppdfile || !binfile || stat(ppdfile, &ppdinfo))
+    return (0);
+
+  if ((fd = open(binfile, O_RDONLY)) < 0)
+    return (0);
+
+  status = !fstat(fd, &bininfo) &&
+           read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+	   ppd_bin_check(&header, &ppdinfo, &bininfo);
+
+  close(fd);
+
+  return (status);
+#endif /* WIN32 */
+}
+
+
+/*
+ * '_ppdOpenBinary()' - Map a binary PPD file written by _ppdWriteBinary().
+ *
+ * The binary file is only used when it was written on this system from the
+ * current version of the source PPD file, otherwise @code NULL@ is returned
+ * and the caller should read the PPD file instead.  The records are copied
+ * from the memory-mapped file and the strings are added to the string pool,
+ * so the PPD file record is freed by ppdClose() like any other.
+ */
+
+ppd_file_t *				/* O - PPD file record or @code NULL@ */
+_ppdOpenBinary(const char *ppdfile,	/* I - Source PPD file */
+               const char *binfile)	/* I - Binary PPD file */
+{
+#ifdef WIN32
+  (void)ppdfile;
+  (void)binfile;
+
+  return (NULL);
+
+#else
+  int			i, j;		/* Looping vars */
+  int			fd;		/* Binary PPD file */
+  struct stat		ppdinfo,	/* Source PPD file info */
+			bininfo;	/* Binary PPD file info */
+  char			*data;		/* Mapped file */
+  const _ppd_bin_header_t *header;	/* Binary PPD file header */
+  const ppd_file_t	*src;		/* PPD file record in mapped file */
+  _ppd_bin_map_t	mapping,	/* Mapping record */
+			*map = &mapping;/* Pointer to mapping record */
+  ppd_file_t		*ppd;		/* PPD file record */
+  const char		*patches;	/* Patch commands */
+  const ppd_attr_t	*sattrs;	/* Attributes in mapped file */
+  ppd_attr_t		*attr;		/* Current attribute */
+  const _ppd_bin_coption_t *scoptions;	/* Custom options in mapped file */
+  ppd_coption_t		*coption;	/* Current custom option */
+  const ppd_cparam_t	*sparams;	/* Custom parameters in mapped file */
+  ppd_cparam_t		*cparam;	/* Current custom parameter */
+  _cups_globals_t	*cg = _cupsGlobals();
+					/* Global data */
+
+
+  DEBUG_printf(("_ppdOpenBinary(ppdfile=\"%s\", binfile=\"%s\")", ppdfile,
+                binfile));
+
+ /*
+  * Map the binary file...
+  */
+
+  if (!ppdfile || !binfile || stat(ppdfile, &ppdinfo))
+    return (NULL);
+
+  if ((fd = open(binfile, O_RDONLY)) < 0)
+    return (NULL);
+
+  if (fstat(fd, &bininfo) ||
+      bininfo.st_size < (off_t)sizeof(_ppd_bin_header_t))
+  {
+    close(fd);
+    return (NULL);
+  }
+
+  data = mmap(NULL, (size_t)bininfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return (NULL);
+
+ /*
+  * Validate the header...
+  */
+
+  header = (const _ppd_bin_header_t *)data;
+
+  if (!ppd_bin_check(header, &ppdinfo, &bininfo) ||
+      data[bininfo.st_size - 1])
+  {
+    DEBUG_puts("1_ppdOpenBinary: Binary PPD file is stale or invalid.");
+
+    munmap(data, (size_t)bininfo.st_size);
+    return (NULL);
+  }
+
+ /*
+  * Allocate the PPD file record...
+  */
+
+  if ((ppd = calloc(1, sizeof(ppd_file_t))) == NULL)
+  {
+    munmap(data, (size_t)bininfo.st_size);
+    return (NULL);
+  }
+
+  map->data   = data;
+  map->length = (size_t)bininfo.st_size;
+  map->error  = 0;
+
+ /*
+  * Copy the top-level values...
+  */
+
+  src = &(header->ppd);
+
+  ppd->language_level    = src->language_level;
+  ppd->color_device      = src->color_device;
+  ppd->variable_sizes    = src->variable_sizes;
+  ppd->accurate_screens  = src->accurate_screens;
+  ppd->contone_only      = src->contone_only;
+  ppd->landscape         = src->landscape;
+  ppd->model_number      = src->model_number;
+  ppd->manual_copies     = src->manual_copies;
+  ppd->throughput        = src->throughput;
+  ppd->colorspace        = src->colorspace;
+  ppd->flip_duplex       = src->flip_duplex;
+
+  memcpy(ppd->custom_min, src->custom_min, sizeof(ppd->custom_min));
+  memcpy(ppd->custom_max, src->custom_max, sizeof(ppd->custom_max));
+  memcpy(ppd->custom_margins, src->custom_margins,
+         sizeof(ppd->custom_margins));
+
+  ppd->jcl_begin     = ppd_bin_alloc_string(map, src->jcl_begin);
+  ppd->jcl_ps        = ppd_bin_alloc_string(map, src->jcl_ps);
+  ppd->jcl_end       = ppd_bin_alloc_string(map, src->jcl_end);
+  ppd->lang_encoding = ppd_bin_alloc_string(map, src->lang_encoding);
+  ppd->nickname      = ppd_bin_alloc_string(map, src->nickname);
+
+  if ((patches = ppd_bin_string(map, src->patches)) != NULL &&
+      (ppd->patches = strdup(patches)) == NULL)
+    map->error = 1;
+
+ /*
+  * Copy the emulations, groups, sizes, constraints, fonts, profiles, and
+  * filters...
+  */
+
+  if ((ppd->emulations = ppd_bin_array(map, src->emulations,
+                                       src->num_emulations,
+				       sizeof(ppd_emul_t))) != NULL)
+  {
+    ppd->num_emulations = src->num_emulations;
+
+    for (i = 0; i < ppd->num_emulations; i ++)
+    {
+      ppd->emulations[i].start = ppd_bin_alloc_string(map,
+                                                ppd->emulations[i].start);
+      ppd->emulations[i].stop  = ppd_bin_alloc_string(map,
+                                                ppd->emulations[i].stop);
+    }
+  }
+
+  if ((ppd->groups = ppd_bin_load_groups(map, src->groups, src->num_groups,
+                                         0)) != NULL)
+    ppd->num_groups = src->num_groups;
+
+  if ((ppd->sizes = ppd_bin_array(map, src->sizes, src->num_sizes,
+                                  sizeof(ppd_size_t))) != NULL)
+    ppd->num_sizes = src->num_sizes;
+
+  if ((ppd->consts = ppd_bin_array(map, src->consts, src->num_consts,
+                                   sizeof(ppd_const_t))) != NULL)
+    ppd->num_consts = src->num_consts;
+
+  if ((ppd->fonts = ppd_bin_load_strings(map, src->fonts,
+                                         src->num_fonts)) != NULL)
+    ppd->num_fonts = src->num_fonts;
+
+  if ((ppd->profiles = ppd_bin_array(map, src->profiles, src->num_profiles,
+                                     sizeof(ppd_profile_t))) != NULL)
+    ppd->num_profiles = src->num_profiles;
+
+  if ((ppd->filters = ppd_bin_load_strings(map, src->filters,
+                                           src->num_filters)) != NULL)
+    ppd->num_filters = src->num_filters;
+
+ /*
+  * Copy the attributes; each one is allocated separately since ppdClose()
+  * frees them that way...
+  */
+
+  if ((sattrs = ppd_bin_data(map, src->attrs, src->num_attrs,
+                             sizeof(ppd_attr_t))) != NULL)
+  {
+    if ((ppd->attrs = calloc((size_t)src->num_attrs,
+                             sizeof(ppd_attr_t *))) == NULL ||
+        (ppd->sorted_attrs =
+	     cupsArrayNew((cups_array_func_t)ppd_compare_attrs,
+	                  NULL)) == NULL)
+      map->error = 1;
+    else
+    {
+      for (i = 0; i < src->num_attrs; i ++)
+      {
+        if ((attr = malloc(sizeof(ppd_attr_t))) == NULL)
+	{
+	  map->error = 1;
+	  break;
+	}
+
+        *attr       = sattrs[i];
+	attr->value = ppd_bin_alloc_string(map, sattrs[i].value);
+
+        ppd->attrs[ppd->num_attrs ++] = attr;
+
+        cupsArrayAdd(ppd->sorted_attrs, attr);
+      }
+    }
+  }
+
+ /*
+  * Copy the custom options...
+  */
+
+  if ((ppd->coptions = cupsArrayNew((cups_array_func_t)ppd_compare_coptions,
+                                    NULL)) == NULL)
+    map->error = 1;
+  else if ((scoptions = ppd_bin_data(map, PPD_BIN_POINTER(header->coptions),
+                                     header->num_coptions,
+				     sizeof(_ppd_bin_coption_t))) != NULL)
+  {
+    for (i = 0; i < header->num_coptions; i ++)
+    {
+      if ((coption = malloc(sizeof(ppd_coption_t))) == NULL)
+      {
+        map->error = 1;
+	break;
+      }
+
+      *coption         = scoptions[i].coption;
+      coption->option  = NULL;
+      coption->params  = cupsArrayNew((cups_array_func_t)NULL, NULL);
+
+      cupsArrayAdd(ppd->coptions, coption);
+
+      if ((sparams = ppd_bin_data(map, scoptions[i].coption.params,
+                                  scoptions[i].num_params,
+				  sizeof(ppd_cparam_t))) == NULL)
+        continue;
+
+      for (j = 0; j < scoptions[i].num_params; j ++)
+      {
+        if ((cparam = malloc(sizeof(ppd_cparam_t))) == NULL)
+	{
+	  map->error = 1;
+	  break;
+	}
+
+        *cparam = sparams[j];
+
+	switch (cparam->type)
+	{
+	  case PPD_CUSTOM_PASSCODE :
+	  case PPD_CUSTOM_PASSWORD :
+	  case PPD_CUSTOM_STRING :
+	      cparam->current.custom_string =
+	          ppd_bin_alloc_string(map, sparams[j].current.custom_string);
+	      break;
+
+	  default :
+	      break;
+	}
+
+        if (!cupsArrayAdd(coption->params, cparam))
+	{
+	  free(cparam);
+	  map->error = 1;
+	  break;
+	}
+      }
+    }
+  }
+
+ /*
+  * The remaining top-level strings point to the values of the matching
+  * attributes, just like the PPD file parser...
+  */
+
+  ppd->lang_version  = ppd_bin_keyword(ppd, map, "LanguageVersion",
+                                       src->lang_version);
+  ppd->modelname     = ppd_bin_keyword(ppd, map, "ModelName", src->modelname);
+  ppd->ttrasterizer  = ppd_bin_keyword(ppd, map, "TTRasterizer",
+                                       src->ttrasterizer);
+  ppd->manufacturer  = ppd_bin_keyword(ppd, map, "Manufacturer",
+                                       src->manufacturer);
+  ppd->product       = ppd_bin_keyword(ppd, map, "Product", src->product);
+  ppd->shortnickname = ppd_bin_keyword(ppd, map, "ShortNickName",
+                                       src->shortnickname);
+  ppd->protocols     = ppd_bin_keyword(ppd, map, "Protocols", src->protocols);
+  ppd->pcfilename    = ppd_bin_keyword(ppd, map, "PCFileName",
+                                       src->pcfilename);
+
+ /*
+  * Nothing refers to the mapped file after this point...
+  */
+
+  munmap(data, (size_t)bininfo.st_size);
+
+  if (map->error)
+  {
+    DEBUG_puts("1_ppdOpenBinary: Unable to load binary PPD file.");
+
+    ppdClose(ppd);
+    return (NULL);
+  }
+
+ /*
+  * Create the sorted options array and marked choices array...
+  */
+
+  ppd_index_options(ppd);
+
+  cg->ppd_status = PPD_OK;
+  cg->ppd_line   = 0;
+
+  return (ppd);
+#endif /* WIN32 */
+}
+
+
 /*
  * 'ppdOpenFd()' - Read a PPD file into memory.
  */
@@ -2131,6 +2660,10 @@ _ppdOpenFile(const char		  *filename,	/* I - File to read from */
 {
   cups_file_t		*fp;		/* File pointer */
   ppd_file_t		*ppd;		/* PPD file record */
+  const char		*ppdenv,	/* PPD environment variable */
+			*cachedir,	/* CUPS_CACHEDIR environment variable */
+			*printer;	/* PRINTER environment variable */
+  char			binfile[1024];	/* Binary PPD filename */
   _cups_globals_t	*cg = _cupsGlobals();
 					/* Global data */
 
@@ -2152,6 +2685,23 @@ _ppdOpenFile(const char		  *filename,	/* I - File to read from */
     return (NULL);
   }
 
+ /*
+  * Filters opening the printer's PPD file can use the binary copy that the
+  * scheduler keeps in its cache directory.  It contains all localizations,
+  * which is a superset of what was asked for...
+  */
+
+  if (cg->ppd_conform == PPD_CONFORM_RELAXED &&
+      (ppdenv = getenv("PPD")) != NULL && !strcmp(filename, ppdenv) &&
+      (cachedir = getenv("CUPS_CACHEDIR")) != NULL &&
+      (printer = getenv("PRINTER")) != NULL && !strchr(printer, '/'))
+  {
+    snprintf(binfile, sizeof(binfile), "%s/%s.ppdb", cachedir, printer);
+
+    if ((ppd = _ppdOpenBinary(filename, binfile)) != NULL)
+      return (ppd);
+  }
+
  /*
   * Try to open the file and parse it...
   */
@@ -2201,10 +2751,313 @@ ppdSetConformance(ppd_conform_t c)	/* I - Conformance level */
 
 
 /*
- * 'ppd_add_attr()' - Add an attribute to the PPD data.
+ * '_ppdWriteBinary()' - Write a binary PPD file for _ppdOpenBinary().
+ *
+ * The PPD file record should come straight from _ppdOpenFile() for "ppdfile",
+ * normally with all localizations loaded so the binary file can serve any
+ * locale.  The binary file is replaced atomically so that processes which
+ * have the previous version mapped are not affected.
  */
 
-static ppd_attr_t *			/* O - New attribute */
+int					/* O - 0 on success, -1 on error */
+_ppdWriteBinary(ppd_file_t *ppd,	/* I - PPD file record */
+                const char *ppdfile,	/* I - Source PPD file */
+                const char *binfile)	/* I - Binary PPD file */
+{
+#ifdef WIN32
+  (void)ppd;
+  (void)ppdfile;
+  (void)binfile;
+
+  return (-1);
+
+#else
+  int			i, j;		/* Looping vars */
+  struct stat		ppdinfo;	/* Source PPD file info */
+  _ppd_bin_buffer_t	buf;		/* Output buffer */
+  _ppd_bin_header_t	header;		/* File header */
+  ppd_file_t		*dst;		/* PPD file record in header */
+  ppd_emul_t		*emulations;	/* Emulations with offsets */
+  ppd_attr_t		*attrs;		/* Attributes with offsets */
+  ppd_coption_t		*coption;	/* Current custom option */
+  ppd_cparam_t		*cparam,	/* Current custom parameter */
+			*cparams;	/* Custom parameters with offsets */
+  _ppd_bin_coption_t	*coptions;	/* Custom options with offsets */
+  int			num_coptions;	/* Number of custom options */
+  int			fd;		/* Output file */
+  char			tempfile[1024];	/* Temporary filename */
+  const char		*ptr;		/* Pointer into buffer */
+  size_t		bytes;		/* Bytes left to write */
+  ssize_t		written;	/* Bytes written */
+
+
+  DEBUG_printf(("_ppdWriteBinary(ppd=%p, ppdfile=\"%s\", binfile=\"%s\")",
+                ppd, ppdfile, binfile));
+
+  if (!ppd || !ppdfile || !binfile || stat(ppdfile, &ppdinfo))
+    return (-1);
+
+ /*
+  * Reserve space for the header, which is filled in last...
+  */
+
+  memset(&buf, 0, sizeof(buf));
+  memset(&header, 0, sizeof(header));
+
+  ppd_bin_add(&buf, &header, sizeof(header), 1);
+
+  memcpy(header.magic, PPD_BIN_MAGIC, sizeof(header.magic));
+  header.version    = PPD_BIN_VERSION;
+  header.byte_order = PPD_BIN_ORDER;
+  header.ppd_size   = (long long)ppdinfo.st_size;
+  header.ppd_mtime  = (long long)ppdinfo.st_mtime;
+
+  ppd_bin_layout(header.layout);
+
+ /*
+  * Copy the top-level values, replacing pointers with offsets...
+  */
+
+  dst  = &(header.ppd);
+  *dst = *ppd;
+
+  dst->patches       = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->patches));
+  dst->jcl_begin     = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->jcl_begin));
+  dst->jcl_ps        = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->jcl_ps));
+  dst->jcl_end       = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->jcl_end));
+  dst->lang_encoding = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->lang_encoding));
+  dst->lang_version  = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->lang_version));
+  dst->modelname     = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->modelname));
+  dst->ttrasterizer  = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->ttrasterizer));
+  dst->manufacturer  = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->manufacturer));
+  dst->product       = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->product));
+  dst->nickname      = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->nickname));
+  dst->shortnickname = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->shortnickname));
+  dst->protocols     = PPD_BIN_POINTER(ppd_bin_add_string(&buf, ppd->protocols));
+  dst->pcfilename    = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+                                                          ppd->pcfilename));
+
+  dst->cur_attr           = 0;
+  dst->sorted_attrs       = NULL;
+  dst->options            = NULL;
+  dst->coptions           = NULL;
+  dst->marked             = NULL;
+  dst->cups_uiconstraints = NULL;
+  dst->cache              = NULL;
+  dst->index              = NULL;
+
+ /*
+  * Emulations...
+  */
+
+  dst->emulations = NULL;
+
+  if (ppd->num_emulations > 0)
+  {
+    if ((emulations = calloc((size_t)ppd->num_emulations,
+                             sizeof(ppd_emul_t))) == NULL)
+      buf.error = 1;
+    else
+    {
+      for (i = 0; i < ppd->num_emulations; i ++)
+      {
+        emulations[i]       = ppd->emulations[i];
+	emulations[i].start = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+	                          ppd->emulations[i].start));
+	emulations[i].stop  = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+	                          ppd->emulations[i].stop));
+      }
+
+      dst->emulations = PPD_BIN_POINTER(ppd_bin_add(&buf, emulations,
+                            (size_t)ppd->num_emulations * sizeof(ppd_emul_t),
+			    1));
+
+      free(emulations);
+    }
+  }
+
+ /*
+  * Groups, options, and choices...
+  */
+
+  dst->groups = PPD_BIN_POINTER(ppd_bin_groups(&buf, ppd->groups,
+                                               ppd->num_groups));
+
+ /*
+  * Sizes, constraints, fonts, profiles, and filters...
+  */
+
+  dst->sizes    = PPD_BIN_POINTER(ppd_bin_add(&buf, ppd->sizes,
+                      (size_t)ppd->num_sizes * sizeof(ppd_size_t), 1));
+  dst->consts   = PPD_BIN_POINTER(ppd_bin_add(&buf, ppd->consts,
+                      (size_t)ppd->num_consts * sizeof(ppd_const_t), 1));
+  dst->fonts    = PPD_BIN_POINTER(ppd_bin_strings(&buf, ppd->fonts,
+                                                  ppd->num_fonts));
+  dst->profiles = PPD_BIN_POINTER(ppd_bin_add(&buf, ppd->profiles,
+                      (size_t)ppd->num_profiles * sizeof(ppd_profile_t), 1));
+  dst->filters  = PPD_BIN_POINTER(ppd_bin_strings(&buf, ppd->filters,
+                                                  ppd->num_filters));
+
+ /*
+  * Attributes...
+  */
+
+  dst->attrs = NULL;
+
+  if (ppd->num_attrs > 0)
+  {
+    if ((attrs = calloc((size_t)ppd->num_attrs, sizeof(ppd_attr_t))) == NULL)
+      buf.error = 1;
+    else
+    {
+      for (i = 0; i < ppd->num_attrs; i ++)
+      {
+        attrs[i]       = *(ppd->attrs[i]);
+	attrs[i].value = PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+	                                     ppd->attrs[i]->value));
+      }
+
+      dst->attrs = PPD_BIN_POINTER(ppd_bin_add(&buf, attrs,
+                       (size_t)ppd->num_attrs * sizeof(ppd_attr_t), 1));
+
+      free(attrs);
+    }
+  }
+
+ /*
+  * Custom options and parameters...
+  */
+
+  if ((num_coptions = cupsArrayCount(ppd->coptions)) > 0)
+  {
+    if ((coptions = calloc((size_t)num_coptions,
+                           sizeof(_ppd_bin_coption_t))) == NULL)
+      buf.error = 1;
+    else
+    {
+      for (coption = (ppd_coption_t *)cupsArrayFirst(ppd->coptions), i = 0;
+           coption;
+	   coption = (ppd_coption_t *)cupsArrayNext(ppd->coptions), i ++)
+      {
+	coptions[i].coption        = *coption;
+	coptions[i].coption.option = NULL;
+	coptions[i].coption.params = NULL;
+	coptions[i].num_params     = cupsArrayCount(coption->params);
+
+        if (coptions[i].num_params <= 0)
+	  continue;
+
+        if ((cparams = calloc((size_t)coptions[i].num_params,
+	                      sizeof(ppd_cparam_t))) == NULL)
+	{
+	  buf.error = 1;
+	  break;
+	}
+
+        for (cparam = (ppd_cparam_t *)cupsArrayFirst(coption->params), j = 0;
+	     cparam;
+	     cparam = (ppd_cparam_t *)cupsArrayNext(coption->params), j ++)
+	{
+	  cparams[j] = *cparam;
+
+	  switch (cparam->type)
+	  {
+	    case PPD_CUSTOM_PASSCODE :
+	    case PPD_CUSTOM_PASSWORD :
+	    case PPD_CUSTOM_STRING :
+	        cparams[j].current.custom_string =
+		    PPD_BIN_POINTER(ppd_bin_add_string(&buf,
+		                        cparam->current.custom_string));
+		break;
+
+	    default :
+		break;
+	  }
+	}
+
+        coptions[i].coption.params = PPD_BIN_POINTER(ppd_bin_add(&buf,
+	                                 cparams, (size_t)coptions[i].num_params *
+					     sizeof(ppd_cparam_t), 1));
+
+        free(cparams);
+      }
+
+      header.num_coptions = num_coptions;
+      header.coptions     = ppd_bin_add(&buf, coptions,
+                                        (size_t)num_coptions *
+					    sizeof(_ppd_bin_coption_t), 1);
+
+      free(coptions);
+    }
+  }
+
+ /*
+  * Terminate the file with a nul so that every string offset is known to be
+  * terminated, then fill in the header...
+  */
+
+  ppd_bin_add(&buf, "", 1, 0);
+
+  if (buf.error)
+  {
+    free(buf.data);
+    return (-1);
+  }
+
+  header.length = (long long)buf.used;
+
+  memcpy(buf.data, &header, sizeof(header));
+
+ /*
+  * Write to a temporary file and then rename it...
+  */
+
+  snprintf(tempfile, sizeof(tempfile), "%s.N", binfile);
+
+  if ((fd = open(tempfile, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+  {
+    free(buf.data);
+    return (-1);
+  }
+
+  for (ptr = buf.data, bytes = buf.used; bytes > 0; ptr += written,
+       bytes -= (size_t)written)
+  {
+    if ((written = write(fd, ptr, bytes)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+      {
+        written = 0;
+        continue;
+      }
+
+      break;
+    }
+  }
+
+  free(buf.data);
+
+  if (close(fd) || bytes > 0 || rename(tempfile, binfile))
+  {
+    unlink(tempfile);
+    return (-1);
+  }
+
+  return (0);
+#endif /* WIN32 */
+}
+
+
+/*
+ * 'ppd_add_attr()' - Add an attribute to the PPD data.
+ */
+
+static ppd_attr_t *			/* O - New attribute */
 ppd_add_attr(ppd_file_t *ppd,		/* I - PPD file data */
              const char *name,		/* I - Attribute name */
              const char *spec,		/* I - Specifier string, if any */
@@ -2335,6 +3188,520 @@ ppd_add_size(ppd_file_t *ppd,		/* I - PPD file */
 }
 
 
+#ifndef WIN32
+/*
+ * 'ppd_bin_add()' - Add data to a binary PPD output buffer.
+ */
+
+static size_t				/* O - Offset of data or 0 on error */
+ppd_bin_add(_ppd_bin_buffer_t *buf,	/* I - Output buffer */
+            const void        *data,	/* I - Data to add */
+	    size_t            bytes,	/* I - Number of bytes */
+	    int               align)	/* I - 1 to align data, 0 otherwise */
+{
+  size_t	offset;			/* Offset of data */
+  char		*temp;			/* New buffer */
+  size_t	alloc;			/* New buffer size */
+
+
+  if (!data || !bytes || buf->error)
+    return (0);
+
+  if (align)
+    offset = (buf->used + 7) & ~(size_t)7;
+  else
+    offset = buf->used;
+
+  if (offset + bytes > buf->alloc)
+  {
+    for (alloc = buf->alloc ? buf->alloc : 65536;
+         alloc < offset + bytes;
+	 alloc *= 2);
+
+    if ((temp = realloc(buf->data, alloc)) == NULL)
+    {
+      buf->error = 1;
+      return (0);
+    }
+
+    buf->data  = temp;
+    buf->alloc = alloc;
+  }
+
+  if (offset > buf->used)
+    memset(buf->data + buf->used, 0, offset - buf->used);
+
+  memcpy(buf->data + offset, data, bytes);
+  buf->used = offset + bytes;
+
+  return (offset);
+}
+
+
+/*
+ * 'ppd_bin_add_string()' - Add a string to a binary PPD output buffer.
+ */
+
+static size_t				/* O - Offset of string or 0 */
+ppd_bin_add_string(
+    _ppd_bin_buffer_t *buf,		/* I - Output buffer */
+    const char        *s)		/* I - String or @code NULL@ */
+{
+  return (s ? ppd_bin_add(buf, s, strlen(s) + 1, 0) : 0);
+}
+
+
+/*
+ * 'ppd_bin_alloc_string()' - Add a string in a binary PPD file to the string
+ *                            pool.
+ */
+
+static char *				/* O - String or @code NULL@ */
+ppd_bin_alloc_string(
+    _ppd_bin_map_t *map,		/* I - Mapping */
+    const void     *offset)		/* I - Offset of string */
+{
+  const char	*s;			/* String in mapped file */
+  char		*string;		/* Pooled string */
+
+
+  if ((s = ppd_bin_string(map, offset)) == NULL)
+    return (NULL);
+
+  if ((string = _cupsStrAlloc(s)) == NULL)
+    map->error = 1;
+
+  return (string);
+}
+
+
+/*
+ * 'ppd_bin_array()' - Copy an array from a binary PPD file.
+ */
+
+static void *				/* O - Copy of array or @code NULL@ */
+ppd_bin_array(_ppd_bin_map_t *map,	/* I - Mapping */
+              const void     *offset,	/* I - Offset of array */
+	      int            count,	/* I - Number of elements */
+	      size_t         size)	/* I - Size of each element */
+{
+  const void	*data;			/* Array in mapped file */
+  void		*array;			/* Copy of array */
+
+
+  if ((data = ppd_bin_data(map, offset, count, size)) == NULL)
+    return (NULL);
+
+  if ((array = malloc((size_t)count * size)) == NULL)
+  {
+    map->error = 1;
+    return (NULL);
+  }
+
+  memcpy(array, data, (size_t)count * size);
+
+  return (array);
+}
+
+
+/*
+ * 'ppd_bin_check()' - Validate the header of a binary PPD file.
+ */
+
+static int				/* O - 1 if valid, 0 otherwise */
+ppd_bin_check(
+    const _ppd_bin_header_t *header,	/* I - Binary PPD file header */
+    struct stat             *ppdinfo,	/* I - Source PPD file info */
+    struct stat             *bininfo)	/* I - Binary PPD file info */
+{
+  unsigned	layout[8];		/* Structure sizes */
+
+
+  ppd_bin_layout(layout);
+
+  return (!memcmp(header->magic, PPD_BIN_MAGIC, sizeof(header->magic)) &&
+          header->version == PPD_BIN_VERSION &&
+          header->byte_order == PPD_BIN_ORDER &&
+          !memcmp(header->layout, layout, sizeof(layout)) &&
+          header->ppd_size == (long long)ppdinfo->st_size &&
+          header->ppd_mtime == (long long)ppdinfo->st_mtime &&
+          header->length == (long long)bininfo->st_size);
+}
+
+
+/*
+ * 'ppd_bin_data()' - Validate and return an array in a binary PPD file.
+ */
+
+static const void *			/* O - Array or @code NULL@ */
+ppd_bin_data(_ppd_bin_map_t *map,	/* I - Mapping */
+             const void     *offset,	/* I - Offset of array */
+	     int            count,	/* I - Number of elements */
+	     size_t         size)	/* I - Size of each element */
+{
+  size_t	off = PPD_BIN_OFFSET(offset);
+					/* Offset of array */
+
+
+  if (count == 0 && !off)
+    return (NULL);
+
+  if (count <= 0 || off < sizeof(_ppd_bin_header_t) || off > map->length ||
+      (off & 7) || (size_t)count > (map->length - off) / size)
+  {
+    map->error = 1;
+    return (NULL);
+  }
+
+  return (map->data + off);
+}
+
+
+/*
+ * 'ppd_bin_groups()' - Add groups to a binary PPD output buffer.
+ */
+
+static size_t				/* O - Offset of groups or 0 */
+ppd_bin_groups(_ppd_bin_buffer_t *buf,	/* I - Output buffer */
+               ppd_group_t       *groups,
+					/* I - Groups */
+	       int               num_groups)
+					/* I - Number of groups */
+{
+  int		i;			/* Looping var */
+  ppd_group_t	*temp;			/* Groups with offsets */
+  size_t	offset;			/* Offset of groups */
+
+
+  if (num_groups <= 0)
+    return (0);
+
+  if ((temp = malloc((size_t)num_groups * sizeof(ppd_group_t))) == NULL)
+  {
+    buf->error = 1;
+    return (0);
+  }
+
+  memcpy(temp, groups, (size_t)num_groups * sizeof(ppd_group_t));
+
+  for (i = 0; i < num_groups; i ++)
+  {
+    temp[i].options   = PPD_BIN_POINTER(ppd_bin_options(buf,
+                                                        groups[i].options,
+                                                        groups[i].num_options));
+    temp[i].subgroups = PPD_BIN_POINTER(ppd_bin_groups(buf,
+                                                       groups[i].subgroups,
+                                                       groups[i].num_subgroups));
+  }
+
+  offset = ppd_bin_add(buf, temp, (size_t)num_groups * sizeof(ppd_group_t), 1);
+
+  free(temp);
+
+  return (offset);
+}
+
+
+/*
+ * 'ppd_bin_keyword()' - Find the attribute value for a top-level string in a
+ *                       binary PPD file.
+ */
+
+static char *				/* O - Attribute value or @code NULL@ */
+ppd_bin_keyword(ppd_file_t     *ppd,	/* I - PPD file */
+                _ppd_bin_map_t *map,	/* I - Mapping */
+                const char     *keyword,/* I - Attribute name */
+		const void     *offset)	/* I - Offset of string */
+{
+  int		i;			/* Looping var */
+  const char	*s;			/* String in mapped file */
+  ppd_attr_t	**attr;			/* Current attribute */
+
+
+  if ((s = ppd_bin_string(map, offset)) == NULL)
+    return (NULL);
+
+  for (i = ppd->num_attrs, attr = ppd->attrs; i > 0; i --, attr ++)
+    if (!strcmp((*attr)->name, keyword) && (*attr)->value &&
+        !strcmp((*attr)->value, s))
+      return ((*attr)->value);
+
+  map->error = 1;
+
+  return (NULL);
+}
+
+
+/*
+ * 'ppd_bin_layout()' - Get the structure sizes for a binary PPD file.
+ */
+
+static void
+ppd_bin_layout(unsigned *layout)	/* O - Structure sizes */
+{
+  layout[0] = (unsigned)sizeof(_ppd_bin_header_t);
+  layout[1] = (unsigned)sizeof(ppd_group_t);
+  layout[2] = (unsigned)sizeof(ppd_option_t);
+  layout[3] = (unsigned)sizeof(ppd_choice_t);
+  layout[4] = (unsigned)sizeof(ppd_size_t);
+  layout[5] = (unsigned)sizeof(ppd_attr_t);
+  layout[6] = (unsigned)sizeof(_ppd_bin_coption_t);
+  layout[7] = (unsigned)sizeof(ppd_cparam_t);
+}
+
+
+/*
+ * 'ppd_bin_load_groups()' - Copy groups from a binary PPD file.
+ */
+
+static ppd_group_t *			/* O - Groups or @code NULL@ */
+ppd_bin_load_groups(
+    _ppd_bin_map_t *map,		/* I - Mapping */
+    const void     *offset,		/* I - Offset of groups */
+    int            num_groups,		/* I - Number of groups */
+    int            depth)		/* I - Depth of groups */
+{
+  int		i;			/* Looping var */
+  ppd_group_t	*groups,		/* Groups */
+		*group;			/* Current group */
+
+
+  if (depth > 1 && num_groups)
+  {
+    map->error = 1;
+    return (NULL);
+  }
+
+  if ((groups = ppd_bin_array(map, offset, num_groups,
+                              sizeof(ppd_group_t))) == NULL)
+    return (NULL);
+
+  for (i = num_groups, group = groups; i > 0; i --, group ++)
+  {
+    if ((group->options = ppd_bin_load_options(map, group->options,
+                                               group->num_options)) == NULL)
+      group->num_options = 0;
+
+    if ((group->subgroups = ppd_bin_load_groups(map, group->subgroups,
+                                                group->num_subgroups,
+						depth + 1)) == NULL)
+      group->num_subgroups = 0;
+  }
+
+  return (groups);
+}
+
+
+/*
+ * 'ppd_bin_load_options()' - Copy options and choices from a binary PPD file.
+ */
+
+static ppd_option_t *			/* O - Options or @code NULL@ */
+ppd_bin_load_options(
+    _ppd_bin_map_t *map,		/* I - Mapping */
+    const void     *offset,		/* I - Offset of options */
+    int            num_options)		/* I - Number of options */
+{
+  int		i, j;			/* Looping vars */
+  ppd_option_t	*options,		/* Options */
+		*option;		/* Current option */
+  ppd_choice_t	*choice;		/* Current choice */
+
+
+  if ((options = ppd_bin_array(map, offset, num_options,
+                               sizeof(ppd_option_t))) == NULL)
+    return (NULL);
+
+  for (i = num_options, option = options; i > 0; i --, option ++)
+  {
+    if ((option->choices = ppd_bin_array(map, option->choices,
+                                         option->num_choices,
+					 sizeof(ppd_choice_t))) == NULL)
+    {
+      option->num_choices = 0;
+      continue;
+    }
+
+    for (j = option->num_choices, choice = option->choices;
+         j > 0;
+	 j --, choice ++)
+    {
+      choice->code   = ppd_bin_alloc_string(map, choice->code);
+      choice->option = NULL;
+    }
+  }
+
+  return (options);
+}
+
+
+/*
+ * 'ppd_bin_load_strings()' - Copy an array of strings from a binary PPD file.
+ */
+
+static char **				/* O - Strings or @code NULL@ */
+ppd_bin_load_strings(
+    _ppd_bin_map_t *map,		/* I - Mapping */
+    const void     *offset,		/* I - Offset of string offsets */
+    int            num_strings)		/* I - Number of strings */
+{
+  int		i;			/* Looping var */
+  char * const	*offsets;		/* String offsets in mapped file */
+  char		**strings;		/* Strings */
+
+
+  if ((offsets = ppd_bin_data(map, offset, num_strings,
+                              sizeof(char *))) == NULL)
+    return (NULL);
+
+  if ((strings = malloc((size_t)num_strings * sizeof(char *))) == NULL)
+  {
+    map->error = 1;
+    return (NULL);
+  }
+
+  for (i = 0; i < num_strings; i ++)
+    strings[i] = ppd_bin_alloc_string(map, offsets[i]);
+
+  return (strings);
+}
+
+
+/*
+ * 'ppd_bin_options()' - Add options to a binary PPD output buffer.
+ */
+
+static size_t				/* O - Offset of options or 0 */
+ppd_bin_options(
+    _ppd_bin_buffer_t *buf,		/* I - Output buffer */
+    ppd_option_t      *options,		/* I - Options */
+    int               num_options)	/* I - Number of options */
+{
+  int		i, j;			/* Looping vars */
+  ppd_option_t	*temp;			/* Options with offsets */
+  ppd_choice_t	*choices;		/* Choices with offsets */
+  size_t	offset;			/* Offset of options */
+
+
+  if (num_options <= 0)
+    return (0);
+
+  if ((temp = malloc((size_t)num_options * sizeof(ppd_option_t))) == NULL)
+  {
+    buf->error = 1;
+    return (0);
+  }
+
+  memcpy(temp, options, (size_t)num_options * sizeof(ppd_option_t));
+
+  for (i = 0; i < num_options; i ++)
+  {
+    temp[i].choices = NULL;
+
+    if (options[i].num_choices <= 0)
+      continue;
+
+    if ((choices = malloc((size_t)options[i].num_choices *
+                          sizeof(ppd_choice_t))) == NULL)
+    {
+      buf->error = 1;
+      break;
+    }
+
+    memcpy(choices, options[i].choices,
+           (size_t)options[i].num_choices * sizeof(ppd_choice_t));
+
+    for (j = 0; j < options[i].num_choices; j ++)
+    {
+      choices[j].marked = 0;
+      choices[j].code   = PPD_BIN_POINTER(ppd_bin_add_string(buf,
+                                              options[i].choices[j].code));
+      choices[j].option = NULL;
+    }
+
+    temp[i].choices = PPD_BIN_POINTER(ppd_bin_add(buf, choices,
+                          (size_t)options[i].num_choices *
+			      sizeof(ppd_choice_t), 1));
+
+    free(choices);
+  }
+
+  offset = ppd_bin_add(buf, temp, (size_t)num_options * sizeof(ppd_option_t),
+                       1);
+
+  free(temp);
+
+  return (offset);
+}
+
+
+/*
+ * 'ppd_bin_string()' - Validate and return a string in a binary PPD file.
+ */
+
+static const char *			/* O - String or @code NULL@ */
+ppd_bin_string(_ppd_bin_map_t *map,	/* I - Mapping */
+               const void     *offset)	/* I - Offset of string */
+{
+  size_t	off = PPD_BIN_OFFSET(offset);
+					/* Offset of string */
+
+
+ /*
+  * The last byte of the file is a nul, so any offset inside the file is a
+  * terminated string...
+  */
+
+  if (!off)
+    return (NULL);
+
+  if (off < sizeof(_ppd_bin_header_t) || off >= map->length)
+  {
+    map->error = 1;
+    return (NULL);
+  }
+
+  return (map->data + off);
+}
+
+
+/*
+ * 'ppd_bin_strings()' - Add an array of strings to a binary PPD output buffer.
+ */
+
+static size_t				/* O - Offset of string offsets or 0 */
+ppd_bin_strings(_ppd_bin_buffer_t *buf,	/* I - Output buffer */
+                char              **strings,
+					/* I - Strings */
+		int               num_strings)
+					/* I - Number of strings */
+{
+  int		i;			/* Looping var */
+  char		**temp;			/* String offsets */
+  size_t	offset;			/* Offset of string offsets */
+
+
+  if (num_strings <= 0)
+    return (0);
+
+  if ((temp = calloc((size_t)num_strings, sizeof(char *))) == NULL)
+  {
+    buf->error = 1;
+    return (0);
+  }
+
+  for (i = 0; i < num_strings; i ++)
+    temp[i] = PPD_BIN_POINTER(ppd_bin_add_string(buf, strings[i]));
+
+  offset = ppd_bin_add(buf, temp, (size_t)num_strings * sizeof(char *), 1);
+
+  free(temp);
+
+  return (offset);
+}
+#endif /* !WIN32 */
+
+
 /*
  * 'ppd_compare_attrs()' - Compare two attributes.
  */
@@ -2706,6 +4073,23 @@ ppd_get_option(ppd_group_t *group,	/* I - Group */
 }
 
 
+/*
+ * 'ppd_hash_name()' - Generate a case-insensitive hash of a name.
+ */
+
+static unsigned				/* O - Hash value */
+ppd_hash_name(const char *name)		/* I - Name */
+{
+  unsigned	hash;			/* Hash value */
+
+
+  for (hash = 2166136261U; *name; name ++)
+    hash = (hash ^ (unsigned)_cups_tolower(*name)) * 16777619U;
+
+  return (hash);
+}
+
+
 /*
  * 'ppd_hash_option()' - Generate a hash of the option name...
  */
@@ -2724,6 +4108,244 @@ ppd_hash_option(ppd_option_t *option)	/* I - Option */
 }
 
 
+/*
+ * 'ppd_index_hash()' - Create the option, choice, and attribute hash index.
+ *
+ * Each table is an open-addressing hash table that is at most half full.
+ * Attribute slots point at the first attribute with a name, or name and
+ * specifier, in the sorted attribute array.
+ */
+
+static void
+ppd_index_hash(ppd_file_t *ppd)		/* I - PPD file */
+{
+  int		i, j;			/* Looping vars */
+  size_t	num_choices,		/* Number of choices */
+		alloc_options,		/* Number of option slots */
+		alloc_choices,		/* Number of choice slots */
+		alloc_attrs;		/* Number of attribute slots */
+  _ppd_index_t	*index;			/* Hash index */
+  _ppd_hash_t	*slot;			/* Current slot */
+  ppd_option_t	*option;		/* Current option */
+  ppd_choice_t	*choice;		/* Current choice */
+  ppd_attr_t	*attr,			/* Current attribute */
+		*prev;			/* Previous attribute */
+  unsigned	hash;			/* Hash of name */
+
+
+ /*
+  * Size the tables...
+  */
+
+  for (option = (ppd_option_t *)cupsArrayFirst(ppd->options), num_choices = 0;
+       option;
+       option = (ppd_option_t *)cupsArrayNext(ppd->options))
+    if (option->num_choices >= _PPD_INDEX_CHOICES)
+      num_choices += (size_t)option->num_choices;
+
+  for (alloc_options = 16;
+       alloc_options < 2 * (size_t)cupsArrayCount(ppd->options);
+       alloc_options *= 2);
+
+  for (alloc_choices = 16; alloc_choices < 2 * num_choices;
+       alloc_choices *= 2);
+
+  if (cupsArrayCount(ppd->sorted_attrs) > 0)
+    for (alloc_attrs = 16;
+         alloc_attrs < 2 * (size_t)cupsArrayCount(ppd->sorted_attrs);
+	 alloc_attrs *= 2);
+  else
+    alloc_attrs = 0;
+
+  if ((index = calloc(1, sizeof(_ppd_index_t) +
+                         (alloc_options + alloc_choices + 2 * alloc_attrs) *
+			     sizeof(_ppd_hash_t))) == NULL)
+    return;
+
+  index->num_attrs     = cupsArrayCount(ppd->sorted_attrs);
+  index->alloc_options = alloc_options;
+  index->alloc_choices = alloc_choices;
+  index->alloc_attrs   = alloc_attrs;
+  index->options       = (_ppd_hash_t *)(index + 1);
+  index->choices       = index->options + alloc_options;
+  index->attrs         = alloc_attrs ? index->choices + alloc_choices : NULL;
+  index->specs         = alloc_attrs ? index->attrs + alloc_attrs : NULL;
+
+ /*
+  * Add the options and the choices of options with many choices; the first
+  * option or choice with a given name wins, which matches the sorted array
+  * and linear searches...
+  */
+
+  for (option = (ppd_option_t *)cupsArrayFirst(ppd->options);
+       option;
+       option = (ppd_option_t *)cupsArrayNext(ppd->options))
+  {
+    hash = ppd_hash_name(option->keyword);
+    slot = ppd_index_lookup(index->options, alloc_options, NULL,
+                            option->keyword, NULL, hash);
+
+    if (!slot->data)
+    {
+      slot->hash = hash;
+      slot->name = option->keyword;
+      slot->data = option;
+    }
+
+    if (option->num_choices < _PPD_INDEX_CHOICES)
+      continue;
+
+    for (j = option->num_choices, choice = option->choices;
+         j > 0;
+	 j --, choice ++)
+    {
+      hash = ppd_hash_name(choice->choice);
+      slot = ppd_index_lookup(index->choices, alloc_choices, option,
+                              choice->choice, NULL, hash);
+
+      if (!slot->data)
+      {
+	slot->hash  = hash;
+	slot->name  = choice->choice;
+	slot->owner = option;
+	slot->data  = choice;
+      }
+    }
+  }
+
+ /*
+  * Add the first attribute with each name and each name and specifier...
+  */
+
+  for (i = 0, prev = NULL; i < index->num_attrs; i ++, prev = attr)
+  {
+    attr = (ppd_attr_t *)cupsArrayIndex(ppd->sorted_attrs, i);
+
+    if (!prev || _cups_strcasecmp(prev->name, attr->name))
+    {
+      hash = ppd_hash_name(attr->name);
+      slot = ppd_index_lookup(index->attrs, alloc_attrs, NULL, attr->name,
+                              NULL, hash);
+
+      if (!slot->data)
+      {
+	slot->hash     = hash;
+	slot->position = i;
+	slot->name     = attr->name;
+	slot->data     = attr;
+      }
+    }
+
+    hash = ppd_hash_name(attr->name) ^ ppd_hash_name(attr->spec);
+    slot = ppd_index_lookup(index->specs, alloc_attrs, NULL, attr->name,
+                            attr->spec, hash);
+
+    if (!slot->data)
+    {
+      slot->hash     = hash;
+      slot->position = i;
+      slot->name     = attr->name;
+      slot->spec     = attr->spec;
+      slot->data     = attr;
+    }
+  }
+
+  ppd->index = index;
+}
+
+
+/*
+ * 'ppd_index_lookup()' - Find the slot for a name in a hash table.
+ */
+
+static _ppd_hash_t *			/* O - Matching or empty slot */
+ppd_index_lookup(_ppd_hash_t *slots,	/* I - Hash table */
+                 size_t      alloc,	/* I - Number of slots (power of 2) */
+		 const void  *owner,	/* I - Option for choices or NULL */
+		 const char  *name,	/* I - Name */
+		 const char  *spec,	/* I - Specifier or NULL */
+		 unsigned    hash)	/* I - Hash of name and specifier */
+{
+  size_t	i,			/* Current slot */
+		mask = alloc - 1;	/* Mask for slot numbers */
+  _ppd_hash_t	*slot;			/* Current slot */
+
+
+ /*
+  * Choices are spread out by option, since many options share choice
+  * names like "None" and "True"...
+  */
+
+  i = hash;
+
+  if (owner)
+    i += 2654435761U * (unsigned)((size_t)owner / sizeof(ppd_option_t));
+
+  i &= mask;
+
+  for (slot = slots + i; slot->data; i = (i + 1) & mask, slot = slots + i)
+    if (slot->hash == hash && slot->owner == owner &&
+        !_cups_strcasecmp(slot->name, name) &&
+	(!spec || !_cups_strcasecmp(slot->spec, spec)))
+      break;
+
+  return (slot);
+}
+
+
+/*
+ * 'ppd_index_options()' - Create the sorted options and marked choices arrays.
+ *
+ * This also sets the option back-pointer for each choice and custom option
+ * and creates the hash index.
+ */
+
+static void
+ppd_index_options(ppd_file_t *ppd)	/* I - PPD file */
+{
+  int		i, j, k;		/* Looping vars */
+  ppd_group_t	*group;			/* Current group */
+  ppd_option_t	*option;		/* Current option */
+  ppd_coption_t	*coption;		/* Custom option */
+
+
+  ppd->options = cupsArrayNew2((cups_array_func_t)ppd_compare_options, NULL,
+                               (cups_ahash_func_t)ppd_hash_option,
+			       PPD_HASHSIZE);
+
+  for (i = ppd->num_groups, group = ppd->groups;
+       i > 0;
+       i --, group ++)
+  {
+    for (j = group->num_options, option = group->options;
+         j > 0;
+	 j --, option ++)
+    {
+      cupsArrayAdd(ppd->options, option);
+
+      for (k = 0; k < option->num_choices; k ++)
+        option->choices[k].option = option;
+
+      if ((coption = ppdFindCustomOption(ppd, option->keyword)) != NULL)
+        coption->option = option;
+    }
+  }
+
+ /*
+  * Create an array to track the marked choices...
+  */
+
+  ppd->marked = cupsArrayNew((cups_array_func_t)ppd_compare_choices, NULL);
+
+ /*
+  * Create the hash index used by ppdFindOption, ppdFindAttr, and
+  * ppd_mark_option...
+  */
+
+  ppd_index_hash(ppd);
+}
+
+
 /*
  * 'ppd_read()' - Read a line from a PPD file, skipping comment lines as
  *                necessary.
@@ -290,6 +290,9 @@ typedef struct ppd_coption_s		/**** Custom Option @since CUPS 1.2/OS X 10.5@ ***
 typedef struct _ppd_cache_s _ppd_cache_t;
 					/**** PPD cache and mapping data @since CUPS 1.5/OS X 10.7@ @private@ ****/
 
+typedef struct _ppd_index_s _ppd_index_t;
+					/**** Option, choice, and attribute hash index @since CUPS 2.0/OS X 10.10@ @private@ ****/
+
 typedef struct ppd_file_s		/**** PPD File ****/
 {
   int		language_level;		/* Language level of device */
@@ -355,6 +358,9 @@ typedef struct ppd_file_s		/**** PPD File ****/
 
   /**** New in CUPS 1.5 ****/
   _ppd_cache_t	*cache;			/* PPD cache and mapping data @since CUPS 1.5/OS X 10.7@ @private@ */
+
+  /**** New in CUPS 2.0 ****/
+  _ppd_index_t	*index;			/* Option, choice, and attribute hash index @since CUPS 2.0/OS X 10.10@ @private@ */
 } ppd_file_t;
 
 
@@ -47,10 +47,47 @@
 #  endif /* !min */
 
 
+/*
+ * Persistent filter protocol...
+ *
+ * The worker sends a _CUPS_PERSIST_STARTED message with the ID of the process
+ * that will run the next job, and a _CUPS_PERSIST_EXITED message with the
+ * wait() status of each process that exits.  For each job the scheduler
+ * sends a _cups_persist_req_t followed by "length" bytes of nul-terminated
+ * strings: the security profile ("" for none), "argc" arguments, and "envc"
+ * environment strings.  The descriptors flagged in "fds" (bit N = descriptor
+ * N of the filter) are attached to the request with SCM_RIGHTS.  The
+ * scheduler only sends a request after a _CUPS_PERSIST_STARTED message.
+ */
+
+#  define _CUPS_PERSIST_MAX	65536	/* Maximum length of strings */
+#  define _CUPS_PERSIST_STARTED	1	/* Filter process started */
+#  define _CUPS_PERSIST_EXITED	2	/* Filter process exited */
+
+typedef struct _cups_persist_req_s	/**** Persistent filter request ****/
+{
+  int		length,			/* Length of strings that follow */
+		argc,			/* Number of arguments */
+		envc,			/* Number of environment strings */
+		fds;			/* Attached descriptors */
+} _cups_persist_req_t;
+
+typedef struct _cups_persist_msg_s	/**** Persistent filter message ****/
+{
+  int		type,			/* _CUPS_PERSIST_STARTED or _EXITED */
+		pid,			/* Process ID or 0 on error */
+		status;			/* Exit status */
+} _cups_persist_msg_t;
+
+typedef int (*_cups_persist_cb_t)(int argc, char *argv[], ppd_file_t *ppd);
+					/**** Filter main function ****/
+
+
 /*
  * Prototypes...
  */
 
+extern int		_cupsFilterRunPersistent(_cups_persist_cb_t cb);
 extern int		_cupsRasterExecPS(cups_page_header2_t *h,
 			                  int *preferred_bits,
 			                  const char *code)
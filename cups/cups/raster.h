@@ -394,6 +394,11 @@ extern const char	*cupsRasterErrorString(void) _CUPS_API_1_3;
 extern cups_raster_t	*cupsRasterOpenIO(cups_raster_iocb_t iocb, void *ctx,
 			                  cups_mode_t mode);
 
+/**** New in CUPS 2.1 ****/
+extern unsigned		cupsRasterWriteBand(cups_raster_t *r,
+			                    unsigned char *p,
+					    unsigned lines) _CUPS_API_2_1;
+
 #  ifdef __cplusplus
 }
 #  endif /* __cplusplus */
@@ -59,6 +59,7 @@ extern "C" {
  */
 
 #  define _CUPS_STR_GUARD	0x12344321
+#  define _CUPS_SP_SHARDS	32	/* Number of string pool shards */
 
 typedef struct _cups_sp_item_s		/**** String Pool Item ****/
 {
@@ -66,9 +67,18 @@ typedef struct _cups_sp_item_s		/**** String Pool Item ****/
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
   unsigned int	ref_count;		/* Reference count */
+  unsigned int	hash;			/* Hash of string */
   char		str[1];			/* String */
 } _cups_sp_item_t;
 
+typedef struct _cups_sp_stats_s		/**** String Pool Shard Statistics ****/
+{
+  size_t	count,			/* Number of unique strings */
+		hits,			/* Allocations of existing strings */
+		misses,			/* Allocations of new strings */
+		contention;		/* Times the shard lock was busy */
+} _cups_sp_stats_t;
+
 
 /*
  * Replacements for the ctype macros that are not affected by locale, since we
@@ -187,6 +197,8 @@ extern char	*_cupsStrAlloc(const char *s);
 extern void	_cupsStrFlush(void);
 extern void	_cupsStrFree(const char *s);
 extern char	*_cupsStrRetain(const char *s);
+extern int	_cupsStrShardStatistics(_cups_sp_stats_t *stats,
+		                        int num_stats);
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes);
 
 
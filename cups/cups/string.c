@@ -25,21 +25,73 @@
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_sp_shard_s		/**** String pool shard ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex to control access to shard */
+  size_t		count,		/* Number of strings in shard */
+			alloc;		/* Allocated hash table slots */
+  _cups_sp_item_t	**items;	/* Open-addressed hash table */
+  size_t		hits,		/* Allocations of existing strings */
+			misses,		/* Allocations of new strings */
+			contention;	/* Times the mutex was already locked */
+} _cups_sp_shard_t;
+
+
+/*
+ * Local macros...
+ *
+ * The top bits of the string hash select the shard and the bottom bits the
+ * starting slot in the shard's hash table.  Reference counts are updated
+ * with atomic operations when available so that _cupsStrRetain never touches
+ * the shard mutex.  _cupsStrFree locks the shard to check that the string
+ * is really in the pool.
+ */
+
+#define SP_SHARD(h)	(sp_shards + ((h) >> 27))
+#define SP_SHARD_INIT	{ _CUPS_MUTEX_INITIALIZER, 0, 0, NULL, 0, 0, 0 }
+
+#ifdef HAVE_ATOMIC_BUILTINS
+#  define sp_ref_dec(item) __atomic_sub_fetch(&(item)->ref_count, 1, __ATOMIC_ACQ_REL)
+#  define sp_ref_get(item) __atomic_load_n(&(item)->ref_count, __ATOMIC_ACQUIRE)
+#  define sp_ref_inc(item) __atomic_add_fetch(&(item)->ref_count, 1, __ATOMIC_RELAXED)
+#else
+#  define sp_ref_dec(item) (-- (item)->ref_count)
+#  define sp_ref_get(item) ((item)->ref_count)
+#  define sp_ref_inc(item) (++ (item)->ref_count)
+#endif /* HAVE_ATOMIC_BUILTINS */
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+static _cups_sp_shard_t	sp_shards[_CUPS_SP_SHARDS] =
+{					/* Global string pool */
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT
+};
 
 
 /*
  * Local functions...
  */
 
-static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static int	sp_grow(_cups_sp_shard_t *shard);
+static unsigned	sp_hash(const char *s);
+static void	sp_lock(_cups_sp_shard_t *shard);
+static _cups_sp_item_t **sp_lookup(_cups_sp_shard_t *shard, const char *s,
+		                   unsigned hash);
+static int	sp_remove(_cups_sp_shard_t *shard, _cups_sp_item_t *item);
 
 
 /*
@@ -50,8 +102,10 @@ char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+			**slot;		/* Hash table slot */
 
 
  /*
@@ -62,17 +116,17 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Lock the shard for this string and make sure there is room for it...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  hash  = sp_hash(s);
+  shard = SP_SHARD(hash);
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+  sp_lock(shard);
 
-  if (!stringpool)
+  if (shard->count >= shard->alloc / 2 && !sp_grow(shard))
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
@@ -81,15 +135,16 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * See if the string is already in the pool...
   */
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  slot = sp_lookup(shard, s, hash);
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  if ((item = *slot) != NULL)
   {
    /*
     * Found it, return the cached string...
     */
 
-    item->ref_count ++;
+    sp_ref_inc(item);
+    shard->hits ++;
 
 #ifdef DEBUG_GUARDS
     DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
@@ -100,7 +155,7 @@ _cupsStrAlloc(const char *s)		/* I - String */
       abort();
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (item->str);
   }
@@ -113,12 +168,13 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
 
   item->ref_count = 1;
+  item->hash      = hash;
   memcpy(item->str, s, slen + 1);
 
 #ifdef DEBUG_GUARDS
@@ -133,9 +189,11 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  *slot = item;
+  shard->count ++;
+  shard->misses ++;
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
@@ -181,23 +239,29 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
-  _cups_sp_item_t	*item;		/* Current item */
+  int			i;		/* Looping var */
+  size_t		j;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+
 
+  for (i = _CUPS_SP_SHARDS, shard = sp_shards; i > 0; i --, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d",
+                  (int)shard->count, _CUPS_SP_SHARDS - i));
 
-  _cupsMutexLock(&sp_mutex);
+    for (j = 0; j < shard->alloc; j ++)
+      free(shard->items[j]);
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    free(shard->items);
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    shard->items = NULL;
+    shard->count = 0;
+    shard->alloc = 0;
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -283,13 +347,17 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 
 /*
  * '_cupsStrFree()' - Free/dereference a string.
+ *
+ * Note: Like _cupsStrRetain, this function only accepts pointers returned
+ *       by _cupsStrAlloc or _cupsStrRetain.
  */
 
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
-  _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+  _cups_sp_item_t	*item;		/* String pool item */
+  unsigned		hash;		/* Hash of string */
 
 
  /*
@@ -300,55 +368,44 @@ _cupsStrFree(const char *s)		/* I - String to free */
     return;
 
  /*
-  * Check the string pool...
-  *
-  * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
-  * work if it is initialized before we lock...
-  */
-
-  if (!stringpool)
-    return;
-
- /*
-  * See if the string is already in the pool...
+  * See if the string is in the pool.  Callers may pass strings that did not
+  * come from _cupsStrAlloc, so look the string up by its own hash before
+  * touching the pool item...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  hash  = sp_hash(s);
+  shard = SP_SHARD(hash);
+  item  = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  sp_lock(shard);
 
-#ifdef DEBUG_GUARDS
-  if (key->guard != _CUPS_STR_GUARD)
+  if (shard->items && *sp_lookup(shard, s, hash) == item)
   {
-    DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, "
-                  "ref_count=%d", key, key->str, key->guard, key->ref_count));
-    abort();
-  }
+#ifdef DEBUG_GUARDS
+    if (item->guard != _CUPS_STR_GUARD)
+    {
+      DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, "
+		    "ref_count=%d", item, item->str, item->guard,
+		    item->ref_count));
+      abort();
+    }
 #endif /* DEBUG_GUARDS */
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
-      item == key)
-  {
    /*
     * Found it, dereference...
     */
 
-    item->ref_count --;
-
-    if (!item->ref_count)
+    if (!sp_ref_dec(item) && sp_remove(shard, item))
     {
      /*
       * Remove and free...
       */
 
-      cupsArrayRemove(stringpool, item);
-
       free(item);
     }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 }
 
 
@@ -364,6 +421,9 @@ char *					/* O - Pointer to string */
 _cupsStrRetain(const char *s)		/* I - String to retain */
 {
   _cups_sp_item_t	*item;		/* Pointer to string pool item */
+#ifndef HAVE_ATOMIC_BUILTINS
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+#endif /* !HAVE_ATOMIC_BUILTINS */
 
 
   if (s)
@@ -379,11 +439,17 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+#ifdef HAVE_ATOMIC_BUILTINS
+    sp_ref_inc(item);
+#else
+    shard = SP_SHARD(item->hash);
+
+    _cupsMutexLock(&shard->mutex);
 
-    item->ref_count ++;
+    sp_ref_inc(item);
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+#endif /* HAVE_ATOMIC_BUILTINS */
   }
 
   return ((char *)s);
@@ -536,10 +602,14 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
-  size_t		count,		/* Number of strings */
+  int			i;		/* Looping var */
+  size_t		j,		/* Looping var */
+			count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  unsigned		ref_count;	/* Reference count */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -547,24 +617,33 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (i = _CUPS_SP_SHARDS, shard = sp_shards, count = 0, abytes = 0,
+           tbytes = 0;
+       i > 0;
+       i --, shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    for (j = 0; j < shard->alloc; j ++)
+    {
+      if ((item = shard->items[j]) == NULL)
+        continue;
 
-  _cupsMutexUnlock(&sp_mutex);
+     /*
+      * Count allocated memory, using a 64-bit aligned buffer as a basis.
+      */
+
+      ref_count = sp_ref_get(item);
+      count     += ref_count;
+      len       = (strlen(item->str) + 8) & (size_t)~7;
+      abytes    += sizeof(_cups_sp_item_t) + len;
+      tbytes    += ref_count * len;
+    }
+
+    abytes += shard->alloc * sizeof(_cups_sp_item_t *);
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -580,6 +659,36 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
 }
 
 
+/*
+ * '_cupsStrShardStatistics()' - Return per-shard statistics for string pool.
+ */
+
+int					/* O - Number of shards */
+_cupsStrShardStatistics(
+    _cups_sp_stats_t *stats,		/* O - Shard statistics */
+    int              num_stats)		/* I - Size of statistics array */
+{
+  int			i;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+
+
+  for (i = 0, shard = sp_shards; i < num_stats && i < _CUPS_SP_SHARDS;
+       i ++, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
+
+    stats[i].count      = shard->count;
+    stats[i].hits       = shard->hits;
+    stats[i].misses     = shard->misses;
+    stats[i].contention = shard->contention;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
+
+  return (_CUPS_SP_SHARDS);
+}
+
+
 /*
  * '_cups_strcpy()' - Copy a string allowing for overlapping strings.
  */
@@ -760,14 +869,150 @@ _cups_strlcpy(char       *dst,		/* O - Destination string */
 
 
 /*
- * 'compare_sp_items()' - Compare two string pool items...
+ * 'sp_grow()' - Double the size of a shard's hash table.
  */
 
-static int				/* O - Result of comparison */
-compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
-                 _cups_sp_item_t *b)	/* I - Second item */
+static int				/* O - 1 on success, 0 on failure */
+sp_grow(_cups_sp_shard_t *shard)	/* I - String pool shard */
 {
-  return (strcmp(a->str, b->str));
+  size_t		i,		/* Looping var */
+			alloc;		/* New table size */
+  _cups_sp_item_t	**items,	/* New table */
+			**slot;		/* Slot in new table */
+
+
+  alloc = shard->alloc ? 2 * shard->alloc : 64;
+
+  if ((items = calloc(alloc, sizeof(_cups_sp_item_t *))) == NULL)
+    return (0);
+
+  for (i = 0; i < shard->alloc; i ++)
+  {
+    if (!shard->items[i])
+      continue;
+
+    for (slot = items + (shard->items[i]->hash & (alloc - 1));
+         *slot;
+	 slot = slot == items + alloc - 1 ? items : slot + 1);
+
+    *slot = shard->items[i];
+  }
+
+  free(shard->items);
+
+  shard->items = items;
+  shard->alloc = alloc;
+
+  return (1);
+}
+
+
+/*
+ * 'sp_hash()' - Compute the FNV-1a hash of a string.
+ */
+
+static unsigned				/* O - Hash value */
+sp_hash(const char *s)			/* I - String */
+{
+  unsigned	hash = 2166136261U;	/* Hash value */
+
+
+  while (*s)
+  {
+    hash ^= (unsigned char)*s++;
+    hash *= 16777619U;
+  }
+
+  return (hash);
+}
+
+
+/*
+ * 'sp_lock()' - Lock a shard, counting contention.
+ */
+
+static void
+sp_lock(_cups_sp_shard_t *shard)	/* I - String pool shard */
+{
+  if (!_cupsMutexTryLock(&shard->mutex))
+  {
+    _cupsMutexLock(&shard->mutex);
+
+    shard->contention ++;
+  }
+}
+
+
+/*
+ * 'sp_lookup()' - Find the slot for a string in a locked shard.
+ *
+ * Returns the slot holding the string or the empty slot where it belongs.
+ * The table must have at least one empty slot.
+ */
+
+static _cups_sp_item_t **		/* O - Hash table slot */
+sp_lookup(_cups_sp_shard_t *shard,	/* I - String pool shard */
+          const char       *s,		/* I - String */
+	  unsigned         hash)	/* I - Hash of string */
+{
+  size_t		mask = shard->alloc - 1;
+					/* Slot mask */
+  size_t		i;		/* Current slot */
+  _cups_sp_item_t	*item;		/* Current item */
+
+
+  for (i = hash & mask; (item = shard->items[i]) != NULL; i = (i + 1) & mask)
+    if (item->hash == hash && !strcmp(item->str, s))
+      break;
+
+  return (shard->items + i);
+}
+
+
+/*
+ * 'sp_remove()' - Remove an item from a locked shard.
+ *
+ * Entries after the removed one are shifted back so that lookups never need
+ * tombstones.
+ */
+
+static int				/* O - 1 if removed, 0 if not found */
+sp_remove(_cups_sp_shard_t *shard,	/* I - String pool shard */
+          _cups_sp_item_t  *item)	/* I - Item to remove */
+{
+  size_t	mask = shard->alloc - 1,/* Slot mask */
+		i,			/* Hole to fill */
+		j,			/* Current slot */
+		home;			/* Home slot of current item */
+
+
+  if (!shard->items)
+    return (0);
+
+  for (i = item->hash & mask; shard->items[i] != item; i = (i + 1) & mask)
+    if (!shard->items[i])
+      return (0);
+
+  for (j = (i + 1) & mask; shard->items[j]; j = (j + 1) & mask)
+  {
+   /*
+    * Move the item at j into the hole unless its home slot lies cyclically
+    * between the hole and j...
+    */
+
+    home = shard->items[j]->hash & mask;
+
+    if (((j - home) & mask) >= ((j - i) & mask))
+    {
+      shard->items[i] = shard->items[j];
+      i               = j;
+    }
+  }
+
+  shard->items[i] = NULL;
+  shard->count --;
+
+  return (1);
 }
 
 
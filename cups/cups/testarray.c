@@ -23,22 +23,45 @@
 #include "debug-private.h"
 #include "array-private.h"
 #include "dir.h"
+#include "thread-private.h"
 
 
 /*
  * Local functions...
  */
 
+static int	compare_values(void *a, void *b, void *data);
+static void	do_bench(void);
 static double	get_seconds(void);
+static int	hash_value(void *a, void *data);
 static int	load_words(const char *filename, cups_array_t *array);
+#ifdef HAVE_PTHREAD_H
+static void	*pool_thread(void *arg);
+#endif /* HAVE_PTHREAD_H */
+static int	test_tree(int sorted);
+
+
+/*
+ * Local macros...
+ */
+
+#define VALUE(v)	((void *)(size_t)(v))
+					/* Array element for a number */
 
 
 /*
  * 'main()' - Main entry.
+ *
+ * Usage:
+ *
+ *   ./testarray [-b]
+ *
+ * The "-b" option runs the B-tree scaling benchmark instead of the tests.
  */
 
 int					/* O - Exit status */
-main(void)
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
   cups_array_t	*array,			/* Test array */
@@ -52,6 +75,13 @@ main(void)
   cups_dentry_t	*dent;			/* Directory entry */
   char		*saved[32];		/* Saved entries */
   void		*data;			/* User data for arrays */
+  size_t	base_count,		/* Initial string pool count */
+		count;			/* Current string pool count */
+  _cups_sp_stats_t stats[_CUPS_SP_SHARDS];
+					/* String pool shard statistics */
+#ifdef HAVE_PTHREAD_H
+  pthread_t	threads[8];		/* String pool threads */
+#endif /* HAVE_PTHREAD_H */
 
 
  /*
@@ -60,6 +90,17 @@ main(void)
 
   status = 0;
 
+  if (argc == 2 && !strcmp(argv[1], "-b"))
+  {
+    do_bench();
+    return (0);
+  }
+  else if (argc > 1)
+  {
+    puts("Usage: ./testarray [-b]");
+    return (1);
+  }
+
  /*
   * cupsArrayNew()
   */
@@ -479,6 +520,103 @@ main(void)
 
   cupsArrayDelete(array);
 
+ /*
+  * Test the B-tree storage against the flat array...
+  */
+
+  if (!test_tree(1))
+    status ++;
+
+  if (!test_tree(0))
+    status ++;
+
+ /*
+  * Test the string pool...
+  */
+
+  fputs("_cupsStrAlloc/_cupsStrRetain/_cupsStrFree: ", stdout);
+
+  base_count = _cupsStrStatistics(NULL, NULL);
+  saved[0]   = _cupsStrAlloc("testarray-pool");
+  saved[1]   = _cupsStrAlloc("testarray-pool");
+  saved[2]   = _cupsStrRetain(saved[0]);
+
+  if (!saved[0] || saved[0] != saved[1] || saved[0] != saved[2])
+  {
+    status ++;
+    puts("FAIL (pooled strings differ)");
+  }
+  else if ((count = _cupsStrStatistics(NULL, NULL)) != base_count + 3)
+  {
+    status ++;
+    printf("FAIL (%d references, expected %d)\n", (int)count,
+           (int)base_count + 3);
+  }
+  else
+  {
+    char	unpooled[] = "testarray-pool";
+					/* Copy that is not in the pool */
+
+    _cupsStrFree(unpooled);
+
+    count = _cupsStrStatistics(NULL, NULL);
+
+    _cupsStrFree(saved[0]);
+    _cupsStrFree(saved[1]);
+    _cupsStrFree(saved[2]);
+
+    if (count != base_count + 3 || strcmp(unpooled, "testarray-pool"))
+    {
+      status ++;
+      puts("FAIL (freed a string that is not in the pool)");
+    }
+    else if ((count = _cupsStrStatistics(NULL, NULL)) != base_count)
+    {
+      status ++;
+      printf("FAIL (%d references after free, expected %d)\n", (int)count,
+	     (int)base_count);
+    }
+    else
+      puts("PASS");
+  }
+
+#ifdef HAVE_PTHREAD_H
+  fputs("_cupsStrAlloc/_cupsStrFree (8 threads): ", stdout);
+
+  start = get_seconds();
+
+  for (i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i ++)
+    pthread_create(threads + i, NULL, pool_thread, NULL);
+
+  for (i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i ++)
+    pthread_join(threads[i], NULL);
+
+  end = get_seconds();
+
+  if ((count = _cupsStrStatistics(NULL, NULL)) != base_count)
+  {
+    status ++;
+    printf("FAIL (%d references after threads, expected %d)\n", (int)count,
+	   (int)base_count);
+  }
+  else
+  {
+    size_t	hits = 0,		/* Total hits */
+		misses = 0,		/* Total misses */
+		contention = 0;		/* Total contention */
+
+    for (i = _cupsStrShardStatistics(stats, _CUPS_SP_SHARDS) - 1; i >= 0; i --)
+    {
+      hits       += stats[i].hits;
+      misses     += stats[i].misses;
+      contention += stats[i].contention;
+    }
+
+    printf("PASS (%.3f seconds, %d hits, %d misses, %d contended)\n",
+           end - start, (int)hits, (int)misses, (int)contention);
+  }
+#endif /* HAVE_PTHREAD_H */
+
  /*
   * Summarize the results and return...
   */
@@ -492,6 +630,92 @@ main(void)
 }
 
 
+/*
+ * 'compare_values()' - Compare two numeric array elements.
+ */
+
+static int				/* O - Result of comparison */
+compare_values(void *a,			/* I - First element */
+               void *b,			/* I - Second element */
+	       void *data)		/* I - User data (unused) */
+{
+  (void)data;
+
+  if ((size_t)a < (size_t)b)
+    return (-1);
+  else
+    return ((size_t)a > (size_t)b);
+}
+
+
+/*
+ * 'do_bench()' - Benchmark flat and B-tree arrays from 1k to 10M elements.
+ *
+ * Elements are added, found, iterated, and removed in a pseudo-random
+ * order.  Flat arrays are skipped above 100k elements since every add and
+ * remove moves half of the array on average.
+ */
+
+static void
+do_bench(void)
+{
+  int		i,			/* Looping var */
+		n,			/* Number of elements */
+		tree;			/* Use B-tree? */
+  cups_array_t	*array;			/* Test array */
+  void		*e;			/* Current element */
+  double	start,			/* Start time */
+		add_time,		/* Time to add elements */
+		find_time,		/* Time to find elements */
+		iter_time,		/* Time to iterate elements */
+		remove_time;		/* Time to remove elements */
+
+
+  puts("Elements  Storage         Add        Find     Iterate      Remove");
+
+  for (n = 1000; n <= 10000000; n *= 10)
+  {
+    for (tree = 0; tree < 2; tree ++)
+    {
+      printf("%8d  %-7s", n, tree ? "B-tree" : "flat");
+
+      if (!tree && n > 100000)
+      {
+        puts("     skipped");
+	continue;
+      }
+
+      array = _cupsArrayNew4(compare_values, NULL, NULL, 0, NULL, NULL,
+                             tree ? _CUPS_ARRAY_FLAG_TREE : 0);
+
+      start = get_seconds();
+      for (i = 0; i < n; i ++)
+        cupsArrayAdd(array, VALUE(((long long)i * 2654435761LL) % n + 1));
+      add_time = get_seconds() - start;
+
+      start = get_seconds();
+      for (i = 0; i < n; i ++)
+        cupsArrayFind(array, VALUE(((long long)i * 40503) % n + 1));
+      find_time = get_seconds() - start;
+
+      start = get_seconds();
+      for (e = cupsArrayFirst(array); e; e = cupsArrayNext(array));
+      iter_time = get_seconds() - start;
+
+      start = get_seconds();
+      for (i = 0; i < n; i ++)
+        cupsArrayRemove(array, VALUE(((long long)i * 69069) % n + 1));
+      remove_time = get_seconds() - start;
+
+      printf(" %10.3fs %10.3fs %10.3fs %10.3fs%s\n", add_time, find_time,
+             iter_time, remove_time, cupsArrayCount(array) ? " FAIL" : "");
+
+      cupsArrayDelete(array);
+    }
+  }
+}
+
+
 /*
  * 'get_seconds()' - Get the current time in seconds...
  */
@@ -520,6 +744,20 @@ get_seconds(void)
 #endif /* WIN32 */
 
 
+/*
+ * 'hash_value()' - Hash a numeric array element.
+ */
+
+static int				/* O - Hash value */
+hash_value(void *a,			/* I - Element */
+           void *data)			/* I - User data (unused) */
+{
+  (void)data;
+
+  return ((int)((size_t)a & 63));
+}
+
+
 /*
  * 'load_words()' - Load words from a file.
  */
@@ -550,6 +788,199 @@ load_words(const char   *filename,	/* I - File to load */
 }
 
 
+#ifdef HAVE_PTHREAD_H
+/*
+ * 'pool_thread()' - Allocate and free pooled strings from a thread.
+ */
+
+static void *				/* O - Thread exit status */
+pool_thread(void *arg)			/* I - Unused */
+{
+  int	i, j;				/* Looping vars */
+  char	name[64],			/* String to pool */
+	*strings[256];			/* Pooled strings */
+
+
+  (void)arg;
+
+  for (i = 0; i < 200; i ++)
+  {
+    for (j = 0; j < 256; j ++)
+    {
+      snprintf(name, sizeof(name), "testarray-pool-%d", (j * 7 + i) & 255);
+      strings[j] = _cupsStrAlloc(name);
+    }
+
+    for (j = 0; j < 256; j ++)
+      _cupsStrRetain(strings[j]);
+
+    for (j = 0; j < 256; j ++)
+    {
+      _cupsStrFree(strings[j]);
+      _cupsStrFree(strings[j]);
+    }
+  }
+
+  return (NULL);
+}
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * 'test_tree()' - Compare a B-tree array with a flat array.
+ *
+ * The same pseudo-random sequence of adds, inserts, finds, removes, and
+ * iteration is applied to both arrays, filling them to several thousand
+ * elements before draining them again.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_tree(int sorted)			/* I - Test a sorted array? */
+{
+  int		i,			/* Looping var */
+		op,			/* Current operation */
+		errors = 0;		/* Number of differences */
+  unsigned	seed = 1;		/* Random number seed */
+  cups_array_t	*flat,			/* Flat array */
+		*tree,			/* B-tree array */
+		*dup;			/* Copy of B-tree array */
+  void		*fe,			/* Element from flat array */
+		*te;			/* Element from B-tree array */
+
+
+  printf("_cupsArrayNew4(%s, _CUPS_ARRAY_FLAG_TREE): ",
+         sorted ? "sorted" : "unsorted");
+  fflush(stdout);
+
+  flat = cupsArrayNew2(sorted ? compare_values : NULL, NULL,
+                       sorted ? hash_value : NULL, 64);
+  tree = _cupsArrayNew4(sorted ? compare_values : NULL, NULL,
+                        sorted ? hash_value : NULL, 64, NULL, NULL,
+			_CUPS_ARRAY_FLAG_TREE);
+
+  for (i = 0; i < 40000 && !errors; i ++)
+  {
+    seed = seed * 1103515245 + 12345;
+    op   = (int)((seed >> 16) % 8);
+    te   = VALUE((seed >> 4) % 5000 + 1);
+
+    switch (op)
+    {
+      case 0 :
+      case 1 :
+          if (cupsArrayAdd(flat, te) != cupsArrayAdd(tree, te))
+	    errors ++;
+	  break;
+
+      case 2 :
+          if (cupsArrayInsert(flat, te) != cupsArrayInsert(tree, te))
+	    errors ++;
+	  break;
+
+      case 3 :
+          if (cupsArrayFind(flat, te) != cupsArrayFind(tree, te) ||
+	      cupsArrayNext(flat) != cupsArrayNext(tree))
+	    errors ++;
+	  break;
+
+      case 4 :
+      case 5 :
+         /*
+	  * Find the element first so that both arrays remove the first of
+	  * any equal elements...
+	  */
+
+          if (!sorted)
+	  {
+	    op = (int)(seed % 7919) % (cupsArrayCount(flat) + 1);
+	    te = cupsArrayIndex(flat, op);
+
+	    if (te != cupsArrayIndex(tree, op))
+	      errors ++;
+	  }
+	  else if (cupsArrayFind(flat, te) != cupsArrayFind(tree, te))
+	    errors ++;
+
+          if (cupsArrayRemove(flat, te) != cupsArrayRemove(tree, te))
+	    errors ++;
+	  break;
+
+      case 6 :
+          op = cupsArrayCount(flat) ? (int)(seed % 7919) % cupsArrayCount(flat) : 0;
+
+          if (cupsArrayIndex(flat, op) != cupsArrayIndex(tree, op) ||
+	      cupsArraySave(flat) != cupsArraySave(tree) ||
+	      cupsArrayPrev(flat) != cupsArrayPrev(tree) ||
+	      cupsArrayRestore(flat) != cupsArrayRestore(tree) ||
+	      cupsArrayGetIndex(flat) != cupsArrayGetIndex(tree) ||
+	      cupsArrayGetInsert(flat) != cupsArrayGetInsert(tree))
+	    errors ++;
+	  break;
+
+      case 7 :
+          if (cupsArrayCurrent(flat) != cupsArrayCurrent(tree))
+	    errors ++;
+	  break;
+    }
+
+    if (cupsArrayCount(flat) != cupsArrayCount(tree))
+      errors ++;
+
+    if ((i % 5000) == 4999)
+    {
+     /*
+      * Compare the whole array, including a copy of the B-tree...
+      */
+
+      dup = cupsArrayDup(tree);
+
+      for (fe = cupsArrayFirst(flat), te = cupsArrayFirst(tree);
+           fe && fe == te && fe == cupsArrayIndex(dup, cupsArrayGetIndex(flat));
+	   fe = cupsArrayNext(flat), te = cupsArrayNext(tree));
+
+      if (fe || te || cupsArrayCount(dup) != cupsArrayCount(flat))
+        errors ++;
+
+      for (fe = cupsArrayLast(flat), te = cupsArrayLast(tree);
+           fe && fe == te;
+	   fe = cupsArrayPrev(flat), te = cupsArrayPrev(tree));
+
+      if (fe || te)
+        errors ++;
+
+      cupsArrayDelete(dup);
+    }
+  }
+
+  while (!errors && (fe = cupsArrayFirst(flat)) != NULL)
+  {
+   /*
+    * Drain the arrays...
+    */
+
+    if (fe != cupsArrayFirst(tree) ||
+        cupsArrayRemove(flat, fe) != cupsArrayRemove(tree, fe))
+      errors ++;
+
+    i ++;
+  }
+
+  if (errors)
+    printf("FAIL (arrays differ after %d operations)\n", i);
+  else if (cupsArrayCount(tree))
+  {
+    printf("FAIL (%d elements left, expected 0)\n", cupsArrayCount(tree));
+    errors ++;
+  }
+  else
+    printf("PASS (%d operations)\n", i);
+
+  cupsArrayDelete(flat);
+  cupsArrayDelete(tree);
+
+  return (!errors);
+}
+
 /*
  * End of "$Id: testarray.c 11560 2014-02-06 20:10:19Z msweet $".
  */
@@ -15,7 +15,9 @@
  *
  * Contents:
  *
- *   main() - Main entry.
+ *   main()        - Main entry.
+ *   do_bench()    - Benchmark constraint checks for every choice in a PPD.
+ *   get_seconds() - Get the current time in seconds.
  */
 
 /*
@@ -27,6 +29,14 @@
 #include "string-private.h"
 
 
+/*
+ * Local functions...
+ */
+
+static void	do_bench(ppd_file_t *ppd, int iterations);
+static double	get_seconds(void);
+
+
 /*
  * 'main()' - Main entry.
  */
@@ -45,28 +55,38 @@ main(int  argc,				/* I - Number of command-line arguments */
   cups_option_t	*options;		/* Options */
   char		*option,		/* Current option */
 		*choice;		/* Current choice */
+  int		bench = 0;		/* Benchmark? */
 
 
-  if (argc != 2)
+  if (argc == 3 && !strcmp(argv[1], "-b"))
+    bench = 1;
+  else if (argc != 2)
   {
-    puts("Usage: testconflicts filename.ppd");
+    puts("Usage: testconflicts [-b] filename.ppd");
     return (1);
   }
 
-  if ((ppd = ppdOpenFile(argv[1])) == NULL)
+  if ((ppd = ppdOpenFile(argv[argc - 1])) == NULL)
   {
     ppd_status_t	err;		/* Last error in file */
     int			linenum;	/* Line number in file */
 
     err = ppdLastError(&linenum);
 
-    printf("Unable to open PPD file \"%s\": %s on line %d\n", argv[1],
+    printf("Unable to open PPD file \"%s\": %s on line %d\n", argv[argc - 1],
            ppdErrorString(err), linenum);
     return (1);
   }
 
   ppdMarkDefaults(ppd);
 
+  if (bench)
+  {
+    do_bench(ppd, 10);
+    ppdClose(ppd);
+    return (0);
+  }
+
   option = NULL;
   choice = NULL;
 
@@ -133,6 +153,117 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'do_bench()' - Benchmark constraint checks for every choice in a PPD.
+ */
+
+static void
+do_bench(ppd_file_t *ppd,		/* I - PPD file */
+         int        iterations)		/* I - Number of iterations */
+{
+  int		i, j, k,		/* Looping vars */
+		count,			/* Number of choices tested */
+		num_conflicts,		/* Number of conflicting choices */
+		num_resolved,		/* Number of resolved choices */
+		num_options;		/* Number of options */
+  cups_option_t	*options;		/* Options */
+  ppd_group_t	*group;			/* Current group */
+  ppd_option_t	*option;		/* Current option */
+  ppd_choice_t	*choice;		/* Current choice */
+  double	start,			/* Start time */
+		get_time,		/* Time for cupsGetConflicts */
+		resolve_time;		/* Time for cupsResolveConflicts */
+
+
+ /*
+  * Load the constraints outside of the timed loops...
+  */
+
+  ppdConflicts(ppd);
+
+  count         = 0;
+  num_conflicts = 0;
+  num_resolved  = 0;
+  get_time      = 0.0;
+  resolve_time  = 0.0;
+
+  for (; iterations > 0; iterations --)
+    for (i = ppd->num_groups, group = ppd->groups; i > 0; i --, group ++)
+      for (j = group->num_options, option = group->options;
+           j > 0;
+	   j --, option ++)
+        for (k = option->num_choices, choice = option->choices;
+	     k > 0;
+	     k --, choice ++)
+	{
+	  count ++;
+
+	  start       = get_seconds();
+	  num_options = cupsGetConflicts(ppd, option->keyword, choice->choice,
+	                                 &options);
+	  get_time    += get_seconds() - start;
+
+	  if (num_options > 0)
+	    num_conflicts ++;
+
+	  cupsFreeOptions(num_options, options);
+
+	  num_options = 0;
+	  options     = NULL;
+
+	  start        = get_seconds();
+	  if (cupsResolveConflicts(ppd, option->keyword, choice->choice,
+	                           &num_options, &options))
+	    num_resolved ++;
+	  resolve_time += get_seconds() - start;
+
+	  cupsFreeOptions(num_options, options);
+	}
+
+  if (count == 0)
+  {
+    puts("No choices to test.");
+    return;
+  }
+
+  printf("%d choices tested, %d with conflicts, %d resolved.\n", count,
+         num_conflicts, num_resolved);
+  printf("cupsGetConflicts: %.3f seconds, %.1f microseconds per call\n",
+         get_time, 1000000.0 * get_time / count);
+  printf("cupsResolveConflicts: %.3f seconds, %.1f microseconds per call\n",
+         resolve_time, 1000000.0 * resolve_time / count);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+#ifdef WIN32
+#  include <windows.h>
+
+
+static double
+get_seconds(void)
+{
+  return (GetTickCount() * 0.001);
+}
+#else
+#  include <sys/time.h>
+
+
+static double
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+#endif /* WIN32 */
+
+
 /*
  * End of "$Id: testconflicts.c 3757 2012-03-30 06:13:47Z msweet $".
  */
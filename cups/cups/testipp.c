@@ -28,6 +28,7 @@
 #  include <unistd.h>
 #  include <fcntl.h>
 #endif /* WIN32 */
+#include <time.h>
 
 
 /*
@@ -228,6 +229,7 @@ static ipp_uchar_t mixed[] =		/* Mixed value buffer */
  * Local functions...
  */
 
+void	benchmark(int iterations);
 void	hex_dump(const char *title, ipp_uchar_t *buffer, size_t bytes);
 void	print_attributes(ipp_t *ipp, int indent);
 ssize_t	read_cb(_ippdata_t *data, ipp_uchar_t *buffer, size_t bytes);
@@ -246,14 +248,17 @@ main(int  argc,			/* I - Number of command-line arguments */
   ipp_uchar_t	buffer[8192];	/* Write buffer data */
   ipp_t		*cols[2],	/* Collections */
 		*size;		/* media-size collection */
-  ipp_t		*request;	/* Request */
+  ipp_t		*request,	/* Request */
+		*copy;		/* Copy of request */
   ipp_attribute_t *media_col,	/* media-col attribute */
 		*media_size,	/* media-size attribute */
 		*attr;		/* Other attribute */
   ipp_state_t	state;		/* State */
   size_t	length;		/* Length of data */
   cups_file_t	*fp;		/* File pointer */
-  size_t	i;		/* Looping var */
+  size_t	i, j;		/* Looping vars */
+  char		attrname[256],	/* Attribute name */
+		bigvalue[3000];	/* Large attribute value */
   int		status;		/* Status of tests (0 = success, 1 = fail) */
 #ifdef DEBUG
   const char	*name;		/* Option name */
@@ -591,6 +596,227 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Read the sample into a message using an arena, grow an attribute, and
+    * then copy it to a normal message...
+    */
+
+    printf("Read Sample into Arena: ");
+
+    request   = ippNewWithArena();
+    data.rpos = 0;
+
+    while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL,
+                              request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    length = ippLength(request);
+
+    if (state != IPP_STATE_DATA)
+    {
+      printf("FAIL - %d bytes read.\n", (int)data.rpos);
+      status = 1;
+    }
+    else if (length != sizeof(collection))
+    {
+      printf("FAIL - wrong ippLength(), %d instead of %d bytes!\n",
+             (int)length, (int)sizeof(collection));
+      print_attributes(request, 8);
+      status = 1;
+    }
+    else
+    {
+      attr = ippAddString(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "job-sheets",
+                          NULL, "none");
+      for (i = 1; i < 20; i ++)
+        ippSetString(request, &attr, (int)i, "standard");
+
+      copy = ippNew();
+      ippCopyAttributes(copy, request, 0, NULL, NULL);
+      ippDelete(request);
+      request = copy;
+
+      if ((attr = ippFindAttribute(request, "job-sheets",
+                                   IPP_TAG_KEYWORD)) == NULL ||
+          ippGetCount(attr) != 20 ||
+	  strcmp(ippGetString(attr, 19, NULL), "standard"))
+      {
+        puts("FAIL (bad job-sheets)");
+	print_attributes(request, 8);
+	status = 1;
+      }
+      else if ((media_col = ippFindAttribute(request, "media-col",
+                                             IPP_TAG_BEGIN_COLLECTION)) == NULL ||
+               ippGetCount(media_col) != 2)
+      {
+        puts("FAIL (bad media-col)");
+	print_attributes(request, 8);
+	status = 1;
+      }
+      else
+        puts("PASS");
+    }
+
+    ippDelete(request);
+
+   /*
+    * Write and read back values that are large enough to be written directly
+    * from the attribute...
+    */
+
+    printf("Write/Read Large Values: ");
+
+    request = ippNew();
+
+    memset(bigvalue, 'x', sizeof(bigvalue));
+    bigvalue[sizeof(bigvalue) - 1] = '\0';
+
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", 1);
+    ippAddOctetString(request, IPP_TAG_OPERATION, "octets", bigvalue,
+                      sizeof(bigvalue));
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_TEXT, "text", NULL,
+                 bigvalue + 1000);
+
+    data.wused   = 0;
+    data.wsize   = sizeof(buffer);
+    data.wbuffer = buffer;
+
+    while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL,
+                               request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+	break;
+
+    length = ippLength(request);
+    ippDelete(request);
+
+    if (state != IPP_STATE_DATA || data.wused != length)
+    {
+      printf("FAIL - wrote %d bytes, expected %d bytes!\n", (int)data.wused,
+             (int)length);
+      status = 1;
+    }
+    else
+    {
+      request   = ippNew();
+      data.rpos = 0;
+
+      while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL,
+				request)) != IPP_STATE_DATA)
+	if (state == IPP_STATE_ERROR)
+	  break;
+
+      if (state != IPP_STATE_DATA)
+      {
+	printf("FAIL - %d bytes read.\n", (int)data.rpos);
+	status = 1;
+      }
+      else if ((attr = ippFindAttribute(request, "octets",
+                                        IPP_TAG_STRING)) == NULL ||
+               attr->values[0].unknown.length != (int)sizeof(bigvalue) ||
+	       memcmp(attr->values[0].unknown.data, bigvalue,
+	              sizeof(bigvalue)))
+      {
+        puts("FAIL (bad octets)");
+	status = 1;
+      }
+      else if ((attr = ippFindAttribute(request, "text",
+                                        IPP_TAG_TEXT)) == NULL ||
+               strcmp(ippGetString(attr, 0, NULL), bigvalue + 1000))
+      {
+        puts("FAIL (bad text)");
+	status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Build a message that is large enough to use the attribute name index and
+    * make sure lookups still work after adding, growing, renaming, and
+    * deleting attributes...
+    */
+
+    printf("Find Attributes in Large Message: ");
+
+    request = ippNew();
+
+    for (i = 0; i < 100; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "attribute-%d", (int)i);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, attrname,
+                    (int)i);
+    }
+
+    ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "attribute-50",
+                 NULL, "duplicate");
+
+    if ((attr = ippFindAttribute(request, "ATTRIBUTE-99",
+                                 IPP_TAG_INTEGER)) == NULL ||
+        ippGetInteger(attr, 0) != 99)
+    {
+      puts("FAIL (attribute-99)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attribute-50",
+                                      IPP_TAG_KEYWORD)) == NULL ||
+             strcmp(ippGetString(attr, 0, NULL), "duplicate"))
+    {
+      puts("FAIL (attribute-50 keyword)");
+      status = 1;
+    }
+    else if (ippFindAttribute(request, "attribute-100", IPP_TAG_ZERO))
+    {
+      puts("FAIL (attribute-100)");
+      status = 1;
+    }
+    else
+    {
+      for (attr = ippFindAttribute(request, "attribute-50", IPP_TAG_ZERO), i = 0;
+           attr;
+	   attr = ippFindNextAttribute(request, "attribute-50", IPP_TAG_ZERO))
+        i ++;
+
+      attr = ippFindAttribute(request, "attribute-10", IPP_TAG_INTEGER);
+      for (j = 1; j < 10; j ++)
+        ippSetInteger(request, &attr, (int)j, (int)j);
+
+      attr = ippFindAttribute(request, "attribute-11", IPP_TAG_INTEGER);
+      ippDeleteAttribute(request, attr);
+
+      attr = ippFindAttribute(request, "attribute-12", IPP_TAG_INTEGER);
+      ippSetName(request, &attr, "attribute-1000");
+
+      if (i != 2)
+      {
+        printf("FAIL (found %d attribute-50)\n", (int)i);
+	status = 1;
+      }
+      else if ((attr = ippFindAttribute(request, "attribute-10",
+                                        IPP_TAG_INTEGER)) == NULL ||
+               ippGetCount(attr) != 10 ||
+	       (attr = ippFindAttribute(request, "attribute-13",
+	                                IPP_TAG_INTEGER)) == NULL ||
+	       ippGetInteger(attr, 0) != 13)
+      {
+        puts("FAIL (after ippSetInteger)");
+	status = 1;
+      }
+      else if (ippFindAttribute(request, "attribute-11", IPP_TAG_ZERO) ||
+               ippFindAttribute(request, "attribute-12", IPP_TAG_ZERO) ||
+               !ippFindAttribute(request, "attribute-1000", IPP_TAG_ZERO))
+      {
+        puts("FAIL (after ippDeleteAttribute/ippSetName)");
+	status = 1;
+      }
+      else
+        puts("PASS");
+    }
+
+    ippDelete(request);
+
    /*
     * Read the mixed data and confirm we converted everything to rangeOfInteger
     * values...
@@ -706,6 +932,14 @@ main(int  argc,			/* I - Number of command-line arguments */
     else
       puts("Core IPP tests passed.");
   }
+  else if (!strcmp(argv[1], "-b"))
+  {
+   /*
+    * Benchmark normal and arena messages...
+    */
+
+    benchmark(argc > 2 ? atoi(argv[2]) : 1000);
+  }
   else
   {
    /*
@@ -745,6 +979,83 @@ main(int  argc,			/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'benchmark()' - Compare the speed of normal and arena messages.
+ *
+ * Each message looks like a Get-Printer-Attributes response with 1000
+ * attributes.
+ */
+
+void
+benchmark(int iterations)		/* I - Number of messages */
+{
+  int		arena,			/* Use an arena? */
+		i, j;			/* Looping vars */
+  ipp_t		*response;		/* Response message */
+  char		name[256],		/* Attribute name */
+		value[256];		/* Attribute value */
+  clock_t	start;			/* Start time */
+  double	secs;			/* Elapsed time */
+  size_t	length = 0;		/* Length of message */
+  static const char * const keywords[] =/* Keyword values */
+		{
+		  "one-sided",
+		  "two-sided-long-edge",
+		  "two-sided-short-edge",
+		  "none",
+		  "standard"
+		};
+
+
+  if (iterations < 1)
+    iterations = 1;
+
+  for (arena = 0; arena < 2; arena ++)
+  {
+    start = clock();
+
+    for (i = 0; i < iterations; i ++)
+    {
+      response = arena ? ippNewWithArena() : ippNew();
+
+      ippAddString(response, IPP_TAG_OPERATION, IPP_TAG_CHARSET,
+		   "attributes-charset", NULL, "utf-8");
+      ippAddString(response, IPP_TAG_OPERATION, IPP_TAG_LANGUAGE,
+		   "attributes-natural-language", NULL, "en");
+
+      for (j = 0; j < 250; j ++)
+      {
+        snprintf(name, sizeof(name), "attribute-%d-supported", j);
+        ippAddStrings(response, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, name,
+	              (int)(sizeof(keywords) / sizeof(keywords[0])), NULL,
+		      keywords);
+
+        snprintf(name, sizeof(name), "attribute-%d-default", j);
+        snprintf(value, sizeof(value), "value for attribute %d", j);
+        ippAddString(response, IPP_TAG_PRINTER, IPP_TAG_TEXT, name, NULL,
+	             value);
+
+        snprintf(name, sizeof(name), "attribute-%d-count", j);
+        ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, name, j);
+
+        snprintf(name, sizeof(name), "attribute-%d-range", j);
+        ippAddRange(response, IPP_TAG_PRINTER, name, 1, j + 1);
+      }
+
+      length = ippLength(response);
+
+      ippDelete(response);
+    }
+
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%s: %d messages of %d bytes in %.3f seconds, %.1f us/message\n",
+           arena ? "ippNewWithArena" : "ippNew", iterations, (int)length,
+	   secs, 1000000.0 * secs / iterations);
+  }
+}
+
+
 /*
  * 'hex_dump()' - Produce a hex dump of a buffer.
  */
@@ -31,6 +31,14 @@
 #include <math.h>
 
 
+/*
+ * Local functions...
+ */
+
+static void	do_bench(ppd_file_t *ppd);
+static double	get_seconds(void);
+
+
 /*
  * Test data...
  */
@@ -135,7 +143,8 @@ main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
-  ppd_file_t	*ppd;			/* PPD file loaded from disk */
+  ppd_file_t	*ppd,			/* PPD file loaded from disk */
+		*binppd;		/* PPD file loaded from binary file */
   int		status;			/* Status of tests (0 = success, 1 = fail) */
   int		conflicts;		/* Number of conflicts */
   char		*s;			/* String */
@@ -191,6 +200,97 @@ main(int  argc,				/* I - Number of command-line arguments */
       printf("FAIL (%s on line %d)\n", ppdErrorString(err), line);
     }
 
+   /*
+    * Run the rest of the test.ppd tests with the binary copy...
+    */
+
+    fputs("_ppdWriteBinary(test.ppd): ", stdout);
+    if (!_ppdWriteBinary(ppd, "test.ppd", "test.ppdb"))
+      puts("PASS");
+    else
+    {
+      status ++;
+      printf("FAIL (%s)\n", strerror(errno));
+    }
+
+    fputs("_ppdCheckBinary(test.ppd): ", stdout);
+    if (_ppdCheckBinary("test.ppd", "test.ppdb") &&
+        !_ppdCheckBinary("test.ppd", "test.ppd"))
+      puts("PASS");
+    else
+    {
+      status ++;
+      puts("FAIL");
+    }
+
+    fputs("_ppdOpenBinary(test.ppd): ", stdout);
+    if ((binppd = _ppdOpenBinary("test.ppd", "test.ppdb")) == NULL)
+    {
+      status ++;
+      puts("FAIL (unable to open)");
+    }
+    else
+    {
+      for (i = 0; i < ppd->num_attrs && i < binppd->num_attrs; i ++)
+        if (strcmp(ppd->attrs[i]->name, binppd->attrs[i]->name) ||
+	    strcmp(ppd->attrs[i]->spec, binppd->attrs[i]->spec) ||
+	    (ppd->attrs[i]->value != NULL) !=
+	        (binppd->attrs[i]->value != NULL) ||
+	    (ppd->attrs[i]->value &&
+	     strcmp(ppd->attrs[i]->value, binppd->attrs[i]->value)))
+	  break;
+
+      if (binppd->num_groups != ppd->num_groups ||
+          cupsArrayCount(binppd->options) != cupsArrayCount(ppd->options) ||
+          cupsArrayCount(binppd->coptions) != cupsArrayCount(ppd->coptions) ||
+          binppd->num_sizes != ppd->num_sizes ||
+          binppd->num_consts != ppd->num_consts ||
+          binppd->num_attrs != ppd->num_attrs || i < ppd->num_attrs)
+      {
+        status ++;
+	puts("FAIL (different contents)");
+      }
+      else
+        puts("PASS");
+
+      fputs("ppdClose(binary copy): ", stdout);
+
+      ppdClose(_ppdOpenBinary("test.ppd", "test.ppdb"));
+
+      for (i = 0; i < ppd->num_attrs; i ++)
+        if (ppd->attrs[i]->value &&
+	    strcmp(ppd->attrs[i]->value, binppd->attrs[i]->value))
+	  break;
+
+      if (i < ppd->num_attrs)
+      {
+        status ++;
+	printf("FAIL (%s changed from \"%s\" to \"%s\")\n",
+	       ppd->attrs[i]->name, ppd->attrs[i]->value,
+	       binppd->attrs[i]->value);
+      }
+      else if (!binppd->modelname || strcmp(binppd->modelname, ppd->modelname))
+      {
+        status ++;
+	puts("FAIL (wrong ModelName)");
+      }
+      else
+        puts("PASS");
+
+      ppdClose(ppd);
+      ppd = binppd;
+    }
+
+    fputs("_ppdOpenBinary(test2.ppd): ", stdout);
+    if ((binppd = _ppdOpenBinary("test2.ppd", "test.ppdb")) == NULL)
+      puts("PASS");
+    else
+    {
+      status ++;
+      puts("FAIL (stale binary file was used)");
+      ppdClose(binppd);
+    }
+
     fputs("ppdFindAttr(wildcard): ", stdout);
     if ((attr = ppdFindAttr(ppd, "cupsTest", NULL)) == NULL)
     {
@@ -628,6 +728,7 @@ main(int  argc,				/* I - Number of command-line arguments */
     }
 
     ppdClose(ppd);
+    unlink("test.ppdb");
 
    /*
     * Test new constraints...
@@ -853,6 +954,32 @@ main(int  argc,				/* I - Number of command-line arguments */
       status ++;
     }
   }
+  else if (!strcmp(argv[1], "-b"))
+  {
+   /*
+    * Benchmark option, choice, and attribute lookups...
+    */
+
+    if (argc != 3)
+    {
+      puts("Usage: ./testppd -b filename.ppd");
+      return (1);
+    }
+
+    if ((ppd = ppdOpenFile(argv[2])) == NULL)
+    {
+      ppd_status_t	err;		/* Last error in file */
+      int		line;		/* Line number in file */
+
+
+      err = ppdLastError(&line);
+
+      printf("%s: %s on line %d\n", argv[2], ppdErrorString(err), line);
+      return (1);
+    }
+
+    do_bench(ppd);
+  }
   else
   {
     const char	*filename;		/* PPD filename */
@@ -1106,6 +1233,173 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'do_bench()' - Benchmark option, choice, and attribute lookups.
+ *
+ * Each lookup is timed with the PPD file's hash index and again with the
+ * sorted arrays and linear choice searches that are used without it.
+ */
+
+static void
+do_bench(ppd_file_t *ppd)		/* I - PPD file */
+{
+  int		i, j, k,		/* Looping vars */
+		pass,			/* Current pass */
+		iterations,		/* Number of iterations */
+		num_options,		/* Number of options */
+		num_choices,		/* Number of choices */
+		num_marks;		/* Number of options to mark */
+  ppd_group_t	*group;			/* Current group */
+  ppd_option_t	*option;		/* Current option */
+  ppd_choice_t	*choice;		/* Current choice */
+  ppd_attr_t	*attr;			/* Current attribute */
+  cups_option_t	*marks;			/* Options to mark */
+  _ppd_index_t	*index = ppd->index;	/* Hash index */
+  double	start,			/* Start time */
+		secs[2][4];		/* Times for each pass and lookup */
+  static const char * const names[4] =	/* Lookup names */
+  {
+    "ppdFindOption",
+    "ppdFindChoice",
+    "ppdFindAttr",
+    "cupsMarkOptions"
+  };
+
+
+  if (!index)
+  {
+    puts("PPD file has no hash index.");
+    return;
+  }
+
+ /*
+  * Collect up to 100 options to mark, like a typical job...
+  */
+
+  for (i = ppd->num_groups, group = ppd->groups, num_options = 0,
+           num_choices = 0, num_marks = 0, marks = NULL;
+       i > 0;
+       i --, group ++)
+    for (j = group->num_options, option = group->options;
+         j > 0;
+	 j --, option ++)
+    {
+      num_options ++;
+      num_choices += option->num_choices;
+
+      if (num_marks < 100 && option->num_choices > 0)
+        num_marks = cupsAddOption(option->keyword,
+	                          option->choices[option->num_choices - 1].choice,
+				  num_marks, &marks);
+    }
+
+  iterations = 1000;
+
+ /*
+  * Mark once before timing so the PPD cache and constraints are loaded...
+  */
+
+  cupsMarkOptions(ppd, num_marks, marks);
+
+  printf("%d options, %d choices, %d attributes, %d iterations.\n",
+         num_options, num_choices, ppd->num_attrs, iterations);
+
+  for (pass = 0; pass < 2; pass ++)
+  {
+    ppd->index = pass ? NULL : index;
+
+    start = get_seconds();
+    for (k = 0; k < iterations; k ++)
+      for (i = ppd->num_groups, group = ppd->groups; i > 0; i --, group ++)
+	for (j = group->num_options, option = group->options;
+	     j > 0;
+	     j --, option ++)
+	  ppdFindOption(ppd, option->keyword);
+    secs[pass][0] = get_seconds() - start;
+
+    start = get_seconds();
+    for (k = 0; k < iterations; k ++)
+      for (i = ppd->num_groups, group = ppd->groups; i > 0; i --, group ++)
+	for (j = group->num_options, option = group->options;
+	     j > 0;
+	     j --, option ++)
+	{
+	  int	m;			/* Looping var */
+
+	  for (m = option->num_choices, choice = option->choices;
+	       m > 0;
+	       m --, choice ++)
+	    _ppdFindChoice(ppd, option, choice->choice);
+	}
+    secs[pass][1] = get_seconds() - start;
+
+    start = get_seconds();
+    for (k = 0; k < iterations; k ++)
+      for (i = 0; i < ppd->num_attrs; i ++)
+      {
+        attr = ppd->attrs[i];
+
+	ppdFindAttr(ppd, attr->name, attr->spec);
+      }
+    secs[pass][2] = get_seconds() - start;
+
+    start = get_seconds();
+    for (k = 0; k < iterations; k ++)
+      cupsMarkOptions(ppd, num_marks, marks);
+    secs[pass][3] = get_seconds() - start;
+  }
+
+  ppd->index = index;
+
+  cupsFreeOptions(num_marks, marks);
+
+  num_marks = num_marks ? 1 : 0;
+
+  for (i = 0; i < 4; i ++)
+  {
+    int count = i == 0 ? num_options : i == 1 ? num_choices :
+                i == 2 ? ppd->num_attrs : num_marks;
+					/* Lookups per iteration */
+
+    if (count == 0)
+      continue;
+
+    printf("%-16s %8.1f ns hashed, %8.1f ns sorted/linear\n", names[i],
+           1000000000.0 * secs[0][i] / iterations / count,
+           1000000000.0 * secs[1][i] / iterations / count);
+  }
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds.
+ */
+
+#ifdef WIN32
+#  include <windows.h>
+
+
+static double
+get_seconds(void)
+{
+  return (GetTickCount() * 0.001);
+}
+#else
+#  include <sys/time.h>
+
+
+static double
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+#endif /* WIN32 */
+
+
 /*
  * End of "$Id: testppd.c 11645 2014-02-27 16:35:53Z msweet $".
  */
@@ -82,6 +82,7 @@ typedef void	*_cups_threadkey_t;
 
 extern void	_cupsMutexInit(_cups_mutex_t *mutex);
 extern void	_cupsMutexLock(_cups_mutex_t *mutex);
+extern int	_cupsMutexTryLock(_cups_mutex_t *mutex);
 extern void	_cupsMutexUnlock(_cups_mutex_t *mutex);
 extern void	_cupsRWInit(_cups_rwlock_t *rwlock);
 extern void	_cupsRWLockRead(_cups_rwlock_t *rwlock);
@@ -45,6 +45,17 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Lock a mutex if it is not already locked.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  return (!pthread_mutex_trylock(mutex));
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -155,6 +166,30 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Lock a mutex if it is not already locked.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  if (!mutex->m_init)
+  {
+    _cupsGlobalLock();
+
+    if (!mutex->m_init)
+    {
+      InitializeCriticalSection(&mutex->m_criticalSection);
+      mutex->m_init = 1;
+    }
+
+    _cupsGlobalUnlock();
+  }
+
+  return (TryEnterCriticalSection(&mutex->m_criticalSection) != 0);
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -247,6 +282,19 @@ _cupsMutexLock(_cups_mutex_t *mutex)	/* I - Mutex */
 }
 
 
+/*
+ * '_cupsMutexTryLock()' - Lock a mutex if it is not already locked.
+ */
+
+int					/* O - 1 if locked, 0 if busy */
+_cupsMutexTryLock(_cups_mutex_t *mutex)	/* I - Mutex */
+{
+  (void)mutex;
+
+  return (1);
+}
+
+
 /*
  * '_cupsMutexUnlock()' - Unlock a mutex.
  */
@@ -20,6 +20,7 @@
  */
 
 #include <cups/cups-private.h>
+#include <cups/file-private.h>
 
 
 /*
@@ -31,8 +32,6 @@ main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
   cups_file_t	*fp;			/* File */
-  char		buffer[8192];		/* Data buffer */
-  ssize_t	bytes;			/* Number of bytes read/written */
   int		copies;			/* Number of copies */
 
 
@@ -69,7 +68,8 @@ main(int  argc,				/* I - Number of command-line arguments */
   }
 
  /*
-  * Copy the file to stdout...
+  * Copy the file to stdout; uncompressed files are spliced straight into the
+  * next filter or backend when possible...
   */
 
   while (copies > 0)
@@ -79,16 +79,15 @@ main(int  argc,				/* I - Number of command-line arguments */
 
     cupsFileRewind(fp);
 
-    while ((bytes = cupsFileRead(fp, buffer, sizeof(buffer))) > 0)
-      if (write(1, buffer, (size_t)bytes) < bytes)
-      {
-	_cupsLangPrintFilter(stderr, "ERROR",
-			     _("Unable to write uncompressed print data: %s"),
-			     strerror(errno));
-	cupsFileClose(fp);
+    if (_cupsFilePassThrough(fp, 1) < 0)
+    {
+      _cupsLangPrintFilter(stderr, "ERROR",
+			   _("Unable to write uncompressed print data: %s"),
+			   strerror(errno));
+      cupsFileClose(fp);
 
-	return (1);
-      }
+      return (1);
+    }
 
     copies --;
   }
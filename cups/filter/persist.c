@@ -0,0 +1,595 @@
+/*
+ * "$Id$"
+ *
+ * Persistent filter support for CUPS.
+ *
+ * Copyright 2007-2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * This file is subject to the Apple OS-Developed Software exception.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/raster-private.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef HAVE_SANDBOX_H
+#  include <sandbox.h>
+#  ifndef SANDBOX_NAMED_EXTERNAL
+#    define SANDBOX_NAMED_EXTERNAL  0x0003
+#  endif /* !SANDBOX_NAMED_EXTERNAL */
+#  pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif /* HAVE_SANDBOX_H */
+
+extern char **environ;
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct _cups_persist_ppd_s	/**** Cached PPD file ****/
+{
+  ppd_file_t	*ppd;			/* PPD file or NULL */
+  char		filename[1024];		/* PPD filename */
+  struct stat	fileinfo;		/* PPD file information */
+} _cups_persist_ppd_t;
+
+
+/*
+ * Local globals...
+ */
+
+static int	persist_pipe[2] = { -1, -1 };
+					/* Pipe for SIGCHLD notifications */
+static int	persist_ready[2] = { -1, -1 };
+					/* Pipe for "spare process took a job" */
+
+
+/*
+ * Local functions...
+ */
+
+static void	persist_child(int sig);
+static void	persist_exec(_cups_persist_cb_t cb, ppd_file_t *ppd,
+		             const char *profile, int argc, char *argv[],
+		             char *envp[], int fds[5])
+		             __attribute__((noreturn));
+static void	persist_load(_cups_persist_ppd_t *cache, const char *ppdfile);
+static int	persist_recv(void *buffer, size_t length);
+static void	persist_request(_cups_persist_cb_t cb,
+		                _cups_persist_ppd_t *cache);
+static void	persist_send(int type, int pid, int status);
+static int	persist_spare(_cups_persist_cb_t cb,
+		              _cups_persist_ppd_t *cache);
+
+
+/*
+ * '_cupsFilterRunPersistent()' - Run a filter as a persistent worker.
+ *
+ * The worker keeps the PPD file named by the "PPD" environment variable
+ * loaded and always has one "spare" process forked from it that waits for
+ * the next job request from the scheduler on standard input.  The process ID
+ * of the spare process is sent to the scheduler ahead of time, so the
+ * scheduler never waits for the worker when it starts a job.  The spare
+ * process calls "cb" with the job's arguments, environment, and file
+ * descriptors after applying the scheduler's security profile for the job.
+ *
+ * The worker, the spare process, and the job processes share one process
+ * group so that the scheduler can stop all of them at once.  When the
+ * scheduler shuts down its end of the connection instead, the worker exits
+ * after the jobs that are still running have finished.
+ */
+
+int					/* O - Exit status */
+_cupsFilterRunPersistent(
+    _cups_persist_cb_t cb)		/* I - Filter main function */
+{
+  _cups_persist_ppd_t	cache;		/* Cached PPD file */
+  struct pollfd		pfds[2];	/* Polled descriptors */
+  int			i,		/* Looping var */
+			pid,		/* Finished process */
+			status,		/* Exit status of process */
+			spare = 0,	/* Spare process */
+			taken = 1,	/* Did the spare process take a job? */
+			stop = 0;	/* Stop the worker? */
+  char			buffer[256];	/* Notification buffer */
+#if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
+  struct sigaction	action;		/* Actions for POSIX signals */
+#endif /* HAVE_SIGACTION && !HAVE_SIGSET */
+
+
+  setpgid(0, 0);
+
+ /*
+  * Create pipes that wake up poll() when a job process finishes or the spare
+  * process takes a job...
+  */
+
+  if (pipe(persist_pipe) || pipe(persist_ready))
+  {
+    fprintf(stderr, "DEBUG: Unable to create pipe: %s\n", strerror(errno));
+    return (1);
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    fcntl(persist_pipe[i], F_SETFL, O_NONBLOCK);
+    fcntl(persist_pipe[i], F_SETFD, FD_CLOEXEC);
+    fcntl(persist_ready[i], F_SETFL, O_NONBLOCK);
+    fcntl(persist_ready[i], F_SETFD, FD_CLOEXEC);
+  }
+
+#ifdef HAVE_SIGSET /* Use System V signals over POSIX to avoid bugs */
+  sigset(SIGCHLD, persist_child);
+#elif defined(HAVE_SIGACTION)
+  memset(&action, 0, sizeof(action));
+
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = persist_child;
+  action.sa_flags   = SA_RESTART;
+  sigaction(SIGCHLD, &action, NULL);
+#else
+  signal(SIGCHLD, persist_child);
+#endif /* HAVE_SIGSET */
+
+ /*
+  * Run jobs until the spare process exits without taking one, which happens
+  * when the scheduler closes the connection...
+  */
+
+  memset(&cache, 0, sizeof(cache));
+
+  while (!stop)
+  {
+    if (taken)
+    {
+     /*
+      * Start the next spare process and tell the scheduler about it...
+      */
+
+      persist_load(&cache, getenv("PPD"));
+
+      if ((spare = persist_spare(cb, &cache)) <= 0)
+        break;
+
+      persist_send(_CUPS_PERSIST_STARTED, spare, 0);
+
+      taken = 0;
+    }
+
+    pfds[0].fd     = persist_pipe[0];
+    pfds[0].events = POLLIN;
+    pfds[1].fd     = persist_ready[0];
+    pfds[1].events = POLLIN;
+
+    if (poll(pfds, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      break;
+    }
+
+   /*
+    * Check for a taken job first; the spare process may already be done
+    * with it...
+    */
+
+    while (read(persist_ready[0], buffer, sizeof(buffer)) > 0)
+      taken = 1;
+
+    while (read(persist_pipe[0], buffer, sizeof(buffer)) > 0);
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+      persist_send(_CUPS_PERSIST_EXITED, pid, status);
+
+      if (pid == spare && !taken)
+        stop = 1;
+    }
+  }
+
+ /*
+  * Report the exit status of any jobs that are still running...
+  */
+
+  while ((pid = waitpid(-1, &status, 0)) != 0)
+  {
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      break;
+    }
+
+    persist_send(_CUPS_PERSIST_EXITED, pid, status);
+  }
+
+  ppdClose(cache.ppd);
+
+  return (0);
+}
+
+
+/*
+ * 'persist_child()' - Wake up the main loop when a job process finishes.
+ */
+
+static void
+persist_child(int sig)			/* I - Signal number (unused) */
+{
+  int	saved_errno = errno;		/* Saved errno value */
+
+
+  (void)sig;
+
+  if (write(persist_pipe[1], "", 1) < 1)
+  {
+   /*
+    * The pipe is already full, so poll() will wake up anyway...
+    */
+  }
+
+  errno = saved_errno;
+}
+
+
+/*
+ * 'persist_exec()' - Set up a job process and run the filter.
+ */
+
+static void
+persist_exec(_cups_persist_cb_t cb,	/* I - Filter main function */
+             ppd_file_t         *ppd,	/* I - Cached PPD file or NULL */
+             const char         *profile,
+					/* I - Security profile or "" */
+             int                argc,	/* I - Number of arguments */
+             char               *argv[],/* I - Arguments */
+             char               *envp[],/* I - Environment */
+             int                fds[5])	/* I - Job file descriptors */
+{
+  int		i,			/* Looping var */
+		fd;			/* Current file descriptor */
+#ifdef HAVE_SANDBOX_H
+  char		*sandbox_error = NULL;	/* Sandbox error, if any */
+#endif /* HAVE_SANDBOX_H */
+
+
+#ifdef HAVE_SIGSET
+  sigset(SIGCHLD, SIG_DFL);
+#else
+  signal(SIGCHLD, SIG_DFL);
+#endif /* HAVE_SIGSET */
+
+  close(persist_pipe[0]);
+  close(persist_pipe[1]);
+  close(persist_ready[0]);
+  close(persist_ready[1]);
+
+ /*
+  * Move the job descriptors out of the way, then put them in place of the
+  * worker's standard input, output, error, back-, and side-channel...
+  */
+
+  for (i = 0; i < 5; i ++)
+    if (fds[i] >= 0 && fds[i] < 5)
+    {
+      fd = fcntl(fds[i], F_DUPFD, 5);
+      close(fds[i]);
+      fds[i] = fd;
+    }
+
+  for (i = 0; i < 5; i ++)
+  {
+    if (fds[i] < 0)
+    {
+      if (i > 2)
+      {
+        close(i);
+        continue;
+      }
+
+      fds[i] = open("/dev/null", i ? O_WRONLY : O_RDONLY);
+    }
+
+    if (fds[i] != i)
+    {
+      dup2(fds[i], i);
+      close(fds[i]);
+    }
+  }
+
+  environ = envp;
+
+#ifdef HAVE_SANDBOX_H
+ /*
+  * Run in the job's security profile...
+  */
+
+  if (*profile &&
+      sandbox_init(profile, SANDBOX_NAMED_EXTERNAL, &sandbox_error))
+  {
+    fprintf(stderr, "DEBUG: sandbox_init failed: %s (%s)\n", sandbox_error,
+	    strerror(errno));
+    sandbox_free_error(sandbox_error);
+    exit(100 + EINVAL);
+  }
+#else
+  (void)profile;
+#endif /* HAVE_SANDBOX_H */
+
+  exit((*cb)(argc, argv, ppd));
+}
+
+
+/*
+ * 'persist_load()' - Load the PPD file if it has changed since the last job.
+ */
+
+static void
+persist_load(
+    _cups_persist_ppd_t *cache,		/* I - Cached PPD file */
+    const char          *ppdfile)	/* I - PPD filename or NULL */
+{
+  struct stat	fileinfo;		/* PPD file information */
+
+
+  if (!ppdfile || stat(ppdfile, &fileinfo))
+  {
+    ppdClose(cache->ppd);
+    cache->ppd         = NULL;
+    cache->filename[0] = '\0';
+  }
+  else if (!cache->ppd || strcmp(ppdfile, cache->filename) ||
+           fileinfo.st_ino != cache->fileinfo.st_ino ||
+           fileinfo.st_size != cache->fileinfo.st_size ||
+           fileinfo.st_mtime != cache->fileinfo.st_mtime)
+  {
+    ppdClose(cache->ppd);
+
+    if ((cache->ppd = ppdOpenFile(ppdfile)) != NULL)
+    {
+      strlcpy(cache->filename, ppdfile, sizeof(cache->filename));
+      cache->fileinfo = fileinfo;
+    }
+    else
+      cache->filename[0] = '\0';
+  }
+}
+
+
+/*
+ * 'persist_recv()' - Read an exact number of bytes from the scheduler.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+persist_recv(void   *buffer,		/* I - Buffer */
+             size_t length)		/* I - Number of bytes to read */
+{
+  char		*ptr = (char *)buffer;	/* Current position in buffer */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  while (length > 0)
+  {
+    if ((bytes = recv(0, ptr, length, MSG_WAITALL)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return (-1);
+    }
+    else if (bytes == 0)
+      return (-1);
+
+    ptr    += bytes;
+    length -= (size_t)bytes;
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'persist_request()' - Read a job request and run the job.
+ *
+ * This function only returns if the request cannot be read.
+ */
+
+static void
+persist_request(
+    _cups_persist_cb_t  cb,		/* I - Filter main function */
+    _cups_persist_ppd_t *cache)		/* I - Cached PPD file */
+{
+  _cups_persist_req_t	req;		/* Request header */
+  struct msghdr		msg;		/* Socket message */
+  struct iovec		iov;		/* I/O vector for header */
+  struct cmsghdr	*cmsg;		/* Control message */
+  union
+  {
+    struct cmsghdr	hdr;		/* Alignment */
+    char		buf[CMSG_SPACE(5 * sizeof(int))];
+					/* Control buffer */
+  }			control;	/* Control data */
+  int			received[5],	/* Received descriptors */
+			num_received = 0,
+					/* Number of received descriptors */
+			fds[5],		/* Job descriptors */
+			i, j;		/* Looping vars */
+  ssize_t		bytes;		/* Bytes read */
+  char			*strings = NULL,/* Request strings */
+			*ptr,		/* Pointer into strings */
+			*end,		/* End of strings */
+			**argv = NULL,	/* Job arguments */
+			**envp = NULL;	/* Job environment */
+  const char		*ppdfile = NULL;/* PPD filename */
+
+
+ /*
+  * Read the request header and any attached descriptors...
+  */
+
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base       = &req;
+  iov.iov_len        = sizeof(req);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  while ((bytes = recvmsg(0, &msg, 0)) < 0 && errno == EINTR);
+
+  if (bytes <= 0)
+    return;
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+      num_received = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+      if (num_received > 5)
+        num_received = 5;
+
+      memcpy(received, CMSG_DATA(cmsg), (size_t)num_received * sizeof(int));
+    }
+
+  if ((size_t)bytes < sizeof(req) &&
+      persist_recv((char *)&req + bytes, sizeof(req) - (size_t)bytes))
+    goto done;
+
+ /*
+  * Validate the header and read the strings...
+  */
+
+  if (req.length < 1 || req.length > _CUPS_PERSIST_MAX ||
+      req.argc < 1 || req.argc > 100 || req.envc < 0 || req.envc > 200)
+    goto done;
+
+  for (i = 0, j = 0; i < 5; i ++)
+    if (req.fds & (1 << i))
+      fds[i] = j < num_received ? received[j ++] : -1;
+    else
+      fds[i] = -1;
+
+  if (j != num_received)
+    goto done;
+
+  if ((strings = malloc((size_t)req.length + 1)) == NULL ||
+      (argv = calloc((size_t)req.argc + 1, sizeof(char *))) == NULL ||
+      (envp = calloc((size_t)req.envc + 1, sizeof(char *))) == NULL)
+    goto done;
+
+  if (persist_recv(strings, (size_t)req.length))
+    goto done;
+
+  strings[req.length] = '\0';
+  end                 = strings + req.length;
+  ptr                 = strings + strlen(strings) + 1;
+
+  for (i = 0; i < req.argc && ptr < end; i ++, ptr += strlen(ptr) + 1)
+    argv[i] = ptr;
+
+  if (i < req.argc)
+    goto done;
+
+  for (i = 0; i < req.envc && ptr < end; i ++, ptr += strlen(ptr) + 1)
+  {
+    envp[i] = ptr;
+
+    if (!strncmp(ptr, "PPD=", 4))
+      ppdfile = ptr + 4;
+  }
+
+  if (i < req.envc)
+    goto done;
+
+ /*
+  * Let the worker start the next spare process, reload the PPD file if the
+  * job uses a different or changed file, and run the job...
+  */
+
+  if (write(persist_ready[1], "", 1) < 1)
+  {
+   /*
+    * The pipe is already full, so the worker will wake up anyway...
+    */
+  }
+
+  persist_load(cache, ppdfile);
+
+  persist_exec(cb, cache->ppd, strings, req.argc, argv, envp, fds);
+
+ /*
+  * Close the job descriptors and free memory...
+  */
+
+  done:
+
+  for (i = 0; i < num_received; i ++)
+    close(received[i]);
+
+  free(strings);
+  free(argv);
+  free(envp);
+}
+
+
+/*
+ * 'persist_send()' - Send a message to the scheduler.
+ */
+
+static void
+persist_send(int type,			/* I - Message type */
+             int pid,			/* I - Process ID */
+             int status)		/* I - Exit status */
+{
+  _cups_persist_msg_t	msg;		/* Message */
+
+
+  msg.type   = type;
+  msg.pid    = pid;
+  msg.status = status;
+
+  while (send(0, &msg, sizeof(msg), 0) < 0 && errno == EINTR);
+}
+
+
+/*
+ * 'persist_spare()' - Start a process that waits for the next job.
+ */
+
+static int				/* O - Process ID or -1 on error */
+persist_spare(
+    _cups_persist_cb_t  cb,		/* I - Filter main function */
+    _cups_persist_ppd_t *cache)		/* I - Cached PPD file */
+{
+  int	pid;				/* Process ID */
+
+
+  if ((pid = fork()) == 0)
+  {
+    persist_request(cb, cache);
+    exit(1);
+  }
+  else if (pid < 0)
+    fprintf(stderr, "DEBUG: Unable to fork: %s\n", strerror(errno));
+
+  return (pid);
+}
+
+
+/*
+ * End of "$Id$".
+ */
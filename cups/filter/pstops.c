@@ -26,6 +26,8 @@
 #include <cups/array.h>
 #include <cups/language-private.h>
 #include <signal.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 
 /*
@@ -67,6 +69,14 @@ typedef struct				/**** Page information ****/
   cups_option_t	*options;		/* Options for this page */
 } pstops_page_t;
 
+typedef struct				/**** Reference to print file data ****/
+{
+  off_t		pos,			/* Position in page data */
+		temp,			/* Offset in temporary file */
+		offset;			/* Offset in print file */
+  size_t	length;			/* Number of bytes */
+} pstops_ref_t;
+
 typedef struct				/**** Document information ****/
 {
   int		page;			/* Current page */
@@ -83,6 +93,12 @@ typedef struct				/**** Document information ****/
   cups_array_t	*pages;			/* Pages in document */
   cups_file_t	*temp;			/* Temporary file, if any */
   char		tempfile[1024];		/* Temporary filename */
+  off_t		temp_pos;		/* Position in page data */
+  cups_file_t	*input;			/* Print file for page data, if any */
+  int		num_refs,		/* Number of print file references */
+		alloc_refs;		/* Allocated print file references */
+  pstops_ref_t	*refs;			/* Print file references */
+  double	start_time;		/* Time filtering started */
   int		job_id;			/* Job ID */
   const char	*user,			/* User name */
 		*title;			/* Job name */
@@ -159,16 +175,21 @@ static ssize_t		copy_prolog(cups_file_t *fp, pstops_doc_t *doc,
 static ssize_t		copy_setup(cups_file_t *fp, pstops_doc_t *doc,
 			           ppd_file_t *ppd, char *line,
 				   ssize_t linelen, size_t linesize);
+static void		copy_temp(pstops_doc_t *doc, off_t offset,
+			          size_t length);
 static ssize_t		copy_trailer(cups_file_t *fp, pstops_doc_t *doc,
 			             ppd_file_t *ppd, int number, char *line,
 				     ssize_t linelen, size_t linesize);
 static void		do_prolog(pstops_doc_t *doc, ppd_file_t *ppd);
 static void 		do_setup(pstops_doc_t *doc, ppd_file_t *ppd);
+static void		doc_copy(pstops_doc_t *doc, cups_file_t *fp,
+			         const char *s, size_t len);
 static void		doc_printf(pstops_doc_t *doc, const char *format, ...)
 			__attribute__ ((__format__ (__printf__, 2, 3)));
 static void		doc_puts(pstops_doc_t *doc, const char *s);
 static void		doc_write(pstops_doc_t *doc, const char *s, size_t len);
 static void		end_nup(pstops_doc_t *doc, int number);
+static double		get_time(void);
 static int		include_feature(ppd_file_t *ppd, const char *line,
 			                int num_options,
 					cups_option_t **options);
@@ -204,6 +225,7 @@ main(int  argc,				/* I - Number of command-line args */
   cups_option_t	*options;		/* Print options */
   char		line[8192];		/* Line buffer */
   ssize_t	len;			/* Length of line buffer */
+  struct stat	fileinfo;		/* Print file information */
 #if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
   struct sigaction action;		/* Actions for POSIX signals */
 #endif /* HAVE_SIGACTION && !HAVE_SIGSET */
@@ -289,6 +311,18 @@ main(int  argc,				/* I - Number of command-line args */
 
   set_pstops_options(&doc, ppd, argv, num_options, options);
 
+  doc.start_time = get_time();
+
+ /*
+  * When pages are reordered or collated from an uncompressed print file,
+  * copy the page data from the print file instead of saving it in the
+  * temporary file...
+  */
+
+  if (doc.temp && argc == 7 && !cupsFileCompression(fp) &&
+      !stat(argv[6], &fileinfo) && S_ISREG(fileinfo.st_mode))
+    doc.input = cupsFileOpen(argv[6], "r");
+
  /*
   * Write any "exit server" options that have been selected...
   */
@@ -378,12 +412,21 @@ main(int  argc,				/* I - Number of command-line args */
   * Close files and remove the temporary file if needed...
   */
 
+  fprintf(stderr, "DEBUG: Filtered %d pages in %.3f seconds.\n", doc.page,
+          get_time() - doc.start_time);
+
   if (doc.temp)
   {
     cupsFileClose(doc.temp);
     unlink(doc.tempfile);
   }
 
+  if (doc.input)
+  {
+    cupsFileClose(doc.input);
+    free(doc.refs);
+  }
+
   ppdClose(ppd);
   cupsFreeOptions(num_options, options);
 
@@ -420,7 +463,7 @@ add_page(pstops_doc_t *doc,		/* I - Document information */
   }
 
   pageinfo->label  = strdup(label);
-  pageinfo->offset = cupsFileTell(doc->temp);
+  pageinfo->offset = doc->temp_pos;
 
   cupsArrayAdd(doc->pages, pageinfo);
 
@@ -827,7 +870,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
 
   while (strncmp(line, "%%Page:", 7) && strncmp(line, "%%Trailer", 9))
   {
-    doc_write(doc, line, (size_t)linelen);
+    doc_copy(doc, fp, line, (size_t)linelen);
 
     if ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) == 0)
       break;
@@ -872,7 +915,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
     doc_puts(doc, "showpage\n");
     end_nup(doc, doc->number_up);
 
-    pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+    pageinfo->length = (ssize_t)(doc->temp_pos - pageinfo->offset);
   }
 
   if (doc->slow_duplex && (doc->page & 1))
@@ -896,7 +939,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
     doc_puts(doc, "showpage\n");
     end_nup(doc, doc->number_up);
 
-    pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+    pageinfo->length = (ssize_t)(doc->temp_pos - pageinfo->offset);
   }
 
  /*
@@ -905,6 +948,14 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
 
   number = doc->slow_order ? 0 : doc->page;
 
+  if (doc->temp)
+    fprintf(stderr,
+            "DEBUG: Read %d pages in %.3f seconds, " CUPS_LLFMT " bytes "
+	    "saved in temporary file, " CUPS_LLFMT " bytes indexed in print "
+	    "file.\n", cupsArrayCount(doc->pages),
+	    get_time() - doc->start_time, CUPS_LLCAST cupsFileTell(doc->temp),
+	    CUPS_LLCAST (doc->temp_pos - cupsFileTell(doc->temp)));
+
   if (doc->temp && !JobCanceled && cupsArrayCount(doc->pages) > 0)
   {
     int	copy;				/* Current copy */
@@ -973,7 +1024,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
       if (!number)
       {
         pageinfo = (pstops_page_t *)cupsArrayFirst(doc->pages);
-	copy_bytes(doc->temp, 0, (size_t)pageinfo->offset);
+	copy_temp(doc, 0, (size_t)pageinfo->offset);
       }
 
      /*
@@ -1008,7 +1059,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
 		 pageinfo->bounding_box[2], pageinfo->bounding_box[3]);
 	}
 
-	copy_bytes(doc->temp, pageinfo->offset, (size_t)pageinfo->length);
+	copy_temp(doc, pageinfo->offset, (size_t)pageinfo->length);
 
 	pageinfo = doc->slow_order ? (pstops_page_t *)cupsArrayPrev(doc->pages) :
                                      (pstops_page_t *)cupsArrayNext(doc->pages);
@@ -1049,6 +1100,7 @@ copy_non_dsc(cups_file_t  *fp,		/* I - File to read from */
   int		copy;			/* Current copy */
   char		buffer[8192];		/* Copy buffer */
   ssize_t	bytes;			/* Number of bytes copied */
+  off_t		start = 0;		/* Start of document in print file */
 
 
   (void)linesize;
@@ -1146,14 +1198,16 @@ copy_non_dsc(cups_file_t  *fp,		/* I - File to read from */
 
   fwrite(line, (size_t)linelen, 1, stdout);
 
-  if (doc->temp)
+  if (doc->input)
+    start = cupsFileTell(fp) - linelen;
+  else if (doc->temp)
     cupsFileWrite(doc->temp, line, (size_t)linelen);
 
   while ((bytes = cupsFileRead(fp, buffer, sizeof(buffer))) > 0)
   {
     fwrite(buffer, 1, (size_t)bytes, stdout);
 
-    if (doc->temp)
+    if (doc->temp && !doc->input)
       cupsFileWrite(doc->temp, buffer, (size_t)bytes);
   }
 
@@ -1195,6 +1249,9 @@ copy_non_dsc(cups_file_t  *fp,		/* I - File to read from */
 
       copy_bytes(doc->temp, 0, 0);
 
+      if (doc->input)
+        copy_bytes(doc->input, start, 0);
+
       puts("%%EndDocument");
 
       if (doc->use_ESPshowpage)
@@ -1608,14 +1665,14 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
     else if (!strncmp(line, "%%BeginDocument", 15) ||
 	     !strncmp(line, "%ADO_BeginApplication", 21))
     {
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       level ++;
     }
     else if ((!strncmp(line, "%%EndDocument", 13) ||
 	      !strncmp(line, "%ADO_EndApplication", 19)) && level > 0)
     {
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       level --;
     }
@@ -1630,7 +1687,7 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
       int	bytes;			/* Bytes of data */
 
 
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       bytes = atoi(strchr(line, ':') + 1);
 
@@ -1648,13 +1705,13 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
 	  return (0);
 	}
 
-        doc_write(doc, line, (size_t)linelen);
+        doc_copy(doc, fp, line, (size_t)linelen);
 
 	bytes -= linelen;
       }
     }
     else
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
   }
   while ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) > 0);
 
@@ -1664,7 +1721,7 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
 
   end_nup(doc, number);
 
-  pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+  pageinfo->length = (ssize_t)(doc->temp_pos - pageinfo->offset);
 
   return (linelen);
 }
@@ -1709,7 +1766,7 @@ copy_prolog(cups_file_t  *fp,		/* I - File to read from */
           !strncmp(line, "%%Page:", 7))
         break;
 
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
     }
 
     if (!strncmp(line, "%%EndProlog", 11))
@@ -1801,6 +1858,86 @@ copy_setup(cups_file_t  *fp,		/* I - File to read from */
 }
 
 
+/*
+ * 'copy_temp()' - Copy page data from the temporary and print files to
+ *                 stdout.
+ */
+
+static void
+copy_temp(pstops_doc_t *doc,		/* I - Document information */
+          off_t        offset,		/* I - Offset to page data */
+	  size_t       length)		/* I - Length of page data */
+{
+  int		left,			/* Left index for search */
+		right,			/* Right index for search */
+		current;		/* Current reference */
+  pstops_ref_t	*ref;			/* Current reference */
+  off_t		end,			/* End of page data */
+		next,			/* End of data to copy this time */
+		temp;			/* Offset in temporary file */
+
+
+  if (!doc->num_refs)
+  {
+    copy_bytes(doc->temp, offset, length);
+    return;
+  }
+
+ /*
+  * Find the first reference that ends after the offset...
+  */
+
+  for (left = 0, right = doc->num_refs; left < right;)
+  {
+    current = (left + right) / 2;
+    ref     = doc->refs + current;
+
+    if ((ref->pos + (off_t)ref->length) <= offset)
+      left = current + 1;
+    else
+      right = current;
+  }
+
+ /*
+  * Then copy the data, switching between the temporary file and the print
+  * file as needed...
+  */
+
+  for (end = offset + (off_t)length, current = left; offset < end;)
+  {
+    ref = current < doc->num_refs ? doc->refs + current : NULL;
+
+    if (ref && ref->pos <= offset)
+    {
+      if ((next = ref->pos + (off_t)ref->length) > end)
+        next = end;
+
+      copy_bytes(doc->input, ref->offset + offset - ref->pos,
+                 (size_t)(next - offset));
+
+      current ++;
+    }
+    else
+    {
+      if (!ref || (next = ref->pos) > end)
+        next = end;
+
+      if (current > 0)
+      {
+        ref  = doc->refs + current - 1;
+	temp = ref->temp + offset - ref->pos - (off_t)ref->length;
+      }
+      else
+        temp = offset;
+
+      copy_bytes(doc->temp, temp, (size_t)(next - offset));
+    }
+
+    offset = next;
+  }
+}
+
+
 /*
  * 'copy_trailer()' - Copy the document trailer.
  *
@@ -2002,6 +2139,81 @@ do_setup(pstops_doc_t *doc,		/* I - Document information */
 }
 
 
+/*
+ * 'doc_copy()' - Send data from the print file to stdout and/or the temp file.
+ *
+ * "s" must be the data that was just read from "fp".  When we have the
+ * print file open for page data, only a reference to the data is saved.
+ */
+
+static void
+doc_copy(pstops_doc_t *doc,		/* I - Document information */
+         cups_file_t  *fp,		/* I - File the data was read from */
+	 const char   *s,		/* I - Data to send */
+	 size_t       len)		/* I - Number of bytes to send */
+{
+  off_t		offset;			/* Offset in print file */
+  pstops_ref_t	*ref;			/* Current reference */
+
+
+  if (!doc->input || !doc->temp)
+  {
+    doc_write(doc, s, len);
+    return;
+  }
+
+  if (!doc->slow_order)
+    fwrite(s, 1, len, stdout);
+
+  offset = cupsFileTell(fp) - (off_t)len;
+
+ /*
+  * Extend the last reference if the data follows it...
+  */
+
+  if (doc->num_refs > 0)
+  {
+    ref = doc->refs + doc->num_refs - 1;
+
+    if ((ref->pos + (off_t)ref->length) == doc->temp_pos &&
+        (ref->offset + (off_t)ref->length) == offset)
+    {
+      ref->length    += len;
+      doc->temp_pos += (off_t)len;
+      return;
+    }
+  }
+
+ /*
+  * Otherwise add a new reference...
+  */
+
+  if (doc->num_refs >= doc->alloc_refs)
+  {
+    if ((ref = realloc(doc->refs, (size_t)(doc->alloc_refs + 1024) *
+                                  sizeof(pstops_ref_t))) == NULL)
+    {
+      _cupsLangPrintError("EMERG",
+                          _("Unable to allocate memory for pages array"));
+      exit(1);
+    }
+
+    doc->refs       = ref;
+    doc->alloc_refs += 1024;
+  }
+
+  ref = doc->refs + doc->num_refs;
+  doc->num_refs ++;
+
+  ref->pos    = doc->temp_pos;
+  ref->temp   = cupsFileTell(doc->temp);
+  ref->offset = offset;
+  ref->length = len;
+
+  doc->temp_pos += (off_t)len;
+}
+
+
 /*
  * 'doc_printf()' - Send a formatted string to stdout and/or the temp file.
  *
@@ -2062,7 +2274,10 @@ doc_write(pstops_doc_t *doc,		/* I - Document information */
     fwrite(s, 1, len, stdout);
 
   if (doc->temp)
+  {
     cupsFileWrite(doc->temp, s, len);
+    doc->temp_pos += (off_t)len;
+  }
 }
 
 
@@ -2133,6 +2348,21 @@ end_nup(pstops_doc_t *doc,		/* I - Document information */
 }
 
 
+/*
+ * 'get_time()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+get_time(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
 /*
  * 'include_feature()' - Include a printer option/feature command.
  */
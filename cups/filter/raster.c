@@ -25,6 +25,35 @@
 #ifdef HAVE_STDINT_H
 #  include <stdint.h>
 #endif /* HAVE_STDINT_H */
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+/*
+ * Run detection in the PackBits encoder compares a vector of pixels with
+ * the next pixel at once when the compiler targets a SIMD instruction set...
+ */
+
+#ifdef __GNUC__
+#  if defined(__AVX2__)
+#    include <immintrin.h>
+#    define CUPS_RASTER_VECSIZE	32
+#  elif defined(__SSE2__)
+#    include <emmintrin.h>
+#    define CUPS_RASTER_VECSIZE	16
+#  elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define CUPS_RASTER_VECSIZE	16
+#  endif /* __AVX2__ */
+#endif /* __GNUC__ */
+
+
+/*
+ * Limits for cupsRasterWriteBand...
+ */
+
+#define _CUPS_RASTER_MAX_THREADS 16	/* Maximum number of threads */
+#define _CUPS_RASTER_MIN_LINES	8	/* Minimum lines per thread */
 
 
 /*
@@ -50,17 +79,48 @@ struct _cups_raster_s			/**** Raster stream data ****/
 			*bufptr,	/* Current (read) position in buffer */
 			*bufend;	/* End of current (read) buffer */
   size_t		bufsize;	/* Buffer size */
+  unsigned char		*band;		/* Band compression buffer */
+  size_t		bandsize;	/* Band compression buffer size */
+  int			threads;	/* Number of band compression threads */
 };
 
+typedef struct _cups_raster_line_s	/**** Line to compress ****/
+{
+  const unsigned char	*pixels;	/* Pixels for line */
+  unsigned		count;		/* Line repeat count */
+} _cups_raster_line_t;
+
+typedef struct _cups_raster_job_s	/**** Band compression job ****/
+{
+  cups_raster_t		*r;		/* Raster stream */
+  _cups_raster_line_t	*lines;		/* Lines to compress */
+  unsigned		num_lines;	/* Number of lines */
+  unsigned char		*buffer;	/* Compressed data */
+  size_t		bytes;		/* Bytes of compressed data */
+} _cups_raster_job_t;
+
 
 /*
  * Local functions...
  */
 
+static void	*cups_raster_band(_cups_raster_job_t *job);
+#ifdef CUPS_RASTER_VECSIZE
+static unsigned	cups_raster_equal(const unsigned char *a,
+		                  const unsigned char *b);
+#endif /* CUPS_RASTER_VECSIZE */
+static void	cups_raster_fill(unsigned char *ptr, size_t bytes,
+		                 unsigned bpp);
 static ssize_t	cups_raster_io(cups_raster_t *r, unsigned char *buf, size_t bytes);
+static size_t	cups_raster_pack(cups_raster_t *r,
+		                 const unsigned char *pixels, unsigned repeat,
+				 unsigned char *buffer);
 static unsigned	cups_raster_read_header(cups_raster_t *r);
 static ssize_t	cups_raster_read(cups_raster_t *r, unsigned char *buf,
 		                 size_t bytes);
+static unsigned	cups_raster_span(const unsigned char *ptr,
+		                 const unsigned char *plast, unsigned bpp,
+				 unsigned max, int repeat);
 static void	cups_raster_update(cups_raster_t *r);
 static ssize_t	cups_raster_write(cups_raster_t *r,
 		                  const unsigned char *pixels);
@@ -87,6 +147,9 @@ cupsRasterClose(cups_raster_t *r)	/* I - Stream to close */
     if (r->pixels)
       free(r->pixels);
 
+    if (r->band)
+      free(r->band);
+
     free(r);
   }
 }
@@ -430,15 +493,9 @@ cupsRasterReadPixels(cups_raster_t *r,	/* I - Raster stream */
           if (!cups_raster_read(r, temp, r->bpp))
 	    return (0);
 
-	  temp  += r->bpp;
-	  count -= r->bpp;
+	  cups_raster_fill(temp + r->bpp, count - r->bpp, r->bpp);
 
-	  while (count > 0)
-	  {
-	    memcpy(temp, temp - r->bpp, r->bpp);
-	    temp  += r->bpp;
-	    count -= r->bpp;
-          }
+	  temp += count;
 	}
       }
 
@@ -897,6 +954,203 @@ cupsRasterWritePixels(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cupsRasterWriteBand()' - Write a band of lines to a raster stream.
+ *
+ * "lines" full lines of @code cupsBytesPerLine@ bytes each are written.
+ * For compressed streams the lines are compressed by several threads in
+ * parallel; the output is the same as writing each line with
+ * @link cupsRasterWritePixels@.
+ *
+ * @since CUPS 2.1@
+ */
+
+unsigned				/* O - Number of lines written */
+cupsRasterWriteBand(cups_raster_t *r,	/* I - Raster stream */
+                    unsigned char *p,	/* I - Lines to write */
+		    unsigned      lines)/* I - Number of lines to write */
+{
+  unsigned		y,		/* Current line */
+			count,		/* Repeat count for current line */
+			num_records,	/* Number of lines to compress */
+			num_jobs,	/* Number of compression jobs */
+			i;		/* Looping var */
+  size_t		bpl,		/* Bytes per line */
+			linesize;	/* Maximum size of a compressed line */
+  const unsigned char	*current;	/* Current line */
+  _cups_raster_line_t	*records,	/* Lines to compress */
+			*record;	/* Current record */
+  _cups_raster_job_t	jobs[_CUPS_RASTER_MAX_THREADS],
+					/* Compression jobs */
+			*job;		/* Current job */
+  unsigned char		*band;		/* New band buffer */
+#ifdef HAVE_PTHREAD_H
+  pthread_t		threads[_CUPS_RASTER_MAX_THREADS];
+					/* Compression threads */
+  int			started[_CUPS_RASTER_MAX_THREADS];
+					/* Was the thread started? */
+  long			cpus;		/* Number of processors */
+#endif /* HAVE_PTHREAD_H */
+
+
+  DEBUG_printf(("cupsRasterWriteBand(r=%p, p=%p, lines=%u), remaining=%u\n",
+		r, p, lines, r ? r->remaining : 0));
+
+  if (r == NULL || r->mode == CUPS_RASTER_READ || r->remaining == 0 ||
+      lines == 0)
+    return (0);
+
+  bpl = r->header.cupsBytesPerLine;
+
+  if (lines > r->remaining)
+    lines = r->remaining;
+
+ /*
+  * Uncompressed data and partially written lines are handled by
+  * cupsRasterWritePixels...
+  */
+
+  if (!r->compressed || r->pcurrent != r->pixels)
+    return (cupsRasterWritePixels(r, p, (unsigned)(lines * bpl)) ? lines : 0);
+
+ /*
+  * Collect the lines to compress, merging repeated lines the same way
+  * cupsRasterWritePixels does.  The pending line from a previous call is
+  * the first line we compare to...
+  */
+
+  if ((records = malloc((lines + 1) * sizeof(_cups_raster_line_t))) == NULL)
+    return (0);
+
+  current     = r->count ? r->pixels : NULL;
+  count       = r->count;
+  num_records = 0;
+
+  for (y = 0; y < lines; y ++, p += bpl)
+  {
+    if (count > 0 && !memcmp(p, current, bpl))
+      count ++;
+    else
+    {
+      if (count > 0)
+      {
+        records[num_records].pixels = current;
+        records[num_records].count  = count;
+	num_records ++;
+      }
+
+      current = p;
+      count   = 1;
+    }
+
+    if (count == 256 || y == (r->remaining - 1))
+    {
+      records[num_records].pixels = current;
+      records[num_records].count  = count;
+      num_records ++;
+
+      count = 0;
+    }
+  }
+
+ /*
+  * Make sure the band buffer can hold the compressed lines...
+  */
+
+  linesize = 2 * bpl + 2;
+
+  if (num_records * linesize > r->bandsize)
+  {
+    if ((band = realloc(r->band, num_records * linesize)) == NULL)
+    {
+      free(records);
+      return (0);
+    }
+
+    r->band     = band;
+    r->bandsize = num_records * linesize;
+  }
+
+ /*
+  * Split the lines into one job per thread...
+  */
+
+  num_jobs = 1;
+
+#ifdef HAVE_PTHREAD_H
+  if (!r->threads)
+  {
+    if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+      r->threads = 1;
+    else if (cpus > _CUPS_RASTER_MAX_THREADS)
+      r->threads = _CUPS_RASTER_MAX_THREADS;
+    else
+      r->threads = (int)cpus;
+  }
+
+  if ((num_jobs = num_records / _CUPS_RASTER_MIN_LINES) > (unsigned)r->threads)
+    num_jobs = (unsigned)r->threads;
+  else if (num_jobs < 1)
+    num_jobs = 1;
+#endif /* HAVE_PTHREAD_H */
+
+  for (i = 0, job = jobs, record = records; i < num_jobs; i ++, job ++)
+  {
+    job->r         = r;
+    job->lines     = record;
+    job->num_lines = num_records / num_jobs + (i < (num_records % num_jobs));
+    job->buffer    = r->band + (size_t)(record - records) * linesize;
+    job->bytes     = 0;
+
+    record += job->num_lines;
+  }
+
+ /*
+  * Compress the lines; the first job runs in this thread...
+  */
+
+#ifdef HAVE_PTHREAD_H
+  for (i = 1; i < num_jobs; i ++)
+    started[i] = !pthread_create(threads + i, NULL,
+                                 (void *(*)(void *))cups_raster_band,
+				 jobs + i);
+#endif /* HAVE_PTHREAD_H */
+
+  cups_raster_band(jobs);
+
+#ifdef HAVE_PTHREAD_H
+  for (i = 1; i < num_jobs; i ++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      cups_raster_band(jobs + i);
+#endif /* HAVE_PTHREAD_H */
+
+  free(records);
+
+ /*
+  * Write the compressed lines in order...
+  */
+
+  for (i = 0, job = jobs; i < num_jobs; i ++, job ++)
+    if (job->bytes > 0 &&
+        cups_raster_io(r, job->buffer, job->bytes) < (ssize_t)job->bytes)
+      return (0);
+
+ /*
+  * Save the last line if it may be repeated by the next call...
+  */
+
+  if (count > 0 && current != r->pixels)
+    memcpy(r->pixels, current, bpl);
+
+  r->count     = count;
+  r->remaining -= lines;
+
+  return (lines);
+}
+
+
 /*
  * 'cups_raster_read_header()' - Read a raster page header.
  */
@@ -967,6 +1221,101 @@ cups_raster_read_header(
 }
 
 
+/*
+ * 'cups_raster_band()' - Compress the lines in a band compression job.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+cups_raster_band(
+    _cups_raster_job_t *job)		/* I - Compression job */
+{
+  unsigned		i;		/* Looping var */
+  _cups_raster_line_t	*line;		/* Current line */
+
+
+  for (i = job->num_lines, line = job->lines; i > 0; i --, line ++)
+    job->bytes += cups_raster_pack(job->r, line->pixels, line->count,
+                                   job->buffer + job->bytes);
+
+  return (NULL);
+}
+
+
+#ifdef CUPS_RASTER_VECSIZE
+/*
+ * 'cups_raster_equal()' - Compare two vectors of bytes.
+ *
+ * Bit N of the result is set when byte N of both vectors is the same.
+ */
+
+static unsigned				/* O - Equal bytes mask */
+cups_raster_equal(
+    const unsigned char *a,		/* I - First vector */
+    const unsigned char *b)		/* I - Second vector */
+{
+#  if defined(__AVX2__)
+  return ((unsigned)_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)a),
+			                  _mm256_loadu_si256((const __m256i *)b))));
+
+#  elif defined(__SSE2__)
+  return ((unsigned)_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+			               _mm_loadu_si128((const __m128i *)b))));
+
+#  else
+  static const uint8_t	bits[16] =	/* Bit for each byte */
+  { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t		eq;		/* Equal bytes */
+
+
+  eq = vandq_u8(vceqq_u8(vld1q_u8(a), vld1q_u8(b)), vld1q_u8(bits));
+
+  return ((unsigned)vaddv_u8(vget_low_u8(eq)) |
+          ((unsigned)vaddv_u8(vget_high_u8(eq)) << 8));
+#  endif /* __AVX2__ */
+}
+#endif /* CUPS_RASTER_VECSIZE */
+
+
+/*
+ * 'cups_raster_fill()' - Repeat the pixel before "ptr" for "bytes" bytes.
+ */
+
+static void
+cups_raster_fill(unsigned char *ptr,	/* I - Pointer after first pixel */
+                 size_t        bytes,	/* I - Number of bytes to fill */
+		 unsigned      bpp)	/* I - Bytes per pixel */
+{
+  unsigned char	*start;			/* Start of repeated pixels */
+  size_t	filled,			/* Bytes filled so far */
+		count;			/* Bytes to copy this time */
+
+
+  if (bpp == 1)
+  {
+    memset(ptr, ptr[-1], bytes);
+    return;
+  }
+
+ /*
+  * Double the run of repeated pixels with each copy so that long runs only
+  * take a handful of (large) memcpy calls...
+  */
+
+  start = ptr - bpp;
+  bytes += bpp;
+
+  for (filled = bpp; filled < bytes; filled += count)
+  {
+    if ((count = bytes - filled) > filled)
+      count = filled;
+
+    memcpy(start + filled, start, count);
+  }
+}
+
+
 /*
  * 'cups_raster_io()' - Read/write bytes from a context, handling interruptions.
  */
@@ -998,6 +1347,99 @@ cups_raster_io(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_pack()' - Compress a row of raster data.
+ *
+ * "buffer" must hold at least 2 * cupsBytesPerLine bytes.
+ */
+
+static size_t				/* O - Number of bytes of compressed data */
+cups_raster_pack(
+    cups_raster_t       *r,		/* I - Raster stream */
+    const unsigned char *pixels,	/* I - Pixel data to compress */
+    unsigned            repeat,		/* I - Row repeat count */
+    unsigned char       *buffer)	/* O - Compressed data */
+{
+  const unsigned char	*start,		/* Start of sequence */
+			*ptr,		/* Current pointer in sequence */
+			*pend,		/* End of raster buffer */
+			*plast;		/* Pointer to last pixel */
+  unsigned char		*wptr;		/* Pointer into write buffer */
+  unsigned		bpp,		/* Bytes per pixel */
+			count;		/* Count */
+
+
+ /*
+  * Write the row repeat count...
+  */
+
+  bpp     = r->bpp;
+  pend    = pixels + r->header.cupsBytesPerLine;
+  plast   = pend - bpp;
+  wptr    = buffer;
+  *wptr++ = (unsigned char)(repeat - 1);
+
+ /*
+  * Write using a modified PackBits compression...
+  */
+
+  for (ptr = pixels; ptr < pend;)
+  {
+    start = ptr;
+    ptr += bpp;
+
+    if (ptr == pend)
+    {
+     /*
+      * Encode a single pixel at the end...
+      */
+
+      *wptr++ = 0;
+      for (count = bpp; count > 0; count --)
+        *wptr++ = *start++;
+    }
+    else if (!memcmp(start, ptr, bpp))
+    {
+     /*
+      * Encode a sequence of repeating pixels...
+      */
+
+      count = cups_raster_span(ptr, plast, bpp, 126, 1);
+      ptr   += count * bpp;
+      count += 2;
+
+      *wptr++ = (unsigned char)(count - 1);
+      for (count = bpp; count > 0; count --)
+        *wptr++ = *ptr++;
+    }
+    else
+    {
+     /*
+      * Encode a sequence of non-repeating pixels...
+      */
+
+      count = cups_raster_span(ptr, plast, bpp, 127, 0);
+      ptr   += count * bpp;
+      count ++;
+
+      if (ptr >= plast && count < 128)
+      {
+        count ++;
+	ptr += bpp;
+      }
+
+      *wptr++ = (unsigned char)(257 - count);
+
+      count *= bpp;
+      memcpy(wptr, start, count);
+      wptr += count;
+    }
+  }
+
+  return ((size_t)(wptr - buffer));
+}
+
+
 /*
  * 'cups_raster_read()' - Read through the raster buffer.
  */
@@ -1135,6 +1577,77 @@ cups_raster_read(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_span()' - Count the pixels in a run.
+ *
+ * Counts the pixels starting at "ptr" that are the same as ("repeat" = 1) or
+ * different from ("repeat" = 0) the pixel following them, stopping at "max"
+ * pixels or the last pixel in the row.
+ */
+
+static unsigned				/* O - Number of pixels */
+cups_raster_span(
+    const unsigned char *ptr,		/* I - First pixel */
+    const unsigned char *plast,		/* I - Last pixel in row */
+    unsigned            bpp,		/* I - Bytes per pixel */
+    unsigned            max,		/* I - Maximum number of pixels */
+    int                 repeat)		/* I - Count repeated pixels? */
+{
+  unsigned	count = 0;		/* Number of pixels */
+#ifdef CUPS_RASTER_VECSIZE
+  unsigned	i,			/* Looping var */
+		pixels,			/* Pixels per vector */
+		first,			/* Mask of first byte in each pixel */
+		equal,			/* Equal bytes */
+		stop;			/* Pixels that end the run */
+
+
+ /*
+  * Compare whole vectors of pixels with the following pixels.  A pixel is
+  * the same as the next one when all of its bytes compare equal, which we
+  * find by folding the bytes of each pixel onto its first byte...
+  */
+
+  if (bpp <= CUPS_RASTER_VECSIZE / 2)
+  {
+    pixels = CUPS_RASTER_VECSIZE / bpp;
+
+    for (i = 0, first = 0; i < pixels; i ++)
+      first |= 1U << (i * bpp);
+
+    while ((count + pixels) <= max && (ptr + CUPS_RASTER_VECSIZE) <= plast)
+    {
+      equal = cups_raster_equal(ptr, ptr + bpp);
+
+      for (i = 1, stop = equal; i < bpp; i ++)
+        stop &= equal >> i;
+
+      stop &= first;
+
+      if (repeat)
+        stop ^= first;
+
+      if (stop)
+        return (count + (unsigned)__builtin_ctz(stop) / bpp);
+
+      count += pixels;
+      ptr   += pixels * bpp;
+    }
+  }
+#endif /* CUPS_RASTER_VECSIZE */
+
+ /*
+  * Check the remaining pixels one at a time...
+  */
+
+  for (; count < max && ptr < plast; count ++, ptr += bpp)
+    if ((memcmp(ptr, ptr + bpp, bpp) == 0) != repeat)
+      break;
+
+  return (count);
+}
+
+
 /*
  * 'cups_raster_update()' - Update the raster header and row count for the
  *                          current page.
@@ -1268,13 +1781,8 @@ cups_raster_write(
     cups_raster_t       *r,		/* I - Raster stream */
     const unsigned char *pixels)	/* I - Pixel data to write */
 {
-  const unsigned char	*start,		/* Start of sequence */
-			*ptr,		/* Current pointer in sequence */
-			*pend,		/* End of raster buffer */
-			*plast;		/* Pointer to last pixel */
   unsigned char		*wptr;		/* Pointer into write buffer */
-  unsigned		bpp,		/* Bytes per pixel */
-			count;		/* Count */
+  unsigned		count;		/* Count */
 
 
   DEBUG_printf(("cups_raster_write(r=%p, pixels=%p)\n", r, pixels));
@@ -1298,74 +1806,8 @@ cups_raster_write(
     r->bufsize = count;
   }
 
- /*
-  * Write the row repeat count...
-  */
-
-  bpp     = r->bpp;
-  pend    = pixels + r->header.cupsBytesPerLine;
-  plast   = pend - bpp;
-  wptr    = r->buffer;
-  *wptr++ = (unsigned char)(r->count - 1);
-
- /*
-  * Write using a modified PackBits compression...
-  */
-
-  for (ptr = pixels; ptr < pend;)
-  {
-    start = ptr;
-    ptr += bpp;
-
-    if (ptr == pend)
-    {
-     /*
-      * Encode a single pixel at the end...
-      */
-
-      *wptr++ = 0;
-      for (count = bpp; count > 0; count --)
-        *wptr++ = *start++;
-    }
-    else if (!memcmp(start, ptr, bpp))
-    {
-     /*
-      * Encode a sequence of repeating pixels...
-      */
-
-      for (count = 2; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (memcmp(ptr, ptr + bpp, bpp))
-	  break;
-
-      *wptr++ = (unsigned char)(count - 1);
-      for (count = bpp; count > 0; count --)
-        *wptr++ = *ptr++;
-    }
-    else
-    {
-     /*
-      * Encode a sequence of non-repeating pixels...
-      */
-
-      for (count = 1; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (!memcmp(ptr, ptr + bpp, bpp))
-	  break;
-
-      if (ptr >= plast && count < 128)
-      {
-        count ++;
-	ptr += bpp;
-      }
-
-      *wptr++ = (unsigned char)(257 - count);
-
-      count *= bpp;
-      memcpy(wptr, start, count);
-      wptr += count;
-    }
-  }
-
-  return (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)));
+  return (cups_raster_io(r, r->buffer,
+                         cups_raster_pack(r, pixels, r->count, r->buffer)));
 }
 
 
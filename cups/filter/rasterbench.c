@@ -36,6 +36,21 @@
 #define TEST_HEIGHT	1024
 #define TEST_PAGES	16
 #define TEST_PASSES	20
+#define FORMAT_PAGES	4
+#define FORMAT_PASSES	5
+
+
+/*
+ * Local types...
+ */
+
+typedef struct membuf_s			/**** Memory buffer for raster data ****/
+{
+  unsigned char	*data;			/* Raster data */
+  size_t	used,			/* Bytes used */
+		alloc,			/* Bytes allocated */
+		pos;			/* Read position */
+} membuf_t;
 
 
 /*
@@ -43,7 +58,12 @@
  */
 
 static double	compute_median(double *secs);
+static void	format_test(void);
 static double	get_time(void);
+static void	make_test_data(unsigned char data[32][8 * TEST_WIDTH]);
+static ssize_t	membuf_read(void *ctx, unsigned char *buffer, size_t bytes);
+static ssize_t	membuf_write(void *ctx, unsigned char *buffer,
+		             size_t bytes);
 static void	read_test(int fd);
 static int	run_read_test(void);
 static void	write_test(int fd, cups_mode_t mode);
@@ -116,6 +136,12 @@ main(int  argc,				/* I - Number of command-line args */
   printf("\nMedian Total Time: %.3f seconds per document\n",
          compute_median(pass_secs));
 
+ /*
+  * Then measure the compression code for each color space and bit depth...
+  */
+
+  format_test();
+
   return (0);
 }
 
@@ -152,6 +178,124 @@ compute_median(double *secs)		/* I - Array of time samples */
 }
 
 
+/*
+ * 'format_test()' - Benchmark compressed raster data in memory by format.
+ */
+
+static void
+format_test(void)
+{
+  unsigned		i,		/* Looping var */
+			bits,		/* Bits per color */
+			pass,		/* Current pass */
+			page,		/* Current page */
+			y;		/* Current row */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  membuf_t		buf;		/* Compressed raster data */
+  double		start_secs,	/* Start time */
+			secs,		/* Elapsed time */
+			write_secs,	/* Fastest write time */
+			read_secs,	/* Fastest read time */
+			bytes;		/* Uncompressed bytes per pass */
+  static const struct
+  {
+    const char		*name;		/* Name of color space */
+    cups_cspace_t	cspace;		/* Color space */
+    unsigned		colors;		/* Number of colors */
+  }			spaces[] =	/* Color spaces to test */
+  {
+    { "K",    CUPS_CSPACE_K,    1 },
+    { "RGB",  CUPS_CSPACE_RGB,  3 },
+    { "CMYK", CUPS_CSPACE_CMYK, 4 }
+  };
+  static unsigned char	data[32][8 * TEST_WIDTH];
+					/* Raster data to write */
+  unsigned char		buffer[8 * TEST_WIDTH];
+					/* Read buffer */
+
+
+  make_test_data(data);
+
+  memset(&buf, 0, sizeof(buf));
+
+  printf("\nCompressed write/read speed of %d pages by format...\n\n",
+         FORMAT_PAGES);
+  puts("Space  Bits  Write MB/s   Read MB/s  Ratio");
+
+  for (i = 0; i < (sizeof(spaces) / sizeof(spaces[0])); i ++)
+    for (bits = 8; bits <= 16; bits += 8)
+    {
+      memset(&header, 0, sizeof(header));
+      header.cupsWidth        = TEST_WIDTH;
+      header.cupsHeight       = TEST_HEIGHT;
+      header.cupsBitsPerColor = bits;
+      header.cupsBitsPerPixel = bits * spaces[i].colors;
+      header.cupsBytesPerLine = TEST_WIDTH * header.cupsBitsPerPixel / 8;
+      header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+      header.cupsColorSpace   = spaces[i].cspace;
+      header.cupsNumColors    = spaces[i].colors;
+
+      for (pass = 0, write_secs = read_secs = 1000000.0;
+           pass < FORMAT_PASSES;
+	   pass ++)
+      {
+        buf.used = 0;
+	buf.pos  = 0;
+
+        start_secs = get_time();
+
+	if ((r = cupsRasterOpenIO(membuf_write, &buf,
+	                          CUPS_RASTER_WRITE_COMPRESSED)) == NULL)
+	{
+	  perror("Unable to create raster output stream");
+	  free(buf.data);
+	  return;
+	}
+
+	for (page = 0; page < FORMAT_PAGES; page ++)
+	{
+	  cupsRasterWriteHeader2(r, &header);
+
+	  for (y = 0; y < TEST_HEIGHT; y ++)
+	    cupsRasterWritePixels(r, data[y & 31], header.cupsBytesPerLine);
+	}
+
+	cupsRasterClose(r);
+
+	if ((secs = get_time() - start_secs) < write_secs)
+	  write_secs = secs;
+
+        start_secs = get_time();
+
+	if ((r = cupsRasterOpenIO(membuf_read, &buf, CUPS_RASTER_READ)) == NULL)
+	{
+	  perror("Unable to create raster input stream");
+	  free(buf.data);
+	  return;
+	}
+
+	while (cupsRasterReadHeader2(r, &header))
+	  for (y = 0; y < header.cupsHeight; y ++)
+	    cupsRasterReadPixels(r, buffer, header.cupsBytesPerLine);
+
+	cupsRasterClose(r);
+
+	if ((secs = get_time() - start_secs) < read_secs)
+	  read_secs = secs;
+      }
+
+      bytes = (double)FORMAT_PAGES * TEST_HEIGHT * header.cupsBytesPerLine;
+
+      printf("%-5s %5u %11.1f %11.1f %6.2f\n", spaces[i].name, bits,
+             bytes / write_secs / 1048576.0, bytes / read_secs / 1048576.0,
+	     bytes / buf.used);
+    }
+
+  free(buf.data);
+}
+
+
 /*
  * 'get_time()' - Get the current time in seconds.
  */
@@ -167,6 +311,102 @@ get_time(void)
 }
 
 
+/*
+ * 'make_test_data()' - Create rows of test data.
+ *
+ * The rows combine random data and repeated data to simulate text with some
+ * whitespace.
+ */
+
+static void
+make_test_data(
+    unsigned char data[32][8 * TEST_WIDTH])/* O - Raster data */
+{
+  unsigned	x, y;			/* Looping vars */
+  unsigned	count;			/* Number of bytes to set */
+
+
+  CUPS_SRAND(time(NULL));
+
+  memset(data, 0, 32 * 8 * TEST_WIDTH);
+
+  for (y = 0; y < 28; y ++)
+  {
+    for (x = CUPS_RAND() & 127, count = (CUPS_RAND() & 15) + 1;
+         x < (8 * TEST_WIDTH);
+         x ++, count --)
+    {
+      if (count <= 0)
+      {
+	x     += (CUPS_RAND() & 15) + 1;
+	count = (CUPS_RAND() & 15) + 1;
+
+        if (x >= (8 * TEST_WIDTH))
+	  break;
+      }
+
+      data[y][x] = (unsigned char)CUPS_RAND();
+    }
+  }
+}
+
+
+/*
+ * 'membuf_read()' - Read raster data from memory.
+ */
+
+static ssize_t				/* O - Bytes read */
+membuf_read(void          *ctx,		/* I - Memory buffer */
+            unsigned char *buffer,	/* I - Buffer */
+	    size_t        bytes)	/* I - Number of bytes to read */
+{
+  membuf_t	*buf = (membuf_t *)ctx;	/* Memory buffer */
+
+
+  if (bytes > (buf->used - buf->pos))
+    bytes = buf->used - buf->pos;
+
+  memcpy(buffer, buf->data + buf->pos, bytes);
+  buf->pos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'membuf_write()' - Write raster data to memory.
+ */
+
+static ssize_t				/* O - Bytes written or -1 */
+membuf_write(void          *ctx,	/* I - Memory buffer */
+             unsigned char *buffer,	/* I - Buffer */
+	     size_t        bytes)	/* I - Number of bytes to write */
+{
+  membuf_t	*buf = (membuf_t *)ctx;	/* Memory buffer */
+  unsigned char	*data;			/* New raster data */
+  size_t	alloc;			/* New allocation size */
+
+
+  if ((buf->used + bytes) > buf->alloc)
+  {
+    for (alloc = buf->alloc ? buf->alloc : 1048576;
+         alloc < (buf->used + bytes);
+	 alloc *= 2);
+
+    if ((data = realloc(buf->data, alloc)) == NULL)
+      return (-1);
+
+    buf->data  = data;
+    buf->alloc = alloc;
+  }
+
+  memcpy(buf->data + buf->used, buffer, bytes);
+  buf->used += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'read_test()' - Benchmark the raster read functions.
  */
@@ -256,8 +496,7 @@ static void
 write_test(int         fd,		/* I - File descriptor to write to */
            cups_mode_t mode)		/* I - Write mode */
 {
-  unsigned		page, x, y;	/* Looping vars */
-  unsigned		count;		/* Number of bytes to set */
+  unsigned		page, y;	/* Looping vars */
   cups_raster_t		*r;		/* Raster stream */
   cups_page_header2_t	header;		/* Page header */
   unsigned char		data[32][8 * TEST_WIDTH];
@@ -269,28 +508,7 @@ write_test(int         fd,		/* I - File descriptor to write to */
   * text with some whitespace.
   */
 
-  CUPS_SRAND(time(NULL));
-
-  memset(data, 0, sizeof(data));
-
-  for (y = 0; y < 28; y ++)
-  {
-    for (x = CUPS_RAND() & 127, count = (CUPS_RAND() & 15) + 1;
-         x < sizeof(data[0]);
-         x ++, count --)
-    {
-      if (count <= 0)
-      {
-	x     += (CUPS_RAND() & 15) + 1;
-	count = (CUPS_RAND() & 15) + 1;
-
-        if (x >= sizeof(data[0]))
-	  break;
-      }
-
-      data[y][x] = (unsigned char)CUPS_RAND();
-    }
-  }
+  make_test_data(data);
 
  /*
   * Test write speed...
@@ -23,7 +23,7 @@
 #include <cups/ppd.h>
 #include <cups/string-private.h>
 #include <cups/language-private.h>
-#include <cups/raster.h>
+#include <cups/raster-private.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
@@ -84,6 +84,7 @@ void	EndPage(ppd_file_t *ppd, cups_page_header2_t *header);
 void	CancelJob(int sig);
 void	OutputLine(ppd_file_t *ppd, cups_page_header2_t *header, unsigned y);
 void	PCLCompress(unsigned char *line, unsigned length);
+int	PrintJob(int argc, char *argv[], ppd_file_t *ppd);
 void	ZPLCompress(unsigned char repeat_char, unsigned repeat_count);
 
 
@@ -1086,12 +1087,38 @@ ZPLCompress(unsigned char repeat_char,	/* I - Character to repeat */
 int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
+{
+ /*
+  * Make sure status messages are not buffered...
+  */
+
+  setbuf(stderr, NULL);
+
+ /*
+  * Run as a persistent filter for the scheduler as needed...
+  */
+
+  if (argc == 2 && !strcmp(argv[1], "--persistent"))
+    return (_cupsFilterRunPersistent(PrintJob));
+  else
+    return (PrintJob(argc, argv, NULL));
+}
+
+
+/*
+ * 'PrintJob()' - Print a job, using the PPD file if it is already loaded.
+ */
+
+int					/* O - Exit status */
+PrintJob(int        argc,		/* I - Number of command-line arguments */
+         char       *argv[],		/* I - Command-line arguments */
+         ppd_file_t *ppd)		/* I - PPD file or NULL */
 {
   int			fd;		/* File descriptor */
   cups_raster_t		*ras;		/* Raster stream for printing */
   cups_page_header2_t	header;		/* Page header from file */
   unsigned		y;		/* Current line */
-  ppd_file_t		*ppd;		/* PPD file */
+  ppd_file_t		*ppdfile = NULL;/* PPD file opened for this job */
   int			num_options;	/* Number of options */
   cups_option_t		*options;	/* Options */
 #if defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
@@ -1099,12 +1126,6 @@ main(int  argc,				/* I - Number of command-line arguments */
 #endif /* HAVE_SIGACTION && !HAVE_SIGSET */
 
 
- /*
-  * Make sure status messages are not buffered...
-  */
-
-  setbuf(stderr, NULL);
-
  /*
   * Check command-line...
   */
@@ -1165,7 +1186,9 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   num_options = cupsParseOptions(argv[5], 0, &options);
 
-  ppd = ppdOpenFile(getenv("PPD"));
+  if (!ppd)
+    ppd = ppdfile = ppdOpenFile(getenv("PPD"));
+
   if (!ppd)
   {
     ppd_status_t	status;		/* PPD error */
@@ -1276,7 +1299,7 @@ main(int  argc,				/* I - Number of command-line arguments */
   * Close the PPD file and free the options...
   */
 
-  ppdClose(ppd);
+  ppdClose(ppdfile);
   cupsFreeOptions(num_options, options);
 
  /*
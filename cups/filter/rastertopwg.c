@@ -24,6 +24,13 @@
 #include <fcntl.h>
 
 
+/*
+ * Constants...
+ */
+
+#define RASTERTOPWG_BAND	256	/* Lines to compress at a time */
+
+
 /*
  * 'main()' - Main entry for filter.
  */
@@ -37,8 +44,10 @@ main(int  argc,				/* I - Number of command-line args */
 			*outras;	/* Output raster stream */
   cups_page_header2_t	inheader,	/* Input raster page header */
 			outheader;	/* Output raster page header */
-  unsigned		y;		/* Current line */
-  unsigned char		*line;		/* Line buffer */
+  unsigned		y,		/* Current line */
+			lines;		/* Lines in current band */
+  unsigned char		*line,		/* Line buffer */
+			*bandptr;	/* Pointer into band */
   unsigned		page = 0,	/* Current page */
 			page_width,	/* Actual page width */
 			page_height,	/* Actual page height */
@@ -401,7 +410,7 @@ main(int  argc,				/* I - Number of command-line args */
     * Copy raster data...
     */
 
-    line = malloc(linesize);
+    line = malloc(RASTERTOPWG_BAND * linesize);
 
     memset(line, white, linesize);
     for (y = page_top; y > 0; y --)
@@ -413,10 +422,23 @@ main(int  argc,				/* I - Number of command-line args */
 	return (1);
       }
 
-    for (y = inheader.cupsHeight; y > 0; y --)
+   /*
+    * Copy the page image a band at a time so that the lines can be
+    * compressed in parallel...
+    */
+
+    memset(line, white, RASTERTOPWG_BAND * linesize);
+    for (y = inheader.cupsHeight; y > 0; y -= lines)
     {
-      cupsRasterReadPixels(inras, line + lineoffset, inheader.cupsBytesPerLine);
-      if (!cupsRasterWritePixels(outras, line, outheader.cupsBytesPerLine))
+      if ((lines = y) > RASTERTOPWG_BAND)
+        lines = RASTERTOPWG_BAND;
+
+      for (bandptr = line + lineoffset;
+           bandptr < (line + lines * linesize);
+	   bandptr += linesize)
+        cupsRasterReadPixels(inras, bandptr, inheader.cupsBytesPerLine);
+
+      if (cupsRasterWriteBand(outras, line, lines) != lines)
       {
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
 	fprintf(stderr, "DEBUG: Unable to write line %d for page %d.\n",
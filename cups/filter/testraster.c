@@ -182,6 +182,7 @@ static cups_page_header2_t setpagedevice_header =
  * Local functions...
  */
 
+static int	do_band_tests(cups_mode_t mode);
 static int	do_ppd_tests(const char *filename, int num_options,
 		             cups_option_t *options);
 static int	do_ps_tests(void);
@@ -209,6 +210,8 @@ main(int  argc,				/* I - Number of command-line args */
     errors += do_raster_tests(CUPS_RASTER_WRITE);
     errors += do_raster_tests(CUPS_RASTER_WRITE_COMPRESSED);
     errors += do_raster_tests(CUPS_RASTER_WRITE_PWG);
+    errors += do_band_tests(CUPS_RASTER_WRITE_COMPRESSED);
+    errors += do_band_tests(CUPS_RASTER_WRITE_PWG);
   }
   else
   {
@@ -267,6 +270,131 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'do_band_tests()' - Test that cupsRasterWriteBand matches
+ *                     cupsRasterWritePixels.
+ */
+
+static int				/* O - Number of errors */
+do_band_tests(cups_mode_t mode)		/* I - Write mode */
+{
+  int			i;		/* Looping var */
+  unsigned		page,		/* Current page */
+			x, y,		/* Looping vars */
+			lines;		/* Lines in band */
+  FILE			*fp[2];		/* Raster files */
+  cups_raster_t		*r[2];		/* Raster streams */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		*data,		/* Raster data */
+			*line;		/* Current line */
+  int			ch;		/* Current character */
+  static const char * const filenames[2] =
+  {					/* Raster files */
+    "test.raster",
+    "test-band.raster"
+  };
+
+
+  printf("cupsRasterWriteBand(%s): ",
+         mode == CUPS_RASTER_WRITE_COMPRESSED ? "CUPS_RASTER_WRITE_COMPRESSED" :
+	                                        "CUPS_RASTER_WRITE_PWG");
+  fflush(stdout);
+
+  if ((data = malloc(600 * 1024)) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    if ((fp[i] = fopen(filenames[i], "wb+")) == NULL)
+    {
+      printf("FAIL (%s)\n", strerror(errno));
+      if (i)
+        fclose(fp[0]);
+      free(data);
+      return (1);
+    }
+
+    r[i] = cupsRasterOpen(fileno(fp[i]), mode);
+  }
+
+ /*
+  * Write the same pages with cupsRasterWritePixels and cupsRasterWriteBand.
+  * The first 300 lines are the same and the rest repeat in shorter runs so
+  * that runs cross band boundaries and the 256 line repeat limit...
+  */
+
+  for (page = 0; page < 3; page ++)
+  {
+    memset(&header, 0, sizeof(header));
+    header.cupsWidth        = 256;
+    header.cupsHeight       = 600;
+    header.cupsColorSpace   = page == 1 ? CUPS_CSPACE_RGB : CUPS_CSPACE_K;
+    header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+    header.cupsNumColors    = page == 1 ? 3 : 1;
+    header.cupsBitsPerColor = page == 2 ? 16 : 8;
+    header.cupsBitsPerPixel = header.cupsBitsPerColor * header.cupsNumColors;
+    header.cupsBytesPerLine = 256 * header.cupsBitsPerPixel / 8;
+
+    for (y = 0, line = data; y < header.cupsHeight;
+         y ++, line += header.cupsBytesPerLine)
+      for (x = 0; x < header.cupsBytesPerLine; x ++)
+        line[x] = (unsigned char)((y < 300 ? page : y * y / 1200) *
+	                          ((x / 7) & 3));
+
+    for (i = 0; i < 2; i ++)
+      cupsRasterWriteHeader2(r[i], &header);
+
+    for (y = 0, line = data; y < header.cupsHeight;
+         y ++, line += header.cupsBytesPerLine)
+      cupsRasterWritePixels(r[0], line, header.cupsBytesPerLine);
+
+    cupsRasterWritePixels(r[1], data, header.cupsBytesPerLine);
+
+    for (y = 1, line = data + header.cupsBytesPerLine;
+         y < header.cupsHeight;
+	 y += lines, line += lines * header.cupsBytesPerLine)
+    {
+      if ((lines = 37 + 50 * page) > (header.cupsHeight - y))
+        lines = header.cupsHeight - y;
+
+      if (cupsRasterWriteBand(r[1], line, lines) != lines)
+        break;
+    }
+  }
+
+  free(data);
+
+  for (i = 0; i < 2; i ++)
+  {
+    cupsRasterClose(r[i]);
+    rewind(fp[i]);
+  }
+
+ /*
+  * Compare the files...
+  */
+
+  while ((ch = getc(fp[0])) == getc(fp[1]))
+    if (ch == EOF)
+      break;
+
+  if (ch == EOF)
+    puts("PASS");
+  else
+    printf("FAIL (output differs at offset %ld)\n", ftell(fp[0]) - 1);
+
+  for (i = 0; i < 2; i ++)
+    fclose(fp[i]);
+
+  unlink(filenames[1]);
+
+  return (ch != EOF);
+}
+
+
 /*
  * 'do_ppd_tests()' - Test the default option commands in a PPD file.
  */
@@ -0,0 +1,506 @@
+/*
+ * "$Id$"
+ *
+ * Page accounting routines for the CUPS scheduler.
+ *
+ * Copyright 2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cupsd.h"
+#include <cups/accounting-private.h>
+
+
+/*
+ * Design Notes for Page Accounting
+ * --------------------------------
+ *
+ * The page_log file is text in the PageLogFormat format, which accounting
+ * programs have to parse and which can only be searched by reading all of
+ * it.  When AccountingDir is set, every page that is logged is also written
+ * as a fixed-size binary record to "AccountingDir/printer.page", with the
+ * strings (user, title, billing, etc.) stored in "AccountingDir/strings".
+ * See <cups/accounting-private.h> for the file format.
+ *
+ * The file for each printer is the printer index, and since the records in
+ * it are in time order a date range is found with a binary search.  The
+ * cupsacct(8) program uses this to report the pages printed per user and
+ * printer.
+ *
+ * Record times never go backwards within a file - if the clock is set back
+ * the time of the previous record is used.  A partial record left by a crash
+ * is truncated before the next record is appended.
+ *
+ * Strings are not looked up in the string table when they are added, so the
+ * same string can appear more than once; the scheduler remembers the offsets
+ * of recently used strings to keep the duplicates to a minimum.
+ */
+
+
+/*
+ * Local constants...
+ */
+
+#define CUPSD_ACCT_MAX_STRINGS	4096	/* Maximum number of cached strings */
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct cupsd_acctstr_s		/**** Cached string ****/
+{
+  unsigned	offset;			/* Offset in string table */
+  char		str[1];			/* String */
+} cupsd_acctstr_t;
+
+
+/*
+ * Local globals...
+ */
+
+static int		acct_fd = -1;	/* String table file */
+static cups_array_t	*acct_strings = NULL;
+					/* Cached strings */
+
+
+/*
+ * Local functions...
+ */
+
+static int		compare_strings(cupsd_acctstr_t *a, cupsd_acctstr_t *b);
+static unsigned		get_string(const char *s);
+static int		hash_string(cupsd_acctstr_t *a);
+static int		open_strings(void);
+static int		write_header(int fd, const char *magic);
+
+
+/*
+ * 'cupsdCloseAccounting()' - Close the page accounting files.
+ */
+
+void
+cupsdCloseAccounting(void)
+{
+  cupsd_acctstr_t	*str;		/* Current string */
+
+
+  if (acct_fd >= 0)
+  {
+    close(acct_fd);
+    acct_fd = -1;
+  }
+
+  for (str = (cupsd_acctstr_t *)cupsArrayFirst(acct_strings);
+       str;
+       str = (cupsd_acctstr_t *)cupsArrayNext(acct_strings))
+    free(str);
+
+  cupsArrayDelete(acct_strings);
+  acct_strings = NULL;
+}
+
+
+/*
+ * 'cupsdLogAccounting()' - Write a page accounting record.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdLogAccounting(cupsd_job_t *job,	/* I - Job being printed */
+                   const char  *page)	/* I - Page being printed */
+{
+  char			filename[1024],	/* Page file */
+			number[256];	/* Page number */
+  int			copies,		/* Number of copies */
+			fd;		/* Page file descriptor */
+  unsigned char		record[_CUPS_ACCT_RECORD];
+					/* Page record */
+  struct stat		fileinfo;	/* Page file information */
+  off_t			length;		/* Length of whole records */
+  time_t		curtime;	/* Time of record */
+  long long		lasttime;	/* Time of previous record */
+  ipp_attribute_t	*attr;		/* Job attribute */
+  const char		*billing,	/* job-billing value */
+			*host,		/* job-originating-host-name value */
+			*title,		/* job-name value */
+			*media;		/* media value */
+
+
+  if (!AccountingDir || !AccountingDir[0])
+    return (1);
+
+  if (!open_strings())
+    return (0);
+
+ /*
+  * Get the page number and copies the same way as cupsdLogPage()...
+  */
+
+  strlcpy(number, "1", sizeof(number));
+  copies = 1;
+  sscanf(page, "%255s%d", number, &copies);
+
+ /*
+  * Open the page file for the printer, creating it as needed...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/%s" _CUPS_ACCT_SUFFIX, AccountingDir,
+           job->printer->name);
+
+  if ((fd = open(filename, O_RDWR | O_CREAT | O_APPEND | O_NOFOLLOW,
+                 LogFilePerm)) < 0)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename,
+                strerror(errno));
+    return (0);
+  }
+
+  if (fstat(fd, &fileinfo))
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to stat \"%s\": %s", filename,
+                strerror(errno));
+    close(fd);
+    return (0);
+  }
+
+  curtime = time(NULL);
+
+  if (fileinfo.st_size == 0)
+  {
+   /*
+    * New file, write the header...
+    */
+
+    fchown(fd, RunUser, Group);
+    fchmod(fd, LogFilePerm);
+
+    if (!write_header(fd, _CUPS_ACCT_MAGIC))
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to write \"%s\": %s",
+                  filename, strerror(errno));
+      close(fd);
+      return (0);
+    }
+  }
+  else if (fileinfo.st_size < _CUPS_ACCT_HEADER)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Bad page accounting file \"%s\".",
+                filename);
+    close(fd);
+    return (0);
+  }
+  else
+  {
+   /*
+    * Drop any partial record and get the time of the last record...
+    */
+
+    length = fileinfo.st_size - _CUPS_ACCT_HEADER;
+    length -= length % _CUPS_ACCT_RECORD;
+
+    if (length + _CUPS_ACCT_HEADER != fileinfo.st_size)
+    {
+      cupsdLogJob(job, CUPSD_LOG_WARN,
+                  "Removing partial record from \"%s\".", filename);
+
+      if (ftruncate(fd, length + _CUPS_ACCT_HEADER))
+      {
+	cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to truncate \"%s\": %s",
+		    filename, strerror(errno));
+	close(fd);
+	return (0);
+      }
+    }
+
+    if (length > 0 &&
+        pread(fd, record, 8, length + _CUPS_ACCT_HEADER - _CUPS_ACCT_RECORD +
+	                     _CUPS_ACCT_TIME) == 8)
+    {
+      lasttime = (long long)_CUPS_ACCT_GET32(record) << 32 |
+                 _CUPS_ACCT_GET32(record + 4);
+
+      if (lasttime > curtime)
+        curtime = (time_t)lasttime;
+    }
+  }
+
+ /*
+  * Build the record...
+  */
+
+  if ((attr = ippFindAttribute(job->attrs, "job-billing",
+                               IPP_TAG_ZERO)) == NULL)
+    attr = ippFindAttribute(job->attrs, "job-account-id", IPP_TAG_ZERO);
+  billing = ippGetString(attr, 0, NULL);
+
+  attr = ippFindAttribute(job->attrs, "job-originating-host-name",
+                          IPP_TAG_ZERO);
+  host = ippGetString(attr, 0, NULL);
+
+  attr  = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME);
+  title = ippGetString(attr, 0, NULL);
+
+  if ((attr = ippFindAttribute(job->attrs, "media", IPP_TAG_ZERO)) != NULL)
+    media = ippGetString(attr, 0, NULL);
+  else if ((attr = ippFindAttribute(job->attrs, "media-col/media-size",
+                                    IPP_TAG_BEGIN_COLLECTION)) != NULL)
+  {
+    ipp_attribute_t *x_dimension = ippFindAttribute(ippGetCollection(attr, 0), "x-dimension", IPP_TAG_INTEGER);
+    ipp_attribute_t *y_dimension = ippFindAttribute(ippGetCollection(attr, 0), "y-dimension", IPP_TAG_INTEGER);
+					/* Media dimensions */
+    pwg_media_t	    *pwg = NULL;	/* PWG media name */
+
+    if (x_dimension && y_dimension)
+      pwg = pwgMediaForSize(ippGetInteger(x_dimension, 0),
+                            ippGetInteger(y_dimension, 0));
+
+    media = pwg ? pwg->pwg : NULL;
+  }
+  else
+    media = NULL;
+
+  memset(record, 0, sizeof(record));
+
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_TIME,
+                   (unsigned)((long long)curtime >> 32));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_TIME + 4, (unsigned)curtime);
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_JOB_ID, (unsigned)job->id);
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_COPIES, (unsigned)copies);
+
+  if (!_cups_strcasecmp(number, "total"))
+    _CUPS_ACCT_PUT32(record + _CUPS_ACCT_FLAGS, _CUPS_ACCT_FLAG_TOTAL);
+  else
+    _CUPS_ACCT_PUT32(record + _CUPS_ACCT_PAGE, (unsigned)atoi(number));
+
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_PRINTER, get_string(job->printer->name));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_USER, get_string(job->username));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_TITLE, get_string(title));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_BILLING, get_string(billing));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_HOST, get_string(host));
+  _CUPS_ACCT_PUT32(record + _CUPS_ACCT_MEDIA, get_string(media));
+
+ /*
+  * Append the record...
+  */
+
+  if (write(fd, record, sizeof(record)) != sizeof(record))
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to write \"%s\": %s", filename,
+                strerror(errno));
+    close(fd);
+    return (0);
+  }
+
+  close(fd);
+
+  return (1);
+}
+
+
+/*
+ * 'compare_strings()' - Compare two cached strings.
+ */
+
+static int				/* O - Result of comparison */
+compare_strings(cupsd_acctstr_t *a,	/* I - First string */
+                cupsd_acctstr_t *b)	/* I - Second string */
+{
+  return (strcmp(a->str, b->str));
+}
+
+
+/*
+ * 'get_string()' - Get the offset of a string, adding it as needed.
+ */
+
+static unsigned				/* O - Offset in string table or 0 */
+get_string(const char *s)		/* I - String */
+{
+  cupsd_acctstr_t	*str,		/* New string */
+			*cached;	/* Cached string */
+  size_t		len;		/* Length of string */
+  off_t			offset;		/* Offset in string table */
+
+
+  if (!s || !*s)
+    return (0);
+
+ /*
+  * Look for a cached copy...
+  */
+
+  len = strlen(s);
+
+  if ((str = malloc(sizeof(cupsd_acctstr_t) + len)) == NULL)
+    return (0);
+
+  str->offset = 0;
+  memcpy(str->str, s, len + 1);
+
+  if ((cached = (cupsd_acctstr_t *)cupsArrayFind(acct_strings, str)) != NULL)
+  {
+    free(str);
+    return (cached->offset);
+  }
+
+ /*
+  * Append the string to the string table...
+  */
+
+  if ((offset = lseek(acct_fd, 0, SEEK_END)) < 0 || offset > 0x7fffffff ||
+      write(acct_fd, s, len + 1) != (ssize_t)(len + 1))
+  {
+    free(str);
+    return (0);
+  }
+
+  str->offset = (unsigned)offset;
+
+ /*
+  * Cache it, starting over if we have too many strings...
+  */
+
+  if (cupsArrayCount(acct_strings) >= CUPSD_ACCT_MAX_STRINGS)
+  {
+    cupsd_acctstr_t	*temp;		/* Current string */
+
+    for (temp = (cupsd_acctstr_t *)cupsArrayFirst(acct_strings);
+	 temp;
+	 temp = (cupsd_acctstr_t *)cupsArrayNext(acct_strings))
+      free(temp);
+
+    cupsArrayClear(acct_strings);
+  }
+
+  cupsArrayAdd(acct_strings, str);
+
+  return (str->offset);
+}
+
+
+/*
+ * 'hash_string()' - Hash a cached string.
+ */
+
+static int				/* O - Hash value */
+hash_string(cupsd_acctstr_t *a)		/* I - String */
+{
+  const char	*s;			/* Pointer into string */
+  unsigned	hash;			/* Hash value */
+
+
+  for (s = a->str, hash = 0; *s; s ++)
+    hash = hash * 31 + (unsigned char)*s;
+
+  return ((int)(hash & 1023));
+}
+
+
+/*
+ * 'open_strings()' - Open the string table, creating directories and files
+ *                    as needed.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+open_strings(void)
+{
+  char		filename[1024];		/* String table file */
+  struct stat	fileinfo;		/* String table information */
+  mode_t	dir_perm = (mode_t)(0300 | LogFilePerm);
+					/* LogFilePerm + owner write/search */
+
+
+  if (acct_fd >= 0)
+    return (1);
+
+ /*
+  * Create the accounting directory as needed...
+  */
+
+  if (dir_perm & 0040)
+    dir_perm |= 0010;			/* Add group search */
+  if (dir_perm & 0004)
+    dir_perm |= 0001;			/* Add other search */
+
+  if (cupsdCheckPermissions(AccountingDir, NULL, dir_perm, RunUser, Group, 1,
+                            1) < 0)
+    return (0);
+
+ /*
+  * Open the string table...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/" _CUPS_ACCT_STRINGS, AccountingDir);
+
+  if ((acct_fd = open(filename, O_RDWR | O_CREAT | O_APPEND | O_NOFOLLOW,
+                      LogFilePerm)) < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename,
+                    strerror(errno));
+    return (0);
+  }
+
+  fcntl(acct_fd, F_SETFD, fcntl(acct_fd, F_GETFD) | FD_CLOEXEC);
+
+  if (fstat(acct_fd, &fileinfo))
+    fileinfo.st_size = -1;
+
+  if (fileinfo.st_size == 0)
+  {
+    fchown(acct_fd, RunUser, Group);
+    fchmod(acct_fd, LogFilePerm);
+
+    if (!write_header(acct_fd, _CUPS_ACCT_STRMAGIC))
+      fileinfo.st_size = -1;
+  }
+
+  if (fileinfo.st_size < 0 ||
+      (fileinfo.st_size > 0 && fileinfo.st_size < _CUPS_ACCT_HEADER))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Bad page accounting file \"%s\".",
+                    filename);
+    close(acct_fd);
+    acct_fd = -1;
+    return (0);
+  }
+
+  if (!acct_strings)
+    acct_strings = cupsArrayNew2((cups_array_func_t)compare_strings, NULL,
+                                 (cups_ahash_func_t)hash_string, 1024);
+
+  return (1);
+}
+
+
+/*
+ * 'write_header()' - Write the header for a new accounting file.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+write_header(int        fd,		/* I - File descriptor */
+             const char *magic)		/* I - Magic string */
+{
+  unsigned char	header[_CUPS_ACCT_HEADER];
+					/* File header */
+
+
+  memcpy(header, magic, 8);
+  _CUPS_ACCT_PUT32(header + 8, _CUPS_ACCT_VERSION);
+  _CUPS_ACCT_PUT32(header + 12, _CUPS_ACCT_RECORD);
+
+  return (write(fd, header, sizeof(header)) == sizeof(header));
+}
+
+
+/*
+ * End of "$Id$".
+ */
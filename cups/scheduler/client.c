@@ -414,6 +414,16 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
 
   partial = 0;
 
+  if (con->pending_loads > 0)
+  {
+   /*
+    * Don't resume the request when background job loads complete...
+    */
+
+    cupsdCancelWork(con);
+    con->pending_loads = 0;
+  }
+
   if (con->pipe_pid != 0)
   {
    /*
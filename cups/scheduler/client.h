@@ -51,6 +51,8 @@ struct cupsd_client_s
 			got_fields,	/* Non-zero if all fields seen */
 			header_used;	/* Number of header bytes used */
   char			header[2048];	/* Header from CGI program */
+  int			pending_loads,	/* Number of job loads pending */
+			sync_loads;	/* Load jobs synchronously? */
   cups_lang_t		*language;	/* Language to use */
 #ifdef HAVE_SSL
   int			auto_ssl;	/* Automatic test for SSL/TLS */
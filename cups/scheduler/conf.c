@@ -98,7 +98,9 @@ static const cupsd_var_t	cupsd_vars[] =
 #endif /* HAVE_LAUNCHD */
   { "LimitRequestBody",		&MaxRequestSize,	CUPSD_VARTYPE_INTEGER },
   { "ListenBackLog",		&ListenBackLog,		CUPSD_VARTYPE_INTEGER },
+  { "LogBufferSize",		&LogBufferSize,		CUPSD_VARTYPE_INTEGER },
   { "LogDebugHistory",		&LogDebugHistory,	CUPSD_VARTYPE_INTEGER },
+  { "LogSyncInterval",		&LogSyncInterval,	CUPSD_VARTYPE_TIME },
   { "MaxActiveJobs",		&MaxActiveJobs,		CUPSD_VARTYPE_INTEGER },
   { "MaxClients",		&MaxClients,		CUPSD_VARTYPE_INTEGER },
   { "MaxClientsPerHost",	&MaxClientsPerHost,	CUPSD_VARTYPE_INTEGER },
@@ -127,11 +129,13 @@ static const cupsd_var_t	cupsd_vars[] =
   { "ServerName",		&ServerName,		CUPSD_VARTYPE_STRING },
   { "StrictConformance",	&StrictConformance,	CUPSD_VARTYPE_BOOLEAN },
   { "Timeout",			&Timeout,		CUPSD_VARTYPE_TIME },
-  { "WebInterface",		&WebInterface,		CUPSD_VARTYPE_BOOLEAN }
+  { "WebInterface",		&WebInterface,		CUPSD_VARTYPE_BOOLEAN },
+  { "WorkerThreads",		&WorkerThreads,		CUPSD_VARTYPE_INTEGER }
 };
 static const cupsd_var_t	cupsfiles_vars[] =
 {
   { "AccessLog",		&AccessLog,		CUPSD_VARTYPE_STRING },
+  { "AccountingDir",		&AccountingDir,		CUPSD_VARTYPE_STRING },
   { "CacheDir",			&CacheDir,		CUPSD_VARTYPE_STRING },
   { "ConfigFilePerm",		&ConfigFilePerm,	CUPSD_VARTYPE_PERM },
   { "DataDir",			&DataDir,		CUPSD_VARTYPE_STRING },
@@ -179,6 +183,7 @@ static const unsigned	zeros[4] =
 static http_addrlist_t	*get_address(const char *value, int defport);
 static int		get_addr_and_mask(const char *value, unsigned *ip,
 			                  unsigned *mask);
+static double		get_elapsed(struct timeval *start);
 static void		mime_error_cb(void *ctx, const char *message);
 static int		parse_aaa(cupsd_location_t *loc, char *line,
 			          char *value, int linenum);
@@ -561,6 +566,7 @@ cupsdReadConfiguration(void)
   cupsdSetString(&DataDir, CUPS_DATADIR);
   cupsdSetString(&DocumentRoot, CUPS_DOCROOT);
   cupsdSetString(&AccessLog, CUPS_LOGDIR "/access_log");
+  cupsdClearString(&AccountingDir);
   cupsdClearString(&ErrorLog);
   cupsdSetString(&PageLog, CUPS_LOGDIR "/page_log");
   cupsdSetString(&PageLogFormat,
@@ -698,9 +704,11 @@ cupsdReadConfiguration(void)
   KeepAlive                = TRUE;
   KeepAliveTimeout         = DEFAULT_KEEPALIVE;
   ListenBackLog            = SOMAXCONN;
+  LogBufferSize            = 0;
   LogDebugHistory          = 200;
   LogFilePerm              = CUPS_DEFAULT_LOG_FILE_PERM;
   LogLevel                 = CUPSD_LOG_WARN;
+  LogSyncInterval          = 0;
   LogTimeFormat            = CUPSD_TIME_STANDARD;
   MaxClients               = 100;
   MaxClientsPerHost        = 0;
@@ -715,6 +723,7 @@ cupsdReadConfiguration(void)
   SyncOnClose              = FALSE;
   Timeout                  = DEFAULT_TIMEOUT;
   WebInterface             = CUPS_DEFAULT_WEBIF;
+  WorkerThreads            = 0;
 
   BrowseLocalProtocols     = parse_protocols(CUPS_DEFAULT_BROWSE_LOCAL_PROTOCOLS);
   BrowseWebIF              = FALSE;
@@ -730,6 +739,7 @@ cupsdReadConfiguration(void)
 
   cupsdSetString(&ErrorPolicy, "stop-printer");
 
+  JobCacheFormat      = CUPSD_JOBCACHE_BINARY;
   JobHistory          = DEFAULT_HISTORY;
   JobFiles            = DEFAULT_FILES;
   JobAutoPurge        = 0;
@@ -1059,6 +1069,9 @@ cupsdReadConfiguration(void)
   if (CacheDir[0] != '/')
     cupsdSetStringf(&CacheDir, "%s/%s", ServerRoot, CacheDir);
 
+  if (AccountingDir && AccountingDir[0] && AccountingDir[0] != '/')
+    cupsdSetStringf(&AccountingDir, "%s/%s", ServerRoot, AccountingDir);
+
 #ifdef HAVE_SSL
   if (ServerKeychain[0] != '/')
     cupsdSetStringf(&ServerKeychain, "%s/%s", ServerRoot, ServerKeychain);
@@ -1261,6 +1274,19 @@ cupsdReadConfiguration(void)
                   "Allowing up to %d client connections per host.",
                   MaxClientsPerHost);
 
+ /*
+  * Limit the number of worker threads to something reasonable...
+  */
+
+  if (WorkerThreads < 0)
+    WorkerThreads = 0;
+  else if (WorkerThreads > 64)
+    WorkerThreads = 64;
+
+  if (WorkerThreads > 0)
+    cupsdLogMessage(CUPSD_LOG_INFO, "Using %d worker threads.",
+                    WorkerThreads);
+
  /*
   * Update the default policy, as needed...
   */
@@ -1447,10 +1473,15 @@ cupsdReadConfiguration(void)
     mime_type_t	*type;			/* Current type */
     char	mimetype[MIME_MAX_SUPER + MIME_MAX_TYPE];
 					/* MIME type name */
+    struct timeval reload_start,	/* Start of reload */
+		phase_start;		/* Start of current phase */
 
 
     cupsdLogMessage(CUPSD_LOG_INFO, "Full reload is required.");
 
+    gettimeofday(&reload_start, NULL);
+    phase_start = reload_start;
+
    /*
     * Free all memory...
     */
@@ -1501,6 +1532,9 @@ cupsdReadConfiguration(void)
 		    "%d filters...", mimedir, ServerRoot,
 		    mimeNumTypes(MimeDatabase), mimeNumFilters(MimeDatabase));
 
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loaded MIME database in %.3f seconds.",
+                    get_elapsed(&phase_start));
+
    /*
     * Create a list of MIME types for the document-format-supported
     * attribute...
@@ -1565,7 +1599,12 @@ cupsdReadConfiguration(void)
     */
 
     cupsdLoadAllPrinters();
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loaded printers in %.3f seconds.",
+                    get_elapsed(&phase_start));
+
     cupsdLoadAllClasses();
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loaded classes in %.3f seconds.",
+                    get_elapsed(&phase_start));
 
     cupsdCreateCommonData();
 
@@ -1581,14 +1620,19 @@ cupsdReadConfiguration(void)
     */
 
     cupsdLoadAllJobs();
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loaded jobs in %.3f seconds.",
+                    get_elapsed(&phase_start));
 
    /*
     * Load subscriptions...
     */
 
     cupsdLoadAllSubscriptions();
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loaded subscriptions in %.3f seconds.",
+                    get_elapsed(&phase_start));
 
-    cupsdLogMessage(CUPSD_LOG_INFO, "Full reload complete.");
+    cupsdLogMessage(CUPSD_LOG_INFO, "Full reload complete in %.3f seconds.",
+                    get_elapsed(&reload_start));
   }
   else
   {
@@ -1965,6 +2009,27 @@ get_addr_and_mask(const char *value,	/* I - String from config file */
 }
 
 
+/*
+ * 'get_elapsed()' - Get the time since the start of a reload phase.
+ */
+
+static double				/* O - Elapsed time in seconds */
+get_elapsed(struct timeval *start)	/* IO - Start time, updated to now */
+{
+  struct timeval	curtime;	/* Current time */
+  double		elapsed;	/* Elapsed time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  elapsed = (double)(curtime.tv_sec - start->tv_sec) +
+            0.000001 * (double)(curtime.tv_usec - start->tv_usec);
+  *start  = curtime;
+
+  return (elapsed);
+}
+
+
 /*
  * 'mime_error_cb()' - Log a MIME error.
  */
@@ -3178,6 +3243,20 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
         cupsdLogMessage(CUPSD_LOG_WARN, "Unknown LogLevel %s on line %d.",
 	                value, linenum);
     }
+    else if (!_cups_strcasecmp(line, "JobCacheFormat") && value)
+    {
+     /*
+      * Format of the job cache file...
+      */
+
+      if (!_cups_strcasecmp(value, "binary"))
+        JobCacheFormat = CUPSD_JOBCACHE_BINARY;
+      else if (!_cups_strcasecmp(value, "text"))
+        JobCacheFormat = CUPSD_JOBCACHE_TEXT;
+      else
+        cupsdLogMessage(CUPSD_LOG_WARN, "Unknown JobCacheFormat %s on line %d.",
+	                value, linenum);
+    }
     else if (!_cups_strcasecmp(line, "LogTimeFormat") && value)
     {
      /*
@@ -3302,6 +3381,7 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
 	                linenum);
     }
     else if (!_cups_strcasecmp(line, "AccessLog") ||
+             !_cups_strcasecmp(line, "AccountingDir") ||
              !_cups_strcasecmp(line, "CacheDir") ||
              !_cups_strcasecmp(line, "ConfigFilePerm") ||
              !_cups_strcasecmp(line, "DataDir") ||
@@ -128,6 +128,8 @@ VAR gid_t		SystemGroupIDs[MAX_SYSTEM_GROUPS]
 					/* System group IDs */
 VAR char		*AccessLog		VALUE(NULL),
 					/* Access log filename */
+			*AccountingDir		VALUE(NULL),
+					/* Page accounting directory */
 			*ErrorLog		VALUE(NULL),
 					/* Error log filename */
 			*PageLog		VALUE(NULL),
@@ -168,6 +170,10 @@ VAR int			ClassifyOverride	VALUE(0),
 					/* Allow overrides? */
 			LogDebugHistory		VALUE(200),
 					/* Amount of automatic debug history */
+			LogBufferSize		VALUE(0),
+					/* Size of log buffer, 0 for none */
+			LogSyncInterval		VALUE(0),
+					/* Seconds between log file fsync() */
 			FatalErrors		VALUE(CUPSD_FATAL_CONFIG),
 					/* Which errors are fatal? */
 			StrictConformance	VALUE(FALSE),
@@ -222,8 +228,10 @@ VAR int			MaxClients		VALUE(100),
 					/* Share printers by default? */
 			MultipleOperationTimeout VALUE(DEFAULT_TIMEOUT),
 					/* multiple-operation-time-out value */
-			WebInterface		VALUE(CUPS_DEFAULT_WEBIF);
+			WebInterface		VALUE(CUPS_DEFAULT_WEBIF),
 					/* Enable the web interface? */
+			WorkerThreads		VALUE(0);
+					/* Number of worker threads */
 VAR cups_file_t		*AccessFile		VALUE(NULL),
 					/* Access log file */
 			*ErrorFile		VALUE(NULL),
@@ -277,6 +285,8 @@ extern int	cupsdCheckProgram(const char *filename, cupsd_printer_t *p);
 extern int	cupsdDefaultAuthType(void);
 extern void	cupsdFreeAliases(cups_array_t *aliases);
 extern char	*cupsdGetDateTime(struct timeval *t, cupsd_time_t format);
+extern int	cupsdGetLogStatistics(size_t *used, size_t *size, int *drops,
+		                      int *overflow);
 extern int	cupsdLogClient(cupsd_client_t *con, int level,
                                const char *message, ...)
                                __attribute__((__format__(__printf__, 3, 4)));
@@ -294,6 +304,8 @@ extern int	cupsdLogMessage(int level, const char *message, ...)
 extern int	cupsdLogPage(cupsd_job_t *job, const char *page);
 extern int	cupsdLogRequest(cupsd_client_t *con, http_status_t code);
 extern int	cupsdReadConfiguration(void);
+extern void	cupsdStartLogWriter(void);
+extern void	cupsdStopLogWriter(void);
 extern int	cupsdWriteErrorLog(int level, const char *message);
 
 
@@ -140,6 +140,14 @@ extern const char *cups_hstrerror(int);
 typedef void (*cupsd_selfunc_t)(void *data);
 
 
+/*
+ * Worker thread callback function types...
+ */
+
+typedef void (*cupsd_workfunc_t)(void *data);
+typedef void (*cupsd_donefunc_t)(void *owner, void *data);
+
+
 /*
  * Globals...
  */
@@ -168,6 +176,10 @@ VAR int			OnDemand	VALUE(0);
  * Prototypes...
  */
 
+/* accounting.c */
+extern void		cupsdCloseAccounting(void);
+extern int		cupsdLogAccounting(cupsd_job_t *job, const char *page);
+
 /* env.c */
 extern void		cupsdInitEnv(void);
 extern int		cupsdLoadEnv(char *envp[], int envmax);
@@ -201,15 +213,26 @@ extern void		cupsdSetStringf(char **s, const char *f, ...)
 			__attribute__ ((__format__ (__printf__, 2, 3)));
 
 /* process.c */
+extern void		cupsdCheckPersistentProcesses(void);
 extern void		*cupsdCreateProfile(int job_id, int allow_networking);
 extern void		cupsdDestroyProfile(void *profile);
 extern int		cupsdEndProcess(int pid, int force);
 extern const char	*cupsdFinishProcess(int pid, char *name, size_t namelen, int *job_id);
+extern time_t		cupsdGetPersistentKillTime(void);
+extern int		cupsdStartPersistentProcess(const char *command,
+			                            char *argv[], char *envp[],
+			                            int infd, int outfd,
+			                            int errfd, int backfd,
+			                            int sidefd, void *profile,
+			                            cupsd_job_t *job, int *pid);
 extern int		cupsdStartProcess(const char *command, char *argv[],
 					  char *envp[], int infd, int outfd,
 					  int errfd, int backfd, int sidefd,
 					  int root, void *profile,
 					  cupsd_job_t *job, int *pid);
+extern void		cupsdStopPersistentProcesses(cupsd_printer_t *p,
+			                             int force);
+extern int		cupsdWaitPersistentProcess(int *status);
 
 /* select.c */
 extern int		cupsdAddSelect(int fd, cupsd_selfunc_t read_cb,
@@ -226,6 +249,15 @@ extern void		cupsdStopSelect(void);
 extern void		cupsdStartServer(void);
 extern void		cupsdStopServer(void);
 
+/* worker.c */
+extern void		cupsdCancelWork(void *owner);
+extern int		cupsdQueueWork(void *owner, cupsd_workfunc_t work_cb,
+			               cupsd_donefunc_t done_cb, void *data);
+extern void		cupsdRunWork(cupsd_workfunc_t work_cb, void **data,
+			             int num_data);
+extern void		cupsdStartWorkers(void);
+extern void		cupsdStopWorkers(void);
+
 
 /*
  * End of "$Id: cupsd.h 11742 2014-03-26 21:14:15Z msweet $".
@@ -20,10 +20,19 @@
  *   mimeFilter2()          - Find the fastest way to convert from one type to
  *                            another, including the file size.
  *   mimeFilterLookup()     - Lookup a filter.
+ *   _mimeFreeFilterCache() - Free the filter chain cache.
+ *   mime_compare_chains()  - Compare two cached filter chains.
  *   mime_compare_filters() - Compare two filters.
+ *   mime_compare_nodes()   - Compare two conversion graph nodes.
  *   mime_compare_srcs()    - Compare two filter source types.
+ *   mime_find_chain()      - Find the filters to convert from one type to
+ *                            another using the filter chain cache.
  *   mime_find_filters()    - Find the filters to convert from one type to
  *                            another.
+ *   mime_pop_node()        - Remove the least costly node from a queue.
+ *   mime_push_node()       - Add a node to a queue.
+ *   mime_shortest_filters() - Find the least costly filters to convert from
+ *                            one type to another.
  */
 
 /*
@@ -32,7 +41,7 @@
 
 #include <cups/string-private.h>
 #include <cups/debug-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -45,16 +54,67 @@ typedef struct _mime_typelist_s		/**** List of source types ****/
   mime_type_t		*src;		/* Source type */
 } _mime_typelist_t;
 
+typedef struct _mime_chain_s		/**** Cached filter chain ****/
+{
+  mime_type_t		*src,		/* Source type */
+			*dst;		/* Destination type */
+  int			bucket,		/* File size bucket */
+			cost;		/* Cost of filters */
+  cups_array_t		*filters;	/* Filters to run or NULL for none */
+} _mime_chain_t;
+
+typedef struct _mime_fcache_s		/**** Filter chain cache ****/
+{
+  cups_array_t		*chains;	/* Cached filter chains */
+  int			num_sizes;	/* Number of maximum file sizes */
+  size_t		*sizes;		/* Sorted maximum file sizes */
+  int			negative;	/* Any filters with a negative cost? */
+} _mime_fcache_t;
+
+typedef struct _mime_node_s		/**** Conversion graph node ****/
+{
+  mime_type_t		*type;		/* Type */
+  int			cost,		/* Cost from source type */
+			hops,		/* Number of filters from source type */
+			done;		/* Least costly filters found? */
+  mime_filter_t		*filter;	/* Last filter to this type */
+} _mime_node_t;
+
+typedef struct _mime_qentry_s		/**** Node queue entry ****/
+{
+  int			cost,		/* Cost when queued */
+			hops;		/* Number of filters when queued */
+  _mime_node_t		*node;		/* Node */
+} _mime_qentry_t;
+
+typedef struct _mime_queue_s		/**** Node priority queue ****/
+{
+  int			num_entries,	/* Number of entries */
+			alloc_entries;	/* Allocated entries */
+  _mime_qentry_t	*entries;	/* Binary heap of entries */
+} _mime_queue_t;
+
 
 /*
  * Local functions...
  */
 
+static int		mime_compare_chains(_mime_chain_t *, _mime_chain_t *);
 static int		mime_compare_filters(mime_filter_t *, mime_filter_t *);
+static int		mime_compare_nodes(_mime_node_t *, _mime_node_t *);
 static int		mime_compare_srcs(mime_filter_t *, mime_filter_t *);
+static cups_array_t	*mime_find_chain(mime_t *mime, mime_type_t *src,
+			                 size_t srcsize, mime_type_t *dst,
+					 int *cost);
 static cups_array_t	*mime_find_filters(mime_t *mime, mime_type_t *src,
 				      size_t srcsize, mime_type_t *dst,
 				      int *cost, _mime_typelist_t *visited);
+static _mime_node_t	*mime_pop_node(_mime_queue_t *queue);
+static int		mime_push_node(_mime_queue_t *queue,
+			               _mime_node_t *node);
+static cups_array_t	*mime_shortest_filters(mime_t *mime, mime_type_t *src,
+			                       size_t srcsize, mime_type_t *dst,
+					       int *cost);
 
 
 /*
@@ -105,6 +165,8 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
                     temp->filter, temp->cost));
       temp->cost = cost;
       strlcpy(temp->filter, filter, sizeof(temp->filter));
+
+      _mimeFreeFilterCache(mime);
     }
   }
   else
@@ -134,6 +196,8 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
     DEBUG_puts("1mimeAddFilter: Adding new filter.");
     cupsArrayAdd(mime->filters, temp);
     cupsArrayAdd(mime->srcs, temp);
+
+    _mimeFreeFilterCache(mime);
   }
 
  /*
@@ -218,7 +282,7 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
   * Find the filters...
   */
 
-  filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL);
+  filters = mime_find_chain(mime, src, srcsize, dst, cost);
 
   DEBUG_printf(("1mimeFilter2: Returning %d filter(s), cost %d:",
                 cupsArrayCount(filters), cost ? *cost : -1));
@@ -266,6 +330,58 @@ mimeFilterLookup(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFreeFilterCache()' - Free the filter chain cache.
+ *
+ * The cache is rebuilt by the next call to mimeFilter2().
+ */
+
+void
+_mimeFreeFilterCache(mime_t *mime)	/* I - MIME database */
+{
+  _mime_fcache_t	*fcache;	/* Filter chain cache */
+  _mime_chain_t		*chain;		/* Current chain */
+
+
+  if (!mime || (fcache = mime->fcache) == NULL)
+    return;
+
+  DEBUG_printf(("2_mimeFreeFilterCache: Freeing %d chains.",
+                cupsArrayCount(fcache->chains)));
+
+  for (chain = (_mime_chain_t *)cupsArrayFirst(fcache->chains);
+       chain;
+       chain = (_mime_chain_t *)cupsArrayNext(fcache->chains))
+  {
+    cupsArrayDelete(chain->filters);
+    free(chain);
+  }
+
+  cupsArrayDelete(fcache->chains);
+  free(fcache->sizes);
+  free(fcache);
+
+  mime->fcache = NULL;
+}
+
+
+/*
+ * 'mime_compare_chains()' - Compare two cached filter chains.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_chains(_mime_chain_t *c0,	/* I - First chain */
+                    _mime_chain_t *c1)	/* I - Second chain */
+{
+  if (c0->src != c1->src)
+    return (c0->src < c1->src ? -1 : 1);
+  else if (c0->dst != c1->dst)
+    return (c0->dst < c1->dst ? -1 : 1);
+  else
+    return (c0->bucket - c1->bucket);
+}
+
+
 /*
  * 'mime_compare_filters()' - Compare two filters.
  */
@@ -286,6 +402,23 @@ mime_compare_filters(mime_filter_t *f0,	/* I - First filter */
 }
 
 
+/*
+ * 'mime_compare_nodes()' - Compare two conversion graph nodes.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_nodes(_mime_node_t *n0,	/* I - First node */
+                   _mime_node_t *n1)	/* I - Second node */
+{
+  if (n0->type < n1->type)
+    return (-1);
+  else if (n0->type > n1->type)
+    return (1);
+  else
+    return (0);
+}
+
+
 /*
  * 'mime_compare_srcs()' - Compare two filter source types.
  */
@@ -304,6 +437,171 @@ mime_compare_srcs(mime_filter_t *f0,	/* I - First filter */
 }
 
 
+/*
+ * 'mime_find_chain()' - Find the filters to convert from one type to another
+ *                       using the filter chain cache.
+ *
+ * Chains are cached by source type, destination type, and file size bucket;
+ * the bucket is the number of filter "maxsize" limits below the file size,
+ * so all sizes in a bucket can use the same filters.  mimeAddFilter() and
+ * mimeDeleteFilter() clear the cache.
+ */
+
+static cups_array_t *			/* O - Array of filters to run */
+mime_find_chain(mime_t      *mime,	/* I - MIME database */
+                mime_type_t *src,	/* I - Source file type */
+		size_t      srcsize,	/* I - Size of source file */
+		mime_type_t *dst,	/* I - Destination file type */
+		int         *cost)	/* O - Cost of filters */
+{
+  _mime_fcache_t	*fcache;	/* Filter chain cache */
+  _mime_chain_t		key,		/* Search key */
+			*chain;		/* Cached chain */
+  mime_filter_t		*current;	/* Current filter */
+  int			left,		/* Left side of binary search */
+			right,		/* Right side of binary search */
+			middle,		/* Middle of binary search */
+			tempcost;	/* Cost of filters */
+  cups_array_t		*filters;	/* Filters to run */
+
+
+ /*
+  * Create the cache as needed, collecting the maximum file sizes used by
+  * the filters...
+  */
+
+  if ((fcache = mime->fcache) == NULL)
+  {
+    if ((fcache = calloc(1, sizeof(_mime_fcache_t))) == NULL)
+      return (mime_shortest_filters(mime, src, srcsize, dst, cost));
+
+    fcache->chains = cupsArrayNew((cups_array_func_t)mime_compare_chains,
+                                  NULL);
+
+    cupsArraySave(mime->filters);
+
+    for (current = (mime_filter_t *)cupsArrayFirst(mime->filters);
+         current;
+	 current = (mime_filter_t *)cupsArrayNext(mime->filters))
+    {
+      if (current->cost < 0)
+        fcache->negative = 1;
+
+      if (current->maxsize > 0)
+        fcache->num_sizes ++;
+    }
+
+    if (fcache->num_sizes > 0)
+    {
+      if ((fcache->sizes = calloc((size_t)fcache->num_sizes,
+                                  sizeof(size_t))) == NULL)
+      {
+        cupsArrayRestore(mime->filters);
+        cupsArrayDelete(fcache->chains);
+	free(fcache);
+        return (mime_shortest_filters(mime, src, srcsize, dst, cost));
+      }
+
+      fcache->num_sizes = 0;
+
+      for (current = (mime_filter_t *)cupsArrayFirst(mime->filters);
+	   current;
+	   current = (mime_filter_t *)cupsArrayNext(mime->filters))
+      {
+        if (current->maxsize == 0)
+	  continue;
+
+       /*
+        * Insert the size in order, skipping duplicates...
+	*/
+
+        for (left = 0; left < fcache->num_sizes; left ++)
+	  if (fcache->sizes[left] >= current->maxsize)
+	    break;
+
+        if (left < fcache->num_sizes && fcache->sizes[left] == current->maxsize)
+	  continue;
+
+        memmove(fcache->sizes + left + 1, fcache->sizes + left,
+	        (size_t)(fcache->num_sizes - left) * sizeof(size_t));
+        fcache->sizes[left] = current->maxsize;
+	fcache->num_sizes ++;
+      }
+    }
+
+    cupsArrayRestore(mime->filters);
+
+    mime->fcache = fcache;
+  }
+
+ /*
+  * Find the size bucket...
+  */
+
+  for (left = 0, right = fcache->num_sizes; left < right;)
+  {
+    middle = (left + right) / 2;
+
+    if (fcache->sizes[middle] < srcsize)
+      left = middle + 1;
+    else
+      right = middle;
+  }
+
+ /*
+  * Look for a cached chain...
+  */
+
+  key.src    = src;
+  key.dst    = dst;
+  key.bucket = left;
+
+  if ((chain = (_mime_chain_t *)cupsArrayFind(fcache->chains, &key)) != NULL)
+  {
+    DEBUG_printf(("3mime_find_chain: Using cached chain (bucket %d).", left));
+
+    if (!chain->filters)
+      return (NULL);
+
+    if (cost)
+      *cost = chain->cost;
+
+    return (cupsArrayDup(chain->filters));
+  }
+
+ /*
+  * Not cached, find the least costly filters.  The shortest path search
+  * needs non-negative costs and distinct types, otherwise use the
+  * exhaustive search...
+  */
+
+  tempcost = 0;
+
+  if (fcache->negative || src == dst)
+    filters = mime_find_filters(mime, src, srcsize, dst, &tempcost, NULL);
+  else
+    filters = mime_shortest_filters(mime, src, srcsize, dst, &tempcost);
+
+  if ((chain = calloc(1, sizeof(_mime_chain_t))) != NULL)
+  {
+    chain->src    = src;
+    chain->dst    = dst;
+    chain->bucket = left;
+    chain->cost   = tempcost;
+
+    if (filters && (chain->filters = cupsArrayDup(filters)) == NULL)
+      free(chain);
+    else
+      cupsArrayAdd(fcache->chains, chain);
+  }
+
+  if (filters && cost)
+    *cost = tempcost;
+
+  return (filters);
+}
+
+
 /*
  * 'mime_find_filters()' - Find the filters to convert from one type to another.
  */
@@ -499,6 +797,224 @@ mime_find_filters(
 }
 
 
+/*
+ * 'mime_pop_node()' - Remove the least costly node from a queue.
+ */
+
+static _mime_node_t *			/* O - Node or NULL if queue is empty */
+mime_pop_node(_mime_queue_t *queue)	/* I - Queue */
+{
+  int			i, j;		/* Looping vars */
+  _mime_node_t		*node;		/* Least costly node */
+  _mime_qentry_t	last;		/* Last entry */
+
+
+  if (queue->num_entries == 0)
+    return (NULL);
+
+  node = queue->entries[0].node;
+  last = queue->entries[-- queue->num_entries];
+
+  for (i = 0; (j = 2 * i + 1) < queue->num_entries; i = j)
+  {
+    if (j + 1 < queue->num_entries &&
+        (queue->entries[j + 1].cost < queue->entries[j].cost ||
+	 (queue->entries[j + 1].cost == queue->entries[j].cost &&
+	  queue->entries[j + 1].hops < queue->entries[j].hops)))
+      j ++;
+
+    if (last.cost < queue->entries[j].cost ||
+        (last.cost == queue->entries[j].cost &&
+	 last.hops <= queue->entries[j].hops))
+      break;
+
+    queue->entries[i] = queue->entries[j];
+  }
+
+  if (queue->num_entries > 0)
+    queue->entries[i] = last;
+
+  return (node);
+}
+
+
+/*
+ * 'mime_push_node()' - Add a node to a queue.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mime_push_node(_mime_queue_t *queue,	/* I - Queue */
+               _mime_node_t  *node)	/* I - Node */
+{
+  int			i, j;		/* Looping vars */
+  _mime_qentry_t	*temp;		/* New entries */
+
+
+  if (queue->num_entries >= queue->alloc_entries)
+  {
+    if ((temp = realloc(queue->entries, (size_t)(queue->alloc_entries + 32) *
+                                        sizeof(_mime_qentry_t))) == NULL)
+      return (-1);
+
+    queue->entries       = temp;
+    queue->alloc_entries += 32;
+  }
+
+  for (i = queue->num_entries ++; i > 0; i = j)
+  {
+    j = (i - 1) / 2;
+
+    if (queue->entries[j].cost < node->cost ||
+        (queue->entries[j].cost == node->cost &&
+	 queue->entries[j].hops <= node->hops))
+      break;
+
+    queue->entries[i] = queue->entries[j];
+  }
+
+  queue->entries[i].cost = node->cost;
+  queue->entries[i].hops = node->hops;
+  queue->entries[i].node = node;
+
+  return (0);
+}
+
+
+/*
+ * 'mime_shortest_filters()' - Find the least costly filters to convert from
+ *                             one type to another.
+ *
+ * This is Dijkstra's algorithm over the types, using the filters as edges.
+ * Ties in cost are broken by the number of filters, so a direct filter is
+ * used over a chain of the same cost.
+ */
+
+static cups_array_t *			/* O - Array of filters to run */
+mime_shortest_filters(
+    mime_t      *mime,			/* I - MIME database */
+    mime_type_t *src,			/* I - Source file type */
+    size_t      srcsize,		/* I - Size of source file */
+    mime_type_t *dst,			/* I - Destination file type */
+    int         *cost)			/* O - Cost of filters */
+{
+  cups_array_t		*nodes,		/* Nodes seen so far */
+			*filters = NULL;/* Filters to run */
+  _mime_node_t		key,		/* Search key */
+			*node,		/* Current node */
+			*next;		/* Next node */
+  _mime_queue_t		queue;		/* Queue of nodes */
+  int			tempcost;	/* Cost through current filter */
+  mime_filter_t		*current,	/* Current filter */
+			srckey;		/* Source type key */
+
+
+  DEBUG_printf(("2mime_shortest_filters(mime=%p, src=%p(%s/%s), srcsize="
+                CUPS_LLFMT ", dst=%p(%s/%s), cost=%p)", mime, src, src->super,
+		src->type, CUPS_LLCAST srcsize, dst, dst->super, dst->type,
+		cost));
+
+  memset(&queue, 0, sizeof(queue));
+
+  if ((nodes = cupsArrayNew((cups_array_func_t)mime_compare_nodes,
+                            NULL)) == NULL ||
+      (node = calloc(1, sizeof(_mime_node_t))) == NULL)
+  {
+    cupsArrayDelete(nodes);
+    return (NULL);
+  }
+
+  node->type = src;
+  cupsArrayAdd(nodes, node);
+
+  mime_push_node(&queue, node);
+
+  while ((node = mime_pop_node(&queue)) != NULL)
+  {
+    if (node->done)
+      continue;
+
+    node->done = 1;
+
+    if (node->type == dst)
+      break;
+
+   /*
+    * Update the types we can convert to from this type, queuing each one
+    * whose cost goes down...
+    */
+
+    srckey.src = node->type;
+
+    for (current = (mime_filter_t *)cupsArrayFind(mime->srcs, &srckey);
+         current && current->src == node->type;
+	 current = (mime_filter_t *)cupsArrayNext(mime->srcs))
+    {
+      if (current->maxsize > 0 && srcsize > current->maxsize)
+        continue;
+
+      tempcost = node->cost + current->cost;
+      key.type = current->dst;
+
+      if ((next = (_mime_node_t *)cupsArrayFind(nodes, &key)) == NULL)
+      {
+        if ((next = calloc(1, sizeof(_mime_node_t))) == NULL)
+	  continue;
+
+        next->type = current->dst;
+	cupsArrayAdd(nodes, next);
+      }
+      else if (next->done ||
+               (next->filter &&
+	        (next->cost < tempcost ||
+		 (next->cost == tempcost && next->hops <= node->hops + 1))))
+        continue;
+
+      next->cost   = tempcost;
+      next->hops   = node->hops + 1;
+      next->filter = current;
+
+      mime_push_node(&queue, next);
+    }
+  }
+
+ /*
+  * Build the array of filters by walking back from the destination...
+  */
+
+  key.type = dst;
+
+  if ((node = (_mime_node_t *)cupsArrayFind(nodes, &key)) != NULL &&
+      node->done && node->filter &&
+      (filters = cupsArrayNew(NULL, NULL)) != NULL)
+  {
+    if (cost)
+      *cost = node->cost;
+
+    while (node && node->filter)
+    {
+      cupsArrayInsert(filters, node->filter);
+
+      key.type = node->filter->src;
+      node     = (_mime_node_t *)cupsArrayFind(nodes, &key);
+    }
+  }
+
+  DEBUG_printf(("3mime_shortest_filters: Returning %d filter(s), cost %d, "
+                "%d types seen.", cupsArrayCount(filters), cost ? *cost : -1,
+		cupsArrayCount(nodes)));
+
+  for (node = (_mime_node_t *)cupsArrayFirst(nodes);
+       node;
+       node = (_mime_node_t *)cupsArrayNext(nodes))
+    free(node);
+
+  cupsArrayDelete(nodes);
+  free(queue.entries);
+
+  return (filters);
+}
+
+
 /*
  * End of "$Id: filter.c 11093 2013-07-03 20:48:42Z msweet $".
  */
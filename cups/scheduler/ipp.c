@@ -40,6 +40,17 @@ extern int mbr_check_membership_by_id(uuid_t user, gid_t group, int* ismember);
 #endif /* __APPLE__ */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_jobload_s		/**** Background job load ****/
+{
+  int			id;		/* Job ID */
+  ipp_t			*attrs;		/* Attributes read by worker thread */
+} cupsd_jobload_t;
+
+
 /*
  * Local functions...
  */
@@ -59,6 +70,8 @@ static void	add_queued_job_count(cupsd_client_t *con, cupsd_printer_t *p);
 static void	apply_printer_defaults(cupsd_printer_t *printer,
 				       cupsd_job_t *job);
 static void	authenticate_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static ipp_t	*cache_printer_attrs(cupsd_printer_t *printer,
+		                     cups_array_t *ra, int version);
 static void	cancel_all_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_subscription(cupsd_client_t *con, int id);
@@ -74,7 +87,7 @@ static int	copy_file(const char *from, const char *to);
 static int	copy_model(cupsd_client_t *con, const char *from,
 		           const char *to);
 static void	copy_job_attrs(cupsd_client_t *con,
-		               cupsd_job_t *job,
+		               cupsd_job_t *job, ipp_t *attrs,
 			       cups_array_t *ra, cups_array_t *exclude);
 static void	copy_printer_attrs(cupsd_client_t *con,
 		                   cupsd_printer_t *printer,
@@ -103,10 +116,14 @@ static void	get_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static const char *get_username(cupsd_client_t *con);
 static void	hold_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	hold_new_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	load_job(cupsd_client_t *con, cupsd_job_t *job);
+static void	load_job_done(cupsd_client_t *con, cupsd_jobload_t *load);
+static void	load_job_work(cupsd_jobload_t *load);
 static void	move_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static int	ppd_parse_line(const char *line, char *option, int olen,
 		               char *choice, int clen);
 static void	print_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	queue_job_load(cupsd_client_t *con, cupsd_job_t *job);
 static void	read_job_ticket(cupsd_client_t *con);
 static void	reject_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	release_held_new_jobs(cupsd_client_t *con,
@@ -159,10 +176,11 @@ cupsdProcessIPPRequest(
                   con, con->number, con->request->request.op.operation_id);
 
  /*
-  * First build an empty response message for this request...
+  * First build an empty response message for this request; responses are
+  * short-lived, so allocate them from an arena...
   */
 
-  con->response = ippNew();
+  con->response = ippNewWithArena();
 
   con->response->request.status.version[0] =
       con->request->request.op.version[0];
@@ -624,6 +642,22 @@ cupsdProcessIPPRequest(
     }
   }
 
+  if (con->pending_loads > 0)
+  {
+   /*
+    * The worker threads are loading jobs for this request; process the
+    * request again once they are done (see load_job_done)...
+    */
+
+    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for %d job(s) to load.",
+                   con->pending_loads);
+
+    ippDelete(con->response);
+    con->response = NULL;
+
+    return (1);
+  }
+
   if (con->response)
   {
    /*
@@ -1575,8 +1609,7 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   else
   {
     attr->group_tag = IPP_TAG_JOB;
-    _cupsStrFree(attr->name);
-    attr->name = _cupsStrAlloc("job-originating-user-name");
+    ippSetName(job->attrs, &attr, "job-originating-user-name");
   }
 
   if (con->username[0] || auth_info)
@@ -1681,6 +1714,9 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   job->state = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_ENUM,
                              "job-state", IPP_JOB_STOPPED);
   job->state_value = (ipp_jstate_t)job->state->values[0].integer;
+
+  cupsdUpdateJobIndex(job);
+
   job->reasons = ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_KEYWORD,
                               "job-state-reasons", NULL, "job-incoming");
   job->sheets = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER,
@@ -1940,8 +1976,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2137,7 +2172,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2148,19 +2183,11 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
 
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
+  job->attrs->current = job->attrs->last;
 }
 
 
@@ -2731,6 +2758,10 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
              printer->name);
     unlink(cache_name);
 
+    snprintf(cache_name, sizeof(cache_name), "%s/%s.ppdb", CacheDir,
+             printer->name);
+    unlink(cache_name);
+
     cupsdSetPrinterReasons(printer, "none");
 
    /*
@@ -3087,6 +3118,104 @@ authenticate_job(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'cache_printer_attrs()' - Get the cached printer attributes for a
+ *                           requested-attributes list.
+ *
+ * The printer, PPD, and common attributes only change when the printer is
+ * modified, so the result of filtering them is kept for the last few
+ * requested-attributes lists used with each printer.  The cache is cleared
+ * by cupsdClearPrinterAttrCache().
+ */
+
+static ipp_t *				/* O - Filtered attributes or NULL */
+cache_printer_attrs(
+    cupsd_printer_t *printer,		/* I - Printer */
+    cups_array_t    *ra,		/* I - Requested attributes array */
+    int             version)		/* I - Major IPP version of response */
+{
+  cupsd_attrcache_t	*cache;		/* Current cache entry */
+  char			*key,		/* Cache key */
+			*keyptr;	/* Pointer into key */
+  const char		*name;		/* Current attribute name */
+  size_t		keysize;	/* Size of key */
+
+
+ /*
+  * Build the key from the IPP version, which controls whether collections
+  * are returned by default, and the sorted requested-attributes...
+  */
+
+  for (keysize = 16, name = (char *)cupsArrayFirst(ra);
+       name;
+       name = (char *)cupsArrayNext(ra))
+    keysize += strlen(name) + 1;
+
+  if ((key = malloc(keysize)) == NULL)
+    return (NULL);
+
+  snprintf(key, keysize, "%d:%s", version, ra ? "" : "all");
+
+  for (keyptr = key + strlen(key), name = (char *)cupsArrayFirst(ra);
+       name;
+       name = (char *)cupsArrayNext(ra))
+  {
+    strlcpy(keyptr, name, keysize - (size_t)(keyptr - key));
+    keyptr += strlen(keyptr);
+    *keyptr++ = ',';
+    *keyptr   = '\0';
+  }
+
+  for (cache = (cupsd_attrcache_t *)cupsArrayFirst(printer->attr_cache);
+       cache;
+       cache = (cupsd_attrcache_t *)cupsArrayNext(printer->attr_cache))
+    if (!strcmp(cache->key, key))
+    {
+      free(key);
+      return (cache->attrs);
+    }
+
+ /*
+  * Not cached, filter the attributes, replacing the oldest list as needed...
+  */
+
+  if (!printer->attr_cache)
+    printer->attr_cache = cupsArrayNew(NULL, NULL);
+
+  if (cupsArrayCount(printer->attr_cache) >= CUPSD_ATTR_CACHE_MAX)
+  {
+    cache = (cupsd_attrcache_t *)cupsArrayFirst(printer->attr_cache);
+    cupsArrayRemove(printer->attr_cache, cache);
+
+    free(cache->key);
+    ippDelete(cache->attrs);
+  }
+  else if ((cache = calloc(1, sizeof(cupsd_attrcache_t))) == NULL)
+  {
+    free(key);
+    return (NULL);
+  }
+
+  cache->key   = key;
+  cache->attrs = ippNew();
+
+  cache->attrs->request.status.version[0] = (ipp_uchar_t)version;
+
+  copy_attrs(cache->attrs, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+  if (printer->ppd_attrs)
+    copy_attrs(cache->attrs, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+  copy_attrs(cache->attrs, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+
+  cupsArrayAdd(printer->attr_cache, cache);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "cache_printer_attrs: Cached attributes for %s (%d lists).",
+		  printer->name, cupsArrayCount(printer->attr_cache));
+
+  return (cache->attrs);
+}
+
+
 /*
  * 'cancel_all_jobs()' - Cancel all or selected print jobs.
  */
@@ -4688,6 +4817,7 @@ copy_model(cupsd_client_t *con,		/* I - Client connection */
 static void
 copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
 	       cupsd_job_t    *job,	/* I - Job */
+	       ipp_t          *attrs,	/* I - Job attributes or NULL */
 	       cups_array_t   *ra,	/* I - Requested attributes array */
 	       cups_array_t   *exclude)	/* I - Private attributes array */
 {
@@ -4752,9 +4882,9 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
         	 "job-uri", NULL, job_uri);
   }
 
-  if (job->attrs)
+  if (attrs)
   {
-    copy_attrs(con->response, job->attrs, ra, IPP_TAG_JOB, 0, exclude);
+    copy_attrs(con->response, attrs, ra, IPP_TAG_JOB, 0, exclude);
   }
   else
   {
@@ -4820,6 +4950,7 @@ copy_printer_attrs(
 					/* Printer icons */
   time_t		curtime;	/* Current time */
   int			i;		/* Looping var */
+  ipp_t			*cache;		/* Cached printer attributes */
 
 
  /*
@@ -4852,8 +4983,8 @@ copy_printer_attrs(
 
         if ((p2_uri = ippFindAttribute(p2->attrs, "printer-uri-supported",
 	                               IPP_TAG_URI)) != NULL)
-          member_uris->values[i].string.text =
-	      _cupsStrRetain(p2_uri->values[0].string.text);
+          ippSetString(con->response, &member_uris, i,
+	               p2_uri->values[0].string.text);
         else
 	{
 	  httpAssembleURIf(HTTP_URI_CODING_ALL, printer_uri,
@@ -4861,7 +4992,7 @@ copy_printer_attrs(
 			   con->clientport,
 			   (p2->type & CUPS_PRINTER_CLASS) ?
 			       "/classes/%s" : "/printers/%s", p2->name);
-	  member_uris->values[i].string.text = _cupsStrAlloc(printer_uri);
+	  ippSetString(con->response, &member_uris, i, printer_uri);
         }
       }
     }
@@ -5002,10 +5133,23 @@ copy_printer_attrs(
   if (!ra || cupsArrayFind(ra, "queued-job-count"))
     add_queued_job_count(con, printer);
 
-  copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  if (printer->ppd_attrs)
-    copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  if ((cache = cache_printer_attrs(printer, ra,
+                                   con->response->request.status.version[0])) != NULL)
+  {
+   /*
+    * Copy the printer, PPD, and common attributes that were already filtered
+    * for this requested-attributes list...
+    */
+
+    ippCopyAttributes(con->response, cache, 0, NULL, NULL);
+  }
+  else
+  {
+    copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    if (printer->ppd_attrs)
+      copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  }
 }
 
 
@@ -5699,6 +5843,9 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
   snprintf(filename, sizeof(filename), "%s/%s.data", CacheDir, printer->name);
   unlink(filename);
 
+  snprintf(filename, sizeof(filename), "%s/%s.ppdb", CacheDir, printer->name);
+  unlink(filename);
+
  /*
   * Unregister color profiles...
   */
@@ -6033,6 +6180,7 @@ get_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
   int		port;			/* Port portion of URI */
   cups_array_t	*ra,			/* Requested attributes array */
 		*exclude;		/* Private attributes array */
+  ipp_t		*view;			/* Attributes of unloaded job */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_job_attrs(%p[%d], %s)", con,
@@ -6120,10 +6268,39 @@ get_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
   * Copy attributes...
   */
 
-  cupsdLoadJob(job);
-
   ra = create_requested_array(con->request);
-  copy_job_attrs(con, job, ra, exclude);
+
+  if (!job->attrs && job->state_value > IPP_JOB_STOPPED)
+  {
+   /*
+    * Use the requested attributes from the control file of a completed job
+    * rather than loading the job.  If the control file cannot be mapped,
+    * load the job from a worker thread, or right away when there are no
+    * worker threads...
+    */
+
+    if ((view = cupsdReadJobView(job->id, ra)) == NULL)
+    {
+      if (queue_job_load(con, job))
+      {
+	cupsArrayDelete(ra);
+	return;
+      }
+
+      cupsdLoadJob(job);
+    }
+
+    copy_job_attrs(con, job, view ? view : job->attrs, ra, exclude);
+    ippDelete(view);
+  }
+  else if (!load_job(con, job) && con->pending_loads)
+  {
+    cupsArrayDelete(ra);
+    return;
+  }
+  else
+    copy_job_attrs(con, job, job->attrs, ra, exclude);
+
   cupsArrayDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
@@ -6164,6 +6341,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   int		delete_list = 0;	/* Delete the list afterwards? */
   cups_array_t	*ra,			/* Requested attributes array */
 		*exclude;		/* Private attributes array */
+  ipp_t		*view;			/* Attributes of unloaded job */
   cupsd_policy_t *policy;		/* Current policy */
 
 
@@ -6414,6 +6592,15 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     cupsdLogClient(con, CUPSD_LOG_INFO, "Limiting Get-Jobs response to %d jobs.", limit);
   }
 
+  if (username[0] && list == Jobs)
+  {
+   /*
+    * Only look at the requesting user's jobs...
+    */
+
+    list = cupsdGetUserJobs(username);
+  }
+
  /*
   * OK, build a list of jobs for this printer...
   */
@@ -6437,13 +6624,25 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 
     for (i = 0; i < job_ids->num_values; i ++)
     {
-      job = cupsdFindJob(job_ids->values[i].integer);
+      job  = cupsdFindJob(job_ids->values[i].integer);
+      view = NULL;
 
       if (need_load_job && !job->attrs)
       {
-        cupsdLoadJob(job);
+        if (job->state_value > IPP_JOB_STOPPED)
+	{
+	  if ((view = cupsdReadJobView(job->id, ra)) == NULL)
+	  {
+	    if (queue_job_load(con, job))
+	      continue;
 
-	if (!job->attrs)
+	    cupsdLoadJob(job);
+	  }
+	}
+	else if (!load_job(con, job) && con->pending_loads)
+	  continue;
+
+	if (!view && !job->attrs)
 	{
 	  cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: No attributes for job %d", job->id);
 	  continue;
@@ -6458,7 +6657,8 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 					 policy, con, job->printer,
 					 job->username);
 
-      copy_job_attrs(con, job, ra, exclude);
+      copy_job_attrs(con, job, view ? view : job->attrs, ra, exclude);
+      ippDelete(view);
     }
   }
   else
@@ -6477,7 +6677,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 		      job->username, job->state_value, job->attrs);
 
       if (!job->dest || !job->username)
-	cupsdLoadJob(job);
+	load_job(con, job);
 
       if (!job->dest || !job->username)
 	continue;
@@ -6497,24 +6697,51 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
       if (job->id < first_job_id)
 	continue;
 
+      if (username[0] && _cups_strcasecmp(username, job->username))
+	continue;
+
       current_index ++;
       if (current_index < first_index)
         continue;
 
+      view = NULL;
+
       if (need_load_job && !job->attrs)
       {
-        cupsdLoadJob(job);
+       /*
+        * Completed jobs are answered from their control file, or by loading
+	* the job when it cannot be mapped - in the background when there are
+	* worker threads.  Jobs that are loading in the background count
+	* against the limit so we don't read more of the job history than we
+	* need...
+	*/
 
-	if (!job->attrs)
+        if (job->state_value > IPP_JOB_STOPPED)
+	{
+	  if ((view = cupsdReadJobView(job->id, ra)) == NULL)
+	  {
+	    if (queue_job_load(con, job))
+	    {
+	      count ++;
+	      continue;
+	    }
+
+	    cupsdLoadJob(job);
+	  }
+	}
+	else if (!load_job(con, job) && con->pending_loads)
+	{
+	  count ++;
+	  continue;
+	}
+
+	if (!view && !job->attrs)
 	{
 	  cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: No attributes for job %d", job->id);
 	  continue;
 	}
       }
 
-      if (username[0] && _cups_strcasecmp(username, job->username))
-	continue;
-
       if (count > 0)
 	ippAddSeparator(con->response);
 
@@ -6525,7 +6752,8 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 					 policy, con, job->printer,
 					 job->username);
 
-      copy_job_attrs(con, job, ra, exclude);
+      copy_job_attrs(con, job, view ? view : job->attrs, ra, exclude);
+      ippDelete(view);
     }
 
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: count=%d", count);
@@ -6547,7 +6775,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 static void
 get_notifications(cupsd_client_t *con)	/* I - Client connection */
 {
-  int			i, j;		/* Looping vars */
+  int			i;		/* Looping var */
   http_status_t		status;		/* Policy status */
   cupsd_subscription_t	*sub;		/* Subscription */
   ipp_attribute_t	*ids,		/* notify-subscription-ids */
@@ -6650,29 +6878,10 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
       min_seq = 1;
 
    /*
-    * If we don't have any new events, nothing to do here...
-    */
-
-    if (min_seq > (sub->first_event_id + cupsArrayCount(sub->events)))
-      continue;
-
-   /*
-    * Otherwise copy all of the new events...
+    * Copy all of the new events...
     */
 
-    if (sub->first_event_id > min_seq)
-      j = 0;
-    else
-      j = min_seq - sub->first_event_id;
-
-    for (; j < cupsArrayCount(sub->events); j ++)
-    {
-      ippAddSeparator(con->response);
-
-      copy_attrs(con->response,
-                 ((cupsd_event_t *)cupsArrayIndex(sub->events, j))->attrs, NULL,
-        	 IPP_TAG_EVENT_NOTIFICATION, 0, NULL);
-    }
+    cupsdCopyEvents(con->response, sub, min_seq);
   }
 }
 
@@ -7697,6 +7906,89 @@ hold_new_jobs(cupsd_client_t  *con,	/* I - Connection */
 }
 
 
+/*
+ * 'load_job()' - Load the attributes of a job for a request.
+ *
+ * When worker threads are enabled, the job control file is read in the
+ * background and 0 is returned with con->pending_loads incremented.  The
+ * request is then processed again by load_job_done() once all of the jobs
+ * have been loaded.
+ */
+
+static int				/* O - 1 if loaded, 0 otherwise */
+load_job(cupsd_client_t *con,		/* I - Client connection */
+         cupsd_job_t    *job)		/* I - Job */
+{
+  if (!job->attrs && queue_job_load(con, job))
+    return (0);
+
+  return (cupsdLoadJob(job));
+}
+
+
+/*
+ * 'load_job_done()' - Finish loading a job and resume the request.
+ */
+
+static void
+load_job_done(cupsd_client_t  *con,	/* I - Client connection or NULL */
+              cupsd_jobload_t *load)	/* I - Background job load */
+{
+  cupsd_job_t	*job;			/* Job */
+
+
+ /*
+  * Install the attributes that were read; if the worker thread could not
+  * read the control file, load it again here so that the usual error
+  * handling and logging are done...
+  */
+
+  if ((job = cupsdFindJob(load->id)) != NULL && !job->attrs)
+  {
+    if (load->attrs)
+      cupsdLoadJobAttrs(job, load->attrs);
+    else
+      cupsdLoadJob(job);
+  }
+  else
+    ippDelete(load->attrs);
+
+  free(load);
+
+  if (!con || -- con->pending_loads > 0)
+    return;
+
+ /*
+  * Process the request again; any jobs that are still not loaded (or were
+  * unloaded in the meantime) are loaded synchronously this time...
+  */
+
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Resuming %s request.",
+                 ippOpString(con->request->request.op.operation_id));
+
+  con->sync_loads = 1;
+
+  if (!cupsdProcessIPPRequest(con))
+  {
+    cupsdCloseClient(con);
+    return;
+  }
+
+  con->sync_loads = 0;
+}
+
+
+/*
+ * 'load_job_work()' - Read a job control file from a worker thread.
+ */
+
+static void
+load_job_work(cupsd_jobload_t *load)	/* I - Background job load */
+{
+  load->attrs = cupsdReadJobAttrs(load->id);
+}
+
+
 /*
  * 'move_job()' - Move a job to a new destination.
  */
@@ -8286,6 +8578,41 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
 }
 
 
+/*
+ * 'queue_job_load()' - Queue a job load on the worker threads.
+ *
+ * Returns 0 if there are no worker threads or the request is being processed
+ * again after its jobs were loaded; the job is not loaded in that case.
+ */
+
+static int				/* O - 1 if queued, 0 otherwise */
+queue_job_load(cupsd_client_t *con,	/* I - Client connection */
+               cupsd_job_t    *job)	/* I - Job */
+{
+  cupsd_jobload_t	*load;		/* Background job load */
+
+
+  if (WorkerThreads <= 0 || con->sync_loads)
+    return (0);
+
+  if ((load = calloc(1, sizeof(cupsd_jobload_t))) == NULL)
+    return (0);
+
+  load->id = job->id;
+
+  if (!cupsdQueueWork(con, (cupsd_workfunc_t)load_job_work,
+                      (cupsd_donefunc_t)load_job_done, load))
+  {
+    free(load);
+    return (0);
+  }
+
+  con->pending_loads ++;
+
+  return (1);
+}
+
+
 /*
  * 'read_job_ticket()' - Read a job ticket embedded in a print file.
  *
@@ -8328,8 +8655,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8432,25 +8758,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -10061,15 +10369,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10108,15 +10408,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
@@ -21,6 +21,7 @@
 #include <grp.h>
 #include <cups/backend.h>
 #include <cups/dir.h>
+#include <sys/mman.h>
 #ifdef __APPLE__
 #  include <IOKit/pwr_mgt/IOPMLib.h>
 #  ifdef HAVE_IOKIT_PWR_MGT_IOPMLIBPRIVATE_H
@@ -101,10 +102,112 @@
  */
 
 
+/*
+ * Design Notes for the Job Journal
+ * --------------------------------
+ *
+ * When JobCacheFormat is "binary" (the default), the summary information
+ * that used to be written to the text job.cache file is kept in an
+ * append-only binary journal (job.journal in CacheDir).  The file starts
+ * with a 16-byte header (magic string, byte order mark, and version)
+ * followed by records, each of which starts with a 16-byte header:
+ *
+ *     uint32 length    Length of record including header
+ *     uint32 checksum  FNV-1a checksum of the rest of the record
+ *     uint32 type      CUPSD_JOURNAL_JOB, _DELETE, or _NEXTID
+ *     int32  id        Job ID or NextJobId value
+ *
+ * Job records contain the job's state, priority, destination type,
+ * k-octets, file count, times, username, name, destination, and file
+ * types.  Values are stored in host byte order; journals from other
+ * systems are rejected using the byte order mark and the job data is
+ * reloaded from the RequestRoot directory.
+ *
+ * cupsdSaveAllJobs() only looks at jobs that are new or have been saved or
+ * marked dirty since the last write, appends records for those whose
+ * checksum differs from the last one written plus delete records for
+ * purged jobs, and then syncs just those writes when SyncOnClose is
+ * enabled.  Once the
+ * journal holds more than twice as many records as there are jobs it is
+ * compacted by writing a new file with one record per job.
+ *
+ * At startup the journal is mapped into memory and replayed; the last
+ * record for a job wins.  If the header is bad, a record is damaged (e.g.
+ * a partial write), or there are no records, the replayed jobs are thrown
+ * away and reloaded from the RequestRoot directory, which also forces a
+ * compaction.  Setting JobCacheFormat to "text" writes the traditional
+ * job.cache file instead, and the newest of the two files is used when
+ * loading.
+ */
+
+
+/*
+ * Local constants...
+ */
+
+#define CUPSD_JOURNAL_MAGIC	"CUPSJRN1"
+					/* Magic string for job.journal */
+#define CUPSD_JOURNAL_BOM	0x01020304
+					/* Byte order mark */
+#define CUPSD_JOURNAL_VERSION	1	/* File format version */
+#define CUPSD_JOURNAL_HEADER	16	/* Size of file/record header */
+#define CUPSD_JOURNAL_JOB	1	/* Job record */
+#define CUPSD_JOURNAL_DELETE	2	/* Deleted job record */
+#define CUPSD_JOURNAL_NEXTID	3	/* NextJobId record */
+
+#define CUPSD_JOBINDEX_ACTIVE	1	/* Job counts as active */
+#define CUPSD_JOBINDEX_COMPLETED 2	/* Job is in the completed lists */
+
+#define CUPSD_JOBLOAD_BATCH	256	/* Control files read at a time */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_jobmap_s		/**** Job control file in memory ****/
+{
+  ipp_uchar_t	*data;			/* File data */
+  size_t	length,			/* Length of file data */
+		pos;			/* Current read position */
+  int		mapped;			/* Mapped with mmap()? */
+} cupsd_jobmap_t;
+
+typedef struct cupsd_jobload_s		/**** Job control file to load ****/
+{
+  int		id;			/* Job ID */
+  ipp_t		*attrs;			/* Attributes read from control file */
+} cupsd_jobload_t;
+
+
 /*
  * Local globals...
  */
 
+static unsigned char	*journal_buffer = NULL;
+					/* Journal record buffer */
+static size_t		journal_bufsize = 0;
+					/* Size of journal record buffer */
+static int		journal_loaded = 0,
+					/* Was the journal loaded/written? */
+			journal_compact = 0,
+					/* Compact on next save? */
+			journal_records = 0,
+					/* Number of records in journal */
+			journal_next_id = 0,
+					/* Last NextJobId in journal */
+			num_journal_deletes = 0,
+					/* Number of purged jobs */
+			alloc_journal_deletes = 0,
+					/* Allocated purged job IDs */
+			*journal_deletes = NULL;
+					/* Purged job IDs */
+static cups_array_t	*completed_jobs = NULL,
+					/* Completed jobs, sorted by ID */
+			*dest_index = NULL,
+					/* Jobs by destination */
+			*user_index = NULL;
+					/* Jobs by user */
 static mime_filter_t	gziptoany_filter =
 			{
 			  NULL,		/* Source type */
@@ -121,22 +224,39 @@ static mime_filter_t	gziptoany_filter =
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
 static int	compare_jobs(void *first, void *second, void *data);
+static int	compare_jobloads(cupsd_jobload_t *first,
+		                 cupsd_jobload_t *second);
+static int	compare_jobindex(cupsd_jobindex_t *first,
+		                 cupsd_jobindex_t *second);
 static void	dump_job_history(cupsd_job_t *job);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
 static void	free_job_history(cupsd_job_t *job);
+static void	index_job(cupsd_job_t *job, cupsd_jobindex_t **entry,
+		          cups_array_t **index, const char *name, int flags);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
 static size_t	ipp_length(ipp_t *ipp);
+static unsigned	journal_checksum(const unsigned char *data, size_t length);
+static unsigned char *journal_record(cupsd_job_t *job, int type, int id,
+		                     size_t *length);
 static void	load_job_cache(const char *filename);
+static int	load_job_journal(const char *filename, int ids_only);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static int	map_job_file(int id, cupsd_jobmap_t *map);
+static void	read_job_load(cupsd_jobload_t *load);
+static ssize_t	read_job_map(cupsd_jobmap_t *map, ipp_uchar_t *buffer,
+		             size_t bytes);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
+static void	save_job_journal(int compact);
 static void	set_time(cupsd_job_t *job, const char *name);
 static void	start_job(cupsd_job_t *job, cupsd_printer_t *printer);
 static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
+static void	unindex_job(cupsd_job_t *job);
 static void	unload_job(cupsd_job_t *job);
+static void	unmap_job_file(cupsd_jobmap_t *map);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
 
@@ -175,6 +295,8 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   cupsArrayAdd(Jobs, job);
   cupsArrayAdd(ActiveJobs, job);
 
+  cupsdUpdateJobIndex(job);
+
   return (job);
 }
 
@@ -1177,10 +1299,28 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
       filterfds[slot][1] = job->print_pipes[1];
     }
 
-    pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
-                            filterfds[slot][1], job->status_pipes[1],
-		            job->back_pipes[0], job->side_pipes[0], 0,
-			    job->profile, job, job->filters + i);
+    if ((ptr = strrchr(filter->filter, '/')) != NULL)
+      ptr ++;
+    else
+      ptr = filter->filter;
+
+    if (job->printer->pc && job->printer->pc->persistent_filter &&
+        !strcmp(ptr, job->printer->pc->persistent_filter))
+      pid = cupsdStartPersistentProcess(command, argv, envp,
+                                        filterfds[!slot][0],
+                                        filterfds[slot][1],
+                                        job->status_pipes[1],
+                                        job->back_pipes[0],
+                                        job->side_pipes[0], job->profile,
+                                        job, job->filters + i);
+    else
+      pid = 0;
+
+    if (!pid)
+      pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
+                              filterfds[slot][1], job->status_pipes[1],
+                              job->back_pipes[0], job->side_pipes[0], 0,
+                              job->profile, job, job->filters + i);
 
     cupsdClosePipe(filterfds[!slot]);
 
@@ -1377,8 +1517,35 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
     finalize_job(job, 1);
 
   if (action == CUPSD_JOB_PURGE)
+  {
     remove_job_history(job);
 
+    if (job->journal_crc)
+    {
+     /*
+      * Record the purge in the job journal...
+      */
+
+      if (num_journal_deletes >= alloc_journal_deletes)
+      {
+        int	*temp;			/* New array */
+
+        if ((temp = realloc(journal_deletes, (size_t)(alloc_journal_deletes + 64) * sizeof(int))) != NULL)
+	{
+	  journal_deletes       = temp;
+	  alloc_journal_deletes += 64;
+	}
+      }
+
+      if (num_journal_deletes < alloc_journal_deletes)
+        journal_deletes[num_journal_deletes ++] = job->id;
+      else
+        journal_compact = 1;
+    }
+  }
+
+  unindex_job(job);
+
   cupsdClearString(&job->username);
   cupsdClearString(&job->dest);
   for (i = 0;
@@ -1461,17 +1628,28 @@ cups_array_t *				/* O - Array of jobs */
 cupsdGetCompletedJobs(
     cupsd_printer_t *p)			/* I - Printer */
 {
-  cups_array_t	*list;			/* Array of jobs */
+  cups_array_t	*list,			/* Array of jobs */
+		*completed;		/* Completed jobs to copy */
   cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t *entry,		/* Destination index entry */
+		key;			/* Search key */
 
 
   list = cupsArrayNew(compare_completed_jobs, NULL);
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+  if (p)
+  {
+    key.name  = p->name;
+    entry     = (cupsd_jobindex_t *)cupsArrayFind(dest_index, &key);
+    completed = entry ? entry->completed : NULL;
+  }
+  else
+    completed = completed_jobs;
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(completed);
        job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-    if ((!p || !_cups_strcasecmp(p->name, job->dest)) && job->state_value >= IPP_JOB_STOPPED && job->completed_time)
-      cupsArrayAdd(list, job);
+       job = (cupsd_job_t *)cupsArrayNext(completed))
+    cupsArrayAdd(list, job);
 
   return (list);
 }
@@ -1486,17 +1664,16 @@ int					/* O - Job count */
 cupsdGetPrinterJobCount(
     const char *dest)			/* I - Printer or class name */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t	*entry,		/* Destination index entry */
+			key;		/* Search key */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (job->dest && !_cups_strcasecmp(job->dest, dest))
-      count ++;
+  key.name = (char *)dest;
 
-  return (count);
+  if ((entry = (cupsd_jobindex_t *)cupsArrayFind(dest_index, &key)) != NULL)
+    return (entry->num_active);
+  else
+    return (0);
 }
 
 
@@ -1509,17 +1686,38 @@ int					/* O - Job count */
 cupsdGetUserJobCount(
     const char *username)		/* I - Username */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t	*entry,		/* User index entry */
+			key;		/* Search key */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (!_cups_strcasecmp(job->username, username))
-      count ++;
+  key.name = (char *)username;
+
+  if ((entry = (cupsd_jobindex_t *)cupsArrayFind(user_index, &key)) != NULL)
+    return (entry->num_active);
+  else
+    return (0);
+}
+
+
+/*
+ * 'cupsdGetUserJobs()' - Get the jobs for a user.
+ *
+ * The returned array is sorted by job ID and must not be freed or modified.
+ */
+
+cups_array_t *				/* O - Array of jobs or NULL */
+cupsdGetUserJobs(const char *username)	/* I - Username */
+{
+  cupsd_jobindex_t	*entry,		/* User index entry */
+			key;		/* Search key */
 
-  return (count);
+
+  key.name = (char *)username;
+
+  if ((entry = (cupsd_jobindex_t *)cupsArrayFind(user_index, &key)) != NULL)
+    return (entry->jobs);
+  else
+    return (NULL);
 }
 
 
@@ -1530,8 +1728,10 @@ cupsdGetUserJobCount(
 void
 cupsdLoadAllJobs(void)
 {
-  char		filename[1024];		/* Full filename of job.cache file */
+  char		filename[1024],		/* Full filename of job.cache file */
+		journal[1024];		/* Full filename of job.journal file */
   struct stat	fileinfo,		/* Information on job.cache file */
+		jnlinfo,		/* Information on job.journal file */
 		dirinfo;		/* Information on RequestRoot dir */
 
 
@@ -1541,7 +1741,8 @@ cupsdLoadAllJobs(void)
   */
 
   if (!Jobs)
-    Jobs = cupsArrayNew(compare_jobs, NULL);
+    Jobs = _cupsArrayNew4(compare_jobs, NULL, NULL, 0, NULL, NULL,
+                          _CUPS_ARRAY_FLAG_TREE);
 
   if (!ActiveJobs)
     ActiveJobs = cupsArrayNew(compare_active_jobs, NULL);
@@ -1554,6 +1755,7 @@ cupsdLoadAllJobs(void)
   */
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
 
   if (stat(filename, &fileinfo))
   {
@@ -1565,6 +1767,16 @@ cupsdLoadAllJobs(void)
 		      filename, strerror(errno));
   }
 
+  if (stat(journal, &jnlinfo))
+  {
+    jnlinfo.st_mtime = 0;
+
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to get file information for \"%s\" - %s",
+		      journal, strerror(errno));
+  }
+
   if (stat(RequestRoot, &dirinfo))
   {
     dirinfo.st_mtime = 0;
@@ -1579,7 +1791,19 @@ cupsdLoadAllJobs(void)
   * Load the most recent source for job data...
   */
 
-  if (dirinfo.st_mtime > fileinfo.st_mtime)
+  journal_loaded = 0;
+
+  if (jnlinfo.st_mtime && jnlinfo.st_mtime >= fileinfo.st_mtime)
+  {
+    if (dirinfo.st_mtime > jnlinfo.st_mtime ||
+        !load_job_journal(journal, 0))
+    {
+      load_request_root();
+
+      load_job_journal(journal, 1);
+    }
+  }
+  else if (dirinfo.st_mtime > fileinfo.st_mtime)
   {
     load_request_root();
 
@@ -1603,6 +1827,21 @@ cupsdLoadAllJobs(void)
 
 int					/* O - 1 on success, 0 on failure */
 cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
+{
+  return (cupsdLoadJobAttrs(job, NULL));
+}
+
+
+/*
+ * 'cupsdLoadJobAttrs()' - Load a single job using previously read attributes.
+ *
+ * The "attrs" argument is the result of cupsdReadJobAttrs() or NULL to read
+ * the job control file now.  The attributes are always consumed.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsdLoadJobAttrs(cupsd_job_t *job,	/* I - Job */
+                  ipp_t       *attrs)	/* I - Job attributes or NULL */
 {
   int			i;		/* Looping var */
   char			jobfile[1024];	/* Job filename */
@@ -1617,38 +1856,55 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
 
   if (job->attrs)
   {
+    ippDelete(attrs);
+
     if (job->state_value > IPP_JOB_STOPPED)
       job->access_time = time(NULL);
 
     return (1);
   }
 
-  if ((job->attrs = ippNew()) == NULL)
+  if (attrs)
   {
-    cupsdLogJob(job, CUPSD_LOG_ERROR, "Ran out of memory for job attributes.");
-    return (0);
+   /*
+    * Use the attributes that were read by a worker thread...
+    */
+
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading pre-read attributes...");
+
+    job->attrs = attrs;
   }
+  else
+  {
+    if ((job->attrs = ippNew()) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+                  "Ran out of memory for job attributes.");
+      return (0);
+    }
 
- /*
-  * Load job attributes...
-  */
+   /*
+    * Load job attributes...
+    */
 
-  cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading attributes...");
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading attributes...");
 
-  snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, job->id);
-  if ((fp = cupsdOpenConfFile(jobfile)) == NULL)
-    goto error;
+    snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, job->id);
+    if ((fp = cupsdOpenConfFile(jobfile)) == NULL)
+      goto error;
+
+    if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL,
+                  job->attrs) != IPP_DATA)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "Unable to read job control file \"%s\".", jobfile);
+      cupsFileClose(fp);
+      goto error;
+    }
 
-  if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, job->attrs) != IPP_DATA)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR,
-		"Unable to read job control file \"%s\".", jobfile);
     cupsFileClose(fp);
-    goto error;
   }
 
-  cupsFileClose(fp);
-
  /*
   * Copy attribute data to the job object...
   */
@@ -1999,6 +2255,8 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
     }
   }
 
+  cupsdUpdateJobIndex(job);
+
   job->access_time = time(NULL);
   return (1);
 
@@ -2064,6 +2322,8 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
   cupsdSetString(&job->dest, p->name);
   job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
 
+  cupsdUpdateJobIndex(job);
+
   if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
                                IPP_TAG_URI)) != NULL)
     cupsdSetString(&(attr->values[0].string.text), p->uri);
@@ -2077,6 +2337,227 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
 }
 
 
+/*
+ * 'cupsdReadJobAttrs()' - Read the control file for a job.
+ *
+ * This function only reads the job control file and does not access any
+ * other scheduler state or log messages, so it may be called from a worker
+ * thread.  Errors are reported when the attributes are loaded using
+ * cupsdLoadJobAttrs().
+ */
+
+ipp_t *					/* O - Job attributes or NULL on error */
+cupsdReadJobAttrs(int id)		/* I - Job ID */
+{
+  char		jobfile[1024];		/* Job filename */
+  cups_file_t	*fp;			/* Job file */
+  cupsd_jobmap_t map;			/* Mapped job file */
+  ipp_t		*attrs;			/* Job attributes */
+
+
+ /*
+  * Decode the control file directly from memory when possible...
+  */
+
+  if (map_job_file(id, &map))
+  {
+    if ((attrs = ippNew()) != NULL &&
+        ippReadIO(&map, (ipp_iocb_t)read_job_map, 1, NULL, attrs) != IPP_DATA)
+    {
+      ippDelete(attrs);
+      attrs = NULL;
+    }
+
+    unmap_job_file(&map);
+
+    return (attrs);
+  }
+
+ /*
+  * Otherwise fall back to cupsFile, which also handles compressed files...
+  */
+
+  snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, id);
+  if ((fp = cupsFileOpen(jobfile, "r")) == NULL && errno == ENOENT)
+  {
+   /*
+    * Try opening the backup file, like cupsdOpenConfFile()...
+    */
+
+    strlcat(jobfile, ".O", sizeof(jobfile));
+    fp = cupsFileOpen(jobfile, "r");
+  }
+
+  if (!fp)
+    return (NULL);
+
+  if ((attrs = ippNew()) != NULL &&
+      ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, attrs) != IPP_DATA)
+  {
+    ippDelete(attrs);
+    attrs = NULL;
+  }
+
+  cupsFileClose(fp);
+
+  return (attrs);
+}
+
+
+/*
+ * 'cupsdReadJobView()' - Read the requested attributes from a job control file.
+ *
+ * The control file is mapped into memory and scanned without decoding, and
+ * only the attributes listed in "ra" are decoded into the returned message.
+ * This is used to answer requests for completed jobs without loading (and
+ * later unloading) all of the job's attributes.  NULL is returned for
+ * compressed control files, which cannot be scanned this way.  The caller
+ * must free the returned attributes with ippDelete().
+ */
+
+ipp_t *					/* O - Job attributes or NULL on error */
+cupsdReadJobView(int          id,	/* I - Job ID */
+                 cups_array_t *ra)	/* I - Requested attributes or NULL for all */
+{
+  cupsd_jobmap_t map,			/* Mapped job file */
+		view;			/* Requested attribute data */
+  ipp_uchar_t	*ptr,			/* Pointer into job file */
+		*end,			/* End of job file */
+		*next,			/* Next attribute or value */
+		*start = NULL,		/* Start of current attribute */
+		*bufptr;		/* Pointer into view data */
+  int		tag,			/* Current tag */
+		namelen,		/* Length of name */
+		valuelen,		/* Length of value */
+		want = 0;		/* Copy the current attribute? */
+  ipp_tag_t	group = IPP_TAG_ZERO,	/* Current group */
+		start_group = IPP_TAG_ZERO,
+					/* Group for current attribute */
+		view_group = IPP_TAG_ZERO;
+					/* Last group in view data */
+  char		name[IPP_MAX_NAME];	/* Attribute name */
+  ipp_t		*attrs = NULL;		/* Job attributes */
+
+
+  if (!map_job_file(id, &map))
+    return (NULL);
+
+ /*
+  * The selected attributes (plus one group tag per group) never need more
+  * room than the original file...
+  */
+
+  memset(&view, 0, sizeof(view));
+
+  if ((view.data = malloc(map.length + 1)) == NULL)
+  {
+    unmap_job_file(&map);
+    return (NULL);
+  }
+
+  memcpy(view.data, map.data, 8);
+  bufptr = view.data + 8;
+  ptr    = map.data + 8;
+  end    = map.data + map.length;
+
+  for (;;)
+  {
+   /*
+    * Find the next group tag, named attribute, or additional value...
+    */
+
+    tag      = ptr < end ? *ptr : IPP_TAG_END;
+    next     = ptr + 1;
+    namelen  = 0;
+    valuelen = 0;
+
+    if (tag >= IPP_TAG_UNSUPPORTED_VALUE)
+    {
+      if (tag == IPP_TAG_EXTENSION)
+        next += 4;
+
+      if ((end - next) < 2)
+        goto done;
+
+      namelen = (next[0] << 8) | next[1];
+      next    += 2 + namelen;
+
+      if ((end - next) < 2)
+        goto done;
+
+      valuelen = (next[0] << 8) | next[1];
+      next     += 2 + valuelen;
+
+      if (next > end)
+        goto done;
+    }
+
+   /*
+    * Copy the current attribute once all of its values have been seen...
+    */
+
+    if (start && (tag < IPP_TAG_UNSUPPORTED_VALUE || namelen > 0))
+    {
+      if (want)
+      {
+        if (start_group != view_group)
+	{
+	  *bufptr++  = (ipp_uchar_t)start_group;
+	  view_group = start_group;
+	}
+
+        memcpy(bufptr, start, (size_t)(ptr - start));
+	bufptr += ptr - start;
+      }
+
+      start = NULL;
+    }
+
+    if (tag == IPP_TAG_END)
+      break;
+    else if (tag < IPP_TAG_UNSUPPORTED_VALUE)
+    {
+      group = (ipp_tag_t)tag;
+    }
+    else if (namelen > 0)
+    {
+      start       = ptr;
+      start_group = group;
+
+      if (!ra)
+        want = 1;
+      else if ((want = namelen < (int)sizeof(name)) != 0)
+      {
+        memcpy(name, next - valuelen - 2 - namelen, (size_t)namelen);
+	name[namelen] = '\0';
+
+	want = cupsArrayFind(ra, name) != NULL;
+      }
+    }
+
+    ptr = next;
+  }
+
+  *bufptr++ = IPP_TAG_END;
+
+  view.length = (size_t)(bufptr - view.data);
+
+  if ((attrs = ippNew()) != NULL &&
+      ippReadIO(&view, (ipp_iocb_t)read_job_map, 1, NULL, attrs) != IPP_DATA)
+  {
+    ippDelete(attrs);
+    attrs = NULL;
+  }
+
+  done:
+
+  free(view.data);
+  unmap_job_file(&map);
+
+  return (attrs);
+}
+
+
 /*
  * 'cupsdReleaseJob()' - Release the specified job.
  */
@@ -2134,6 +2615,12 @@ cupsdSaveAllJobs(void)
   struct tm	*curdate;		/* Current date */
 
 
+  if (JobCacheFormat == CUPSD_JOBCACHE_BINARY)
+  {
+    save_job_journal(0);
+    return;
+  }
+
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
   if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
     return;
@@ -2225,7 +2712,8 @@ cupsdSaveJob(cupsd_job_t *job)		/* I - Job */
     strlcat(filename, ".O", sizeof(filename));
     unlink(filename);
 
-    job->dirty = 0;
+    job->dirty         = 0;
+    job->journal_dirty = 1;
   }
 }
 
@@ -2533,6 +3021,8 @@ cupsdSetJobState(
         break;
   }
 
+  cupsdUpdateJobIndex(job);
+
  /*
   * Log message as needed...
   */
@@ -2756,6 +3246,45 @@ cupsdUnloadCompletedJobs(void)
 }
 
 
+/*
+ * 'cupsdUpdateJobIndex()' - Update the destination, user, and completed job
+ *                           indexes for a job.
+ *
+ * This must be called whenever the destination, username, state, or
+ * completion time of a job changes.
+ */
+
+void
+cupsdUpdateJobIndex(cupsd_job_t *job)	/* I - Job */
+{
+  int	flags = 0;			/* New index flags */
+
+
+  if (job->state_value >= IPP_JOB_PENDING &&
+      job->state_value <= IPP_JOB_STOPPED)
+    flags |= CUPSD_JOBINDEX_ACTIVE;
+
+  if (job->state_value >= IPP_JOB_STOPPED && job->completed_time)
+    flags |= CUPSD_JOBINDEX_COMPLETED;
+
+  index_job(job, &job->dest_index, &dest_index, job->dest, flags);
+  index_job(job, &job->user_index, &user_index, job->username, flags);
+
+  if ((flags ^ job->index_flags) & CUPSD_JOBINDEX_COMPLETED)
+  {
+    if (!completed_jobs)
+      completed_jobs = cupsArrayNew(compare_jobs, NULL);
+
+    if (flags & CUPSD_JOBINDEX_COMPLETED)
+      cupsArrayAdd(completed_jobs, job);
+    else
+      cupsArrayRemove(completed_jobs, job);
+  }
+
+  job->index_flags = flags;
+}
+
+
 /*
  * 'cupsdUpdateJobs()' - Update the history/file files for all jobs.
  */
@@ -2857,11 +3386,37 @@ compare_completed_jobs(void *first,	/* I - First job */
 
 
 /*
- * 'compare_jobs()' - Compare the job IDs of two jobs.
+ * 'compare_jobindex()' - Compare two job index entries.
  */
 
-static int				/* O - Difference */
-compare_jobs(void *first,		/* I - First job */
+static int				/* O - Result of comparison */
+compare_jobindex(
+    cupsd_jobindex_t *first,		/* I - First entry */
+    cupsd_jobindex_t *second)		/* I - Second entry */
+{
+  return (_cups_strcasecmp(first->name, second->name));
+}
+
+
+/*
+ * 'compare_jobloads()' - Compare the job IDs of two control files to load.
+ */
+
+static int				/* O - Difference */
+compare_jobloads(cupsd_jobload_t *first,/* I - First job */
+                 cupsd_jobload_t *second)
+					/* I - Second job */
+{
+  return (first->id - second->id);
+}
+
+
+/*
+ * 'compare_jobs()' - Compare the job IDs of two jobs.
+ */
+
+static int				/* O - Difference */
+compare_jobs(void *first,		/* I - First job */
              void *second,		/* I - Second job */
 	     void *data)		/* I - App data (not used) */
 {
@@ -3891,6 +4446,103 @@ get_options(cupsd_job_t *job,		/* I - Job */
 }
 
 
+/*
+ * 'index_job()' - Update a destination or user index entry for a job.
+ */
+
+static void
+index_job(cupsd_job_t      *job,	/* I  - Job */
+          cupsd_jobindex_t **entry,	/* IO - Current index entry */
+	  cups_array_t     **index,	/* IO - Index array */
+	  const char       *name,	/* I  - New name or NULL */
+	  int              flags)	/* I  - New index flags */
+{
+  int			oldflags = job->index_flags;
+					/* Old index flags */
+  cupsd_jobindex_t	key;		/* Search key */
+
+
+  if (*entry && (!name || _cups_strcasecmp((*entry)->name, name)))
+  {
+   /*
+    * Remove the job from the old entry, freeing the entry when it is no
+    * longer used...
+    */
+
+    cupsArrayRemove((*entry)->jobs, job);
+    cupsArrayRemove((*entry)->completed, job);
+
+    if (oldflags & CUPSD_JOBINDEX_ACTIVE)
+      (*entry)->num_active --;
+
+    if (cupsArrayCount((*entry)->jobs) == 0)
+    {
+      cupsArrayRemove(*index, *entry);
+      cupsArrayDelete((*entry)->jobs);
+      cupsArrayDelete((*entry)->completed);
+      cupsdClearString(&(*entry)->name);
+      free(*entry);
+    }
+
+    *entry   = NULL;
+    oldflags = 0;
+  }
+
+  if (!name)
+    return;
+
+  if (!*entry)
+  {
+   /*
+    * Find or create the new entry...
+    */
+
+    if (!*index)
+      *index = cupsArrayNew((cups_array_func_t)compare_jobindex, NULL);
+
+    key.name = (char *)name;
+
+    if ((*entry = (cupsd_jobindex_t *)cupsArrayFind(*index, &key)) == NULL)
+    {
+      if ((*entry = calloc(1, sizeof(cupsd_jobindex_t))) == NULL)
+      {
+        cupsdLogJob(job, CUPSD_LOG_EMERG, "Unable to allocate job index.");
+        return;
+      }
+
+      cupsdSetString(&(*entry)->name, name);
+      (*entry)->jobs      = cupsArrayNew(compare_jobs, NULL);
+      (*entry)->completed = cupsArrayNew(compare_jobs, NULL);
+
+      cupsArrayAdd(*index, *entry);
+    }
+
+    cupsArrayAdd((*entry)->jobs, job);
+    oldflags = 0;
+  }
+
+ /*
+  * Update the active count and completed list...
+  */
+
+  if ((flags ^ oldflags) & CUPSD_JOBINDEX_ACTIVE)
+  {
+    if (flags & CUPSD_JOBINDEX_ACTIVE)
+      (*entry)->num_active ++;
+    else
+      (*entry)->num_active --;
+  }
+
+  if ((flags ^ oldflags) & CUPSD_JOBINDEX_COMPLETED)
+  {
+    if (flags & CUPSD_JOBINDEX_COMPLETED)
+      cupsArrayAdd((*entry)->completed, job);
+    else
+      cupsArrayRemove((*entry)->completed, job);
+  }
+}
+
+
 /*
  * 'ipp_length()' - Compute the size of the buffer needed to hold
  *		    the textual IPP attributes.
@@ -4012,6 +4664,150 @@ ipp_length(ipp_t *ipp)			/* I - IPP request */
 }
 
 
+/*
+ * 'journal_checksum()' - Compute the checksum for a journal record.
+ */
+
+static unsigned				/* O - Checksum, never 0 */
+journal_checksum(
+    const unsigned char *data,		/* I - Record data */
+    size_t              length)		/* I - Length of data */
+{
+  unsigned	hash = 2166136261U;	/* FNV-1a hash */
+
+
+  while (length > 0)
+  {
+    hash ^= *data++;
+    hash *= 16777619U;
+    length --;
+  }
+
+  return (hash ? hash : 1);
+}
+
+
+/*
+ * 'journal_record()' - Build a journal record.
+ *
+ * The returned record is stored in a static buffer that is reused by the
+ * next call.
+ */
+
+static unsigned char *			/* O - Record or NULL on error */
+journal_record(cupsd_job_t *job,	/* I - Job or NULL */
+               int         type,	/* I - Record type */
+	       int         id,		/* I - Job ID or NextJobId */
+	       size_t      *length)	/* O - Length of record */
+{
+  int		i;			/* Looping var */
+  size_t	need;			/* Needed buffer size */
+  unsigned char	*bufptr;		/* Pointer into buffer */
+  unsigned	crc;			/* Record checksum */
+  char		mimetype[MIME_MAX_SUPER + MIME_MAX_TYPE + 1];
+					/* MIME type for file */
+  const char	*strings[3];		/* Strings for job */
+  int		ints[5];		/* Integers for job */
+  long long	times[3];		/* Times for job */
+
+
+ /*
+  * Figure out how much space we need...
+  */
+
+  need = CUPSD_JOURNAL_HEADER;
+
+  if (type == CUPSD_JOURNAL_JOB)
+  {
+    strings[0] = job->username;
+    strings[1] = job->name;
+    strings[2] = job->dest;
+
+    need += sizeof(ints) + sizeof(times) + 3 * 2 + (size_t)job->num_files *
+            (sizeof(int) + 2 + sizeof(mimetype));
+
+    for (i = 0; i < 3; i ++)
+      if (strings[i])
+        need += strlen(strings[i]);
+  }
+
+  if (need > journal_bufsize)
+  {
+    unsigned char *temp;		/* New buffer */
+
+    if ((temp = realloc(journal_buffer, need + 1024)) == NULL)
+      return (NULL);
+
+    journal_buffer  = temp;
+    journal_bufsize = need + 1024;
+  }
+
+ /*
+  * Then fill in the record...
+  */
+
+#define journal_put(data,bytes) memcpy(bufptr, data, bytes), bufptr += bytes
+
+  bufptr = journal_buffer + 8;
+
+  journal_put(&type, 4);
+  journal_put(&id, 4);
+
+  if (type == CUPSD_JOURNAL_JOB)
+  {
+    ints[0]  = job->state_value;
+    ints[1]  = job->priority;
+    ints[2]  = (int)job->dtype;
+    ints[3]  = job->koctets;
+    ints[4]  = job->filetypes && job->compressions ? job->num_files : 0;
+    times[0] = job->creation_time;
+    times[1] = job->completed_time;
+    times[2] = job->hold_until;
+
+    journal_put(ints, sizeof(ints));
+    journal_put(times, sizeof(times));
+
+    for (i = 0; i < 3; i ++)
+    {
+      unsigned short len = (unsigned short)(strings[i] ? strlen(strings[i]) : 0);
+					/* Length of string */
+
+      journal_put(&len, 2);
+      if (len)
+        journal_put(strings[i], len);
+    }
+
+    for (i = 0; i < ints[4]; i ++)
+    {
+      unsigned short len;		/* Length of MIME type */
+
+      if (job->filetypes[i])
+        snprintf(mimetype, sizeof(mimetype), "%s/%s", job->filetypes[i]->super,
+	         job->filetypes[i]->type);
+      else
+        strlcpy(mimetype, "application/vnd.cups-raw", sizeof(mimetype));
+
+      len = (unsigned short)strlen(mimetype);
+
+      journal_put(job->compressions + i, sizeof(int));
+      journal_put(&len, 2);
+      journal_put(mimetype, len);
+    }
+  }
+
+#undef journal_put
+
+  *length = (size_t)(bufptr - journal_buffer);
+  crc     = journal_checksum(journal_buffer + 8, *length - 8);
+  i       = (int)*length;
+
+  memcpy(journal_buffer, &i, 4);
+  memcpy(journal_buffer + 4, &crc, 4);
+
+  return (journal_buffer);
+}
+
+
 /*
  * 'load_job_cache()' - Load jobs from the job.cache file.
  */
@@ -4120,6 +4916,7 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     else if (!_cups_strcasecmp(line, "</Job>"))
     {
       cupsArrayAdd(Jobs, job);
+      cupsdUpdateJobIndex(job);
 
       if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
 	cupsArrayAdd(ActiveJobs, job);
@@ -4286,6 +5083,395 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
 }
 
 
+/*
+ * 'load_job_journal()' - Load jobs from the job.journal file.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+load_job_journal(const char *filename,	/* I - job.journal filename */
+                 int        ids_only)	/* I - Only load NextJobId? */
+{
+  int		fd;			/* File descriptor */
+  struct stat	fileinfo;		/* File information */
+  unsigned char	*data,			/* Journal data */
+		*ptr,			/* Pointer into journal */
+		*end;			/* End of journal */
+  int		mapped;			/* Is the journal mapped? */
+  int		records = 0,		/* Number of records */
+		status = 0;		/* Return status */
+  cups_array_t	*added = NULL;		/* Jobs created by the journal */
+  cupsd_job_t	*job;			/* Current job */
+  char		jobfile[1024];		/* Job filename */
+
+
+ /*
+  * Open and map the journal...
+  */
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+  {
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open job journal \"%s\": %s",
+                      filename, strerror(errno));
+    return (0);
+  }
+
+  if (fstat(fd, &fileinfo) || fileinfo.st_size < CUPSD_JOURNAL_HEADER)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Bad job journal \"%s\".", filename);
+    close(fd);
+    return (0);
+  }
+
+  if ((data = mmap(NULL, (size_t)fileinfo.st_size, PROT_READ, MAP_PRIVATE, fd,
+                   0)) != MAP_FAILED)
+    mapped = 1;
+  else if ((data = malloc((size_t)fileinfo.st_size)) != NULL &&
+           read(fd, data, (size_t)fileinfo.st_size) == fileinfo.st_size)
+    mapped = 0;
+  else
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to read job journal \"%s\": %s",
+                    filename, strerror(errno));
+    free(data);
+    close(fd);
+    return (0);
+  }
+
+  close(fd);
+
+  end = data + fileinfo.st_size;
+
+ /*
+  * Validate the header...
+  */
+
+  {
+    unsigned	bom,			/* Byte order mark */
+		version;		/* File version */
+
+    memcpy(&bom, data + 8, 4);
+    memcpy(&version, data + 12, 4);
+
+    if (memcmp(data, CUPSD_JOURNAL_MAGIC, 8) || bom != CUPSD_JOURNAL_BOM ||
+        version != CUPSD_JOURNAL_VERSION)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Bad job journal header in \"%s\".",
+                      filename);
+      goto done;
+    }
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Loading job journal \"%s\"...", filename);
+
+ /*
+  * Replay the records...
+  */
+
+  for (ptr = data + CUPSD_JOURNAL_HEADER; ptr < end; records ++)
+  {
+    unsigned	length,			/* Record length */
+		crc;			/* Record checksum */
+    int		type,			/* Record type */
+		id;			/* Job ID */
+
+
+    if ((end - ptr) >= CUPSD_JOURNAL_HEADER)
+    {
+      memcpy(&length, ptr, 4);
+      memcpy(&crc, ptr + 4, 4);
+    }
+    else
+      length = 0;
+
+    if (length < CUPSD_JOURNAL_HEADER || length > (unsigned)(end - ptr) ||
+        journal_checksum(ptr + 8, length - 8) != crc)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Damaged record %d in job journal \"%s\".",
+		      records + 1, filename);
+      goto done;
+    }
+
+    memcpy(&type, ptr + 8, 4);
+    memcpy(&id, ptr + 12, 4);
+
+    if (type == CUPSD_JOURNAL_NEXTID)
+    {
+      if (id > NextJobId)
+        NextJobId = id;
+    }
+    else if (type == CUPSD_JOURNAL_DELETE)
+    {
+      if (!ids_only && (job = cupsdFindJob(id)) != NULL)
+      {
+        cupsArrayRemove(added, job);
+        cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
+      }
+    }
+    else if (type == CUPSD_JOURNAL_JOB && ids_only)
+    {
+      if (id >= NextJobId)
+        NextJobId = id + 1;
+    }
+    else if (type == CUPSD_JOURNAL_JOB &&
+             length >= CUPSD_JOURNAL_HEADER + 5 * 4 + 3 * 8 + 3 * 2)
+    {
+      int		i;		/* Looping var */
+      int		ints[5];	/* Integers for job */
+      long long		times[3];	/* Times for job */
+      unsigned short	len;		/* Length of string */
+      char		*strings[3],	/* Strings for job */
+			value[IPP_MAX_NAME * 4];
+					/* String value */
+      unsigned char	*recptr,	/* Pointer into record */
+			*recend;	/* End of record */
+
+
+      if ((job = cupsdFindJob(id)) == NULL)
+      {
+        if ((job = calloc(1, sizeof(cupsd_job_t))) == NULL)
+	{
+	  cupsdLogMessage(CUPSD_LOG_EMERG,
+	                  "[Job %d] Unable to allocate memory for job.", id);
+	  goto done;
+	}
+
+	job->id              = id;
+	job->back_pipes[0]   = -1;
+	job->back_pipes[1]   = -1;
+	job->print_pipes[0]  = -1;
+	job->print_pipes[1]  = -1;
+	job->side_pipes[0]   = -1;
+	job->side_pipes[1]   = -1;
+	job->status_pipes[0] = -1;
+	job->status_pipes[1] = -1;
+
+	cupsArrayAdd(Jobs, job);
+
+        if (!added)
+	  added = cupsArrayNew(NULL, NULL);
+
+        cupsArrayAdd(added, job);
+
+        if (id >= NextJobId)
+	  NextJobId = id + 1;
+      }
+
+      recptr = ptr + CUPSD_JOURNAL_HEADER;
+      recend = ptr + length;
+
+      memcpy(ints, recptr, sizeof(ints));
+      recptr += sizeof(ints);
+      memcpy(times, recptr, sizeof(times));
+      recptr += sizeof(times);
+
+      job->state_value    = (ipp_jstate_t)ints[0];
+      job->priority       = ints[1];
+      job->dtype          = (cups_ptype_t)ints[2];
+      job->koctets        = ints[3];
+      job->creation_time  = (time_t)times[0];
+      job->completed_time = (time_t)times[1];
+      job->hold_until     = (time_t)times[2];
+      job->journal_crc    = crc;
+
+      if (job->state_value < IPP_JOB_PENDING)
+        job->state_value = IPP_JOB_PENDING;
+      else if (job->state_value > IPP_JOB_COMPLETED)
+        job->state_value = IPP_JOB_COMPLETED;
+
+      strings[0] = strings[1] = strings[2] = NULL;
+
+      for (i = 0; i < 3 && recptr <= (recend - 2); i ++)
+      {
+        memcpy(&len, recptr, 2);
+	recptr += 2;
+
+	if (len >= sizeof(value) || len > (recend - recptr))
+	  break;
+
+        memcpy(value, recptr, len);
+	value[len] = '\0';
+	recptr += len;
+
+        if (len)
+	  strings[i] = _cupsStrAlloc(value);
+      }
+
+      cupsdClearString(&job->username);
+      cupsdClearString(&job->name);
+      cupsdClearString(&job->dest);
+
+      job->username = strings[0];
+      job->name     = strings[1];
+      job->dest     = strings[2];
+
+      if (job->num_files > 0)
+      {
+        free(job->compressions);
+	free(job->filetypes);
+
+        job->compressions = NULL;
+	job->filetypes    = NULL;
+	job->num_files    = 0;
+      }
+
+      if (ints[4] > 0 && ints[4] < 65536 && i == 3)
+      {
+        job->filetypes    = calloc((size_t)ints[4], sizeof(mime_type_t *));
+	job->compressions = calloc((size_t)ints[4], sizeof(int));
+
+        if (!job->filetypes || !job->compressions)
+	{
+	  cupsdLogJob(job, CUPSD_LOG_EMERG,
+		      "Unable to allocate memory for %d files.", ints[4]);
+	  free(job->filetypes);
+	  free(job->compressions);
+	  job->filetypes    = NULL;
+	  job->compressions = NULL;
+	}
+	else
+	{
+	  job->num_files = ints[4];
+
+	  for (i = 0; i < job->num_files && recptr <= (recend - 6); i ++)
+	  {
+	    char	super[MIME_MAX_SUPER],
+					/* MIME super type */
+			type[MIME_MAX_TYPE];
+					/* MIME type */
+
+	    memcpy(job->compressions + i, recptr, sizeof(int));
+	    memcpy(&len, recptr + sizeof(int), 2);
+	    recptr += sizeof(int) + 2;
+
+	    if (len >= sizeof(value) || len > (recend - recptr))
+	      break;
+
+	    memcpy(value, recptr, len);
+	    value[len] = '\0';
+	    recptr += len;
+
+	    if (sscanf(value, "%15[^/]/%255s", super, type) == 2)
+	      job->filetypes[i] = mimeType(MimeDatabase, super, type);
+	  }
+	}
+      }
+    }
+
+    ptr += length;
+  }
+
+  if (!records)
+    goto done;
+
+  status = 1;
+
+  if (ids_only)
+    goto done;
+
+ /*
+  * Now finish loading each job just like we do for job.cache...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    int	i;				/* Looping var */
+
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from journal...");
+
+    if (job->num_files > 0)
+    {
+      snprintf(jobfile, sizeof(jobfile), "%s/d%05d-001", RequestRoot, job->id);
+      if (access(jobfile, 0))
+      {
+	cupsdLogJob(job, CUPSD_LOG_INFO, "Data files have gone away.");
+	free(job->compressions);
+	free(job->filetypes);
+
+	job->compressions = NULL;
+	job->filetypes    = NULL;
+	job->num_files    = 0;
+      }
+    }
+
+    for (i = 0; i < job->num_files; i ++)
+    {
+      if (!job->filetypes[i])
+      {
+       /*
+        * If the original MIME type is unknown, auto-type it!
+	*/
+
+        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unknown MIME type for file %d.",
+	            i + 1);
+
+        snprintf(jobfile, sizeof(jobfile), "%s/d%05d-%03d", RequestRoot,
+	         job->id, i + 1);
+        job->filetypes[i] = mimeFileType(MimeDatabase, jobfile, NULL,
+	                                 job->compressions + i);
+
+       /*
+        * If that didn't work, assume it is raw...
+	*/
+
+        if (!job->filetypes[i])
+	  job->filetypes[i] = mimeType(MimeDatabase, "application",
+	                               "vnd.cups-raw");
+      }
+    }
+
+    cupsdUpdateJobIndex(job);
+
+    if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
+      cupsArrayAdd(ActiveJobs, job);
+    else if (job->state_value > IPP_JOB_STOPPED)
+    {
+      if (!job->completed_time || !job->creation_time || !job->name ||
+          !job->koctets)
+      {
+	cupsdLoadJob(job);
+	unload_job(job);
+      }
+    }
+  }
+
+  journal_loaded  = 1;
+  journal_records = records;
+  journal_next_id = NextJobId;
+
+ /*
+  * Unmap/free the journal data and return...
+  */
+
+  done:
+
+  if (mapped)
+    munmap(data, (size_t)fileinfo.st_size);
+  else
+    free(data);
+
+  if (!status && added)
+  {
+   /*
+    * Throw away any jobs from a partial replay so that the caller can reload
+    * them from the RequestRoot directory...
+    */
+
+    for (job = (cupsd_job_t *)cupsArrayFirst(added);
+         job;
+	 job = (cupsd_job_t *)cupsArrayNext(added))
+      cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
+  }
+
+  cupsArrayDelete(added);
+
+  return (status);
+}
+
+
 /*
  * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
  */
@@ -4341,6 +5527,9 @@ load_next_job_id(const char *filename)	/* I - job.cache filename */
 
 /*
  * 'load_request_root()' - Load jobs from the RequestRoot directory.
+ *
+ * The control files are read in batches using cupsdRunWork() and then loaded
+ * in job ID order.
  */
 
 static void
@@ -4349,6 +5538,15 @@ load_request_root(void)
   cups_dir_t		*dir;		/* Directory */
   cups_dentry_t		*dent;		/* Directory entry */
   cupsd_job_t		*job;		/* New job */
+  cupsd_jobload_t	*loads,		/* Control files to load */
+			*load,		/* Current control file */
+			*temp;		/* New control file array */
+  void			*batch[CUPSD_JOBLOAD_BATCH];
+					/* Current batch of control files */
+  int			i, j,		/* Looping vars */
+			num_loads,	/* Number of control files */
+			alloc_loads,	/* Allocated control files */
+			num_batch;	/* Number of files in batch */
 
 
  /*
@@ -4366,12 +5564,62 @@ load_request_root(void)
   }
 
  /*
-  * Read all the c##### files...
+  * Find all the c##### files...
   */
 
+  loads       = NULL;
+  num_loads   = 0;
+  alloc_loads = 0;
+
   while ((dent = cupsDirRead(dir)) != NULL)
     if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c')
     {
+      if (num_loads >= alloc_loads)
+      {
+        alloc_loads += 1024;
+
+        if ((temp = realloc(loads, (size_t)alloc_loads *
+	                               sizeof(cupsd_jobload_t))) == NULL)
+	{
+	  cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
+	  break;
+	}
+
+        loads = temp;
+      }
+
+      loads[num_loads].id    = atoi(dent->filename + 1);
+      loads[num_loads].attrs = NULL;
+      num_loads ++;
+    }
+
+  cupsDirClose(dir);
+
+  if (num_loads > 1)
+    qsort(loads, (size_t)num_loads, sizeof(cupsd_jobload_t),
+          (int (*)(const void *, const void *))compare_jobloads);
+
+  for (i = 0; i < num_loads; i += num_batch)
+  {
+   /*
+    * Read a batch of control files, using the worker threads as configured...
+    */
+
+    for (num_batch = 0;
+         num_batch < CUPSD_JOBLOAD_BATCH && (i + num_batch) < num_loads;
+	 num_batch ++)
+      batch[num_batch] = loads + i + num_batch;
+
+    cupsdRunWork((cupsd_workfunc_t)read_job_load, batch, num_batch);
+
+   /*
+    * Then load the jobs in order...
+    */
+
+    for (j = 0; j < num_batch; j ++)
+    {
+      load = (cupsd_jobload_t *)batch[j];
+
      /*
       * Allocate memory for the job...
       */
@@ -4379,7 +5627,11 @@ load_request_root(void)
       if ((job = calloc(sizeof(cupsd_job_t), 1)) == NULL)
       {
         cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
-	cupsDirClose(dir);
+
+        for (; i + j < num_loads; j ++)
+	  ippDelete(loads[i + j].attrs);
+
+        free(loads);
 	return;
       }
 
@@ -4387,7 +5639,7 @@ load_request_root(void)
       * Assign the job ID...
       */
 
-      job->id              = atoi(dent->filename + 1);
+      job->id              = load->id;
       job->back_pipes[0]   = -1;
       job->back_pipes[1]   = -1;
       job->print_pipes[0]  = -1;
@@ -4401,10 +5653,11 @@ load_request_root(void)
         NextJobId = job->id + 1;
 
      /*
-      * Load the job...
+      * Load the job; if the control file could not be read, it is read again
+      * here so that errors are logged...
       */
 
-      if (cupsdLoadJob(job))
+      if (cupsdLoadJobAttrs(job, load->attrs))
       {
        /*
         * Insert the job into the array, sorting by job priority and ID...
@@ -4419,9 +5672,108 @@ load_request_root(void)
       }
       else
         free(job);
+
+      load->attrs = NULL;
     }
+  }
 
-  cupsDirClose(dir);
+  free(loads);
+}
+
+
+/*
+ * 'map_job_file()' - Map a job control file into memory.
+ *
+ * Compressed control files are not mapped so that cupsFile can be used to
+ * read them.  Like cupsdReadJobAttrs(), this may be called from a worker
+ * thread.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+map_job_file(int            id,		/* I - Job ID */
+             cupsd_jobmap_t *map)	/* O - Mapped job file */
+{
+  int		fd;			/* File descriptor */
+  struct stat	fileinfo;		/* File information */
+  char		jobfile[1024];		/* Job filename */
+
+
+  memset(map, 0, sizeof(cupsd_jobmap_t));
+
+  snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, id);
+  if ((fd = open(jobfile, O_RDONLY)) < 0 && errno == ENOENT)
+  {
+    strlcat(jobfile, ".O", sizeof(jobfile));
+    fd = open(jobfile, O_RDONLY);
+  }
+
+  if (fd < 0)
+    return (0);
+
+  if (fstat(fd, &fileinfo) || fileinfo.st_size < 9)
+  {
+    close(fd);
+    return (0);
+  }
+
+  map->length = (size_t)fileinfo.st_size;
+
+  if ((map->data = mmap(NULL, map->length, PROT_READ, MAP_PRIVATE, fd,
+                        0)) != MAP_FAILED)
+    map->mapped = 1;
+  else if ((map->data = malloc(map->length)) == NULL ||
+           read(fd, map->data, map->length) != (ssize_t)map->length)
+  {
+    free(map->data);
+    close(fd);
+    return (0);
+  }
+
+  close(fd);
+
+  if (map->data[0] == 0x1f && map->data[1] == 0x8b)
+  {
+   /*
+    * gzip'd control file...
+    */
+
+    unmap_job_file(map);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'read_job_load()' - Read a job control file for load_request_root().
+ *
+ * This is called from cupsdRunWork(), possibly on another thread.
+ */
+
+static void
+read_job_load(cupsd_jobload_t *load)	/* I - Control file to load */
+{
+  load->attrs = cupsdReadJobAttrs(load->id);
+}
+
+
+/*
+ * 'read_job_map()' - Read IPP data from a job control file in memory.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+read_job_map(cupsd_jobmap_t *map,	/* I - Mapped job file */
+             ipp_uchar_t    *buffer,	/* O - Buffer */
+	     size_t         bytes)	/* I - Number of bytes to read */
+{
+  if (bytes > map->length - map->pos)
+    bytes = map->length - map->pos;
+
+  memcpy(buffer, map->data + map->pos, bytes);
+  map->pos += bytes;
+
+  return ((ssize_t)bytes);
 }
 
 
@@ -4480,6 +5832,164 @@ remove_job_history(cupsd_job_t *job)	/* I - Job */
 }
 
 
+/*
+ * 'save_job_journal()' - Append changed jobs to the job journal.
+ */
+
+static void
+save_job_journal(int compact)		/* I - Force a compaction? */
+{
+  int		i;			/* Looping var */
+  cups_file_t	*fp;			/* job.journal file */
+  char		filename[1024];		/* job.journal filename */
+  cupsd_job_t	*job;			/* Current job */
+  unsigned char	*record;		/* Current record */
+  size_t	length;			/* Length of record */
+  unsigned	crc;			/* Record checksum */
+  int		count = 0;		/* Number of records written */
+
+
+  snprintf(filename, sizeof(filename), "%s/job.journal", CacheDir);
+
+  if (!journal_loaded || journal_compact ||
+      journal_records > 2 * cupsArrayCount(Jobs) + 1024)
+    compact = 1;
+  else if ((fp = cupsFileOpen(filename, "a")) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename,
+		    strerror(errno));
+    compact = 1;
+  }
+  else if (cupsFileTell(fp) < CUPSD_JOURNAL_HEADER)
+  {
+   /*
+    * The journal has been removed or truncated...
+    */
+
+    cupsFileClose(fp);
+    compact = 1;
+  }
+
+  if (compact)
+  {
+   /*
+    * Write a new journal with one record per job...
+    */
+
+    unsigned	header[2];		/* BOM and version */
+
+    if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
+      return;
+
+    cupsdLogMessage(CUPSD_LOG_INFO, "Compacting job.journal...");
+
+    header[0] = CUPSD_JOURNAL_BOM;
+    header[1] = CUPSD_JOURNAL_VERSION;
+
+    cupsFileWrite(fp, CUPSD_JOURNAL_MAGIC, 8);
+    cupsFileWrite(fp, (char *)header, sizeof(header));
+  }
+  else
+  {
+   /*
+    * Append deletions to the existing journal...
+    */
+
+    for (i = 0; i < num_journal_deletes; i ++)
+      if ((record = journal_record(NULL, CUPSD_JOURNAL_DELETE,
+                                   journal_deletes[i], &length)) != NULL)
+      {
+        cupsFileWrite(fp, (char *)record, length);
+        count ++;
+      }
+  }
+
+  num_journal_deletes = 0;
+
+ /*
+  * Write records for new and changed jobs...
+  */
+
+  if (compact || NextJobId != journal_next_id)
+  {
+    if ((record = journal_record(NULL, CUPSD_JOURNAL_NEXTID, NextJobId,
+                                 &length)) != NULL)
+    {
+      cupsFileWrite(fp, (char *)record, length);
+      count ++;
+    }
+
+    journal_next_id = NextJobId;
+  }
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (!compact && job->journal_crc && !job->dirty && !job->journal_dirty)
+      continue;
+
+    if ((record = journal_record(job, CUPSD_JOURNAL_JOB, job->id,
+                                 &length)) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+                  "Unable to allocate memory for journal record.");
+      continue;
+    }
+
+    job->journal_dirty = 0;
+
+    memcpy(&crc, record + 4, 4);
+
+    if (compact || crc != job->journal_crc)
+    {
+      cupsFileWrite(fp, (char *)record, length);
+      job->journal_crc = crc;
+      count ++;
+    }
+  }
+
+  if (compact)
+  {
+    if (cupsdCloseCreatedConfFile(fp, filename))
+    {
+      journal_compact = 1;
+      return;
+    }
+
+    journal_compact = 0;
+    journal_records = count;
+  }
+  else
+  {
+   /*
+    * Only sync the records we just appended...
+    */
+
+    if (count > 0 && cupsFileFlush(fp))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write changes to \"%s\": %s",
+		      filename, strerror(errno));
+      journal_compact = 1;
+    }
+    else if (count > 0 && SyncOnClose && fsync(cupsFileNumber(fp)))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to sync changes to \"%s\": %s",
+		      filename, strerror(errno));
+      journal_compact = 1;
+    }
+
+    cupsFileClose(fp);
+
+    journal_records += count;
+  }
+
+  journal_loaded = 1;
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Wrote %d records to job.journal.", count);
+}
+
+
 /*
  * 'set_time()' - Set one of the "time-at-xyz" attributes.
  */
@@ -4771,6 +6281,23 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
 }
 
 
+/*
+ * 'unindex_job()' - Remove a job from the job indexes.
+ */
+
+static void
+unindex_job(cupsd_job_t *job)		/* I - Job */
+{
+  index_job(job, &job->dest_index, &dest_index, NULL, 0);
+  index_job(job, &job->user_index, &user_index, NULL, 0);
+
+  if (job->index_flags & CUPSD_JOBINDEX_COMPLETED)
+    cupsArrayRemove(completed_jobs, job);
+
+  job->index_flags = 0;
+}
+
+
 /*
  * 'unload_job()' - Unload a job from memory.
  */
@@ -4795,6 +6322,23 @@ unload_job(cupsd_job_t *job)		/* I - Job */
 }
 
 
+/*
+ * 'unmap_job_file()' - Release a job control file in memory.
+ */
+
+static void
+unmap_job_file(cupsd_jobmap_t *map)	/* I - Mapped job file */
+{
+  if (map->mapped)
+    munmap(map->data, map->length);
+  else
+    free(map->data);
+
+  map->data   = NULL;
+  map->mapped = 0;
+}
+
+
 /*
  * 'update_job()' - Read a status update from a job's filters.
  */
@@ -4867,6 +6411,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
       }
 
       cupsdLogPage(job, message);
+      cupsdLogAccounting(job, message);
 
       if (job->sheets)
 	cupsdAddEvent(CUPSD_EVENT_JOB_PROGRESS, job->printer, job,
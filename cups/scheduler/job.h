@@ -24,6 +24,25 @@ typedef enum cupsd_jobaction_e		/**** Actions for state changes ****/
   CUPSD_JOB_PURGE			/* Force the change and purge */
 } cupsd_jobaction_t;
 
+typedef enum cupsd_jobcache_e		/**** Job cache formats ****/
+{
+  CUPSD_JOBCACHE_BINARY,		/* Binary job.journal file */
+  CUPSD_JOBCACHE_TEXT			/* Text job.cache file */
+} cupsd_jobcache_t;
+
+
+/*
+ * Job index structure...
+ */
+
+typedef struct cupsd_jobindex_s		/**** Job index entry ****/
+{
+  char			*name;		/* Destination or user name */
+  int			num_active;	/* Number of active jobs */
+  cups_array_t		*jobs,		/* All jobs, sorted by ID */
+			*completed;	/* Completed jobs, sorted by ID */
+} cupsd_jobindex_t;
+
 
 /*
  * Job request structure...
@@ -89,6 +108,11 @@ struct cupsd_job_s			/**** Job request ****/
   int			progress;	/* Printing progress */
   int			num_keywords;	/* Number of PPD keywords */
   cups_option_t		*keywords;	/* PPD keywords */
+  cupsd_jobindex_t	*dest_index,	/* Destination index entry */
+			*user_index;	/* User index entry */
+  int			index_flags;	/* Index state flags */
+  unsigned		journal_crc;	/* Checksum of last journal record */
+  int			journal_dirty;	/* Saved since last journal write? */
 };
 
 typedef struct cupsd_joblog_s		/**** Job log message ****/
@@ -102,6 +126,8 @@ typedef struct cupsd_joblog_s		/**** Job log message ****/
  * Globals...
  */
 
+VAR cupsd_jobcache_t	JobCacheFormat	VALUE(CUPSD_JOBCACHE_BINARY);
+					/* Job cache file format */
 VAR int			JobHistory	VALUE(INT_MAX);
 					/* Preserve job history? */
 VAR int			JobFiles	VALUE(86400);
@@ -155,9 +181,13 @@ extern void		cupsdFreeAllJobs(void);
 extern cups_array_t	*cupsdGetCompletedJobs(cupsd_printer_t *p);
 extern int		cupsdGetPrinterJobCount(const char *dest);
 extern int		cupsdGetUserJobCount(const char *username);
+extern cups_array_t	*cupsdGetUserJobs(const char *username);
 extern void		cupsdLoadAllJobs(void);
 extern int		cupsdLoadJob(cupsd_job_t *job);
+extern int		cupsdLoadJobAttrs(cupsd_job_t *job, ipp_t *attrs);
 extern void		cupsdMoveJob(cupsd_job_t *job, cupsd_printer_t *p);
+extern ipp_t		*cupsdReadJobAttrs(int id);
+extern ipp_t		*cupsdReadJobView(int id, cups_array_t *ra);
 extern void		cupsdReleaseJob(cupsd_job_t *job);
 extern void		cupsdRestartJob(cupsd_job_t *job);
 extern void		cupsdSaveAllJobs(void);
@@ -175,6 +205,7 @@ extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobIndex(cupsd_job_t *job);
 extern void		cupsdUpdateJobs(void);
 
 
@@ -20,6 +20,61 @@
 #include "cupsd.h"
 #include <stdarg.h>
 #include <syslog.h>
+#include <pthread.h>
+
+
+/*
+ * Design Notes for the Log Buffer
+ * -------------------------------
+ *
+ * By default every error, access, and page log line is formatted and written
+ * (and flushed) synchronously by the thread that logs it.  When LogBufferSize
+ * is non-zero, cupsdStartLogWriter() allocates a ring buffer of that size
+ * and starts a writer thread.  Log functions then append the preformatted
+ * line to the ring and return without doing any file I/O.
+ *
+ * Producers are serialized by log_mutex (which already protects the error
+ * log) but never wait for the writer.  The writer is the only consumer and
+ * never takes log_mutex; the ring head and tail are published with atomic
+ * acquire/release stores.  The writer wakes up once a second or when the
+ * ring is half full, writes everything that is queued, rotates the files
+ * with cupsdCheckLogFile(), flushes each file once per batch, and calls
+ * fsync() every LogSyncInterval seconds.
+ *
+ * A line that does not fit is dropped rather than blocking the caller.  The
+ * drop counter is reported in the "Report:" debug lines, and the buffer is in
+ * the "overflow" state until a warning with the number of dropped lines has
+ * been queued.
+ *
+ * Records are 8-byte aligned and never wrap - a padding record fills the
+ * space at the end of the ring when a line does not fit there.
+ */
+
+#define CUPSD_LOGREC_PAD	0	/* Padding record */
+#define CUPSD_LOGREC_ERROR	1	/* ErrorLog line */
+#define CUPSD_LOGREC_ACCESS	2	/* AccessLog line */
+#define CUPSD_LOGREC_PAGE	4	/* PageLog line */
+
+#define CUPSD_LOGREC_SIZE(len)	((sizeof(cupsd_logrec_t) + (len) + 7) & ~(size_t)7)
+
+#ifdef HAVE_ATOMIC_BUILTINS
+#  define log_load(v)		__atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#  define log_store(v,n)	__atomic_store_n(&(v), (n), __ATOMIC_RELEASE)
+#else
+#  define log_load(v)		(v)
+#  define log_store(v,n)	(v) = (n)
+#endif /* HAVE_ATOMIC_BUILTINS */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_logrec_s		/**** Log buffer record ****/
+{
+  unsigned	type,			/* Type of record */
+		length;			/* Length of line, including newline */
+} cupsd_logrec_t;
 
 
 /*
@@ -30,6 +85,18 @@ static _cups_mutex_t log_mutex = _CUPS_MUTEX_INITIALIZER;
 					/* Mutex for logging */
 static size_t	log_linesize = 0;	/* Size of line for output file */
 static char	*log_line = NULL;	/* Line for output file */
+static char	*log_buffer = NULL;	/* Log ring buffer or NULL if unbuffered */
+static size_t	log_bufsize = 0,	/* Size of ring buffer (power of 2) */
+		log_head = 0,		/* Producer position in ring */
+		log_tail = 0;		/* Writer position in ring */
+static int	log_drops = 0,		/* Total number of dropped lines */
+		log_dropped = 0,	/* Lines dropped since last warning */
+		log_stop = 0;		/* Stop the writer thread? */
+static pthread_t log_thread;		/* Writer thread */
+static pthread_mutex_t log_wait_mutex = PTHREAD_MUTEX_INITIALIZER;
+					/* Mutex for writer wakeups */
+static pthread_cond_t log_wait_cond = PTHREAD_COND_INITIALIZER;
+					/* Condition for writer wakeups */
 
 #ifdef HAVE_VSYSLOG
 static const int syslevels[] =		/* SYSLOG levels... */
@@ -53,6 +120,13 @@ static const int syslevels[] =		/* SYSLOG levels... */
  */
 
 static int	format_log_line(const char *message, va_list ap);
+static int	log_copy(unsigned type, const char *prefix,
+		         const char *message);
+static int	log_drain(void);
+static int	log_queue(unsigned type, const char *prefix,
+		          const char *message);
+static void	log_sync(int files);
+static void	*log_writer(void *data);
 
 
 /*
@@ -317,6 +391,39 @@ cupsdGetDateTime(struct timeval *t,	/* I - Time value or NULL for current */
 }
 
 
+/*
+ * 'cupsdGetLogStatistics()' - Return the log buffer statistics.
+ */
+
+int					/* O - 1 if log buffer is active, 0 otherwise */
+cupsdGetLogStatistics(
+    size_t *used,			/* O - Bytes queued in log buffer */
+    size_t *size,			/* O - Size of log buffer */
+    int    *drops,			/* O - Number of dropped log lines */
+    int    *overflow)			/* O - 1 if lines are being dropped */
+{
+  int	active;				/* Is the log buffer active? */
+
+
+  _cupsMutexLock(&log_mutex);
+
+  if ((active = log_buffer != NULL) != 0)
+  {
+    *used = log_head - log_load(log_tail);
+    *size = log_bufsize;
+  }
+  else
+    *used = *size = 0;
+
+  *drops    = log_drops;
+  *overflow = log_dropped > 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  return (active);
+}
+
+
 /*
  * 'cupsdLogFCMessage()' - Log a file checking message.
  */
@@ -844,6 +951,21 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   }
 #endif /* HAVE_VSYSLOG */
 
+ /*
+  * Queue the line for the writer thread if the log buffer is active...
+  */
+
+  if (log_buffer)
+  {
+    int	ret;				/* Return value */
+
+    _cupsMutexLock(&log_mutex);
+    ret = log_queue(CUPSD_LOGREC_PAGE, "", buffer);
+    _cupsMutexUnlock(&log_mutex);
+
+    return (ret);
+  }
+
  /*
   * Not using syslog; check the log file...
   */
@@ -873,7 +995,8 @@ int					/* O - 1 on success, 0 on error */
 cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
                 http_status_t  code)	/* I - Response code */
 {
-  char	temp[2048];			/* Temporary string for URI */
+  char	temp[2048],			/* Temporary string for URI */
+	line[4096];			/* Line for log buffer */
   static const char * const states[] =	/* HTTP client states... */
 		{
 		  "WAITING",
@@ -1025,6 +1148,40 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
   }
 #endif /* HAVE_VSYSLOG */
 
+ /*
+  * Format a log of the request in "common log format"...
+  */
+
+  snprintf(line, sizeof(line),
+           "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s",
+	   con->http->hostname,
+	   con->username[0] != '\0' ? con->username : "-",
+	   cupsdGetDateTime(&(con->start), LogTimeFormat),
+	   states[con->operation],
+	   _httpEncodeURI(temp, con->uri, sizeof(temp)),
+	   con->http->version / 100, con->http->version % 100,
+	   code, CUPS_LLCAST con->bytes,
+	   con->request ?
+	       ippOpString(con->request->request.op.operation_id) : "-",
+	   con->response ?
+	       ippErrorString(con->response->request.status.status_code) :
+	       "-");
+
+ /*
+  * Queue the line for the writer thread if the log buffer is active...
+  */
+
+  if (log_buffer)
+  {
+    int	ret;				/* Return value */
+
+    _cupsMutexLock(&log_mutex);
+    ret = log_queue(CUPSD_LOGREC_ACCESS, "", line);
+    _cupsMutexUnlock(&log_mutex);
+
+    return (ret);
+  }
+
  /*
   * Not using syslog; check the log file...
   */
@@ -1032,28 +1189,120 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
   if (!cupsdCheckLogFile(&AccessFile, AccessLog))
     return (0);
 
+  cupsFilePrintf(AccessFile, "%s\n", line);
+  cupsFileFlush(AccessFile);
+
+  return (1);
+}
+
+
+/*
+ * 'cupsdStartLogWriter()' - Start the log writer thread.
+ */
+
+void
+cupsdStartLogWriter(void)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+  size_t	size;			/* Size of ring buffer */
+  char		*buffer;		/* Ring buffer */
+  int		ret;			/* pthread_create() status */
+#endif /* HAVE_ATOMIC_BUILTINS */
+
+
+  if (LogBufferSize <= 0 || log_buffer)
+    return;
+
+#ifndef HAVE_ATOMIC_BUILTINS
+  cupsdLogMessage(CUPSD_LOG_WARN,
+                  "LogBufferSize is not supported on this platform, logging "
+		  "synchronously.");
+
+#else
  /*
-  * Write a log of the request in "common log format"...
+  * Round the buffer size up to a power of 2 between 64k and 64M...
   */
 
-  cupsFilePrintf(AccessFile,
-                 "%s - %s %s \"%s %s HTTP/%d.%d\" %d " CUPS_LLFMT " %s %s\n",
-        	 con->http->hostname,
-		 con->username[0] != '\0' ? con->username : "-",
-		 cupsdGetDateTime(&(con->start), LogTimeFormat),
-		 states[con->operation],
-		 _httpEncodeURI(temp, con->uri, sizeof(temp)),
-		 con->http->version / 100, con->http->version % 100,
-		 code, CUPS_LLCAST con->bytes,
-		 con->request ?
-		     ippOpString(con->request->request.op.operation_id) : "-",
-		 con->response ?
-		     ippErrorString(con->response->request.status.status_code) :
-		     "-");
+  for (size = 65536; size < (size_t)LogBufferSize && size < 67108864; size *= 2);
 
-  cupsFileFlush(AccessFile);
+  if ((buffer = malloc(size)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for log buffer, logging "
+		    "synchronously.");
+    return;
+  }
 
-  return (1);
+  _cupsMutexLock(&log_mutex);
+
+  log_bufsize = size;
+  log_head    = 0;
+  log_tail    = 0;
+  log_stop    = 0;
+  log_buffer  = buffer;
+
+  if ((ret = pthread_create(&log_thread, NULL, log_writer, NULL)) != 0)
+  {
+   /*
+    * Write anything that was queued and go back to logging synchronously...
+    */
+
+    log_drain();
+
+    log_buffer = NULL;
+    free(buffer);
+
+    _cupsMutexUnlock(&log_mutex);
+
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to create log writer thread: %s", strerror(ret));
+    return;
+  }
+
+  _cupsMutexUnlock(&log_mutex);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG,
+                  "Started log writer thread with %u byte buffer.",
+                  (unsigned)size);
+#endif /* !HAVE_ATOMIC_BUILTINS */
+}
+
+
+/*
+ * 'cupsdStopLogWriter()' - Stop the log writer thread.
+ *
+ * All queued lines are written before this function returns.
+ */
+
+void
+cupsdStopLogWriter(void)
+{
+  if (!log_buffer)
+    return;
+
+  pthread_mutex_lock(&log_wait_mutex);
+  log_stop = 1;
+  pthread_cond_signal(&log_wait_cond);
+  pthread_mutex_unlock(&log_wait_mutex);
+
+  pthread_join(log_thread, NULL);
+
+ /*
+  * Write any lines that were queued after the writer thread finished and go
+  * back to logging synchronously...
+  */
+
+  _cupsMutexLock(&log_mutex);
+
+  log_sync(log_drain());
+
+  free(log_buffer);
+  log_buffer  = NULL;
+  log_bufsize = 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Stopped log writer thread.");
 }
 
 
@@ -1066,6 +1315,7 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
                    const char *message)	/* I - Message string */
 {
   int		ret = 1;		/* Return value */
+  char		prefix[256];		/* Level and date/time prefix */
   static const char	levels[] =	/* Log levels... */
 		{
 		  ' ',
@@ -1099,7 +1349,18 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
 
   _cupsMutexLock(&log_mutex);
 
-  if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
+  if (log_buffer)
+  {
+   /*
+    * Queue the log message for the writer thread...
+    */
+
+    snprintf(prefix, sizeof(prefix), "%c %s ", levels[level],
+             cupsdGetDateTime(NULL, LogTimeFormat));
+
+    ret = log_queue(CUPSD_LOGREC_ERROR, prefix, message);
+  }
+  else if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
   {
     ret = 0;
   }
@@ -1185,6 +1446,277 @@ format_log_line(const char *message,	/* I - Printf-style format string */
 }
 
 
+/*
+ * 'log_copy()' - Copy a line into the log buffer.
+ *
+ * The caller must hold log_mutex.
+ */
+
+static int				/* O - 1 on success, 0 if buffer is full */
+log_copy(unsigned   type,		/* I - Type of record */
+         const char *prefix,		/* I - Prefix string */
+	 const char *message)		/* I - Message string */
+{
+  size_t		prefixlen,	/* Length of prefix */
+			length,		/* Length of line */
+			need,		/* Size of record */
+			head,		/* Producer position */
+			offset,		/* Offset of record in ring */
+			contig;		/* Space before end of ring */
+  cupsd_logrec_t	*rec;		/* Record */
+
+
+  prefixlen = strlen(prefix);
+  length    = prefixlen + strlen(message) + 1;
+  need      = CUPSD_LOGREC_SIZE(length);
+
+  if (need > log_bufsize / 2)
+    return (0);
+
+  head   = log_head;
+  offset = head & (log_bufsize - 1);
+  contig = log_bufsize - offset;
+
+  if (log_bufsize - (head - log_load(log_tail)) <
+          (need <= contig ? need : contig + need))
+  {
+   /*
+    * No room, make sure the writer is awake...
+    */
+
+    pthread_cond_signal(&log_wait_cond);
+    return (0);
+  }
+
+  if (need > contig)
+  {
+   /*
+    * Pad out the end of the ring so that the record is contiguous...
+    */
+
+    rec         = (cupsd_logrec_t *)(log_buffer + offset);
+    rec->type   = CUPSD_LOGREC_PAD;
+    rec->length = (unsigned)(contig - sizeof(cupsd_logrec_t));
+
+    head   += contig;
+    offset = 0;
+  }
+
+  rec         = (cupsd_logrec_t *)(log_buffer + offset);
+  rec->type   = type;
+  rec->length = (unsigned)length;
+
+  memcpy(rec + 1, prefix, prefixlen);
+  memcpy((char *)(rec + 1) + prefixlen, message, length - prefixlen - 1);
+  ((char *)(rec + 1))[length - 1] = '\n';
+
+  head += need;
+
+  log_store(log_head, head);
+
+ /*
+  * Wake up the writer early when the ring is half full...
+  */
+
+  if (head - log_load(log_tail) > log_bufsize / 2)
+    pthread_cond_signal(&log_wait_cond);
+
+  return (1);
+}
+
+
+/*
+ * 'log_drain()' - Write all queued lines to the log files.
+ *
+ * Only one thread may drain the log buffer at a time - the writer thread
+ * while it is running, otherwise the caller holding log_mutex.
+ */
+
+static int				/* O - Files that were written */
+log_drain(void)
+{
+  size_t		head,		/* Producer position */
+			tail;		/* Writer position */
+  cupsd_logrec_t	*rec;		/* Current record */
+  cups_file_t		**lf;		/* Log file */
+  const char		*logname;	/* Log filename */
+  int			files = 0;	/* Files that were written */
+
+
+  head = log_load(log_head);
+  tail = log_tail;
+
+  while (tail != head)
+  {
+    rec = (cupsd_logrec_t *)(log_buffer + (tail & (log_bufsize - 1)));
+
+    switch (rec->type)
+    {
+      case CUPSD_LOGREC_ERROR :
+          lf      = &ErrorFile;
+	  logname = ErrorLog;
+          break;
+      case CUPSD_LOGREC_ACCESS :
+          lf      = &AccessFile;
+	  logname = AccessLog;
+          break;
+      case CUPSD_LOGREC_PAGE :
+          lf      = &PageFile;
+	  logname = PageLog;
+          break;
+      default :
+          lf      = NULL;
+	  logname = NULL;
+          break;
+    }
+
+    if (lf && cupsdCheckLogFile(lf, logname))
+    {
+      cupsFileWrite(*lf, (char *)(rec + 1), rec->length);
+      files |= (int)rec->type;
+    }
+
+    tail += CUPSD_LOGREC_SIZE(rec->length);
+
+    log_store(log_tail, tail);
+  }
+
+ /*
+  * Flush each file once per batch...
+  */
+
+  if ((files & CUPSD_LOGREC_ERROR) && ErrorFile)
+    cupsFileFlush(ErrorFile);
+  if ((files & CUPSD_LOGREC_ACCESS) && AccessFile)
+    cupsFileFlush(AccessFile);
+  if ((files & CUPSD_LOGREC_PAGE) && PageFile)
+    cupsFileFlush(PageFile);
+
+  return (files);
+}
+
+
+/*
+ * 'log_queue()' - Queue a line for the writer thread.
+ *
+ * The caller must hold log_mutex.
+ */
+
+static int				/* O - 1 on success, 0 if dropped */
+log_queue(unsigned   type,		/* I - Type of record */
+          const char *prefix,		/* I - Prefix string */
+	  const char *message)		/* I - Message string */
+{
+  if (log_dropped > 0)
+  {
+   /*
+    * Report dropped lines once there is room again...
+    */
+
+    char	notice[256],		/* Dropped lines notice */
+		noticeprefix[256];	/* Level and date/time prefix */
+
+    snprintf(notice, sizeof(notice),
+             "Log buffer overflow, %d log lines were dropped.", log_dropped);
+    snprintf(noticeprefix, sizeof(noticeprefix), "W %s ",
+             cupsdGetDateTime(NULL, LogTimeFormat));
+
+    if (log_copy(CUPSD_LOGREC_ERROR, noticeprefix, notice))
+      log_dropped = 0;
+  }
+
+  if (log_dropped > 0 || !log_copy(type, prefix, message))
+  {
+    log_drops ++;
+    log_dropped ++;
+
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'log_sync()' - Commit the log files to disk.
+ */
+
+static void
+log_sync(int files)			/* I - Files to sync */
+{
+  if (LogSyncInterval <= 0)
+    return;
+
+  if ((files & CUPSD_LOGREC_ERROR) && ErrorFile)
+    fsync(cupsFileNumber(ErrorFile));
+  if ((files & CUPSD_LOGREC_ACCESS) && AccessFile)
+    fsync(cupsFileNumber(AccessFile));
+  if ((files & CUPSD_LOGREC_PAGE) && PageFile)
+    fsync(cupsFileNumber(PageFile));
+}
+
+
+/*
+ * 'log_writer()' - Write queued lines to the log files.
+ */
+
+static void *				/* O - Thread exit status */
+log_writer(void *data)			/* I - Thread data (unused) */
+{
+  int			stop,		/* Stop after this batch? */
+			files = 0;	/* Files written since last sync */
+  time_t		sync_time;	/* Time of last sync */
+  struct timeval	curtime;	/* Current time */
+  struct timespec	timeout;	/* Wakeup time */
+
+
+  (void)data;
+
+  sync_time = time(NULL);
+
+  do
+  {
+   /*
+    * Wait up to 1 second for the ring to fill or for a stop request...
+    */
+
+    pthread_mutex_lock(&log_wait_mutex);
+
+    if (!log_stop)
+    {
+      gettimeofday(&curtime, NULL);
+
+      timeout.tv_sec  = curtime.tv_sec + 1;
+      timeout.tv_nsec = curtime.tv_usec * 1000;
+
+      pthread_cond_timedwait(&log_wait_cond, &log_wait_mutex, &timeout);
+    }
+
+    stop = log_stop;
+
+    pthread_mutex_unlock(&log_wait_mutex);
+
+   /*
+    * Write everything that is queued...
+    */
+
+    files |= log_drain();
+
+    if (files && (stop || (LogSyncInterval > 0 &&
+                           (time(NULL) - sync_time) >= LogSyncInterval)))
+    {
+      log_sync(files);
+
+      files     = 0;
+      sync_time = time(NULL);
+    }
+  }
+  while (!stop);
+
+  return (NULL);
+}
+
+
 /*
  * End of "$Id: log.c 11934 2014-06-17 18:58:29Z msweet $".
  */
@@ -674,6 +674,12 @@ main(int  argc,				/* I - Number of command-line args */
     if (dead_children)
       process_children();
 
+   /*
+    * Kill persistent filters that did not stop in time...
+    */
+
+    cupsdCheckPersistentProcesses();
+
    /*
     * Check if we need to load the server configuration file...
     */
@@ -980,7 +986,15 @@ main(int  argc,				/* I - Number of command-line args */
     {
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
-			total_bytes;	/* Total string bytes */
+			total_bytes,	/* Total string bytes */
+			log_used,	/* Bytes queued in log buffer */
+			log_size;	/* Size of log buffer */
+      int		shard,		/* Current string pool shard */
+			num_shards,	/* Number of string pool shards */
+			log_drops,	/* Dropped log lines */
+			log_overflow;	/* Log buffer overflow? */
+      _cups_sp_stats_t	shards[_CUPS_SP_SHARDS];
+					/* String pool shard statistics */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1013,6 +1027,29 @@ main(int  argc,				/* I - Number of command-line args */
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
 
+      num_shards = _cupsStrShardStatistics(shards, _CUPS_SP_SHARDS);
+
+      for (shard = 0; shard < num_shards; shard ++)
+        cupsdLogMessage(CUPSD_LOG_DEBUG,
+	                "Report: stringpool-shard-%d=" CUPS_LLFMT " strings, "
+			CUPS_LLFMT " hits, " CUPS_LLFMT " misses, " CUPS_LLFMT
+			" contended", shard, CUPS_LLCAST shards[shard].count,
+			CUPS_LLCAST shards[shard].hits,
+			CUPS_LLCAST shards[shard].misses,
+			CUPS_LLCAST shards[shard].contention);
+
+      if (cupsdGetLogStatistics(&log_used, &log_size, &log_drops,
+                                &log_overflow))
+      {
+        cupsdLogMessage(CUPSD_LOG_DEBUG,
+	                "Report: log-buffer-used=" CUPS_LLFMT "/" CUPS_LLFMT,
+			CUPS_LLCAST log_used, CUPS_LLCAST log_size);
+        cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: log-buffer-drops=%d",
+	                log_drops);
+        cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: log-buffer-state=%s",
+	                log_overflow ? "overflow" : "ok");
+      }
+
       report_time = current_time;
     }
 
@@ -1322,15 +1359,19 @@ process_children(void)
   dead_children = 0;
 
  /*
-  * Collect the exit status of some children...
+  * Collect the exit status of some children, including the filters that were
+  * run by persistent filter processes...
   */
 
 #ifdef HAVE_WAITPID
-  while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+  while ((pid = cupsdWaitPersistentProcess(&status)) > 0 ||
+         (pid = waitpid(-1, &status, WNOHANG)) > 0)
 #elif defined(HAVE_WAIT3)
-  while ((pid = wait3(&status, WNOHANG, NULL)) > 0)
+  while ((pid = cupsdWaitPersistentProcess(&status)) > 0 ||
+         (pid = wait3(&status, WNOHANG, NULL)) > 0)
 #else
-  if ((pid = wait(&status)) > 0)
+  if ((pid = cupsdWaitPersistentProcess(&status)) > 0 ||
+      (pid = wait(&status)) > 0)
 #endif /* HAVE_WAITPID */
   {
    /*
@@ -1541,7 +1582,8 @@ static long				/* O - Number of seconds */
 select_timeout(int fds)			/* I - Number of descriptors returned */
 {
   long			timeout;	/* Timeout for select */
-  time_t		now;		/* Current time */
+  time_t		now,		/* Current time */
+			kill_time;	/* Time to kill persistent filters */
   cupsd_client_t	*con;		/* Client information */
   cupsd_job_t		*job;		/* Job information */
   cupsd_subscription_t	*sub;		/* Subscription information */
@@ -1639,6 +1681,12 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
     why     = "update job history";
   }
 
+  if ((kill_time = cupsdGetPersistentKillTime()) > 0 && kill_time < timeout)
+  {
+    timeout = kill_time;
+    why     = "kill persistent filters";
+  }
+
   for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
        job;
        job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
@@ -31,8 +31,11 @@ extern "C" {
  * Prototypes...
  */
 
+extern void	_mimeCompileTypes(mime_t *mime);
 extern void	_mimeError(mime_t *mime, const char *format, ...)
 		__attribute__ ((__format__ (__printf__, 2, 3)));
+extern void	_mimeFreeCompiledTypes(mime_t *mime);
+extern void	_mimeFreeFilterCache(mime_t *mime);
 
 
 #  ifdef __cplusplus
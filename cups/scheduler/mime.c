@@ -83,6 +83,9 @@ mimeDelete(mime_t *mime)		/* I - MIME database */
        type = (mime_type_t *)cupsArrayNext(mime->types))
     mimeDeleteType(mime, type);
 
+  _mimeFreeCompiledTypes(mime);
+  _mimeFreeFilterCache(mime);
+
  /*
   * Free the types and filters arrays, and then the MIME database structure.
   */
@@ -123,8 +126,8 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
   free(filter);
 
  /*
-  * Deleting a filter invalidates the source lookup cache used by
-  * mimeFilter()...
+  * Deleting a filter invalidates the source lookup and filter chain caches
+  * used by mimeFilter()...
   */
 
   if (mime->srcs)
@@ -133,6 +136,8 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
     cupsArrayDelete(mime->srcs);
     mime->srcs = NULL;
   }
+
+  _mimeFreeFilterCache(mime);
 }
 
 
@@ -157,6 +162,11 @@ mimeDeleteType(mime_t      *mime,	/* I - MIME database */
 
   cupsArrayRemove(mime->types, mt);
 
+  if (mt->rules)
+    _mimeFreeCompiledTypes(mime);
+
+  _mimeFreeFilterCache(mime);
+
   mime_delete_rules(mt->rules);
   free(mt);
 }
@@ -397,6 +407,12 @@ mimeLoadTypes(mime_t     *mime,		/* I - MIME database or @code NULL@ to create a
 
   cupsDirClose(dir);
 
+ /*
+  * Compile the type rules for mimeFileType()...
+  */
+
+  _mimeCompileTypes(mime);
+
   DEBUG_printf(("1mimeLoadTypes: Returning %p.", mime));
 
   return (mime);
@@ -112,6 +112,8 @@ typedef struct _mime_s			/**** MIME Database ****/
   cups_array_t		*srcs;		/* Filters sorted by source type */
   mime_error_cb_t	error_cb;	/* Error message callback */
   void			*error_ctx;	/* Pointer for callback */
+  struct _mime_typing_s	*typing;	/* Compiled type detection data */
+  struct _mime_fcache_s	*fcache;	/* Filter chain cache */
 } mime_t;
 
 
@@ -38,6 +38,27 @@
 #endif /* __APPLE__ */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_ppdload_s		/**** PPD data read at startup ****/
+{
+  char		*name;			/* Printer name */
+  _ppd_cache_t	*pc;			/* PPD cache from the cache file */
+  ipp_t		*attrs;			/* PPD attributes from the cache file */
+  ppd_file_t	*ppd;			/* PPD file, if the cache is stale */
+} cupsd_ppdload_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*ppd_loads = NULL;
+					/* PPD data read at startup */
+
+
 /*
  * Local functions...
  */
@@ -46,12 +67,18 @@ static void	add_printer_defaults(cupsd_printer_t *p);
 static void	add_printer_filter(cupsd_printer_t *p, mime_type_t *type,
 				   const char *filter);
 static void	add_printer_formats(cupsd_printer_t *p);
+static int	compare_ppdloads(cupsd_ppdload_t *first,
+		                 cupsd_ppdload_t *second, void *data);
 static int	compare_printers(void *first, void *second, void *data);
 static void	delete_printer_filters(cupsd_printer_t *p);
 static void	dirty_printer(cupsd_printer_t *p);
+static void	free_ppd_loads(void);
 static void	load_ppd(cupsd_printer_t *p);
+static void	preload_ppds(void);
+static void	read_ppd_load(cupsd_ppdload_t *load);
 static ipp_t	*new_media_col(_pwg_size_t *size, const char *source,
 		               const char *type);
+static void	write_ppd_binary(const char *name);
 static void	write_xml_string(cups_file_t *fp, const char *s);
 
 
@@ -128,6 +155,37 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
 }
 
 
+/*
+ * 'cupsdClearPrinterAttrCache()' - Clear the cached printer attributes.
+ *
+ * This must be called before the printer attributes or common data are
+ * changed.
+ */
+
+void
+cupsdClearPrinterAttrCache(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  cupsd_attrcache_t	*cache;		/* Current cache entry */
+
+
+  if (!p->attr_cache)
+    return;
+
+  for (cache = (cupsd_attrcache_t *)cupsArrayFirst(p->attr_cache);
+       cache;
+       cache = (cupsd_attrcache_t *)cupsArrayNext(p->attr_cache))
+  {
+    free(cache->key);
+    ippDelete(cache->attrs);
+    free(cache);
+  }
+
+  cupsArrayDelete(p->attr_cache);
+  p->attr_cache = NULL;
+}
+
+
 /*
  * 'cupsdCreateCommonData()' - Create the common printer data.
  */
@@ -358,7 +416,16 @@ cupsdCreateCommonData(void)
 
 
   if (CommonData)
+  {
+    cupsd_printer_t	*printer;	/* Current printer */
+
+    for (printer = (cupsd_printer_t *)cupsArrayFirst(Printers);
+         printer;
+	 printer = (cupsd_printer_t *)cupsArrayNext(Printers))
+      cupsdClearPrinterAttrCache(printer);
+
     ippDelete(CommonData);
+  }
 
   CommonData = ippNew();
 
@@ -700,6 +767,12 @@ cupsdDeletePrinter(
                      update ? "Job stopped due to printer being deleted." :
 		              "Job stopped.");
 
+ /*
+  * Stop any persistent filters...
+  */
+
+  cupsdStopPersistentProcesses(p, 1);
+
  /*
   * Remove the printer from the list...
   */
@@ -739,6 +812,8 @@ cupsdDeletePrinter(
   for (i = 0; i < p->num_reasons; i ++)
     _cupsStrFree(p->reasons[i]);
 
+  cupsdClearPrinterAttrCache(p);
+
   ippDelete(p->attrs);
   ippDelete(p->ppd_attrs);
 
@@ -842,6 +917,12 @@ cupsdLoadAllPrinters(void)
   if ((fp = cupsdOpenConfFile(line)) == NULL)
     return;
 
+ /*
+  * Read the PPD caches on the worker threads as configured...
+  */
+
+  preload_ppds();
+
  /*
   * Read printer configurations until we hit EOF...
   */
@@ -1231,8 +1312,13 @@ cupsdLoadAllPrinters(void)
       {
         for (; *valueptr && isspace(*valueptr & 255); *valueptr++ = '\0');
 
+       /*
+        * Just collect the attributes here - cupsdSetPrinterAttrs() will copy
+	* them when the printer is closed out...
+	*/
+
         if (!p->attrs)
-	  cupsdSetPrinterAttrs(p);
+	  p->attrs = ippNew();
 
         if (!strcmp(value, "marker-change-time"))
 	  p->marker_time = atoi(valueptr);
@@ -1256,6 +1342,8 @@ cupsdLoadAllPrinters(void)
   }
 
   cupsFileClose(fp);
+
+  free_ppd_loads();
 }
 
 
@@ -1863,6 +1951,8 @@ cupsdSetPrinterAttr(
     return;
   }
 
+  cupsdClearPrinterAttrCache(p);
+
  /*
   * Count the number of values...
   */
@@ -2021,6 +2111,8 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
   DEBUG_printf(("cupsdSetPrinterAttrs: entering name = %s, type = %x\n", p->name,
                 p->type));
 
+  cupsdClearPrinterAttrCache(p);
+
  /*
   * Make sure that we have the common attributes defined...
   */
@@ -3531,6 +3623,22 @@ add_printer_formats(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'compare_ppdloads()' - Compare the printer names of two PPD loads.
+ */
+
+static int				/* O - Result of comparison */
+compare_ppdloads(cupsd_ppdload_t *first,/* I - First PPD load */
+                 cupsd_ppdload_t *second,
+					/* I - Second PPD load */
+		 void            *data)	/* I - Callback data (unused) */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(first->name, second->name));
+}
+
+
 /*
  * 'compare_printers()' - Compare two printers.
  */
@@ -3615,6 +3723,32 @@ dirty_printer(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'free_ppd_loads()' - Free any PPD data that was not used by load_ppd().
+ */
+
+static void
+free_ppd_loads(void)
+{
+  cupsd_ppdload_t	*load;		/* Current PPD load */
+
+
+  for (load = (cupsd_ppdload_t *)cupsArrayFirst(ppd_loads);
+       load;
+       load = (cupsd_ppdload_t *)cupsArrayNext(ppd_loads))
+  {
+    _ppdCacheDestroy(load->pc);
+    ippDelete(load->attrs);
+    ppdClose(load->ppd);
+    free(load->name);
+    free(load);
+  }
+
+  cupsArrayDelete(ppd_loads);
+  ppd_loads = NULL;
+}
+
+
 /*
  * 'load_ppd()' - Load a cached PPD file, updating the cache as needed.
  */
@@ -3646,6 +3780,8 @@ load_ppd(cupsd_printer_t *p)		/* I - Printer */
 		*pwgtype;		/* Current PWG type */
   ipp_attribute_t *attr;		/* Attribute data */
   _ipp_value_t	*val;			/* Attribute value */
+  cupsd_ppdload_t key,			/* Search key for PPD data */
+		*load;			/* PPD data read at startup */
   int		num_finishings,		/* Number of finishings */
 		finishings[5];		/* finishings-supported values */
   int		num_qualities,		/* Number of print-quality values */
@@ -3680,6 +3816,8 @@ load_ppd(cupsd_printer_t *p)		/* I - Printer */
   if (stat(ppd_name, &ppd_info))
     ppd_info.st_mtime = 1;
 
+  write_ppd_binary(p->name);
+
   ippDelete(p->ppd_attrs);
   p->ppd_attrs = NULL;
 
@@ -3688,19 +3826,54 @@ load_ppd(cupsd_printer_t *p)		/* I - Printer */
 
   cupsdClearString(&(p->make_model));
 
-  if (cache_info.st_mtime >= ppd_info.st_mtime)
+ /*
+  * Use the data that was read by preload_ppds(), if any...
+  */
+
+  key.name = p->name;
+
+  if ((load = (cupsd_ppdload_t *)cupsArrayFind(ppd_loads, &key)) != NULL)
   {
-    cupsdLogMessage(CUPSD_LOG_DEBUG, "load_ppd: Loading %s...", cache_name);
+    cupsArrayRemove(ppd_loads, load);
 
-    if ((p->pc = _ppdCacheCreateWithFile(cache_name, &p->ppd_attrs)) != NULL &&
-        p->ppd_attrs)
+    if (load->pc && cache_info.st_mtime >= ppd_info.st_mtime)
     {
-     /*
-      * Loaded successfully!
-      */
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "load_ppd: Loaded %s...", cache_name);
+
+      p->pc        = load->pc;
+      p->ppd_attrs = load->attrs;
 
+      free(load->name);
+      free(load);
       return;
     }
+
+    _ppdCacheDestroy(load->pc);
+    ippDelete(load->attrs);
+    free(load->name);
+
+    ppd = load->ppd;
+
+    free(load);
+  }
+  else
+  {
+    ppd = NULL;
+
+    if (cache_info.st_mtime >= ppd_info.st_mtime)
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "load_ppd: Loading %s...", cache_name);
+
+      if ((p->pc = _ppdCacheCreateWithFile(cache_name, &p->ppd_attrs)) != NULL &&
+	  p->ppd_attrs)
+      {
+       /*
+	* Loaded successfully!
+	*/
+
+	return;
+      }
+    }
   }
 
  /*
@@ -3719,7 +3892,7 @@ load_ppd(cupsd_printer_t *p)		/* I - Printer */
 
   p->ppd_attrs = ippNew();
 
-  if ((ppd = _ppdOpenFile(ppd_name, _PPD_LOCALIZATION_NONE)) != NULL)
+  if (ppd || (ppd = _ppdOpenFile(ppd_name, _PPD_LOCALIZATION_NONE)) != NULL)
   {
    /*
     * Add make/model and other various attributes...
@@ -4897,6 +5070,173 @@ new_media_col(_pwg_size_t *size,	/* I - media-size/margin values */
 }
 
 
+/*
+ * 'preload_ppds()' - Read the PPD caches for all printers using the worker
+ *                    threads.
+ *
+ * The results are used by load_ppd() as each printer is loaded, so printers
+ * are still set up in printers.conf order.  Nothing is done unless worker
+ * threads are configured.
+ */
+
+static void
+preload_ppds(void)
+{
+  cups_dir_t		*dir;		/* PPD directory */
+  cups_dentry_t		*dent;		/* Directory entry */
+  char			ppddir[1024],	/* PPD directory name */
+			*ext;		/* Filename extension */
+  cupsd_ppdload_t	*load;		/* Current PPD load */
+  void			**loads;	/* Array of PPD loads */
+  int			i,		/* Looping var */
+			num_loads;	/* Number of PPD loads */
+
+
+  free_ppd_loads();
+
+  if (WorkerThreads <= 0)
+    return;
+
+  snprintf(ppddir, sizeof(ppddir), "%s/ppd", ServerRoot);
+  if ((dir = cupsDirOpen(ppddir)) == NULL)
+    return;
+
+  ppd_loads = cupsArrayNew((cups_array_func_t)compare_ppdloads, NULL);
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if ((ext = strrchr(dent->filename, '.')) == NULL || strcmp(ext, ".ppd") ||
+        !S_ISREG(dent->fileinfo.st_mode))
+      continue;
+
+    if ((load = calloc(1, sizeof(cupsd_ppdload_t))) == NULL)
+      break;
+
+    if ((load->name = strdup(dent->filename)) == NULL)
+    {
+      free(load);
+      break;
+    }
+
+    load->name[ext - dent->filename] = '\0';
+
+    cupsArrayAdd(ppd_loads, load);
+  }
+
+  cupsDirClose(dir);
+
+  if ((num_loads = cupsArrayCount(ppd_loads)) == 0 ||
+      (loads = calloc((size_t)num_loads, sizeof(void *))) == NULL)
+    return;
+
+  for (i = 0, load = (cupsd_ppdload_t *)cupsArrayFirst(ppd_loads);
+       load;
+       i ++, load = (cupsd_ppdload_t *)cupsArrayNext(ppd_loads))
+    loads[i] = load;
+
+  cupsdRunWork((cupsd_workfunc_t)read_ppd_load, loads, num_loads);
+
+  free(loads);
+}
+
+
+/*
+ * 'read_ppd_load()' - Read the PPD cache or PPD file for a printer.
+ *
+ * This is called from cupsdRunWork(), possibly on another thread, so it must
+ * not log messages or access other scheduler state.
+ */
+
+static void
+read_ppd_load(cupsd_ppdload_t *load)	/* I - PPD load */
+{
+  char		cache_name[1024],	/* Cache filename */
+		ppd_name[1024];		/* PPD filename */
+  struct stat	cache_info,		/* Cache file info */
+		ppd_info;		/* PPD file info */
+
+
+ /*
+  * Use the same checks as load_ppd()...
+  */
+
+  snprintf(cache_name, sizeof(cache_name), "%s/%s.data", CacheDir, load->name);
+  if (stat(cache_name, &cache_info))
+    cache_info.st_mtime = 0;
+
+  snprintf(ppd_name, sizeof(ppd_name), "%s/ppd/%s.ppd", ServerRoot,
+           load->name);
+  if (stat(ppd_name, &ppd_info))
+    ppd_info.st_mtime = 1;
+
+  write_ppd_binary(load->name);
+
+  if (cache_info.st_mtime >= ppd_info.st_mtime)
+  {
+    if ((load->pc = _ppdCacheCreateWithFile(cache_name,
+                                            &load->attrs)) != NULL &&
+        load->attrs)
+      return;
+
+    _ppdCacheDestroy(load->pc);
+    ippDelete(load->attrs);
+
+    load->pc    = NULL;
+    load->attrs = NULL;
+  }
+
+  load->ppd = _ppdOpenFile(ppd_name, _PPD_LOCALIZATION_NONE);
+}
+
+
+/*
+ * 'write_ppd_binary()' - Update the binary PPD file used by filters.
+ *
+ * This is called from read_ppd_load(), possibly on another thread, so it must
+ * not log messages or access other scheduler state.
+ */
+
+static void
+write_ppd_binary(const char *name)	/* I - Printer name */
+{
+  char		bin_name[1024],		/* Binary PPD filename */
+		ppd_name[1024];		/* PPD filename */
+  struct stat	bin_info,		/* Binary PPD file info */
+		ppd_info;		/* PPD file info */
+  ppd_file_t	*ppd;			/* PPD file */
+
+
+  snprintf(bin_name, sizeof(bin_name), "%s/%s.ppdb", CacheDir, name);
+  snprintf(ppd_name, sizeof(ppd_name), "%s/ppd/%s.ppd", ServerRoot, name);
+
+  if (stat(ppd_name, &ppd_info))
+  {
+   /*
+    * No PPD file, remove any old binary file...
+    */
+
+    if (!stat(bin_name, &bin_info))
+      unlink(bin_name);
+
+    return;
+  }
+
+  if (_ppdCheckBinary(ppd_name, bin_name))
+    return;
+
+ /*
+  * Load all localizations so that filters can use the binary file for any
+  * job language...
+  */
+
+  if ((ppd = _ppdOpenFile(ppd_name, _PPD_LOCALIZATION_ALL)) == NULL ||
+      _ppdWriteBinary(ppd, ppd_name, bin_name))
+    unlink(bin_name);
+
+  ppdClose(ppd);
+}
+
+
 /*
  * 'write_xml_string()' - Write a string with XML escaping.
  */
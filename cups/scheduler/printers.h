@@ -51,6 +51,19 @@ typedef AvahiStringList *cupsd_txt_t;	/* TXT record */
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * Cached printer attributes for a requested-attributes list...
+ */
+
+#define CUPSD_ATTR_CACHE_MAX	4	/* Max cached lists per printer */
+
+typedef struct cupsd_attrcache_s
+{
+  char		*key;			/* IPP version and requested attributes */
+  ipp_t		*attrs;			/* Filtered printer attributes */
+} cupsd_attrcache_t;
+
+
 /*
  * Printer/class information structure...
  */
@@ -110,6 +123,7 @@ struct cupsd_printer_s
 		*alert_description;	/* PSX printer-alert-description value */
   time_t	marker_time;		/* Last time marker attributes were updated */
   _ppd_cache_t	*pc;			/* PPD cache and mapping data */
+  cups_array_t	*attr_cache;		/* Cached Get-Printer-Attributes data */
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   char		*reg_name,		/* Name used for service registration */
@@ -149,6 +163,7 @@ VAR cupsd_policy_t	*DefaultPolicyPtr
  */
 
 extern cupsd_printer_t	*cupsdAddPrinter(const char *name);
+extern void		cupsdClearPrinterAttrCache(cupsd_printer_t *p);
 extern void		cupsdCreateCommonData(void);
 extern void		cupsdDeleteAllPrinters(void);
 extern int		cupsdDeletePrinter(cupsd_printer_t *p, int update);
@@ -18,7 +18,9 @@
  */
 
 #include "cupsd.h"
+#include <cups/raster-private.h>
 #include <grp.h>
+#include <sys/socket.h>
 #ifdef __APPLE__
 #  include <libgen.h>
 #endif /* __APPLE__ */
@@ -35,26 +37,114 @@ extern char **environ;
 typedef struct
 {
   int	pid,				/* Process ID */
-	job_id;				/* Job associated with process */
+	job_id,				/* Job associated with process */
+	persist_pid;			/* Persistent filter running process */
   char	name[1];			/* Name of process */
 } cupsd_proc_t;
 
 
+/*
+ * Persistent filter structure...
+ */
+
+typedef struct
+{
+  char		*printer,		/* Printer name */
+		*command;		/* Full path to filter */
+  int		pid,			/* Process ID and process group */
+		fd,			/* Control socket */
+		spare,			/* Process for the next job or 0 */
+		started,		/* Did the filter report a process? */
+		killed;			/* Was SIGKILL sent? */
+  void		*profile;		/* Security profile */
+  time_t	command_time,		/* Modification time of filter */
+		ppd_time,		/* Modification time of PPD file */
+		kill_time;		/* Time to kill a stopped filter */
+} cupsd_persist_t;
+
+
 /*
  * Local globals...
  */
 
-static cups_array_t	*process_array = NULL;
+static cups_array_t	*process_array = NULL,
+			*persist_array = NULL,
+			*persist_exits = NULL,
+			*persist_failed = NULL,
+			*persist_stopped = NULL;
 
 
 /*
  * Local functions...
  */
 
+static void	add_process(int pid, const char *command, cupsd_job_t *job,
+		            int persist_pid);
+static int	compare_persist(cupsd_persist_t *a, cupsd_persist_t *b);
 static int	compare_procs(cupsd_proc_t *a, cupsd_proc_t *b);
 #ifdef HAVE_SANDBOX_H
 static char	*cupsd_requote(char *dst, const char *src, size_t dstsize);
 #endif /* HAVE_SANDBOX_H */
+static void	persist_exited(int pid, int status);
+static void	persist_free(cupsd_persist_t *pf);
+static void	persist_read(cupsd_persist_t *pf);
+static int	persist_send(cupsd_persist_t *pf, char *argv[], char *envp[],
+		             int fds[5], void *profile);
+static cupsd_persist_t *persist_start(const char *command, char *argv[],
+		                      char *envp[], cupsd_job_t *job);
+static void	persist_stat(const char *command, char *envp[],
+		             time_t *command_time, time_t *ppd_time);
+static void	persist_stop(cupsd_persist_t *pf, int force);
+
+
+/*
+ * 'cupsdCheckPersistentProcesses()' - Kill persistent filters that did not
+ *                                     stop in time.
+ */
+
+void
+cupsdCheckPersistentProcesses(void)
+{
+  cupsd_persist_t	*pf;		/* Current persistent filter */
+  time_t		curtime;	/* Current time */
+
+
+  curtime = time(NULL);
+
+  for (pf = (cupsd_persist_t *)cupsArrayFirst(persist_stopped);
+       pf;
+       pf = (cupsd_persist_t *)cupsArrayNext(persist_stopped))
+  {
+    if (pf->fd >= 0)
+      continue;				/* Still finishing jobs */
+
+    if (!kill(-pf->pid, 0))
+    {
+     /*
+      * Some processes in the filter's process group are still running (or
+      * have not been reaped yet); check again every second after killing
+      * them...
+      */
+
+      if (pf->kill_time > curtime)
+        continue;
+
+      if (!pf->killed)
+        cupsdLogMessage(CUPSD_LOG_WARN,
+                        "Killing persistent filter %s (PID %d) for printer "
+			"%s.", pf->command, pf->pid, pf->printer);
+
+      kill(-pf->pid, SIGKILL);
+
+      pf->killed    = 1;
+      pf->kill_time = curtime + 1;
+      continue;
+    }
+
+    cupsArrayRemove(persist_stopped, pf);
+    persist_free(pf);
+  }
+}
 
 
 /*
@@ -375,17 +465,26 @@ int					/* O - 0 on success, -1 on failure */
 cupsdEndProcess(int pid,		/* I - Process ID */
                 int force)		/* I - Force child to die */
 {
+  cupsd_proc_t	key,			/* Search key */
+		*proc;			/* Matching process */
+
+
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdEndProcess(pid=%d, force=%d)", pid,
                   force);
 
   if (!pid)
     return (0);
 
-  if (!RunUser)
+  key.pid = pid;
+
+  if (!RunUser &&
+      ((proc = (cupsd_proc_t *)cupsArrayFind(process_array, &key)) == NULL ||
+       !proc->persist_pid))
   {
    /*
     * When running as root, cupsd puts child processes in their own process
     * group.  Using "-pid" sends a signal to all processes in the group.
+    * Processes run by a persistent filter share the filter's group instead.
     */
 
     pid = -pid;
@@ -437,6 +536,122 @@ cupsdFinishProcess(int    pid,		/* I - Process ID */
 }
 
 
+/*
+ * 'cupsdGetPersistentKillTime()' - Get the time to kill stopped persistent
+ *                                  filters.
+ */
+
+time_t					/* O - Kill time or 0 for none */
+cupsdGetPersistentKillTime(void)
+{
+  cupsd_persist_t	*pf;		/* Current persistent filter */
+  time_t		kill_time = 0;	/* Earliest kill time */
+
+
+  for (pf = (cupsd_persist_t *)cupsArrayFirst(persist_stopped);
+       pf;
+       pf = (cupsd_persist_t *)cupsArrayNext(persist_stopped))
+    if (pf->fd < 0 && (!kill_time || pf->kill_time < kill_time))
+      kill_time = pf->kill_time;
+
+  return (kill_time);
+}
+
+
+/*
+ * 'cupsdStartPersistentProcess()' - Start a filter using a persistent filter.
+ *
+ * The job is sent to the process that the persistent filter for the job's
+ * printer has forked ahead of time.  0 is returned when the filter cannot be
+ * run this way, in which case cupsdStartProcess() should be used instead;
+ * this is also the case while a new persistent filter is starting or has not
+ * yet reported the process for the next job, and when the filter exited
+ * without reporting a process (e.g. because it does not support the
+ * "--persistent" option) until the filter or PPD file changes.
+ */
+
+int					/* O - Process ID or 0 */
+cupsdStartPersistentProcess(
+    const char  *command,		/* I - Full path to command */
+    char        *argv[],		/* I - Command-line arguments */
+    char        *envp[],		/* I - Environment */
+    int         infd,			/* I - Standard input file descriptor */
+    int         outfd,			/* I - Standard output file descriptor */
+    int         errfd,			/* I - Standard error file descriptor */
+    int         backfd,			/* I - Backchannel file descriptor */
+    int         sidefd,			/* I - Sidechannel file descriptor */
+    void        *profile,		/* I - Security profile to use */
+    cupsd_job_t *job,			/* I - Job associated with process */
+    int         *pid)			/* O - Process ID */
+{
+  cupsd_persist_t	key,		/* Search key */
+			*pf;		/* Persistent filter */
+  int			fds[5];		/* Job file descriptors */
+
+
+  *pid = 0;
+
+  key.printer = job->printer->name;
+  key.command = (char *)command;
+
+  if ((pf = (cupsd_persist_t *)cupsArrayFind(persist_array, &key)) == NULL)
+  {
+    if ((pf = (cupsd_persist_t *)cupsArrayFind(persist_failed, &key)) != NULL)
+    {
+      time_t	command_time,		/* Modification time of filter */
+		ppd_time;		/* Modification time of PPD file */
+
+      persist_stat(command, envp, &command_time, &ppd_time);
+
+      if (command_time == pf->command_time && ppd_time == pf->ppd_time)
+        return (0);
+
+      cupsArrayRemove(persist_failed, pf);
+      persist_free(pf);
+    }
+
+    persist_start(command, argv, envp, job);
+    return (0);
+  }
+
+  if (!pf->spare)
+    return (0);
+
+  fds[0] = infd;
+  fds[1] = outfd;
+  fds[2] = errfd;
+  fds[3] = backfd;
+  fds[4] = sidefd;
+
+  if (persist_send(pf, argv, envp, fds, profile))
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR,
+                "Unable to send job to persistent filter %s (PID %d) - %s.",
+		command, pf->pid, strerror(errno));
+    persist_stop(pf, 1);
+    return (0);
+  }
+
+ /*
+  * The waiting process runs the job; persist_read() gets the next one...
+  */
+
+  *pid      = pf->spare;
+  pf->spare = 0;
+
+  add_process(*pid, command, job, pf->pid);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+		  "cupsdStartPersistentProcess(command=\"%s\", argv=%p, "
+		  "envp=%p, infd=%d, outfd=%d, errfd=%d, backfd=%d, sidefd=%d, "
+		  "profile=%p, job=%p(%d), pid=%p) = %d",
+		  command, argv, envp, infd, outfd, errfd, backfd, sidefd,
+		  profile, job, job->id, pid, *pid);
+
+  return (*pid);
+}
+
+
 /*
  * 'cupsdStartProcess()' - Start a process.
  */
@@ -461,7 +676,6 @@ cupsdStartProcess(
   char		*real_argv[110],	/* Real command-line arguments */
 		cups_exec[1024];	/* Path to "cups-exec" program */
   uid_t		user;			/* Command UID */
-  cupsd_proc_t	*proc;			/* New process record */
 #ifdef HAVE_POSIX_SPAWN
   posix_spawn_file_actions_t actions;	/* Spawn file actions */
   posix_spawnattr_t attrs;		/* Spawn attributes */
@@ -791,22 +1005,7 @@ cupsdStartProcess(
 #endif /* HAVE_POSIX_SPAWN */
 
   if (*pid)
-  {
-    if (!process_array)
-      process_array = cupsArrayNew((cups_array_func_t)compare_procs, NULL);
-
-    if (process_array)
-    {
-      if ((proc = calloc(1, sizeof(cupsd_proc_t) + strlen(command))) != NULL)
-      {
-        proc->pid    = *pid;
-	proc->job_id = job ? job->id : 0;
-	_cups_strcpy(proc->name, command);
-
-	cupsArrayAdd(process_array, proc);
-      }
-    }
-  }
+    add_process(*pid, command, job, 0);
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
 		  "cupsdStartProcess(command=\"%s\", argv=%p, envp=%p, "
@@ -819,6 +1018,121 @@ cupsdStartProcess(
 }
 
 
+/*
+ * 'cupsdStopPersistentProcesses()' - Stop persistent filters.
+ *
+ * When "force" is 0, filters that are running jobs are only told to stop
+ * once their current jobs are done; otherwise they are stopped right away
+ * and their jobs fail.
+ */
+
+void
+cupsdStopPersistentProcesses(
+    cupsd_printer_t *p,			/* I - Printer or NULL for all */
+    int             force)		/* I - Stop running jobs too? */
+{
+  cupsd_persist_t	*pf;		/* Current persistent filter */
+
+
+  for (pf = (cupsd_persist_t *)cupsArrayFirst(persist_array);
+       pf;
+       pf = (cupsd_persist_t *)cupsArrayNext(persist_array))
+    if (!p || !strcmp(pf->printer, p->name))
+      persist_stop(pf, force);
+
+  if (force)
+  {
+   /*
+    * Forget about filters that failed to start for the printer(s)...
+    */
+
+    for (pf = (cupsd_persist_t *)cupsArrayFirst(persist_failed);
+	 pf;
+	 pf = (cupsd_persist_t *)cupsArrayNext(persist_failed))
+      if (!p || !strcmp(pf->printer, p->name))
+      {
+        cupsArrayRemove(persist_failed, pf);
+	persist_free(pf);
+      }
+  }
+}
+
+
+/*
+ * 'cupsdWaitPersistentProcess()' - Get the exit status of a process that was
+ *                                  run by a persistent filter.
+ */
+
+int					/* O - Process ID or 0 if none */
+cupsdWaitPersistentProcess(int *status)	/* O - Exit status */
+{
+  _cups_persist_msg_t	*msg;		/* Queued exit status */
+  int			pid;		/* Process ID */
+
+
+  if ((msg = (_cups_persist_msg_t *)cupsArrayFirst(persist_exits)) == NULL)
+    return (0);
+
+  cupsArrayRemove(persist_exits, msg);
+
+  pid     = msg->pid;
+  *status = msg->status;
+
+  free(msg);
+
+  return (pid);
+}
+
+
+/*
+ * 'add_process()' - Add a process to the process array.
+ */
+
+static void
+add_process(int         pid,		/* I - Process ID */
+            const char  *command,	/* I - Full path to command */
+            cupsd_job_t *job,		/* I - Job associated with process */
+	    int         persist_pid)	/* I - Persistent filter or 0 */
+{
+  cupsd_proc_t	*proc;			/* New process record */
+
+
+  if (!process_array)
+    process_array = cupsArrayNew((cups_array_func_t)compare_procs, NULL);
+
+  if (process_array)
+  {
+    if ((proc = calloc(1, sizeof(cupsd_proc_t) + strlen(command))) != NULL)
+    {
+      proc->pid         = pid;
+      proc->job_id      = job ? job->id : 0;
+      proc->persist_pid = persist_pid;
+      _cups_strcpy(proc->name, command);
+
+      cupsArrayAdd(process_array, proc);
+    }
+  }
+}
+
+
+/*
+ * 'compare_persist()' - Compare two persistent filters.
+ */
+
+static int				/* O - Result of comparison */
+compare_persist(cupsd_persist_t *a,	/* I - First filter */
+                cupsd_persist_t *b)	/* I - Second filter */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->printer, b->printer)) == 0)
+    result = strcmp(a->command, b->command);
+
+  return (result);
+}
+
+
 /*
  * 'compare_procs()' - Compare two processes.
  */
@@ -868,6 +1182,472 @@ cupsd_requote(char       *dst,		/* I - Destination buffer */
 }
 #endif /* HAVE_SANDBOX_H */
 
+/*
+ * 'persist_exited()' - Queue the exit status of a persistent filter process.
+ */
+
+static void
+persist_exited(int pid,			/* I - Process ID */
+               int status)		/* I - Exit status */
+{
+  _cups_persist_msg_t	*msg;		/* Queued exit status */
+
+
+  if (!persist_exits)
+    persist_exits = cupsArrayNew(NULL, NULL);
+
+  if ((msg = calloc(1, sizeof(_cups_persist_msg_t))) != NULL)
+  {
+    msg->type   = _CUPS_PERSIST_EXITED;
+    msg->pid    = pid;
+    msg->status = status;
+
+    cupsArrayAdd(persist_exits, msg);
+  }
+
+  cupsdCheckProcess();
+}
+
+
+/*
+ * 'persist_free()' - Free a persistent filter.
+ */
+
+static void
+persist_free(cupsd_persist_t *pf)	/* I - Persistent filter */
+{
+  cupsdDestroyProfile(pf->profile);
+  cupsdClearString(&pf->printer);
+  cupsdClearString(&pf->command);
+  free(pf);
+}
+
+
+/*
+ * 'persist_read()' - Read a message from a persistent filter.
+ */
+
+static void
+persist_read(cupsd_persist_t *pf)	/* I - Persistent filter */
+{
+  _cups_persist_msg_t	msg;		/* Message from filter */
+
+
+  if (recv(pf->fd, &msg, sizeof(msg), MSG_WAITALL) != sizeof(msg))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Persistent filter %s (PID %d) for printer %s closed "
+		    "its connection.", pf->command, pf->pid, pf->printer);
+
+    if (!pf->started)
+    {
+     /*
+      * The filter never got ready, so don't try it again until the filter
+      * or PPD file changes...
+      */
+
+      cupsd_persist_t	*failed;	/* Failed filter */
+
+      cupsdLogMessage(CUPSD_LOG_WARN,
+                      "Persistent filter %s for printer %s did not start; "
+		      "running it once per job.", pf->command, pf->printer);
+
+      if (!persist_failed)
+        persist_failed = cupsArrayNew((cups_array_func_t)compare_persist,
+	                              NULL);
+
+      if ((failed = calloc(1, sizeof(cupsd_persist_t))) != NULL)
+      {
+	cupsdSetString(&failed->printer, pf->printer);
+	cupsdSetString(&failed->command, pf->command);
+	failed->fd           = -1;
+	failed->command_time = pf->command_time;
+	failed->ppd_time     = pf->ppd_time;
+
+        if (!cupsArrayAdd(persist_failed, failed))
+	  persist_free(failed);
+      }
+    }
+
+    persist_stop(pf, 1);
+  }
+  else if (msg.type == _CUPS_PERSIST_STARTED)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "Persistent filter %s (PID %d) for printer %s is ready "
+		    "(PID %d).", pf->command, pf->pid, pf->printer, msg.pid);
+
+    pf->spare   = msg.pid;
+    pf->started = 1;
+  }
+  else if (msg.type == _CUPS_PERSIST_EXITED)
+  {
+    if (msg.pid == pf->spare)
+      pf->spare = 0;
+
+    persist_exited(msg.pid, msg.status);
+  }
+}
+
+
+/*
+ * 'persist_send()' - Send a job request to a persistent filter.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+persist_send(cupsd_persist_t *pf,	/* I - Persistent filter */
+             char            *argv[],	/* I - Command-line arguments */
+             char            *envp[],	/* I - Environment */
+             int             fds[5],	/* I - Job file descriptors */
+             void            *profile)	/* I - Security profile or NULL */
+{
+  _cups_persist_req_t	req;		/* Request header */
+  const char		*pstr;		/* Security profile string */
+  char			*buffer,	/* Request buffer */
+			*bufptr,	/* Pointer into buffer */
+			*bufend;	/* End of buffer */
+  size_t		length;		/* Length of request */
+  ssize_t		bytes;		/* Bytes sent */
+  int			i,		/* Looping var */
+			sendfds[5],	/* Descriptors to send */
+			num_sendfds = 0;/* Number of descriptors */
+  struct msghdr		msg;		/* Socket message */
+  struct iovec		iov;		/* I/O vector */
+  struct cmsghdr	*cmsg;		/* Control message */
+  union
+  {
+    struct cmsghdr	hdr;		/* Alignment */
+    char		buf[CMSG_SPACE(5 * sizeof(int))];
+					/* Control buffer */
+  }			control;	/* Control data */
+
+
+ /*
+  * Build the request...
+  */
+
+  pstr = profile ? (const char *)profile : "";
+
+  memset(&req, 0, sizeof(req));
+
+  length = strlen(pstr) + 1;
+
+  for (i = 0; argv[i]; i ++)
+    length += strlen(argv[i]) + 1;
+
+  req.argc = i;
+
+  for (i = 0; envp[i]; i ++)
+    length += strlen(envp[i]) + 1;
+
+  req.envc = i;
+
+  if (length > _CUPS_PERSIST_MAX)
+  {
+    errno = E2BIG;
+    return (-1);
+  }
+
+  req.length = (int)length;
+
+  for (i = 0; i < 5; i ++)
+    if (fds[i] >= 0)
+    {
+      req.fds |= 1 << i;
+      sendfds[num_sendfds ++] = fds[i];
+    }
+
+  if ((buffer = malloc(sizeof(req) + length)) == NULL)
+    return (-1);
+
+  memcpy(buffer, &req, sizeof(req));
+
+  bufptr = buffer + sizeof(req);
+  length = strlen(pstr) + 1;
+  memcpy(bufptr, pstr, length);
+  bufptr += length;
+
+  for (i = 0; argv[i]; i ++, bufptr += length)
+  {
+    length = strlen(argv[i]) + 1;
+    memcpy(bufptr, argv[i], length);
+  }
+
+  for (i = 0; envp[i]; i ++, bufptr += length)
+  {
+    length = strlen(envp[i]) + 1;
+    memcpy(bufptr, envp[i], length);
+  }
+
+ /*
+  * Send it with the job's file descriptors...
+  */
+
+  bufend = bufptr;
+
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base   = buffer;
+  iov.iov_len    = (size_t)(bufend - buffer);
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+
+  if (num_sendfds > 0)
+  {
+    memset(&control, 0, sizeof(control));
+
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = CMSG_SPACE((size_t)num_sendfds * sizeof(int));
+
+    cmsg             = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN((size_t)num_sendfds * sizeof(int));
+
+    memcpy(CMSG_DATA(cmsg), sendfds, (size_t)num_sendfds * sizeof(int));
+  }
+
+  while ((bytes = sendmsg(pf->fd, &msg, 0)) < 0 && errno == EINTR);
+
+  if (bytes > 0)
+  {
+    for (bufptr = buffer + bytes; bufptr < bufend; bufptr += bytes)
+      if ((bytes = send(pf->fd, bufptr, (size_t)(bufend - bufptr), 0)) < 0)
+      {
+        if (errno != EINTR)
+          break;
+
+        bytes = 0;
+      }
+  }
+
+  free(buffer);
+
+  return (bytes < 0 ? -1 : 0);
+}
+
+
+/*
+ * 'persist_start()' - Start a persistent filter for a printer.
+ */
+
+static cupsd_persist_t *		/* O - Persistent filter or NULL */
+persist_start(const char  *command,	/* I - Full path to command */
+              char        *argv[],	/* I - Command-line arguments */
+              char        *envp[],	/* I - Environment */
+              cupsd_job_t *job)		/* I - Job */
+{
+  cupsd_persist_t	*pf;		/* New persistent filter */
+  int			fds[2],		/* Control socket pair */
+			pid,		/* Process ID */
+			i,		/* Looping var */
+			envc;		/* Number of environment strings */
+  char			*pargv[3],	/* Filter arguments */
+			*penvp[100];	/* Filter environment */
+  void			*profile;	/* Security profile */
+
+
+  if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR,
+                "Unable to create persistent filter socket - %s.",
+		strerror(errno));
+    return (NULL);
+  }
+
+  fcntl(fds[0], F_SETFD, fcntl(fds[0], F_GETFD) | FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, fcntl(fds[1], F_GETFD) | FD_CLOEXEC);
+
+ /*
+  * The filter gets the job's environment minus any authentication
+  * information; each job process gets the full environment of its job...
+  */
+
+  pargv[0] = argv[0];
+  pargv[1] = (char *)"--persistent";
+  pargv[2] = NULL;
+
+  for (i = 0, envc = 0;
+       envp[i] && envc < (int)(sizeof(penvp) / sizeof(penvp[0]) - 1);
+       i ++)
+    if (strncmp(envp[i], "AUTH_", 5))
+      penvp[envc ++] = envp[i];
+
+  penvp[envc] = NULL;
+
+  profile = cupsdCreateProfile(0, 0);
+
+  if (!cupsdStartProcess(command, pargv, penvp, fds[1], -1, -1, -1, -1, 0,
+                         profile, NULL, &pid))
+  {
+    cupsdDestroyProfile(profile);
+    close(fds[0]);
+    close(fds[1]);
+    return (NULL);
+  }
+
+  close(fds[1]);
+
+  if ((pf = calloc(1, sizeof(cupsd_persist_t))) == NULL)
+  {
+    cupsdDestroyProfile(profile);
+    close(fds[0]);
+    cupsdEndProcess(pid, 1);
+    return (NULL);
+  }
+
+  cupsdSetString(&pf->printer, job->printer->name);
+  cupsdSetString(&pf->command, command);
+  pf->pid     = pid;
+  pf->fd      = fds[0];
+  pf->profile = profile;
+
+  persist_stat(command, envp, &pf->command_time, &pf->ppd_time);
+
+  if (!persist_array)
+    persist_array = cupsArrayNew((cups_array_func_t)compare_persist, NULL);
+
+  cupsArrayAdd(persist_array, pf);
+
+  cupsdAddSelect(pf->fd, (cupsd_selfunc_t)persist_read, NULL, pf);
+
+  cupsdLogJob(job, CUPSD_LOG_INFO, "Started persistent filter %s (PID %d)",
+              command, pid);
+
+  return (pf);
+}
+
+
+/*
+ * 'persist_stat()' - Get the modification times of a filter and its PPD file.
+ */
+
+static void
+persist_stat(const char *command,	/* I - Full path to command */
+             char       *envp[],	/* I - Environment */
+	     time_t     *command_time,	/* O - Modification time of filter */
+	     time_t     *ppd_time)	/* O - Modification time of PPD file */
+{
+  int		i;			/* Looping var */
+  struct stat	fileinfo;		/* File information */
+
+
+  *command_time = stat(command, &fileinfo) ? 0 : fileinfo.st_mtime;
+  *ppd_time     = 0;
+
+  for (i = 0; envp[i]; i ++)
+    if (!strncmp(envp[i], "PPD=", 4))
+    {
+      if (!stat(envp[i] + 4, &fileinfo))
+        *ppd_time = fileinfo.st_mtime;
+      break;
+    }
+}
+
+
+/*
+ * 'persist_stop()' - Stop a persistent filter.
+ *
+ * A filter that is running jobs and is not forced to stop gets its connection
+ * shut down for writing; the spare process then exits and the filter exits
+ * after reporting the exit status of its remaining jobs.
+ */
+
+static void
+persist_stop(cupsd_persist_t *pf,	/* I - Persistent filter */
+             int             force)	/* I - Stop running jobs too? */
+{
+  cupsd_proc_t		*proc;		/* Current process */
+  _cups_persist_msg_t	*msg;		/* Queued exit status */
+  int			busy = 0;	/* Number of running jobs */
+
+
+  cupsArrayRemove(persist_array, pf);
+
+  if (!persist_stopped)
+    persist_stopped = cupsArrayNew(NULL, NULL);
+
+  if (!cupsArrayFind(persist_stopped, pf) && !cupsArrayAdd(persist_stopped, pf))
+    force = 1;				/* Can't wait for it to finish */
+
+ /*
+  * See which job processes are still running; nothing else will report their
+  * exit status once the connection is closed...
+  */
+
+  for (proc = (cupsd_proc_t *)cupsArrayFirst(process_array);
+       proc;
+       proc = (cupsd_proc_t *)cupsArrayNext(process_array))
+  {
+    if (proc->persist_pid != pf->pid)
+      continue;
+
+    for (msg = (_cups_persist_msg_t *)cupsArrayFirst(persist_exits);
+         msg;
+	 msg = (_cups_persist_msg_t *)cupsArrayNext(persist_exits))
+      if (msg->pid == proc->pid)
+        break;
+
+    if (msg)
+      continue;
+
+    if (!force)
+    {
+      busy ++;
+      continue;
+    }
+
+   /*
+    * Report it as failed (exit status 1)...
+    */
+
+    proc->persist_pid = 0;
+
+    persist_exited(proc->pid, 1 << 8);
+  }
+
+  pf->spare = 0;
+
+  if (busy)
+  {
+   /*
+    * Let the filter finish its current jobs; persist_read() stops it for
+    * good when it closes its end of the connection...
+    */
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Stopping persistent filter %s (PID %d) for printer %s "
+		    "after %d job(s).", pf->command, pf->pid, pf->printer,
+		    busy);
+
+    shutdown(pf->fd, SHUT_WR);
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG,
+                  "Stopping persistent filter %s (PID %d) for printer %s.",
+		  pf->command, pf->pid, pf->printer);
+
+  cupsdRemoveSelect(pf->fd);
+  close(pf->fd);
+
+  pf->fd = -1;
+
+ /*
+  * The filter and the processes it forked share a process group; ask them
+  * to stop now and kill them after JobKillDelay seconds (see
+  * cupsdCheckPersistentProcesses)...
+  */
+
+  if (kill(-pf->pid, SIGTERM))
+    kill(pf->pid, SIGTERM);
+
+  pf->kill_time = time(NULL) + JobKillDelay;
+
+  if (!cupsArrayFind(persist_stopped, pf))
+    persist_free(pf);
+}
+
+
 
 /*
  * End of "$Id: process.c 12104 2014-08-20 15:23:40Z msweet $".
@@ -107,16 +107,22 @@
  *         a. cupsdStartSelect() creates epoll file descriptor using
  *            epoll_create() with the maximum fd count, and
  *            allocates an events buffer for the maximum fd count.
- *         b. cupsdAdd/RemoveSelect() uses epoll_ctl() to add
- *            (EPOLL_CTL_ADD) or remove (EPOLL_CTL_DEL) a single
- *            event using the level-triggered semantics. The event
- *            user data field is a pointer to the new callback array
- *            element.
- *         c. cupsdDoSelect() uses epoll_wait() with the global event
- *            buffer allocated in cupsdStartSelect() and then loops
- *            through the events, using the user data field to find
- *            the callback record.
- *         d. cupsdStopSelect() closes the epoll file descriptor and
+ *         b. cupsdAddSelect() queues the callback element on a
+ *            change list instead of calling epoll_ctl() directly;
+ *            repeated changes to the same fd within one loop
+ *            iteration are coalesced.
+ *         c. cupsdRemoveSelect() uses epoll_ctl() to remove
+ *            (EPOLL_CTL_DEL) a registered fd right away since the
+ *            fd may be closed and reused before the next loop; fds
+ *            that were added and removed in the same iteration never
+ *            reach the kernel.
+ *         d. cupsdDoSelect() applies the change list, skipping fds
+ *            whose event mask did not change, and then uses
+ *            epoll_wait() with the global event buffer allocated in
+ *            cupsdStartSelect().  Events use level-triggered
+ *            semantics and the event user data field is a pointer
+ *            to the callback record, so no lookups are needed.
+ *         e. cupsdStopSelect() closes the epoll file descriptor and
  *            frees all of the memory used by the event buffer.
  *
  *     4. kqueue() - O(n)
@@ -164,6 +170,13 @@
  *   cupsdRemoveSelect(), however extreme care will be needed to avoid
  *   excess CPU usage and deadlock conditions.
  *
+ *   The epoll() implementation now defers and coalesces changes, which
+ *   removes the epoll_ctl() calls for the common case of a client that
+ *   is re-added with the same callbacks for each request.  Edge-triggered
+ *   events are not used because the client and job callbacks only
+ *   consume part of the available data on each call and rely on being
+ *   called again while data remains.
+ *
  *   We may be able to improve the poll() implementation simply by
  *   keeping the pollfd array sync'd with the _cupsd_fd_t array, as that
  *   will eliminate the rebuilding of the array whenever there is a
@@ -187,6 +200,10 @@ typedef struct _cupsd_fd_s
   cupsd_selfunc_t	read_cb,	/* Read callback */
 			write_cb;	/* Write callback */
   void			*data;		/* Data pointer for callbacks */
+#ifdef HAVE_EPOLL
+  int			epoll_events,	/* Events registered with epoll or -1 */
+			epoll_queued;	/* Queued on change list? */
+#endif /* HAVE_EPOLL */
 } _cupsd_fd_t;
 
 
@@ -211,6 +228,7 @@ static struct pollfd	*cupsd_pollfds = NULL;
 #  ifdef HAVE_EPOLL
 static int		cupsd_epoll_fd = -1;
 static struct epoll_event *cupsd_epoll_events = NULL;
+static cups_array_t	*cupsd_epoll_changes = NULL;
 #  endif /* HAVE_EPOLL */
 #else /* select() */
 static fd_set		cupsd_global_input,
@@ -226,6 +244,9 @@ static fd_set		cupsd_global_input,
 
 static int		compare_fds(_cupsd_fd_t *a, _cupsd_fd_t *b);
 static _cupsd_fd_t	*find_fd(int fd);
+#ifdef HAVE_EPOLL
+static void		update_epoll(void);
+#endif /* HAVE_EPOLL */
 #define			release_fd(f) { \
 			  (f)->use --; \
 			  if (!(f)->use) free((f));\
@@ -244,9 +265,6 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 	       void            *data)	/* I - Data to pass to callback */
 {
   _cupsd_fd_t	*fdptr;			/* File descriptor record */
-#ifdef HAVE_EPOLL
-  int		added;			/* 1 if added, 0 if modified */
-#endif /* HAVE_EPOLL */
 
 
  /*
@@ -275,6 +293,9 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 
     fdptr->fd  = fd;
     fdptr->use = 1;
+#ifdef HAVE_EPOLL
+    fdptr->epoll_events = -1;
+#endif /* HAVE_EPOLL */
 
     if (!cupsArrayAdd(cupsd_fds, fdptr))
     {
@@ -282,15 +303,7 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
       free(fdptr);
       return (0);
     }
-
-#ifdef HAVE_EPOLL
-    added = 1;
-  }
-  else
-    added = 0;
-#else
   }
-#endif /* HAVE_EPOLL */
 
 #ifdef HAVE_KQUEUE
   {
@@ -336,25 +349,25 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 #  ifdef HAVE_EPOLL
   if (cupsd_epoll_fd >= 0)
   {
-    struct epoll_event event;		/* Event data */
-
-
-    event.events = 0;
-
-    if (read_cb)
-      event.events |= EPOLLIN;
-
-    if (write_cb)
-      event.events |= EPOLLOUT;
-
-    event.data.ptr = fdptr;
+   /*
+    * Queue the change for the next call to cupsdDoSelect()...
+    */
 
-    if (epoll_ctl(cupsd_epoll_fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd,
-                  &event))
+    if (!fdptr->epoll_queued)
     {
-      close(cupsd_epoll_fd);
-      cupsd_epoll_fd       = -1;
-      cupsd_update_pollfds = 1;
+      if (cupsArrayAdd(cupsd_epoll_changes, fdptr))
+      {
+        retain_fd(fdptr);
+	fdptr->epoll_queued = 1;
+      }
+      else
+      {
+        cupsdLogMessage(CUPSD_LOG_EMERG, "Unable to queue fd %d for epoll!",
+	                fd);
+        close(cupsd_epoll_fd);
+	cupsd_epoll_fd       = -1;
+	cupsd_update_pollfds = 1;
+      }
     }
   }
   else
@@ -454,6 +467,9 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 #  ifdef HAVE_EPOLL
   cupsd_in_select = 1;
 
+  if (cupsd_epoll_fd >= 0)
+    update_epoll();
+
   if (cupsd_epoll_fd >= 0)
   {
     int			i;		/* Looping var */
@@ -477,8 +493,8 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
       {
 	fdptr = (_cupsd_fd_t *)event->data.ptr;
 
-	if (cupsArrayFind(cupsd_inactive_fds, fdptr))
-	  continue;
+        if (fdptr->epoll_events < 0)
+	  continue;			/* Removed by an earlier callback */
 
 	retain_fd(fdptr);
 
@@ -487,7 +503,7 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 
 	if (fdptr->use > 1 && fdptr->write_cb &&
             (event->events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
-            !cupsArrayFind(cupsd_inactive_fds, fdptr))
+            fdptr->epoll_events >= 0)
 	  (*(fdptr->write_cb))(fdptr->data);
 
 	release_fd(fdptr);
@@ -719,13 +735,19 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
     return;
 
 #ifdef HAVE_EPOLL
-  if (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_DEL, fd, &event))
+  if (fdptr->epoll_events >= 0 && cupsd_epoll_fd >= 0 &&
+      epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_DEL, fd, &event))
   {
     close(cupsd_epoll_fd);
     cupsd_epoll_fd       = -1;
-    cupsd_update_pollfds = 1;
   }
 
+  fdptr->epoll_events  = -1;
+  fdptr->epoll_queued  = 0;
+  fdptr->read_cb       = NULL;
+  fdptr->write_cb      = NULL;
+  cupsd_update_pollfds = 1;
+
 #elif defined(HAVE_KQUEUE)
   timeout.tv_sec  = 0;
   timeout.tv_nsec = 0;
@@ -807,6 +829,7 @@ cupsdStartSelect(void)
 #ifdef HAVE_EPOLL
   cupsd_epoll_fd       = epoll_create(MaxFDs);
   cupsd_epoll_events   = calloc((size_t)MaxFDs, sizeof(struct epoll_event));
+  cupsd_epoll_changes  = cupsArrayNew(NULL, NULL);
   cupsd_update_pollfds = 0;
 
 #elif defined(HAVE_KQUEUE)
@@ -836,6 +859,20 @@ cupsdStopSelect(void)
 
   cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStopSelect()");
 
+#ifdef HAVE_EPOLL
+ /*
+  * Drop the references held by the epoll change list...
+  */
+
+  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_epoll_changes);
+       fdptr;
+       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_epoll_changes))
+    release_fd(fdptr);
+
+  cupsArrayDelete(cupsd_epoll_changes);
+  cupsd_epoll_changes = NULL;
+#endif /* HAVE_EPOLL */
+
   for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
        fdptr;
        fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
@@ -929,6 +966,62 @@ find_fd(int fd)				/* I - File descriptor */
 }
 
 
+#ifdef HAVE_EPOLL
+/*
+ * 'update_epoll()' - Apply queued changes to the epoll interest set.
+ */
+
+static void
+update_epoll(void)
+{
+  _cupsd_fd_t		*fdptr;		/* Current file descriptor */
+  struct epoll_event	event;		/* Event data */
+
+
+  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_epoll_changes);
+       fdptr;
+       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_epoll_changes))
+  {
+    if (fdptr->epoll_queued && cupsd_epoll_fd >= 0)
+    {
+     /*
+      * Only tell the kernel about changes to the event mask...
+      */
+
+      event.events = 0;
+
+      if (fdptr->read_cb)
+	event.events |= EPOLLIN;
+
+      if (fdptr->write_cb)
+	event.events |= EPOLLOUT;
+
+      if ((int)event.events != fdptr->epoll_events)
+      {
+	event.data.ptr = fdptr;
+
+	if (epoll_ctl(cupsd_epoll_fd,
+	              fdptr->epoll_events < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+	              fdptr->fd, &event))
+	{
+	  close(cupsd_epoll_fd);
+	  cupsd_epoll_fd       = -1;
+	  cupsd_update_pollfds = 1;
+	}
+	else
+	  fdptr->epoll_events = (int)event.events;
+      }
+    }
+
+    fdptr->epoll_queued = 0;
+    release_fd(fdptr);
+  }
+
+  cupsArrayClear(cupsd_epoll_changes);
+}
+#endif /* HAVE_EPOLL */
+
+
 /*
  * End of "$Id: select.c 11645 2014-02-27 16:35:53Z msweet $".
  */
@@ -63,6 +63,18 @@ cupsdStartServer(void)
   cupsdStartListening();
   cupsdStartBrowsing();
 
+ /*
+  * Start the worker threads (as needed)...
+  */
+
+  cupsdStartWorkers();
+
+ /*
+  * Start the log writer thread (as needed)...
+  */
+
+  cupsdStartLogWriter();
+
  /*
   * Create a pipe for CGI processes...
   */
@@ -105,6 +117,12 @@ cupsdStopServer(void)
 
   cupsdStopColor();
 
+ /*
+  * Stop persistent filters, letting them finish any jobs they are running...
+  */
+
+  cupsdStopPersistentProcesses(NULL, 0);
+
  /*
   * Close all network clients...
   */
@@ -115,6 +133,18 @@ cupsdStopServer(void)
   cupsdStopAllNotifiers();
   cupsdDeleteAllCerts();
 
+ /*
+  * Stop the worker threads...
+  */
+
+  cupsdStopWorkers();
+
+ /*
+  * Stop the log writer thread, writing any queued log lines...
+  */
+
+  cupsdStopLogWriter();
+
   if (Clients)
   {
     cupsArrayDelete(Clients);
@@ -161,6 +191,8 @@ cupsdStopServer(void)
     PageFile = NULL;
   }
 
+  cupsdCloseAccounting();
+
  /*
   * Delete the default security profile...
   */
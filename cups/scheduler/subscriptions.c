@@ -28,14 +28,80 @@
 #endif /* HAVE_DBUS */
 
 
+/*
+ * Events are kept in a single cache that is shared by all subscriptions, and
+ * each subscription remembers the cache numbers of the first and last events
+ * it could see.  The notification attributes that differ between
+ * subscriptions (notify-subscription-id, notify-sequence-number, and
+ * notify-user-data) are added when an event is sent or copied.  The cache
+ * starts out holding CUPSD_EVENT_CACHE_SCALE times MaxEvents events.
+ *
+ * Each subscription also remembers the cache numbers of the last MaxEvents
+ * events it was sent.  The oldest event in the cache is only purged when no
+ * subscription still needs it; otherwise the cache doubles in size, so a busy
+ * printer never pushes out the events of a quiet subscription.
+ *
+ * Subscriptions are also indexed by printer, job, and event bit so that
+ * cupsdAddEvent only looks at the subscriptions that want an event.
+ */
+
+#define CUPSD_EVENT_CACHE_SCALE	16	/* Event cache size multiplier */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_subindex_s		/**** Subscription index entry ****/
+{
+  cupsd_printer_t	*dest;		/* notify-printer-uri, if any */
+  cupsd_job_t		*job;		/* notify-job-id, if any */
+  unsigned		event;		/* Event bit */
+  cups_array_t		*subs;		/* Subscriptions */
+} cupsd_subindex_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*cupsd_subindex = NULL;
+					/* Subscriptions by printer/job/event */
+static cupsd_event_t	**cupsd_events = NULL;
+					/* Shared event cache */
+static int		cupsd_events_size = 0,
+					/* Size of event cache */
+			cupsd_events_base = 0;
+					/* Size of event cache for MaxEvents */
+static unsigned		cupsd_events_first = 1,
+					/* First event in cache */
+			cupsd_events_next = 1,
+					/* Next event cache number */
+			cupsd_events_pinned = 1;
+					/* Earliest event subscriptions need */
+
+
 /*
  * Local functions...
  */
 
+static void	cupsd_add_index(cupsd_subscription_t *sub);
+static int	cupsd_compare_index(cupsd_subindex_t *first,
+		                    cupsd_subindex_t *second, void *unused);
 static int	cupsd_compare_subscriptions(cupsd_subscription_t *first,
 		                            cupsd_subscription_t *second,
 		                            void *unused);
+static void	cupsd_copy_event(ipp_t *ipp, cupsd_subscription_t *sub,
+		                 cupsd_event_t *event, int seq);
 static void	cupsd_delete_event(cupsd_event_t *event);
+static void	cupsd_delete_index(cupsd_subscription_t *sub);
+static int	cupsd_event_pinned(unsigned number);
+static int	cupsd_match_event(cupsd_subscription_t *sub,
+		                  cupsd_event_t *event);
+static cupsd_event_t *cupsd_new_event(cupsd_eventmask_t event,
+		                      cupsd_printer_t *dest, cupsd_job_t *job,
+		                      const char *text);
+static int	cupsd_resize_events(int size);
 #ifdef HAVE_DBUS
 static void	cupsd_send_dbus(cupsd_eventmask_t event, cupsd_printer_t *dest,
 		                cupsd_job_t *job);
@@ -60,7 +126,10 @@ cupsdAddEvent(
 {
   va_list		ap;		/* Pointer to additional arguments */
   char			ftext[1024];	/* Formatted text buffer */
-  ipp_attribute_t	*attr;		/* Printer/job attribute */
+  unsigned		bit;		/* Current event bit */
+  int			i;		/* Looping var */
+  cupsd_subindex_t	key,		/* Search key */
+			*entry;		/* Matching index entry */
   cupsd_event_t		*temp;		/* New event pointer */
   cupsd_subscription_t	*sub;		/* Current subscription */
 
@@ -93,189 +162,62 @@ cupsdAddEvent(
   }
 
  /*
-  * Then loop through the subscriptions and add the event to the corresponding
-  * caches...
+  * Job events are also printer events...
   */
 
-  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
-       sub;
-       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
-  {
-   /*
-    * Check if this subscription requires this event...
-    */
-
-    if ((sub->mask & event) != 0 &&
-        (sub->dest == dest || !sub->dest) &&
-	(sub->job == job || !sub->job))
-    {
-     /*
-      * Need this event, so create a new event record...
-      */
-
-      if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
-      {
-	cupsdLogMessage(CUPSD_LOG_CRIT,
-	                "Unable to allocate memory for event - %s",
-        	        strerror(errno));
-	return;
-      }
-
-      temp->event = event;
-      temp->time  = time(NULL);
-      temp->attrs = ippNew();
-      temp->job   = job;
-
-      if (dest)
-        temp->dest = dest;
-      else if (job)
-        temp->dest = dest = cupsdFindPrinter(job->dest);
-
-     /*
-      * Add common event notification attributes...
-      */
+  if (!dest && job)
+    dest = cupsdFindPrinter(job->dest);
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
-                   "notify-charset", NULL, "utf-8");
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
-                   "notify-natural-language", NULL, "en-US");
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	            "notify-subscription-id", sub->id);
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	            "notify-sequence-number", sub->next_event_id);
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
-	           "notify-subscribed-event", NULL, cupsdEventName(event));
+ /*
+  * Then look up the subscriptions for each event bit with a matching printer
+  * and job (or none) and send the event to them...
+  */
 
-      if (sub->user_data_len > 0)
-        ippAddOctetString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-	                  "notify-user-data", sub->user_data,
-			  sub->user_data_len);
+  for (temp = NULL, bit = 1; bit & CUPSD_EVENT_ALL; bit <<= 1)
+  {
+    if (!(event & bit))
+      continue;
 
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	            "printer-up-time", time(NULL));
+    for (i = 0; i < 4; i ++)
+    {
+      if (((i & 1) && !dest) || ((i & 2) && !job))
+        continue;
 
-      va_start(ap, text);
-      vsnprintf(ftext, sizeof(ftext), text, ap);
-      va_end(ap);
+      key.dest  = (i & 1) ? dest : NULL;
+      key.job   = (i & 2) ? job : NULL;
+      key.event = bit;
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
-	           "notify-text", NULL, ftext);
+      if ((entry = (cupsd_subindex_t *)cupsArrayFind(cupsd_subindex,
+                                                     &key)) == NULL)
+        continue;
 
-      if (dest)
+      for (sub = (cupsd_subscription_t *)cupsArrayFirst(entry->subs);
+	   sub;
+	   sub = (cupsd_subscription_t *)cupsArrayNext(entry->subs))
       {
        /*
-	* Add printer attributes...
+        * Skip subscriptions that already got this event for another bit...
 	*/
 
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI,
-	             "notify-printer-uri", NULL, dest->uri);
-
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME,
-	             "printer-name", NULL, dest->name);
-
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM,
-	              "printer-state", dest->state);
-
-	if (dest->num_reasons == 0)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-	               IPP_TAG_KEYWORD, "printer-state-reasons", NULL,
-		       dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
-	else
-	  ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-	                IPP_TAG_KEYWORD, "printer-state-reasons",
-			dest->num_reasons, NULL,
-			(const char * const *)dest->reasons);
-
-	ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-	              "printer-is-accepting-jobs", (char)dest->accepting);
-      }
-
-      if (job)
-      {
-       /*
-	* Add job attributes...
-	*/
+        if (temp && sub->last_event == temp->number)
+	  continue;
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	              "notify-job-id", job->id);
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM,
-	              "job-state", job->state_value);
+        if (!temp)
+	{
+	 /*
+	  * Need this event, so add it to the event cache...
+	  */
 
-        if ((attr = ippFindAttribute(job->attrs, "job-name",
-	                             IPP_TAG_NAME)) != NULL)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME,
-	               "job-name", NULL, attr->values[0].string.text);
+	  va_start(ap, text);
+	  vsnprintf(ftext, sizeof(ftext), text, ap);
+	  va_end(ap);
 
-	switch (job->state_value)
-	{
-	  case IPP_JOB_PENDING :
-              if (dest && dest->state == IPP_PRINTER_STOPPED)
-        	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		             IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			     "printer-stopped");
-              else
-        	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		             IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			     "none");
-              break;
-
-	  case IPP_JOB_HELD :
-              if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
-		  ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
-        	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		             IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			     "job-hold-until-specified");
-              else
-        	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		             IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			     "job-incoming");
-              break;
-
-	  case IPP_JOB_PROCESSING :
-              ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		           IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			   "job-printing");
-              break;
-
-	  case IPP_JOB_STOPPED :
-              ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		           IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			   "job-stopped");
-              break;
-
-	  case IPP_JOB_CANCELED :
-              ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		           IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			   "job-canceled-by-user");
-              break;
-
-	  case IPP_JOB_ABORTED :
-              ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		           IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			   "aborted-by-system");
-              break;
-
-	  case IPP_JOB_COMPLETED :
-              ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-		           IPP_TAG_KEYWORD, "job-state-reasons", NULL,
-			   "job-completed-successfully");
-              break;
+	  if ((temp = cupsd_new_event(event, dest, job, ftext)) == NULL)
+	    return;
 	}
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	              "job-impressions-completed",
-		      job->sheets ? job->sheets->values[0].integer : 0);
+	cupsd_send_notification(sub, temp);
       }
-
-     /*
-      * Send the notification for this subscription...
-      */
-
-      cupsd_send_notification(sub, temp);
     }
   }
 
@@ -409,16 +351,18 @@ cupsdAddSubscription(
   temp->dest           = dest;
   temp->job            = job;
   temp->pipe           = -1;
-  temp->first_event_id = 1;
   temp->next_event_id  = 1;
+  temp->first_event    = cupsd_events_next;
+  temp->last_event     = cupsd_events_next - 1;
 
   cupsdSetString(&(temp->recipient), uri);
 
  /*
-  * Add the subscription to the array...
+  * Add the subscription to the array and index...
   */
 
   cupsArrayAdd(Subscriptions, temp);
+  cupsd_add_index(temp);
 
  /*
   * For RSS subscriptions, run the notifier immediately...
@@ -431,6 +375,68 @@ cupsdAddSubscription(
 }
 
 
+/*
+ * 'cupsdCopyEvents()' - Copy the cached events for a subscription.
+ */
+
+int					/* O - Number of events copied */
+cupsdCopyEvents(
+    ipp_t                *ipp,		/* I - IPP message */
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    int                  min_seq)	/* I - First notify-sequence-number */
+{
+  unsigned		number,		/* Event cache number */
+			first;		/* First event to copy */
+  int			seq,		/* Current notify-sequence-number */
+			count;		/* Number of events */
+  cupsd_event_t		*event;		/* Current event */
+
+
+ /*
+  * Walk back from the last event sent to find the first event to copy,
+  * stopping at the start of the event cache, the first event the
+  * subscription could see, or MaxEvents events...
+  */
+
+  for (number = sub->last_event, seq = sub->next_event_id - 1, first = 0,
+           count = 0;
+       (int)(number - cupsd_events_first) >= 0 &&
+           (int)(number - sub->first_event) >= 0 &&
+	   seq >= min_seq && count < MaxEvents;
+       number --)
+  {
+    event = cupsd_events[number & (unsigned)(cupsd_events_size - 1)];
+
+    if (cupsd_match_event(sub, event))
+    {
+      first = number;
+      seq --;
+      count ++;
+    }
+  }
+
+  if (!count)
+    return (0);
+
+ /*
+  * Then copy the events in order...
+  */
+
+  for (number = first, seq ++; (int)(sub->last_event - number) >= 0; number ++)
+  {
+    event = cupsd_events[number & (unsigned)(cupsd_events_size - 1)];
+
+    if (cupsd_match_event(sub, event))
+    {
+      ippAddSeparator(ipp);
+      cupsd_copy_event(ipp, sub, event, seq ++);
+    }
+  }
+
+  return (count);
+}
+
+
 /*
  * 'cupsdDeleteAllSubscriptions()' - Delete all subscriptions.
  */
@@ -451,6 +457,19 @@ cupsdDeleteAllSubscriptions(void)
 
   cupsArrayDelete(Subscriptions);
   Subscriptions = NULL;
+
+ /*
+  * Free the event cache...
+  */
+
+  for (; cupsd_events_first != cupsd_events_next; cupsd_events_first ++)
+    cupsd_delete_event(cupsd_events[cupsd_events_first &
+                                    (unsigned)(cupsd_events_size - 1)]);
+
+  free(cupsd_events);
+  cupsd_events      = NULL;
+  cupsd_events_size = 0;
+  cupsd_events_base = 0;
 }
 
 
@@ -475,6 +494,7 @@ cupsdDeleteSubscription(
   */
 
   cupsArrayRemove(Subscriptions, sub);
+  cupsd_delete_index(sub);
 
  /*
   * Free memory...
@@ -483,8 +503,7 @@ cupsdDeleteSubscription(
   cupsdClearString(&(sub->owner));
   cupsdClearString(&(sub->recipient));
 
-  cupsArrayDelete(sub->events);
-
+  free(sub->recent);
   free(sub);
 
  /*
@@ -772,6 +791,8 @@ cupsdLoadAllSubscriptions(void)
 
       if (delete_sub)
         cupsdDeleteSubscription(sub, 0);
+      else
+        cupsd_add_index(sub);
 
       sub        = NULL;
       delete_sub = 0;
@@ -1023,7 +1044,7 @@ cupsdLoadAllSubscriptions(void)
       */
 
       if (value && isdigit(*value & 255))
-        sub->next_event_id = sub->first_event_id = atoi(value);
+        sub->next_event_id = atoi(value);
       else
       {
 	cupsdLogMessage(CUPSD_LOG_ERROR,
@@ -1044,6 +1065,13 @@ cupsdLoadAllSubscriptions(void)
     }
   }
 
+ /*
+  * Index a subscription that was cut short by a syntax error...
+  */
+
+  if (sub)
+    cupsd_add_index(sub);
+
   cupsFileClose(fp);
 }
 
@@ -1233,6 +1261,89 @@ cupsdStopAllNotifiers(void)
 }
 
 
+/*
+ * 'cupsd_add_index()' - Add a subscription to the index.
+ */
+
+static void
+cupsd_add_index(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  unsigned		bit;		/* Current event bit */
+  cupsd_subindex_t	key,		/* Search key */
+			*entry;		/* Index entry */
+
+
+  if (!cupsd_subindex &&
+      (cupsd_subindex = cupsArrayNew((cups_array_func_t)cupsd_compare_index,
+                                     NULL)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_CRIT,
+                    "Unable to allocate memory for subscription index - %s",
+        	    strerror(errno));
+    return;
+  }
+
+  key.dest = sub->dest;
+  key.job  = sub->job;
+
+  for (bit = 1; bit & CUPSD_EVENT_ALL; bit <<= 1)
+  {
+    if (!(sub->mask & bit))
+      continue;
+
+    key.event = bit;
+
+    if ((entry = (cupsd_subindex_t *)cupsArrayFind(cupsd_subindex,
+                                                   &key)) == NULL)
+    {
+      if ((entry = calloc(1, sizeof(cupsd_subindex_t))) == NULL ||
+          (entry->subs = cupsArrayNew(
+	                     (cups_array_func_t)cupsd_compare_subscriptions,
+			     NULL)) == NULL)
+      {
+	cupsdLogMessage(CUPSD_LOG_CRIT,
+			"Unable to allocate memory for subscription #%d - %s",
+			sub->id, strerror(errno));
+        free(entry);
+	return;
+      }
+
+      entry->dest  = key.dest;
+      entry->job   = key.job;
+      entry->event = bit;
+
+      cupsArrayAdd(cupsd_subindex, entry);
+    }
+
+    cupsArrayAdd(entry->subs, sub);
+  }
+}
+
+
+/*
+ * 'cupsd_compare_index()' - Compare two subscription index entries.
+ */
+
+static int				/* O - Result of comparison */
+cupsd_compare_index(
+    cupsd_subindex_t *first,		/* I - First index entry */
+    cupsd_subindex_t *second,		/* I - Second index entry */
+    void             *unused)		/* I - Unused user data pointer */
+{
+  (void)unused;
+
+  if (first->dest != second->dest)
+    return (first->dest < second->dest ? -1 : 1);
+  else if (first->job != second->job)
+    return (first->job < second->job ? -1 : 1);
+  else if (first->event != second->event)
+    return (first->event < second->event ? -1 : 1);
+  else
+    return (0);
+}
+
+
 /*
  * 'cupsd_compare_subscriptions()' - Compare two subscriptions.
  */
@@ -1249,11 +1360,49 @@ cupsd_compare_subscriptions(
 }
 
 
+/*
+ * 'cupsd_copy_event()' - Copy an event to an IPP message for a subscription.
+ */
+
+static void
+cupsd_copy_event(
+    ipp_t                *ipp,		/* I - IPP message */
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t        *event,	/* I - Event */
+    int                  seq)		/* I - notify-sequence-number */
+{
+  ipp_attribute_t	*attr;		/* Current event attribute */
+
+
+ /*
+  * Copy the common attributes, adding the subscription attributes after the
+  * charset/language and subscribed event like we always have...
+  */
+
+  for (attr = event->attrs->attrs; attr; attr = attr->next)
+  {
+    ippCopyAttribute(ipp, attr, 0);
+
+    if (!strcmp(attr->name, "notify-natural-language"))
+    {
+      ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		    "notify-subscription-id", sub->id);
+      ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		    "notify-sequence-number", seq);
+    }
+    else if (!strcmp(attr->name, "notify-subscribed-event") &&
+             sub->user_data_len > 0)
+      ippAddOctetString(ipp, IPP_TAG_EVENT_NOTIFICATION, "notify-user-data",
+                        sub->user_data, sub->user_data_len);
+  }
+}
+
+
 /*
  * 'cupsd_delete_event()' - Delete a single event...
  *
- * Oldest events must be deleted first, otherwise the subscription cache
- * flushing code will not work properly.
+ * Oldest events must be deleted first, otherwise the event cache will not
+ * work properly.
  */
 
 static void
@@ -1268,6 +1417,339 @@ cupsd_delete_event(cupsd_event_t *event)/* I - Event to delete */
 }
 
 
+/*
+ * 'cupsd_delete_index()' - Remove a subscription from the index.
+ */
+
+static void
+cupsd_delete_index(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  unsigned		bit;		/* Current event bit */
+  cupsd_subindex_t	key,		/* Search key */
+			*entry;		/* Index entry */
+
+
+  key.dest = sub->dest;
+  key.job  = sub->job;
+
+  for (bit = 1; bit & CUPSD_EVENT_ALL; bit <<= 1)
+  {
+    if (!(sub->mask & bit))
+      continue;
+
+    key.event = bit;
+
+    if ((entry = (cupsd_subindex_t *)cupsArrayFind(cupsd_subindex,
+                                                   &key)) == NULL)
+      continue;
+
+    cupsArrayRemove(entry->subs, sub);
+
+    if (cupsArrayCount(entry->subs) == 0)
+    {
+      cupsArrayRemove(cupsd_subindex, entry);
+      cupsArrayDelete(entry->subs);
+      free(entry);
+    }
+  }
+}
+
+
+/*
+ * 'cupsd_event_pinned()' - See whether a subscription still needs an event.
+ *
+ * An event is needed while it is one of the last MaxEvents events that were
+ * sent to a subscription.  Since the oldest needed event only moves forward,
+ * the earliest one is cached until the given event reaches it.
+ */
+
+static int				/* O - 1 if needed, 0 otherwise */
+cupsd_event_pinned(unsigned number)	/* I - Event cache number */
+{
+  cupsd_subscription_t	*sub;		/* Current subscription */
+  unsigned		oldest,		/* Oldest event for subscription */
+			pinned;		/* Earliest needed event */
+
+
+  if ((int)(number - cupsd_events_pinned) < 0)
+    return (0);
+
+  for (pinned = cupsd_events_next,
+           sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+       sub;
+       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+  {
+    if (!sub->num_recent)
+      continue;
+
+    oldest = sub->recent[sub->num_recent < sub->alloc_recent ? 0 :
+                                                               sub->recent_pos];
+
+    if ((int)(oldest - pinned) < 0)
+      pinned = oldest;
+  }
+
+  cupsd_events_pinned = pinned;
+
+  return ((int)(number - pinned) >= 0);
+}
+
+
+/*
+ * 'cupsd_match_event()' - Determine whether a subscription wants an event.
+ */
+
+static int				/* O - 1 if wanted, 0 otherwise */
+cupsd_match_event(
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t        *event)	/* I - Event */
+{
+  return ((sub->mask & event->event) != 0 &&
+          (sub->dest == event->dest || !sub->dest) &&
+	  (sub->job == event->job || !sub->job));
+}
+
+
+/*
+ * 'cupsd_new_event()' - Create a new event and add it to the event cache.
+ */
+
+static cupsd_event_t *			/* O - New event or NULL on error */
+cupsd_new_event(
+    cupsd_eventmask_t event,		/* I - Event */
+    cupsd_printer_t   *dest,		/* I - Printer associated with event */
+    cupsd_job_t       *job,		/* I - Job associated with event */
+    const char        *text)		/* I - Notification text */
+{
+  int			size;		/* Size of event cache */
+  ipp_attribute_t	*attr;		/* Printer/job attribute */
+  cupsd_event_t		*temp;		/* New event pointer */
+
+
+ /*
+  * (Re)size the event cache when MaxEvents changes, keeping the newest
+  * events...
+  */
+
+  for (size = 64;
+       size / CUPSD_EVENT_CACHE_SCALE < MaxEvents && size < 0x40000000;
+       size *= 2);
+
+  if (size != cupsd_events_base)
+  {
+    if (!cupsd_resize_events(size))
+      return (NULL);
+
+    cupsd_events_base = size;
+  }
+
+ /*
+  * Create a new event record...
+  */
+
+  if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_CRIT,
+		    "Unable to allocate memory for event - %s",
+		    strerror(errno));
+    return (NULL);
+  }
+
+  temp->event = event;
+  temp->time  = time(NULL);
+  temp->attrs = ippNew();
+  temp->dest  = dest;
+  temp->job   = job;
+
+ /*
+  * Add common event notification attributes...
+  */
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
+	       "notify-charset", NULL, "utf-8");
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
+	       "notify-natural-language", NULL, "en-US");
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
+	       "notify-subscribed-event", NULL, cupsdEventName(event));
+
+  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"printer-up-time", time(NULL));
+
+  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
+	       "notify-text", NULL, text);
+
+  if (dest)
+  {
+   /*
+    * Add printer attributes...
+    */
+
+    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI,
+		 "notify-printer-uri", NULL, dest->uri);
+
+    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME,
+		 "printer-name", NULL, dest->name);
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM,
+		  "printer-state", dest->state);
+
+    if (dest->num_reasons == 0)
+      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		   IPP_TAG_KEYWORD, "printer-state-reasons", NULL,
+		   dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
+    else
+      ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		    IPP_TAG_KEYWORD, "printer-state-reasons",
+		    dest->num_reasons, NULL,
+		    (const char * const *)dest->reasons);
+
+    ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		  "printer-is-accepting-jobs", (char)dest->accepting);
+  }
+
+  if (job)
+  {
+   /*
+    * Add job attributes...
+    */
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		  "notify-job-id", job->id);
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM,
+		  "job-state", job->state_value);
+
+    if ((attr = ippFindAttribute(job->attrs, "job-name",
+				 IPP_TAG_NAME)) != NULL)
+      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME,
+		   "job-name", NULL, attr->values[0].string.text);
+
+    switch (job->state_value)
+    {
+      case IPP_JOB_PENDING :
+	  if (dest && dest->state == IPP_PRINTER_STOPPED)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+			 IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+			 "printer-stopped");
+	  else
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+			 IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+			 "none");
+	  break;
+
+      case IPP_JOB_HELD :
+	  if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
+	      ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+			 IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+			 "job-hold-until-specified");
+	  else
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+			 IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+			 "job-incoming");
+	  break;
+
+      case IPP_JOB_PROCESSING :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		       IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+		       "job-printing");
+	  break;
+
+      case IPP_JOB_STOPPED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		       IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+		       "job-stopped");
+	  break;
+
+      case IPP_JOB_CANCELED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		       IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+		       "job-canceled-by-user");
+	  break;
+
+      case IPP_JOB_ABORTED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		       IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+		       "aborted-by-system");
+	  break;
+
+      case IPP_JOB_COMPLETED :
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
+		       IPP_TAG_KEYWORD, "job-state-reasons", NULL,
+		       "job-completed-successfully");
+	  break;
+    }
+
+    ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		  "job-impressions-completed",
+		  job->sheets ? job->sheets->values[0].integer : 0);
+  }
+
+ /*
+  * Add the event to the cache, purging the oldest event or growing the cache
+  * as needed...
+  */
+
+  if ((int)(cupsd_events_next - cupsd_events_first) >= cupsd_events_size &&
+      (!cupsd_event_pinned(cupsd_events_first) ||
+       cupsd_events_size >= 0x40000000 ||
+       !cupsd_resize_events(cupsd_events_size * 2)))
+  {
+    cupsd_delete_event(cupsd_events[cupsd_events_first &
+                                    (unsigned)(cupsd_events_size - 1)]);
+    cupsd_events_first ++;
+  }
+
+  temp->number = cupsd_events_next ++;
+
+  cupsd_events[temp->number & (unsigned)(cupsd_events_size - 1)] = temp;
+
+  return (temp);
+}
+
+
+/*
+ * 'cupsd_resize_events()' - Resize the event cache, keeping the newest events.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+cupsd_resize_events(int size)		/* I - New size (power of 2) */
+{
+  unsigned		number;		/* Event cache number */
+  cupsd_event_t		**events;	/* New event cache */
+
+
+  if (size == cupsd_events_size)
+    return (1);
+
+  if ((events = calloc((size_t)size, sizeof(cupsd_event_t *))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_CRIT,
+		    "Unable to allocate memory for event cache - %s",
+		    strerror(errno));
+    return (0);
+  }
+
+  for (; (int)(cupsd_events_next - cupsd_events_first) > size;
+       cupsd_events_first ++)
+    cupsd_delete_event(cupsd_events[cupsd_events_first &
+				    (unsigned)(cupsd_events_size - 1)]);
+
+  for (number = cupsd_events_first; number != cupsd_events_next; number ++)
+    events[number & (unsigned)(size - 1)] =
+	cupsd_events[number & (unsigned)(cupsd_events_size - 1)];
+
+  free(cupsd_events);
+
+  cupsd_events      = events;
+  cupsd_events_size = size;
+
+  return (1);
+}
+
+
 #ifdef HAVE_DBUS
 /*
  * 'cupsd_send_dbus()' - Send a DBUS notification...
@@ -1358,6 +1840,7 @@ cupsd_send_notification(
     cupsd_event_t        *event)	/* I - Event to send */
 {
   ipp_state_t	state;			/* IPP event state */
+  ipp_t		*message = NULL;	/* Notification message */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -1365,49 +1848,33 @@ cupsd_send_notification(
                   sub, sub->id, event, cupsdEventName(event->event));
 
  /*
-  * Allocate the events array as needed...
+  * Remember the last event for cupsdCopyEvents, and the last MaxEvents
+  * events so they stay in the event cache...
   */
 
-  if (!sub->events)
+  sub->last_event = event->number;
+
+  if (sub->alloc_recent != MaxEvents)
   {
-    sub->events = cupsArrayNew3((cups_array_func_t)NULL, NULL,
-                                (cups_ahash_func_t)NULL, 0,
-				(cups_acopy_func_t)NULL,
-				(cups_afree_func_t)cupsd_delete_event);
+    free(sub->recent);
 
-    if (!sub->events)
-    {
-      cupsdLogMessage(CUPSD_LOG_CRIT,
-                      "Unable to allocate memory for subscription #%d!",
-                      sub->id);
-      return;
-    }
+    sub->recent       = calloc((size_t)MaxEvents, sizeof(unsigned));
+    sub->alloc_recent = sub->recent ? MaxEvents : 0;
+    sub->num_recent   = 0;
+    sub->recent_pos   = 0;
   }
 
- /*
-  * Purge an old event as needed...
-  */
-
-  if (cupsArrayCount(sub->events) >= MaxEvents)
+  if (sub->recent)
   {
-   /*
-    * Purge the oldest event in the cache...
-    */
+    sub->recent[sub->recent_pos ++] = event->number;
 
-    cupsArrayRemove(sub->events, cupsArrayFirst(sub->events));
+    if (sub->recent_pos >= sub->alloc_recent)
+      sub->recent_pos = 0;
 
-    sub->first_event_id ++;
+    if (sub->num_recent < sub->alloc_recent)
+      sub->num_recent ++;
   }
 
- /*
-  * Add the event to the subscription.  Since the events array is
-  * always MaxEvents in length, and since we will have already
-  * removed an event from the subscription cache if we hit the
-  * event cache limit, we don't need to check for overflow here...
-  */
-
-  cupsArrayAdd(sub->events, event);
-
  /*
   * Deliver the event...
   */
@@ -1424,9 +1891,17 @@ cupsd_send_notification(
       if (sub->pipe < 0)
 	break;
 
-      event->attrs->state = IPP_IDLE;
+      if (!message)
+      {
+        if ((message = ippNew()) == NULL)
+	  break;
+
+        cupsd_copy_event(message, sub, event, sub->next_event_id);
+      }
 
-      while ((state = ippWriteFile(sub->pipe, event->attrs)) != IPP_DATA)
+      message->state = IPP_IDLE;
+
+      while ((state = ippWriteFile(sub->pipe, message)) != IPP_DATA)
         if (state == IPP_ERROR)
 	  break;
 
@@ -1460,6 +1935,8 @@ cupsd_send_notification(
 
       break;
     }
+
+    ippDelete(message);
   }
 
  /*
@@ -75,9 +75,10 @@ typedef enum
 
 typedef struct cupsd_event_s		/**** Event structure ****/
 {
+  unsigned		number;		/* Event cache sequence number */
   cupsd_eventmask_t	event;		/* Event */
   time_t		time;		/* Time of event */
-  ipp_t			*attrs;		/* Notification message */
+  ipp_t			*attrs;		/* Common notification attributes */
   cupsd_printer_t	*dest;		/* Associated printer, if any */
   cupsd_job_t		*job;		/* Associated job, if any */
 } cupsd_event_t; 
@@ -99,9 +100,13 @@ typedef struct cupsd_subscription_s	/**** Subscription structure ****/
   int			status;		/* Exit status of notifier */
   time_t		last;		/* Time of last notification */
   time_t		expire;		/* Lease expiration time */
-  int			first_event_id,	/* First event-id in cache */
-			next_event_id;	/* Next event-id to use */
-  cups_array_t		*events;	/* Cached events */
+  int			next_event_id;	/* Next event-id to use */
+  unsigned		first_event,	/* First event cache number to check */
+			last_event;	/* Last event cache number sent */
+  unsigned		*recent;	/* Cache numbers of last MaxEvents events */
+  int			num_recent,	/* Number of recent events */
+			alloc_recent,	/* Allocated recent events */
+			recent_pos;	/* Next recent event to replace */
 } cupsd_subscription_t;
 
 
@@ -145,6 +150,8 @@ extern cupsd_subscription_t *
 		cupsdAddSubscription(unsigned mask, cupsd_printer_t *dest,
 		                     cupsd_job_t *job, const char *uri,
 				     int sub_id);
+extern int	cupsdCopyEvents(ipp_t *ipp, cupsd_subscription_t *sub,
+		                int min_seq);
 extern void	cupsdDeleteAllSubscriptions(void);
 extern void	cupsdDeleteSubscription(cupsd_subscription_t *sub, int update);
 extern const char *
@@ -21,6 +21,7 @@
 #include <cups/dir.h>
 #include <cups/debug-private.h>
 #include <cups/ppd-private.h>
+#include <sys/time.h>
 #include "mime.h"
 
 
@@ -31,7 +32,9 @@
 static void	add_ppd_filter(mime_t *mime, mime_type_t *filtertype,
 		               const char *filter);
 static void	add_ppd_filters(mime_t *mime, ppd_file_t *ppd);
+static void	list_files(cups_array_t *files, const char *dirname);
 static void	print_rules(mime_magic_t *rules);
+static void	type_bench(mime_t *mime, const char *dirname);
 static void	type_dir(mime_t *mime, const char *dirname);
 
 
@@ -79,6 +82,21 @@ main(int  argc,				/* I - Number of command-line args */
 	  add_ppd_filters(mime, ppd);
       }
     }
+    else if (!strcmp(argv[i], "-b"))
+    {
+      i ++;
+
+      if (i < argc)
+      {
+	if (!mime)
+	  mime = mimeLoad("../conf", filter_path);
+
+        type_bench(mime, argv[i]);
+
+        mimeDelete(mime);
+	return (0);
+      }
+    }
     else if (!strcmp(argv[i], "-f"))
     {
       i ++;
@@ -356,6 +374,39 @@ add_ppd_filters(mime_t     *mime,	/* I - MIME database */
 }
 
 
+/*
+ * 'list_files()' - Add the regular files in a directory tree to an array.
+ */
+
+static void
+list_files(cups_array_t *files,		/* I - Array of filenames */
+           const char   *dirname)	/* I - Directory */
+{
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  char		filename[1024];		/* Filename */
+
+
+  if ((dir = cupsDirOpen(dirname)) == NULL)
+    return;
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if (dent->filename[0] == '.')
+      continue;
+
+    snprintf(filename, sizeof(filename), "%s/%s", dirname, dent->filename);
+
+    if (S_ISDIR(dent->fileinfo.st_mode))
+      list_files(files, filename);
+    else if (S_ISREG(dent->fileinfo.st_mode))
+      cupsArrayAdd(files, strdup(filename));
+  }
+
+  cupsDirClose(dir);
+}
+
+
 /*
  * 'print_rules()' - Print the rules for a file type...
  */
@@ -444,6 +495,84 @@ print_rules(mime_magic_t *rules)	/* I - Rules to print */
 }
 
 
+/*
+ * 'type_bench()' - Measure how fast the files in a directory are typed.
+ *
+ * The files are typed with the loaded database and again after adding the
+ * printer types a server with 500 queues would have.
+ */
+
+static void
+type_bench(mime_t     *mime,		/* I - MIME database */
+           const char *dirname)		/* I - Directory */
+{
+  cups_array_t	*files;			/* Files to type */
+  char		*filename;		/* Current file */
+  char		name[MIME_MAX_TYPE];	/* Printer type name */
+  int		i,			/* Looping var */
+		passes,			/* Number of passes */
+		count,			/* Number of files typed */
+		unknown;		/* Number of unknown files */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+  double	secs;			/* Elapsed time */
+
+
+  files = cupsArrayNew(NULL, NULL);
+
+  list_files(files, dirname);
+
+  if (cupsArrayCount(files) == 0)
+  {
+    printf("testmime: No files in \"%s\".\n", dirname);
+    cupsArrayDelete(files);
+    return;
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    if (i)
+    {
+      for (count = 0; count < 500; count ++)
+      {
+        snprintf(name, sizeof(name), "bench-%d", count);
+	mimeAddType(mime, "printer", name);
+	mimeAddType(mime, "prefilter", name);
+      }
+    }
+
+   /*
+    * Type all of the files repeatedly for at least 2 seconds...
+    */
+
+    gettimeofday(&start, NULL);
+
+    for (passes = 0, count = 0, unknown = 0, secs = 0.0; secs < 2.0; passes ++)
+    {
+      for (filename = (char *)cupsArrayFirst(files);
+	   filename;
+	   filename = (char *)cupsArrayNext(files), count ++)
+	if (!mimeFileType(mime, filename, NULL, NULL))
+	  unknown ++;
+
+      gettimeofday(&end, NULL);
+      secs = end.tv_sec - start.tv_sec + 0.000001 * (end.tv_usec - start.tv_usec);
+    }
+
+    printf("%d types: typed %d files (%d passes, %d unknown) in %.3f seconds, "
+           "%.0f files/sec.\n", mimeNumTypes(mime), count, passes,
+	   unknown / passes, secs, count / secs);
+  }
+
+  for (filename = (char *)cupsArrayFirst(files);
+       filename;
+       filename = (char *)cupsArrayNext(files))
+    free(filename);
+
+  cupsArrayDelete(files);
+}
+
+
 /*
  * 'type_dir()' - Show the MIME types for a given directory.
  */
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#include <fcntl.h>
 
 
 /*
@@ -33,6 +34,10 @@
 static int	do_test(const char *server, int port,
 		        http_encryption_t encryption, int requests,
 			const char *opstring, int verbose);
+static int	run_clients(const char *program, const char *server,
+		            int port, http_encryption_t encryption,
+			    int requests, int children, const char *opstring,
+			    int verbose, int quiet, double *elapsed);
 static void	usage(void) __attribute__((noreturn));
 
 
@@ -53,12 +58,10 @@ main(int  argc,				/* I - Number of command-line arguments */
   int		requests;		/* Number of requests to send */
   int		children;		/* Number of children to fork */
   int		good_children;		/* Number of children that exited normally */
-  int		pid;			/* Child PID */
-  int		status;			/* Child status */
-  time_t	start,			/* Start time */
-		end;			/* End time */
   double	elapsed;		/* Elapsed time */
   int		verbose;		/* Verbosity */
+  int		scaling;		/* Do a scaling test? */
+  long		cpus;			/* Number of online CPUs */
   const char	*opstring;		/* Operation name */
 
 
@@ -67,11 +70,12 @@ main(int  argc,				/* I - Number of command-line arguments */
   */
 
   requests   = 100;
-  children   = 5;
+  children   = -1;
   server     = (char *)cupsServer();
   port       = ippPort();
   encryption = HTTP_ENCRYPT_IF_REQUESTED;
   verbose    = 0;
+  scaling    = 0;
   opstring   = NULL;
 
   for (i = 1; i < argc; i ++)
@@ -108,6 +112,10 @@ main(int  argc,				/* I - Number of command-line arguments */
 	      requests = atoi(argv[i]);
 	      break;
 
+          case 's' : /* Scaling test */
+	      scaling = 1;
+	      break;
+
           case 'v' : /* Verbose logging */
               verbose ++;
 	      break;
@@ -129,101 +137,88 @@ main(int  argc,				/* I - Number of command-line arguments */
     }
 
  /*
-  * Then create child processes to act as clients...
+  * Figure out how many clients to use; the scaling test defaults to twice
+  * the number of CPUs so that the server's worker threads are saturated...
   */
 
-  if (children > 0)
-  {
-    printf("testspeed: Simulating %d clients with %d requests to %s with "
-           "%sencryption...\n", children, requests, server,
-	   encryption == HTTP_ENCRYPT_IF_REQUESTED ? "no " : "");
-  }
+#ifdef _SC_NPROCESSORS_ONLN
+  if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    cpus = 1;
+#else
+  cpus = 1;
+#endif /* _SC_NPROCESSORS_ONLN */
 
-  start = time(NULL);
+  if (children < 0)
+    children = scaling ? 2 * (int)cpus : 5;
 
-  if (children < 1)
-    return (do_test(server, port, encryption, requests, opstring, verbose));
-  else if (children == 1)
-    good_children = do_test(server, port, encryption, requests, opstring,
-                            verbose) ? 0 : 1;
-  else
+  if (scaling)
   {
-    char	options[255],		/* Command-line options for child */
-		reqstr[255],		/* Requests string for child */
-		serverstr[255];		/* Server:port string for child */
+    int		count,			/* Number of clients */
+		last = 0;		/* Last number of clients */
+    double	rate,			/* Requests per second */
+		base_rate = 0.0;	/* Rate for 1 client */
 
 
-    snprintf(reqstr, sizeof(reqstr), "%d", requests);
-
-    if (port == 631 || server[0] == '/')
-      strlcpy(serverstr, server, sizeof(serverstr));
-    else
-      snprintf(serverstr, sizeof(serverstr), "%s:%d", server, port);
+    if (children < 1)
+      children = 1;
 
-    strlcpy(options, "-cr", sizeof(options));
-
-    if (encryption == HTTP_ENCRYPT_REQUIRED)
-      strlcat(options, "E", sizeof(options));
-
-    if (verbose)
-      strlcat(options, "v", sizeof(options));
+    printf("testspeed: Scaling test with up to %d clients and %d requests "
+           "per client to %s (%ld CPUs)...\n", children, requests, server,
+	   cpus);
+    puts("testspeed: Clients  Requests  Seconds  Requests/sec  Speedup");
 
-    for (i = 0; i < children; i ++)
+    for (count = 1, elapsed = 0.0; last < children; count *= 2)
     {
-      fflush(stdout);
+      if (count > children)
+        count = children;
 
-      if ((pid = fork()) == 0)
-      {
-       /*
-	* Child goes here...
-	*/
-
-        if (opstring)
-	  execlp(argv[0], argv[0], options, "0", reqstr, "-o", opstring,
-	         serverstr, (char *)NULL);
-        else
-	  execlp(argv[0], argv[0], options, "0", reqstr, serverstr, (char *)NULL);
+      last          = count;
+      good_children = run_clients(argv[0], server, port, encryption,
+                                  requests, count, opstring, 0, 1, &elapsed);
 
-	exit(errno);
-      }
-      else if (pid < 0)
+      if (good_children <= 0 || elapsed <= 0.0)
       {
-	printf("testspeed: Fork failed: %s\n", strerror(errno));
-	break;
+        printf("testspeed: %7d  FAILED\n", count);
+	return (1);
       }
-      else
-	printf("testspeed: Started child %d...\n", pid);
-    }
 
-   /*
-    * Wait for children to finish...
-    */
+      rate = good_children * requests / elapsed;
 
-    puts("testspeed: Waiting for children to finish...");
+      if (count == 1)
+        base_rate = rate;
 
-    for (good_children = 0;;)
-    {
-      pid = wait(&status);
+      printf("testspeed: %7d  %8d  %7.3f  %12.1f  %6.2fx\n", count,
+             good_children * requests, elapsed, rate,
+	     base_rate > 0.0 ? rate / base_rate : 0.0);
+    }
 
-      if (pid < 0 && errno != EINTR)
-	break;
+    return (0);
+  }
 
-      printf("testspeed: Ended child %d (%d)...\n", pid, status / 256);
+ /*
+  * Then create child processes to act as clients...
+  */
 
-      if (!status)
-        good_children ++;
-    }
+  if (children > 0)
+  {
+    printf("testspeed: Simulating %d clients with %d requests to %s with "
+           "%sencryption...\n", children, requests, server,
+	   encryption == HTTP_ENCRYPT_IF_REQUESTED ? "no " : "");
   }
 
+  if (children < 1)
+    return (do_test(server, port, encryption, requests, opstring, verbose));
+
+  good_children = run_clients(argv[0], server, port, encryption, requests,
+                              children, opstring, verbose, 0, &elapsed);
+
  /*
   * Compute the total run time...
   */
 
   if (good_children > 0)
   {
-    end     = time(NULL);
-    elapsed = end - start;
-    i       = good_children * requests;
+    i = good_children * requests;
 
     printf("testspeed: %dx%d=%d requests in %.1fs (%.3fs/r, %.1fr/s)\n",
 	   good_children, requests, i, elapsed, elapsed / i, i / elapsed);
@@ -311,6 +306,18 @@ do_test(const char        *server,	/* I - Server to use */
       case IPP_GET_JOBS :
 	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
                        NULL, "ipp://localhost/printers/");
+	  ippDelete(cupsDoRequest(http, request, "/"));
+          break;
+
+      case IPP_GET_JOB_ATTRIBUTES :
+	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri",
+                       NULL, "ipp://localhost/jobs/1");
+	  ippDelete(cupsDoRequest(http, request, "/"));
+          break;
+
+      case IPP_GET_PRINTER_ATTRIBUTES :
+	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri",
+                       NULL, "ipp://localhost/printers/test");
 
       default :
 	  ippDelete(cupsDoRequest(http, request, "/"));
@@ -361,6 +368,125 @@ do_test(const char        *server,	/* I - Server to use */
 }
 
 
+/*
+ * 'run_clients()' - Run a test with the specified number of clients.
+ */
+
+static int				/* O - Number of successful clients */
+run_clients(const char        *program,	/* I - Program name */
+            const char        *server,	/* I - Server to use */
+            int               port,	/* I - Port number to use */
+	    http_encryption_t encryption,
+					/* I - Encryption to use */
+	    int               requests,	/* I - Number of requests per client */
+	    int               children,	/* I - Number of clients */
+	    const char        *opstring,/* I - Operation string */
+	    int               verbose,	/* I - Verbose output? */
+	    int               quiet,	/* I - Hide output from clients? */
+	    double            *elapsed)	/* O - Elapsed time in seconds */
+{
+  int		i;			/* Looping var */
+  int		good_children;		/* Number of children that exited normally */
+  int		pid;			/* Child PID */
+  int		status;			/* Child status */
+  struct timeval start,			/* Start time */
+		end;			/* End time */
+  char		options[255],		/* Command-line options for child */
+		reqstr[255],		/* Requests string for child */
+		serverstr[255];		/* Server:port string for child */
+
+
+  snprintf(reqstr, sizeof(reqstr), "%d", requests);
+
+  if (port == 631 || server[0] == '/')
+    strlcpy(serverstr, server, sizeof(serverstr));
+  else
+    snprintf(serverstr, sizeof(serverstr), "%s:%d", server, port);
+
+  strlcpy(options, "-cr", sizeof(options));
+
+  if (encryption == HTTP_ENCRYPT_REQUIRED)
+    strlcat(options, "E", sizeof(options));
+
+  if (verbose)
+    strlcat(options, "v", sizeof(options));
+
+  gettimeofday(&start, NULL);
+
+  for (i = 0; i < children; i ++)
+  {
+    fflush(stdout);
+
+    if ((pid = fork()) == 0)
+    {
+     /*
+      * Child goes here...
+      */
+
+      if (quiet)
+      {
+       /*
+        * Keep the per-client summaries out of the test output...
+	*/
+
+	int fd = open("/dev/null", O_WRONLY);
+					/* /dev/null */
+
+	if (fd >= 0)
+	{
+	  dup2(fd, 1);
+	  close(fd);
+	}
+      }
+
+      if (opstring)
+	execlp(program, program, options, "0", reqstr, "-o", opstring,
+	       serverstr, (char *)NULL);
+      else
+	execlp(program, program, options, "0", reqstr, serverstr,
+	       (char *)NULL);
+
+      exit(errno);
+    }
+    else if (pid < 0)
+    {
+      printf("testspeed: Fork failed: %s\n", strerror(errno));
+      break;
+    }
+    else if (verbose)
+      printf("testspeed: Started child %d...\n", pid);
+  }
+
+ /*
+  * Wait for children to finish...
+  */
+
+  if (verbose)
+    puts("testspeed: Waiting for children to finish...");
+
+  for (good_children = 0;;)
+  {
+    pid = wait(&status);
+
+    if (pid < 0 && errno != EINTR)
+      break;
+
+    if (verbose)
+      printf("testspeed: Ended child %d (%d)...\n", pid, status / 256);
+
+    if (!status)
+      good_children ++;
+  }
+
+  gettimeofday(&end, NULL);
+
+  *elapsed = (end.tv_sec - start.tv_sec) +
+             0.000001 * (end.tv_usec - start.tv_usec);
+
+  return (good_children);
+}
+
+
 /*
  * 'usage()' - Show program usage...
  */
@@ -368,8 +494,8 @@ do_test(const char        *server,	/* I - Server to use */
 static void
 usage(void)
 {
-  puts("Usage: testspeed [-c children] [-h] [-o operation] [-r requests] [-v] "
-       "[-E] hostname[:port]");
+  puts("Usage: testspeed [-c children] [-h] [-o operation] [-r requests] [-s] "
+       "[-v] [-E] hostname[:port]");
   exit(0);
 }
 
@@ -20,19 +20,46 @@
 #include <cups/string-private.h>
 #include <cups/debug-private.h>
 #include <locale.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
  * Local types...
  */
 
+typedef struct _mime_string_s		/**** contains() string lookup ****/
+{
+  mime_magic_t	*rule;			/* contains() rule */
+  int		string;			/* Index of unique string */
+} _mime_string_t;
+
+typedef struct _mime_typing_s		/**** Compiled type detection data ****/
+{
+  unsigned	rules_gen;		/* Rule generation when compiled */
+  int		num_rules;		/* Number of contains() rules */
+  _mime_string_t *rules;		/* contains() rules, sorted by address */
+  int		num_strings;		/* Number of unique strings */
+  int		*lengths;		/* Length of each string */
+  int		num_states;		/* Number of matcher states */
+  unsigned short (*next)[256];		/* State transitions */
+  int		*output,		/* String ending in state or -1 */
+		*dict;			/* Next state with output or 0 */
+  int		num_types[257];		/* Number of candidates for first byte */
+  mime_type_t	**types[257];		/* Candidate types for first byte, or
+					 * [256] for empty files */
+} _mime_typing_t;
+
 typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
 {
   cups_file_t	*fp;			/* File pointer */
   int		offset,			/* Offset in file */
 		length;			/* Length of buffered data */
   unsigned char	buffer[MIME_MAX_BUFFER];/* Buffered data */
+  _mime_typing_t *typing;		/* Compiled type detection data */
+  int		*hits,			/* First offset of each string or -1 */
+		hitbuf[64],		/* Offsets for small databases */
+		state,			/* String matcher state */
+		scanned;		/* Number of bytes scanned */
 } _mime_filebuf_t;
 
 
@@ -40,16 +67,24 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
  * Local functions...
  */
 
+static int	mime_add_strings(mime_magic_t *rules, _mime_typing_t *typing,
+		                 int *alloc_rules);
+static int	mime_compare_strings(_mime_string_t *s0, _mime_string_t *s1);
 static int	mime_compare_types(mime_type_t *t0, mime_type_t *t1);
 static int	mime_check_rules(const char *filename, _mime_filebuf_t *fb,
 		                 mime_magic_t *rules);
+static void	mime_first_bytes(mime_magic_t *rules, unsigned char *set);
 static int	mime_patmatch(const char *s, const char *pat);
+static int	mime_scan_strings(_mime_filebuf_t *fb, int string, int end);
+static int	mime_string_index(_mime_typing_t *typing, mime_magic_t *rule);
 
 
 /*
  * Local globals...
  */
 
+static unsigned	mime_rules_gen = 0;	/* Incremented for every new rule */
+
 #ifdef DEBUG
 static const char * const debug_ops[] =
 		{			/* Test names... */
@@ -169,6 +204,8 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
   if (!mt || !rule)
     return (-1);
 
+  mime_rules_gen ++;
+
  /*
   * Find the last rule in the top-level of the rules tree.
   */
@@ -572,6 +609,269 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
 }
 
 
+/*
+ * '_mimeCompileTypes()' - Compile the type detection rules.
+ *
+ * The rules of all types are compiled into a table of candidate types for
+ * each possible first byte of a file and a single string matcher
+ * (Aho-Corasick) for all of the contains() rules, so that mimeFileType()
+ * only scans the start of a file once.  If the data cannot be allocated,
+ * mimeFileType() checks every type in turn.
+ */
+
+void
+_mimeCompileTypes(mime_t *mime)		/* I - MIME database */
+{
+  int			i, j, k;	/* Looping vars */
+  int			ch,		/* Current byte */
+			state,		/* Current state */
+			max_states,	/* Maximum number of states */
+			alloc_rules,	/* Allocated contains() rules */
+			num_types,	/* Number of types with rules */
+			qhead,		/* Head of state queue */
+			qtail;		/* Tail of state queue */
+  int			*fail = NULL,	/* Failure state for each state */
+			*queue = NULL;	/* Queue of states */
+  _mime_typing_t	*typing;	/* Compiled type detection data */
+  mime_type_t		*type,		/* Current type */
+			**types = NULL;	/* Types with rules */
+  unsigned char		(*sets)[32] = NULL;
+					/* First bytes for each type */
+  mime_magic_t		*rule;		/* Current contains() rule */
+
+
+  DEBUG_printf(("_mimeCompileTypes(mime=%p)", mime));
+
+  if (!mime)
+    return;
+
+  _mimeFreeCompiledTypes(mime);
+
+  if ((typing = calloc(1, sizeof(_mime_typing_t))) == NULL)
+    return;
+
+  typing->rules_gen = mime_rules_gen;
+  alloc_rules       = 0;
+
+ /*
+  * Collect the types that have rules, the possible first bytes for each
+  * type, and all of the contains() rules...
+  */
+
+  if ((num_types = cupsArrayCount(mime->types)) > 0)
+  {
+    if ((types = calloc((size_t)num_types, sizeof(mime_type_t *))) == NULL ||
+        (sets = calloc((size_t)num_types, sizeof(sets[0]))) == NULL)
+      goto error;
+  }
+
+  for (type = (mime_type_t *)cupsArrayFirst(mime->types), num_types = 0;
+       type;
+       type = (mime_type_t *)cupsArrayNext(mime->types))
+  {
+    if (!type->rules)
+      continue;
+
+    mime_first_bytes(type->rules, sets[num_types]);
+    types[num_types ++] = type;
+
+    if (mime_add_strings(type->rules, typing, &alloc_rules))
+      goto error;
+  }
+
+ /*
+  * Build the table of candidate types for each first byte, preserving the
+  * order of the types array.  Entry 256 holds the types that can match an
+  * empty file...
+  */
+
+  for (ch = 0; ch < 257; ch ++)
+  {
+    for (i = 0, k = 0; i < num_types; i ++)
+    {
+      if (ch < 256)
+      {
+        if (sets[i][ch >> 3] & (1 << (ch & 7)))
+	  k ++;
+      }
+      else
+      {
+        for (j = 0; j < 32; j ++)
+	  if (sets[i][j] != 255)
+	    break;
+
+        if (j == 32)
+	  k ++;
+      }
+    }
+
+    if (k == 0)
+      continue;
+
+    if ((typing->types[ch] = calloc((size_t)k, sizeof(mime_type_t *))) == NULL)
+      goto error;
+
+    for (i = 0; i < num_types; i ++)
+    {
+      if (ch < 256)
+      {
+        if (!(sets[i][ch >> 3] & (1 << (ch & 7))))
+	  continue;
+      }
+      else
+      {
+        for (j = 0; j < 32; j ++)
+	  if (sets[i][j] != 255)
+	    break;
+
+        if (j < 32)
+	  continue;
+      }
+
+      typing->types[ch][typing->num_types[ch] ++] = types[i];
+    }
+  }
+
+  free(types);
+  free(sets);
+
+  types = NULL;
+  sets  = NULL;
+
+ /*
+  * Build the string matcher, starting with a trie of the unique strings...
+  */
+
+  for (i = 0, max_states = 1; i < typing->num_rules; i ++)
+    max_states += typing->rules[i].rule->length;
+
+  if (typing->num_rules > 0 && max_states <= 65536)
+  {
+    if ((typing->lengths = calloc((size_t)typing->num_rules,
+                                  sizeof(int))) == NULL ||
+	(typing->next = calloc((size_t)max_states,
+	                       sizeof(typing->next[0]))) == NULL ||
+	(typing->output = malloc((size_t)max_states * sizeof(int))) == NULL ||
+	(typing->dict = calloc((size_t)max_states, sizeof(int))) == NULL ||
+	(fail = calloc((size_t)max_states, sizeof(int))) == NULL ||
+	(queue = malloc((size_t)max_states * sizeof(int))) == NULL)
+      goto error;
+
+    for (i = 0; i < max_states; i ++)
+      typing->output[i] = -1;
+
+    typing->num_states = 1;
+
+    for (i = 0; i < typing->num_rules; i ++)
+    {
+      rule = typing->rules[i].rule;
+
+      for (j = 0; j < i; j ++)
+        if (typing->rules[j].rule->length == rule->length &&
+	    !memcmp(typing->rules[j].rule->value.stringv, rule->value.stringv,
+	            (size_t)rule->length))
+	  break;
+
+      if (j < i)
+      {
+        typing->rules[i].string = typing->rules[j].string;
+	continue;
+      }
+
+      typing->rules[i].string                   = typing->num_strings;
+      typing->lengths[typing->num_strings ++] = rule->length;
+
+      for (j = 0, state = 0; j < rule->length; j ++)
+      {
+        ch = rule->value.stringv[j] & 255;
+
+        if (!typing->next[state][ch])
+	  typing->next[state][ch] = (unsigned short)typing->num_states ++;
+
+        state = typing->next[state][ch];
+      }
+
+      typing->output[state] = typing->rules[i].string;
+    }
+
+   /*
+    * Then add the failure transitions breadth-first so that every state has
+    * a transition for every byte...
+    */
+
+    for (ch = 0, qhead = 0, qtail = 0; ch < 256; ch ++)
+      if (typing->next[0][ch])
+        queue[qtail ++] = typing->next[0][ch];
+
+    while (qhead < qtail)
+    {
+      state = queue[qhead ++];
+
+      for (ch = 0; ch < 256; ch ++)
+      {
+        if ((k = typing->next[state][ch]) != 0)
+	{
+	  fail[k] = typing->next[fail[state]][ch];
+
+	  if (typing->output[fail[k]] >= 0)
+	    typing->dict[k] = fail[k];
+	  else
+	    typing->dict[k] = typing->dict[fail[k]];
+
+	  queue[qtail ++] = k;
+	}
+	else
+	  typing->next[state][ch] = typing->next[fail[state]][ch];
+      }
+    }
+
+    free(fail);
+    free(queue);
+
+    fail  = NULL;
+    queue = NULL;
+
+    if (typing->num_states < max_states)
+    {
+      unsigned short	(*next)[256];	/* Trimmed state transitions */
+
+      if ((next = realloc(typing->next, (size_t)typing->num_states *
+                                        sizeof(typing->next[0]))) != NULL)
+        typing->next = next;
+    }
+  }
+
+ /*
+  * Sort the contains() rules so mime_check_rules() can find their strings...
+  */
+
+  if (typing->num_rules > 1)
+    qsort(typing->rules, (size_t)typing->num_rules, sizeof(_mime_string_t),
+          (int (*)(const void *, const void *))mime_compare_strings);
+
+  DEBUG_printf(("1_mimeCompileTypes: %d strings, %d states, %d empty file "
+                "types.", typing->num_strings, typing->num_states,
+		typing->num_types[256]));
+
+  mime->typing = typing;
+  return;
+
+ /*
+  * If we get here, we ran out of memory...
+  */
+
+  error:
+
+  free(types);
+  free(sets);
+  free(fail);
+  free(queue);
+
+  mime->typing = typing;
+  _mimeFreeCompiledTypes(mime);
+}
+
+
 /*
  * 'mimeFileType()' - Determine the type of a file.
  */
@@ -582,6 +882,7 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 	     const char *filename,	/* I - Original filename or NULL */
 	     int        *compression)	/* O - Is the file compressed? */
 {
+  int			i;		/* Looping var */
   _mime_filebuf_t	fb;		/* File buffer */
   const char		*base;		/* Base filename of file */
   mime_type_t		*type,		/* File type */
@@ -613,8 +914,19 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
     return (NULL);
   }
 
-  fb.offset = -1;
-  fb.length = 0;
+  if (!mime->typing || mime->typing->rules_gen != mime_rules_gen)
+    _mimeCompileTypes(mime);
+
+ /*
+  * Read the start of the file, which is all that most rules look at...
+  */
+
+  fb.offset  = 0;
+  fb.length  = cupsFileRead(fb.fp, (char *)fb.buffer, sizeof(fb.buffer));
+  fb.typing  = mime->typing;
+  fb.hits    = NULL;
+  fb.state   = 0;
+  fb.scanned = 0;
 
  /*
   * Figure out the base filename (without directory portion)...
@@ -636,14 +948,42 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   * Then check it against all known types...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
-       type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
-    if (mime_check_rules(base, &fb, type->rules))
+  best = NULL;
+
+  if (fb.typing)
+  {
+   /*
+    * Only check the types that can match the first byte of the file...
+    */
+
+    int		slot = fb.length > 0 ? fb.buffer[0] : 256;
+					/* Candidate types */
+
+    for (i = 0; i < fb.typing->num_types[slot]; i ++)
     {
-      if (!best || type->priority > best->priority)
-        best = type;
+      type = fb.typing->types[slot][i];
+
+      if (mime_check_rules(base, &fb, type->rules))
+      {
+	if (!best || type->priority > best->priority)
+	  best = type;
+      }
     }
+  }
+  else
+  {
+    for (type = (mime_type_t *)cupsArrayFirst(mime->types);
+	 type;
+	 type = (mime_type_t *)cupsArrayNext(mime->types))
+      if (mime_check_rules(base, &fb, type->rules))
+      {
+	if (!best || type->priority > best->priority)
+	  best = type;
+      }
+  }
+
+  if (fb.hits != fb.hitbuf)
+    free(fb.hits);
 
  /*
   * Finally, close the file and return a match (if any)...
@@ -663,6 +1003,34 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFreeCompiledTypes()' - Free the compiled type detection rules.
+ */
+
+void
+_mimeFreeCompiledTypes(mime_t *mime)	/* I - MIME database */
+{
+  int			i;		/* Looping var */
+  _mime_typing_t	*typing;	/* Compiled type detection data */
+
+
+  if (!mime || (typing = mime->typing) == NULL)
+    return;
+
+  for (i = 0; i < 257; i ++)
+    free(typing->types[i]);
+
+  free(typing->rules);
+  free(typing->lengths);
+  free(typing->next);
+  free(typing->output);
+  free(typing->dict);
+  free(typing);
+
+  mime->typing = NULL;
+}
+
+
 /*
  * 'mimeType()' - Lookup a file type.
  */
@@ -702,6 +1070,63 @@ mimeType(mime_t     *mime,		/* I - MIME database */
 }
 
 
+/*
+ * 'mime_add_strings()' - Add the contains() rules in a list of rules.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mime_add_strings(
+    mime_magic_t   *rules,		/* I - Rules to add */
+    _mime_typing_t *typing,		/* I - Compiled type detection data */
+    int            *alloc_rules)	/* IO - Allocated contains() rules */
+{
+  _mime_string_t	*temp;		/* New contains() rules */
+
+
+  for (; rules; rules = rules->next)
+  {
+    if (rules->op == MIME_MAGIC_CONTAINS && rules->length > 0)
+    {
+      if (typing->num_rules >= *alloc_rules)
+      {
+        if ((temp = realloc(typing->rules, (size_t)(*alloc_rules + 16) *
+	                                   sizeof(_mime_string_t))) == NULL)
+	  return (-1);
+
+        typing->rules = temp;
+	*alloc_rules  += 16;
+      }
+
+      typing->rules[typing->num_rules].rule   = rules;
+      typing->rules[typing->num_rules].string = -1;
+      typing->num_rules ++;
+    }
+    else if (rules->child && mime_add_strings(rules->child, typing,
+                                              alloc_rules))
+      return (-1);
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'mime_compare_strings()' - Compare two contains() rule addresses.
+ */
+
+static int				/* O - Result of comparison */
+mime_compare_strings(_mime_string_t *s0,/* I - First rule */
+                     _mime_string_t *s1)/* I - Second rule */
+{
+  if (s0->rule < s1->rule)
+    return (-1);
+  else if (s0->rule > s1->rule)
+    return (1);
+  else
+    return (0);
+}
+
+
 /*
  * 'mime_compare_types()' - Compare two MIME super/type names.
  */
@@ -732,6 +1157,7 @@ mime_check_rules(
 {
   int		n;			/* Looping var */
   int		region;			/* Region to look at */
+  int		hit;			/* Offset of contains() string */
   int		logic,			/* Logic to apply */
 		result;			/* Result of test */
   unsigned	intv;			/* Integer value */
@@ -1096,9 +1522,24 @@ mime_check_rules(
 	    else
 	      region = fb->length - rules->length;
 
-	    for (n = 0; n < region; n ++)
-	      if ((result = (memcmp(fb->buffer + rules->offset - fb->offset + n, rules->value.stringv, (size_t)rules->length) == 0)) != 0)
-		break;
+            if (fb->typing && fb->offset == 0 &&
+	        (n = mime_string_index(fb->typing, rules)) >= 0 &&
+		(hit = mime_scan_strings(fb, n, rules->offset + region +
+		                                rules->length - 1)) >= -1 &&
+		(hit < 0 || hit >= rules->offset))
+	    {
+	     /*
+	      * Use the first offset found by the string matcher...
+	      */
+
+	      result = hit >= 0 && hit < rules->offset + region;
+	    }
+	    else
+	    {
+	      for (n = 0; n < region; n ++)
+		if ((result = (memcmp(fb->buffer + rules->offset - fb->offset + n, rules->value.stringv, (size_t)rules->length) == 0)) != 0)
+		  break;
+	    }
           }
 	  break;
 
@@ -1141,6 +1582,95 @@ mime_check_rules(
 }
 
 
+/*
+ * 'mime_first_bytes()' - Get the possible first bytes of a matching file.
+ *
+ * Only string(), istring(), and char() rules at offset 0 limit the first
+ * byte; all other rules allow any value.
+ */
+
+static void
+mime_first_bytes(mime_magic_t  *rules,	/* I - Rules to check */
+                 unsigned char *set)	/* O - Bitset of first bytes */
+{
+  int		ch;			/* Current byte */
+  int		logic;			/* Logic to apply */
+  unsigned char	rset[32];		/* First bytes for current rule */
+
+
+  if (rules->parent == NULL)
+    logic = MIME_MAGIC_OR;
+  else
+    logic = rules->parent->op;
+
+  if (logic != MIME_MAGIC_AND && logic != MIME_MAGIC_OR)
+  {
+    memset(set, 255, sizeof(rset));
+    return;
+  }
+
+  memset(set, logic == MIME_MAGIC_AND ? 255 : 0, sizeof(rset));
+
+  for (; rules; rules = rules->next)
+  {
+    memset(rset, 255, sizeof(rset));
+
+    if (!rules->invert)
+    {
+      switch (rules->op)
+      {
+	case MIME_MAGIC_STRING :
+	case MIME_MAGIC_ISTRING :
+	    if (rules->offset == 0 && rules->length > 0)
+	    {
+	      memset(rset, 0, sizeof(rset));
+
+	      ch = rules->value.stringv[0] & 255;
+	      rset[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+
+	      if (rules->op == MIME_MAGIC_ISTRING)
+	      {
+		ch = _cups_tolower(ch);
+		rset[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+		ch = _cups_toupper(ch);
+		rset[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+	      }
+	    }
+	    break;
+
+	case MIME_MAGIC_CHAR :
+	    if (rules->offset == 0)
+	    {
+	      memset(rset, 0, sizeof(rset));
+
+	      ch = rules->value.charv;
+	      rset[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+	    }
+	    break;
+
+	case MIME_MAGIC_NOP :
+	case MIME_MAGIC_AND :
+	case MIME_MAGIC_OR :
+	    if (rules->child)
+	      mime_first_bytes(rules->child, rset);
+	    else
+	      memset(rset, 0, sizeof(rset));
+	    break;
+
+	default :
+	    break;
+      }
+    }
+
+    for (ch = 0; ch < 32; ch ++)
+      if (logic == MIME_MAGIC_AND)
+        set[ch] &= rset[ch];
+      else
+        set[ch] |= rset[ch];
+  }
+}
+
+
 /*
  * 'mime_patmatch()' - Pattern matching.
  */
@@ -1245,6 +1775,77 @@ mime_patmatch(const char *s,		/* I - String to match against */
 }
 
 
+/*
+ * 'mime_scan_strings()' - Find a contains() string in the file buffer.
+ *
+ * The buffer must hold the start of the file.  All of the strings are
+ * found in a single pass, which resumes where the previous call stopped.
+ */
+
+static int				/* O - Offset of string, -1 if not found, -2 on error */
+mime_scan_strings(_mime_filebuf_t *fb,	/* I - File buffer */
+                  int             string,/* I - String to find */
+		  int             end)	/* I - End of region to scan */
+{
+  int			i,		/* Looping var */
+			match;		/* Matching state */
+  _mime_typing_t	*typing = fb->typing;
+					/* Compiled type detection data */
+
+
+  if (!fb->hits)
+  {
+    if (typing->num_strings <= (int)(sizeof(fb->hitbuf) / sizeof(fb->hitbuf[0])))
+      fb->hits = fb->hitbuf;
+    else if ((fb->hits = malloc((size_t)typing->num_strings * sizeof(int))) == NULL)
+      return (-2);
+
+    for (i = 0; i < typing->num_strings; i ++)
+      fb->hits[i] = -1;
+  }
+
+  if (end > fb->length)
+    end = fb->length;
+
+  for (; fb->scanned < end && fb->hits[string] < 0; fb->scanned ++)
+  {
+    fb->state = typing->next[fb->state][fb->buffer[fb->scanned]];
+
+    for (match = typing->output[fb->state] >= 0 ? fb->state : typing->dict[fb->state];
+         match;
+	 match = typing->dict[match])
+      if (fb->hits[typing->output[match]] < 0)
+        fb->hits[typing->output[match]] = fb->scanned - typing->lengths[typing->output[match]] + 1;
+  }
+
+  return (fb->hits[string]);
+}
+
+
+/*
+ * 'mime_string_index()' - Find the unique string for a contains() rule.
+ */
+
+static int				/* O - String index or -1 */
+mime_string_index(
+    _mime_typing_t *typing,		/* I - Compiled type detection data */
+    mime_magic_t   *rule)		/* I - contains() rule */
+{
+  _mime_string_t	key,		/* Search key */
+			*match;		/* Matching rule */
+
+
+  key.rule = rule;
+
+  if ((match = bsearch(&key, typing->rules, (size_t)typing->num_rules,
+                       sizeof(_mime_string_t),
+		       (int (*)(const void *, const void *))mime_compare_strings)) != NULL)
+    return (match->string);
+  else
+    return (-1);
+}
+
+
 /*
  * End of "$Id: type.c 11645 2014-02-27 16:35:53Z msweet $".
  */
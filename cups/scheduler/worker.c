@@ -0,0 +1,476 @@
+/*
+ * "$Id$"
+ *
+ * Worker thread pool for the CUPS scheduler.
+ *
+ * Copyright 2014 by Apple Inc.
+ *
+ * These coded instructions, statements, and computer programs are the
+ * property of Apple Inc. and are protected by Federal copyright
+ * law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ * which should have been included with this file.  If this file is
+ * file is missing or damaged, see the license at "http://www.cups.org/".
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cupsd.h"
+#include <pthread.h>
+
+
+/*
+ * Design Notes for the Worker Thread Pool
+ * ---------------------------------------
+ *
+ * The scheduler state (printers, jobs, clients, policies, logs, etc.) is
+ * only ever accessed from the main thread.  The worker pool exists to move
+ * blocking or CPU-heavy work that does not touch that state - currently the
+ * reading and decoding of job control files - off of the main thread so that
+ * one slow request does not stall every other client.
+ *
+ * Work is queued with cupsdQueueWork().  The "work" callback runs on one of
+ * WorkerThreads threads and must only use the data it is given.  When it
+ * returns, the item is placed on the completion list and a byte is written
+ * to a pipe that is monitored by cupsdDoSelect(), which then calls the
+ * "done" callback from the main thread where it is safe to update the
+ * scheduler state.
+ *
+ * Each item has an owner (typically a client connection).  If the owner goes
+ * away before the work completes, cupsdCancelWork() clears the owner and the
+ * "done" callback is called with a NULL owner so that it can free the data.
+ *
+ * cupsdRunWork() is used while (re)loading the configuration, before the main
+ * loop is running.  It runs a batch of independent work items on temporary
+ * threads and returns once all of them are done, leaving the caller to merge
+ * the results in a fixed order.
+ */
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct _cupsd_work_s		/**** Work item ****/
+{
+  void			*owner;		/* Owner or NULL if canceled */
+  cupsd_workfunc_t	work_cb;	/* Function to run on worker thread */
+  cupsd_donefunc_t	done_cb;	/* Function to run on main thread */
+  void			*data;		/* Data pointer for callbacks */
+} _cupsd_work_t;
+
+typedef struct _cupsd_batch_s		/**** Batch of work for cupsdRunWork ****/
+{
+  pthread_mutex_t	mutex;		/* Mutex for next item */
+  cupsd_workfunc_t	work_cb;	/* Function to run */
+  void			**data;		/* Data for each item */
+  int			num_data,	/* Number of items */
+			next;		/* Next item to run */
+} _cupsd_batch_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*cupsd_work_active = NULL,
+					/* All outstanding work (main thread) */
+			*cupsd_work_queue = NULL,
+					/* Work waiting for a thread */
+			*cupsd_work_done = NULL;
+					/* Work waiting for completion */
+static pthread_mutex_t	cupsd_work_mutex = PTHREAD_MUTEX_INITIALIZER;
+					/* Mutex for queue and done lists */
+static pthread_cond_t	cupsd_work_cond = PTHREAD_COND_INITIALIZER;
+					/* Condition for new work */
+static pthread_t	*cupsd_work_threads = NULL;
+					/* Worker threads */
+static int		cupsd_num_threads = 0,
+					/* Number of worker threads */
+			cupsd_work_stop = 0,
+					/* Stop the worker threads? */
+			cupsd_work_pipes[2] = { -1, -1 };
+					/* Completion notification pipe */
+
+
+/*
+ * Local functions...
+ */
+
+static void		finish_work(void *data);
+static void		*run_batch(_cupsd_batch_t *batch);
+static void		*run_worker(void *data);
+
+
+/*
+ * 'cupsdCancelWork()' - Cancel all outstanding work for an owner.
+ *
+ * Work that is already running is allowed to complete, however the "done"
+ * callback is called with a NULL owner.
+ */
+
+void
+cupsdCancelWork(void *owner)		/* I - Owner of work */
+{
+  _cupsd_work_t	*item;			/* Current work item */
+
+
+  if (!owner)
+    return;
+
+  for (item = (_cupsd_work_t *)cupsArrayFirst(cupsd_work_active);
+       item;
+       item = (_cupsd_work_t *)cupsArrayNext(cupsd_work_active))
+    if (item->owner == owner)
+      item->owner = NULL;
+}
+
+
+/*
+ * 'cupsdQueueWork()' - Queue work for the worker threads.
+ *
+ * Returns 0 if the worker threads are not running, in which case the caller
+ * should do the work itself.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdQueueWork(void             *owner,	/* I - Owner of work */
+               cupsd_workfunc_t work_cb,/* I - Worker thread callback */
+	       cupsd_donefunc_t done_cb,/* I - Main thread callback */
+	       void             *data)	/* I - Data to pass to callbacks */
+{
+  _cupsd_work_t	*item;			/* New work item */
+
+
+  if (cupsd_num_threads <= 0 || !owner || !work_cb || !done_cb)
+    return (0);
+
+  if ((item = calloc(1, sizeof(_cupsd_work_t))) == NULL)
+    return (0);
+
+  item->owner   = owner;
+  item->work_cb = work_cb;
+  item->done_cb = done_cb;
+  item->data    = data;
+
+  cupsArrayAdd(cupsd_work_active, item);
+
+  pthread_mutex_lock(&cupsd_work_mutex);
+  cupsArrayAdd(cupsd_work_queue, item);
+  pthread_cond_signal(&cupsd_work_cond);
+  pthread_mutex_unlock(&cupsd_work_mutex);
+
+  return (1);
+}
+
+
+/*
+ * 'cupsdRunWork()' - Run a batch of work and wait for it to complete.
+ *
+ * Up to WorkerThreads threads are used, including the calling thread.  The
+ * work is run on the calling thread alone when WorkerThreads is 0.
+ */
+
+void
+cupsdRunWork(cupsd_workfunc_t work_cb,	/* I - Function to run for each item */
+             void             **data,	/* I - Data for each item */
+	     int              num_data)	/* I - Number of items */
+{
+  int			i,		/* Looping var */
+			num_threads,	/* Number of threads to start */
+			ret;		/* pthread_create() status */
+  pthread_t		threads[64];	/* Temporary threads */
+  _cupsd_batch_t	batch;		/* Batch of work */
+
+
+  if (num_data <= 0)
+    return;
+
+  batch.work_cb  = work_cb;
+  batch.data     = data;
+  batch.num_data = num_data;
+  batch.next     = 0;
+
+  pthread_mutex_init(&batch.mutex, NULL);
+
+  if ((num_threads = WorkerThreads - 1) > num_data - 1)
+    num_threads = num_data - 1;
+  if (num_threads > (int)(sizeof(threads) / sizeof(threads[0])))
+    num_threads = (int)(sizeof(threads) / sizeof(threads[0]));
+
+  for (i = 0; i < num_threads; i ++)
+    if ((ret = pthread_create(threads + i, NULL,
+                              (void *(*)(void *))run_batch, &batch)) != 0)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create worker thread: %s",
+                      strerror(ret));
+      break;
+    }
+
+  num_threads = i;
+
+  run_batch(&batch);
+
+  for (i = 0; i < num_threads; i ++)
+    pthread_join(threads[i], NULL);
+
+  pthread_mutex_destroy(&batch.mutex);
+}
+
+
+/*
+ * 'cupsdStartWorkers()' - Start the worker threads.
+ */
+
+void
+cupsdStartWorkers(void)
+{
+  int	i,				/* Looping var */
+	ret;				/* pthread_create() status */
+
+
+  if (WorkerThreads <= 0 || cupsd_num_threads > 0)
+    return;
+
+  if (cupsdOpenPipe(cupsd_work_pipes))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to create pipes for worker threads: %s",
+		    strerror(errno));
+    return;
+  }
+
+  fcntl(cupsd_work_pipes[0], F_SETFL,
+        fcntl(cupsd_work_pipes[0], F_GETFL) | O_NONBLOCK);
+  fcntl(cupsd_work_pipes[1], F_SETFL,
+        fcntl(cupsd_work_pipes[1], F_GETFL) | O_NONBLOCK);
+
+  cupsd_work_active  = cupsArrayNew(NULL, NULL);
+  cupsd_work_queue   = cupsArrayNew(NULL, NULL);
+  cupsd_work_done    = cupsArrayNew(NULL, NULL);
+  cupsd_work_stop    = 0;
+  cupsd_work_threads = calloc((size_t)WorkerThreads, sizeof(pthread_t));
+
+  if (!cupsd_work_active || !cupsd_work_queue || !cupsd_work_done ||
+      !cupsd_work_threads)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for worker threads.");
+    cupsdStopWorkers();
+    return;
+  }
+
+  for (i = 0; i < WorkerThreads; i ++)
+  {
+    if ((ret = pthread_create(cupsd_work_threads + i, NULL, run_worker,
+                              NULL)) != 0)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create worker thread: %s",
+                      strerror(ret));
+      break;
+    }
+
+    cupsd_num_threads ++;
+  }
+
+  if (cupsd_num_threads == 0)
+  {
+    cupsdStopWorkers();
+    return;
+  }
+
+  cupsdAddSelect(cupsd_work_pipes[0], (cupsd_selfunc_t)finish_work, NULL,
+                 NULL);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Started %d worker threads.",
+                  cupsd_num_threads);
+}
+
+
+/*
+ * 'cupsdStopWorkers()' - Stop the worker threads.
+ *
+ * Any outstanding work is canceled.
+ */
+
+void
+cupsdStopWorkers(void)
+{
+  int		i;			/* Looping var */
+  _cupsd_work_t	*item;			/* Current work item */
+
+
+  if (cupsd_num_threads > 0)
+  {
+    pthread_mutex_lock(&cupsd_work_mutex);
+    cupsd_work_stop = 1;
+    pthread_cond_broadcast(&cupsd_work_cond);
+    pthread_mutex_unlock(&cupsd_work_mutex);
+
+    for (i = 0; i < cupsd_num_threads; i ++)
+      pthread_join(cupsd_work_threads[i], NULL);
+
+    cupsd_num_threads = 0;
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Stopped worker threads.");
+  }
+
+  if (cupsd_work_threads)
+  {
+    free(cupsd_work_threads);
+    cupsd_work_threads = NULL;
+  }
+
+ /*
+  * No threads are running now, so release anything left over...
+  */
+
+  for (item = (_cupsd_work_t *)cupsArrayFirst(cupsd_work_active);
+       item;
+       item = (_cupsd_work_t *)cupsArrayNext(cupsd_work_active))
+  {
+    (*(item->done_cb))(NULL, item->data);
+    free(item);
+  }
+
+  cupsArrayDelete(cupsd_work_active);
+  cupsArrayDelete(cupsd_work_queue);
+  cupsArrayDelete(cupsd_work_done);
+
+  cupsd_work_active = NULL;
+  cupsd_work_queue  = NULL;
+  cupsd_work_done   = NULL;
+
+  if (cupsd_work_pipes[0] >= 0)
+  {
+    cupsdRemoveSelect(cupsd_work_pipes[0]);
+    cupsdClosePipe(cupsd_work_pipes);
+  }
+}
+
+
+/*
+ * 'finish_work()' - Call the "done" callbacks for completed work.
+ */
+
+static void
+finish_work(void *data)			/* I - Data (unused) */
+{
+  char		buffer[256];		/* Notification bytes */
+  cups_array_t	*done;			/* Completed work */
+  _cupsd_work_t	*item;			/* Current work item */
+
+
+  (void)data;
+
+ /*
+  * Drain the notification pipe...
+  */
+
+  while (read(cupsd_work_pipes[0], buffer, sizeof(buffer)) > 0);
+
+ /*
+  * Grab the completed work...
+  */
+
+  pthread_mutex_lock(&cupsd_work_mutex);
+  done            = cupsd_work_done;
+  cupsd_work_done = cupsArrayNew(NULL, NULL);
+  pthread_mutex_unlock(&cupsd_work_mutex);
+
+ /*
+  * Then finish each item, noting that a "done" callback may cancel the work
+  * for other owners...
+  */
+
+  for (item = (_cupsd_work_t *)cupsArrayFirst(done);
+       item;
+       item = (_cupsd_work_t *)cupsArrayNext(done))
+  {
+    cupsArrayRemove(cupsd_work_active, item);
+
+    (*(item->done_cb))(item->owner, item->data);
+
+    free(item);
+  }
+
+  cupsArrayDelete(done);
+}
+
+
+/*
+ * 'run_batch()' - Run items from a batch of work until none are left.
+ */
+
+static void *				/* O - Thread exit status */
+run_batch(_cupsd_batch_t *batch)	/* I - Batch of work */
+{
+  int	i;				/* Current item */
+
+
+  for (;;)
+  {
+    pthread_mutex_lock(&batch->mutex);
+    i = batch->next ++;
+    pthread_mutex_unlock(&batch->mutex);
+
+    if (i >= batch->num_data)
+      break;
+
+    (*(batch->work_cb))(batch->data[i]);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'run_worker()' - Run work items from the queue.
+ */
+
+static void *				/* O - Thread exit status */
+run_worker(void *data)			/* I - Data (unused) */
+{
+  _cupsd_work_t	*item;			/* Current work item */
+
+
+  (void)data;
+
+  pthread_mutex_lock(&cupsd_work_mutex);
+
+  while (!cupsd_work_stop)
+  {
+    if ((item = (_cupsd_work_t *)cupsArrayFirst(cupsd_work_queue)) == NULL)
+    {
+      pthread_cond_wait(&cupsd_work_cond, &cupsd_work_mutex);
+      continue;
+    }
+
+    cupsArrayRemove(cupsd_work_queue, item);
+    pthread_mutex_unlock(&cupsd_work_mutex);
+
+    (*(item->work_cb))(item->data);
+
+    pthread_mutex_lock(&cupsd_work_mutex);
+
+    if (cupsd_work_done)
+      cupsArrayAdd(cupsd_work_done, item);
+
+    if (write(cupsd_work_pipes[1], "", 1) < 0)
+    {
+     /*
+      * The pipe is full, which means a notification is already pending...
+      */
+    }
+  }
+
+  pthread_mutex_unlock(&cupsd_work_mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * End of "$Id$".
+ */
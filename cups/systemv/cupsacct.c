@@ -0,0 +1,589 @@
+/*
+ * "$Id$"
+ *
+ *   Page accounting report program for CUPS.
+ *
+ *   Copyright 2014 by Apple Inc.
+ *
+ *   These coded instructions, statements, and computer programs are the
+ *   property of Apple Inc. and are protected by Federal copyright
+ *   law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ *   which should have been included with this file.  If this file is
+ *   file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * Contents:
+ *
+ *   main()          - Parse options and report page counts.
+ *   compare_jobs()  - Compare two jobs.
+ *   compare_names() - Compare two cached strings.
+ *   compare_users() - Compare two users.
+ *   find_time()     - Find the first record at or after a time.
+ *   get_name()      - Get a string from the string table.
+ *   parse_date()    - Parse a date and time.
+ *   report()        - Report the pages printed on a printer.
+ *   usage()         - Show program usage.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include <cups/cups-private.h>
+#include <cups/accounting-private.h>
+#include <cups/dir.h>
+#include <fcntl.h>
+
+
+/*
+ * Local types...
+ */
+
+typedef struct acct_job_s		/**** Job in report ****/
+{
+  int		id;			/* job-id */
+  unsigned	user;			/* Offset of user name */
+  int		pages;			/* Number of pages */
+} acct_job_t;
+
+typedef struct acct_name_s		/**** Cached string ****/
+{
+  unsigned	offset;			/* Offset in string table */
+  char		name[256];		/* String */
+} acct_name_t;
+
+typedef struct acct_user_s		/**** User in report ****/
+{
+  const char	*name;			/* User name */
+  int		pages;			/* Number of pages */
+} acct_user_t;
+
+
+/*
+ * Local functions...
+ */
+
+static int	compare_jobs(acct_job_t *a, acct_job_t *b);
+static int	compare_names(acct_name_t *a, acct_name_t *b);
+static int	compare_users(acct_user_t *a, acct_user_t *b);
+static size_t	find_time(int fd, size_t num_records, long long t);
+static const char *get_name(int fd, cups_array_t *names, unsigned offset);
+static long long parse_date(const char *s);
+static int	report(const char *directory, const char *printer, int strfd,
+		       cups_array_t *names, cups_array_t *users,
+		       long long start, long long end);
+static void	usage(void) __attribute__((noreturn));
+
+
+/*
+ * 'main()' - Parse options and report page counts.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line args */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i;			/* Looping var */
+  const char	*opt,			/* Current option character */
+		*directory,		/* Accounting directory */
+		*printer;		/* Current printer */
+  cups_array_t	*printers,		/* Printers to report */
+		*users,			/* Users to report */
+		*names;			/* Cached strings */
+  long long	start,			/* Start of date range */
+		end;			/* End of date range */
+  char		filename[1024],		/* String table filename */
+		header[_CUPS_ACCT_HEADER];
+					/* String table header */
+  int		strfd,			/* String table file */
+		status = 0;		/* Exit status */
+  cups_dir_t	*dir;			/* Accounting directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  size_t	len;			/* Length of filename */
+
+
+ /*
+  * Process the command-line...
+  */
+
+  _cupsSetLocale(argv);
+
+  directory = CUPS_LOGDIR "/accounting";
+  printers  = _cupsArrayNewStrings(NULL, ',');
+  users     = NULL;
+  start     = 0;
+  end       = 0x7fffffffffffffffLL;
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (argv[i][0] != '-')
+      usage();
+
+    for (opt = argv[i] + 1; *opt; opt ++)
+      switch (*opt)
+      {
+	case 'd' : /* Accounting directory */
+	    i ++;
+	    if (i >= argc)
+	      usage();
+
+	    directory = argv[i];
+	    break;
+
+	case 'e' : /* End date */
+	    i ++;
+	    if (i >= argc)
+	      usage();
+
+	    if ((end = parse_date(argv[i])) < 0)
+	    {
+	      _cupsLangPrintf(stderr, _("cupsacct: Bad date \"%s\"."),
+	                      argv[i]);
+	      return (1);
+	    }
+	    break;
+
+	case 'p' : /* Printer */
+	    i ++;
+	    if (i >= argc)
+	      usage();
+
+	    _cupsArrayAddStrings(printers, argv[i], ',');
+	    break;
+
+	case 's' : /* Start date */
+	    i ++;
+	    if (i >= argc)
+	      usage();
+
+	    if ((start = parse_date(argv[i])) < 0)
+	    {
+	      _cupsLangPrintf(stderr, _("cupsacct: Bad date \"%s\"."),
+	                      argv[i]);
+	      return (1);
+	    }
+	    break;
+
+	case 'u' : /* User */
+	    i ++;
+	    if (i >= argc)
+	      usage();
+
+	    if (!users)
+	      users = _cupsArrayNewStrings(NULL, ',');
+
+	    _cupsArrayAddStrings(users, argv[i], ',');
+	    break;
+
+	default :
+	    _cupsLangPrintf(stderr, _("cupsacct: Unknown option \"%c\"."),
+	                    *opt);
+	    usage();
+      }
+  }
+
+ /*
+  * Open the string table...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/" _CUPS_ACCT_STRINGS, directory);
+
+  if ((strfd = open(filename, O_RDONLY)) < 0)
+  {
+    _cupsLangPrintf(stderr, _("cupsacct: Unable to open \"%s\": %s"),
+                    filename, strerror(errno));
+    return (1);
+  }
+
+  if (read(strfd, header, sizeof(header)) != sizeof(header) ||
+      memcmp(header, _CUPS_ACCT_STRMAGIC, 8))
+  {
+    _cupsLangPrintf(stderr, _("cupsacct: Bad page accounting file \"%s\"."),
+                    filename);
+    return (1);
+  }
+
+ /*
+  * Report all printers if none were specified...
+  */
+
+  if (cupsArrayCount(printers) == 0)
+  {
+    if ((dir = cupsDirOpen(directory)) == NULL)
+    {
+      _cupsLangPrintf(stderr, _("cupsacct: Unable to open \"%s\": %s"),
+		      directory, strerror(errno));
+      return (1);
+    }
+
+    while ((dent = cupsDirRead(dir)) != NULL)
+    {
+      len = strlen(dent->filename);
+
+      if (len > (sizeof(_CUPS_ACCT_SUFFIX) - 1) &&
+          !strcmp(dent->filename + len - (sizeof(_CUPS_ACCT_SUFFIX) - 1),
+	          _CUPS_ACCT_SUFFIX))
+      {
+        dent->filename[len - (sizeof(_CUPS_ACCT_SUFFIX) - 1)] = '\0';
+	cupsArrayAdd(printers, dent->filename);
+      }
+    }
+
+    cupsDirClose(dir);
+  }
+
+ /*
+  * Report the pages for each printer...
+  */
+
+  names = cupsArrayNew((cups_array_func_t)compare_names, NULL);
+
+  for (printer = (const char *)cupsArrayFirst(printers);
+       printer;
+       printer = (const char *)cupsArrayNext(printers))
+    if (!report(directory, printer, strfd, names, users, start, end))
+      status = 1;
+
+  close(strfd);
+
+  return (status);
+}
+
+
+/*
+ * 'compare_jobs()' - Compare two jobs.
+ */
+
+static int				/* O - Result of comparison */
+compare_jobs(acct_job_t *a,		/* I - First job */
+             acct_job_t *b)		/* I - Second job */
+{
+  return (a->id - b->id);
+}
+
+
+/*
+ * 'compare_names()' - Compare two cached strings.
+ */
+
+static int				/* O - Result of comparison */
+compare_names(acct_name_t *a,		/* I - First string */
+              acct_name_t *b)		/* I - Second string */
+{
+  if (a->offset < b->offset)
+    return (-1);
+  else
+    return (a->offset > b->offset);
+}
+
+
+/*
+ * 'compare_users()' - Compare two users.
+ */
+
+static int				/* O - Result of comparison */
+compare_users(acct_user_t *a,		/* I - First user */
+              acct_user_t *b)		/* I - Second user */
+{
+  return (strcmp(a->name, b->name));
+}
+
+
+/*
+ * 'find_time()' - Find the first record at or after a time.
+ */
+
+static size_t				/* O - Record number */
+find_time(int       fd,			/* I - Page file */
+          size_t    num_records,	/* I - Number of records */
+	  long long t)			/* I - Time to find */
+{
+  size_t	left,			/* Left side of search */
+		right,			/* Right side of search */
+		current;		/* Current record */
+  unsigned char	buffer[8];		/* Record time */
+  long long	rtime;			/* Record time */
+
+
+  for (left = 0, right = num_records; left < right;)
+  {
+    current = (left + right) / 2;
+
+    if (pread(fd, buffer, sizeof(buffer),
+              (off_t)(_CUPS_ACCT_HEADER + current * _CUPS_ACCT_RECORD +
+	              _CUPS_ACCT_TIME)) != sizeof(buffer))
+      break;
+
+    rtime = (long long)_CUPS_ACCT_GET32(buffer) << 32 |
+            _CUPS_ACCT_GET32(buffer + 4);
+
+    if (rtime < t)
+      left = current + 1;
+    else
+      right = current;
+  }
+
+  return (left);
+}
+
+
+/*
+ * 'get_name()' - Get a string from the string table.
+ */
+
+static const char *			/* O - String */
+get_name(int          fd,		/* I - String table */
+         cups_array_t *names,		/* I - Cached strings */
+	 unsigned     offset)		/* I - Offset in string table */
+{
+  acct_name_t	key,			/* Search key */
+		*name;			/* Cached string */
+
+
+  if (offset == 0)
+    return ("-");
+
+  key.offset = offset;
+
+  if ((name = (acct_name_t *)cupsArrayFind(names, &key)) != NULL)
+    return (name->name);
+
+  if ((name = calloc(1, sizeof(acct_name_t))) == NULL)
+    return ("-");
+
+  name->offset = offset;
+
+  if (pread(fd, name->name, sizeof(name->name) - 1, (off_t)offset) <= 0)
+    strlcpy(name->name, "-", sizeof(name->name));
+
+  cupsArrayAdd(names, name);
+
+  return (name->name);
+}
+
+
+/*
+ * 'parse_date()' - Parse a date and time.
+ *
+ * Dates are "YYYY-MM-DD" with an optional "THH:MM[:SS]" time in local time.
+ */
+
+static long long			/* O - UNIX time or -1 on error */
+parse_date(const char *s)		/* I - Date string */
+{
+  struct tm	date;			/* Date and time */
+  char		sep;			/* Date/time separator */
+  int		count;			/* Number of fields */
+  time_t	t;			/* UNIX time */
+
+
+  memset(&date, 0, sizeof(date));
+
+  count = sscanf(s, "%d-%d-%d%c%d:%d:%d", &date.tm_year, &date.tm_mon,
+                 &date.tm_mday, &sep, &date.tm_hour, &date.tm_min,
+		 &date.tm_sec);
+
+  if (count != 3 && (count < 6 || (sep != 'T' && sep != ' ')))
+    return (-1);
+
+  date.tm_year  -= 1900;
+  date.tm_mon   -= 1;
+  date.tm_isdst = -1;
+
+  if ((t = mktime(&date)) == (time_t)-1)
+    return (-1);
+
+  return ((long long)t);
+}
+
+
+/*
+ * 'report()' - Report the pages printed on a printer.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+report(const char   *directory,		/* I - Accounting directory */
+       const char   *printer,		/* I - Printer name */
+       int          strfd,		/* I - String table */
+       cups_array_t *names,		/* I - Cached strings */
+       cups_array_t *users,		/* I - Users to report or NULL */
+       long long    start,		/* I - Start time */
+       long long    end)		/* I - End time */
+{
+  char		filename[1024];		/* Page file */
+  int		fd;			/* Page file descriptor */
+  unsigned char	header[_CUPS_ACCT_HEADER],
+					/* File header */
+		buffer[1024 * _CUPS_ACCT_RECORD],
+					/* Records */
+		*record;		/* Current record */
+  ssize_t	bytes;			/* Bytes read */
+  struct stat	fileinfo;		/* Page file information */
+  size_t	num_records,		/* Number of records */
+		current;		/* Current record */
+  long long	rtime;			/* Record time */
+  cups_array_t	*jobs,			/* Jobs */
+		*totals;		/* Pages for each user */
+  acct_job_t	jkey,			/* Job search key */
+		*job;			/* Current job */
+  acct_user_t	ukey,			/* User search key */
+		*user;			/* Current user */
+
+
+  snprintf(filename, sizeof(filename), "%s/%s" _CUPS_ACCT_SUFFIX, directory,
+           printer);
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+  {
+    _cupsLangPrintf(stderr, _("cupsacct: Unable to open \"%s\": %s"),
+                    filename, strerror(errno));
+    return (0);
+  }
+
+  if (fstat(fd, &fileinfo) ||
+      read(fd, header, sizeof(header)) != sizeof(header) ||
+      memcmp(header, _CUPS_ACCT_MAGIC, 8) ||
+      _CUPS_ACCT_GET32(header + 8) != _CUPS_ACCT_VERSION ||
+      _CUPS_ACCT_GET32(header + 12) != _CUPS_ACCT_RECORD)
+  {
+    _cupsLangPrintf(stderr, _("cupsacct: Bad page accounting file \"%s\"."),
+                    filename);
+    close(fd);
+    return (0);
+  }
+
+ /*
+  * Find the first record in the date range and add up the pages for each job
+  * until we get to the end of the range...
+  */
+
+  num_records = (size_t)(fileinfo.st_size - _CUPS_ACCT_HEADER) /
+                _CUPS_ACCT_RECORD;
+  current     = find_time(fd, num_records, start);
+  jobs        = cupsArrayNew((cups_array_func_t)compare_jobs, NULL);
+  bytes       = 0;
+  record      = buffer;
+
+  for (; current < num_records; current ++, record += _CUPS_ACCT_RECORD)
+  {
+    if (record >= (buffer + bytes))
+    {
+      if ((bytes = pread(fd, buffer, sizeof(buffer),
+                         (off_t)(_CUPS_ACCT_HEADER +
+			         current * _CUPS_ACCT_RECORD))) <
+	      _CUPS_ACCT_RECORD)
+        break;
+
+      bytes  -= bytes % _CUPS_ACCT_RECORD;
+      record = buffer;
+    }
+
+    rtime = (long long)_CUPS_ACCT_GET32(record + _CUPS_ACCT_TIME) << 32 |
+            _CUPS_ACCT_GET32(record + _CUPS_ACCT_TIME + 4);
+
+    if (rtime >= end)
+      break;
+
+    jkey.id = (int)_CUPS_ACCT_GET32(record + _CUPS_ACCT_JOB_ID);
+
+    if ((job = (acct_job_t *)cupsArrayFind(jobs, &jkey)) == NULL)
+    {
+      if ((job = calloc(1, sizeof(acct_job_t))) == NULL)
+        break;
+
+      job->id   = jkey.id;
+      job->user = _CUPS_ACCT_GET32(record + _CUPS_ACCT_USER);
+
+      cupsArrayAdd(jobs, job);
+    }
+
+   /*
+    * Count pages the same way as the scheduler does for job-media-sheets-
+    * completed - a total replaces the count so far...
+    */
+
+    if (_CUPS_ACCT_GET32(record + _CUPS_ACCT_FLAGS) & _CUPS_ACCT_FLAG_TOTAL)
+      job->pages = (int)_CUPS_ACCT_GET32(record + _CUPS_ACCT_COPIES);
+    else
+      job->pages += (int)_CUPS_ACCT_GET32(record + _CUPS_ACCT_COPIES);
+  }
+
+  close(fd);
+
+ /*
+  * Add up the pages for each user...
+  */
+
+  totals = cupsArrayNew((cups_array_func_t)compare_users, NULL);
+
+  for (job = (acct_job_t *)cupsArrayFirst(jobs);
+       job;
+       job = (acct_job_t *)cupsArrayNext(jobs))
+  {
+    ukey.name = get_name(strfd, names, job->user);
+
+    if (users && !cupsArrayFind(users, (void *)ukey.name))
+      continue;
+
+    if ((user = (acct_user_t *)cupsArrayFind(totals, &ukey)) == NULL)
+    {
+      if ((user = calloc(1, sizeof(acct_user_t))) == NULL)
+        break;
+
+      user->name = ukey.name;
+
+      cupsArrayAdd(totals, user);
+    }
+
+    user->pages += job->pages;
+  }
+
+  for (user = (acct_user_t *)cupsArrayFirst(totals);
+       user;
+       user = (acct_user_t *)cupsArrayNext(totals))
+  {
+    _cupsLangPrintf(stdout, "%s %s %d", printer, user->name, user->pages);
+    free(user);
+  }
+
+  cupsArrayDelete(totals);
+
+  for (job = (acct_job_t *)cupsArrayFirst(jobs);
+       job;
+       job = (acct_job_t *)cupsArrayNext(jobs))
+    free(job);
+
+  cupsArrayDelete(jobs);
+
+  return (1);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  _cupsLangPuts(stdout, _("Usage: cupsacct [options]"));
+  _cupsLangPuts(stdout, "");
+  _cupsLangPuts(stdout, _("Options:"));
+  _cupsLangPuts(stdout, "");
+  _cupsLangPuts(stdout, _("  -d directory            Specify the accounting "
+                          "directory."));
+  _cupsLangPuts(stdout, _("  -e YYYY-MM-DD[THH:MM]   Report pages printed "
+                          "before the date."));
+  _cupsLangPuts(stdout, _("  -p printer[,...]        Report the named "
+                          "printers."));
+  _cupsLangPuts(stdout, _("  -s YYYY-MM-DD[THH:MM]   Report pages printed on "
+                          "or after the date."));
+  _cupsLangPuts(stdout, _("  -u user[,...]           Report the named "
+                          "users."));
+
+  exit(1);
+}
+
+
+/*
+ * End of "$Id$".
+ */